@@ -0,0 +1,82 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <open62541/types.h>
+#include "../include/ua_allocator.hpp"
+
+// Бенчмарк числа выделений памяти при декодировании ответа Read.
+// Сравнивает прямой malloc/free (только подсчёт) и кэш блоков потока.
+// Запуск: opcua_alloc_bench [число тегов] [число циклов]
+
+namespace {
+
+UA_ByteString encodeResponse(size_t tags) {
+    UA_ReadResponse resp;
+    UA_ReadResponse_init(&resp);
+    resp.results = (UA_DataValue*)UA_Array_new(tags, &UA_TYPES[UA_TYPES_DATAVALUE]);
+    resp.resultsSize = tags;
+    for (size_t i = 0; i < tags; ++i) {
+        UA_Double v = (double)i * 0.5;
+        UA_Variant_setScalarCopy(&resp.results[i].value, &v, &UA_TYPES[UA_TYPES_DOUBLE]);
+        resp.results[i].hasValue = true;
+        resp.results[i].sourceTimestamp = UA_DateTime_now();
+        resp.results[i].hasSourceTimestamp = true;
+        resp.results[i].serverTimestamp = UA_DateTime_now();
+        resp.results[i].hasServerTimestamp = true;
+    }
+    UA_ByteString buf = UA_BYTESTRING_NULL;
+    UA_encodeBinary(&resp, &UA_TYPES[UA_TYPES_READRESPONSE], &buf);
+    UA_ReadResponse_clear(&resp);
+    return buf;
+}
+
+void run(const char* label, bool caching, const UA_ByteString& buf, size_t tags, int cycles) {
+    UaAllocator::installForThisThread(caching);
+    std::vector<double> store(tags);
+
+    auto cycle = [&] {
+        UaAllocator::CycleScope scope;
+        UA_ReadResponse resp;
+        UA_decodeBinary(&buf, &resp, &UA_TYPES[UA_TYPES_READRESPONSE], nullptr);
+        for (size_t i = 0; i < resp.resultsSize && i < tags; ++i) {
+            store[i] = *(UA_Double*)resp.results[i].value.data;
+        }
+        UA_ReadResponse_clear(&resp);
+    };
+
+    for (int i = 0; i < 10; ++i) cycle();  // прогрев: кэш набирает блоки
+
+    UaAllocator::Stats before = UaAllocator::threadStats();
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < cycles; ++i) cycle();
+    auto t1 = std::chrono::steady_clock::now();
+    UaAllocator::Stats after = UaAllocator::threadStats();
+
+    double ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / cycles;
+    std::printf("%-12s requests/cycle %10.1f  heap allocs/cycle %10.3f  heap frees/cycle %10.3f  %10.0f ns/cycle\n",
+                label,
+                (double)(after.requests - before.requests) / cycles,
+                (double)(after.systemAllocs - before.systemAllocs) / cycles,
+                (double)(after.systemFrees - before.systemFrees) / cycles, ns);
+    UaAllocator::uninstallForThisThread();
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t tags = argc > 1 ? (size_t)std::atoi(argv[1]) : 1000;
+    int cycles = argc > 2 ? std::atoi(argv[2]) : 1000;
+
+    if (!UaAllocator::available()) {
+        std::printf("open62541 built without UA_ENABLE_MALLOC_SINGLETON: "
+                    "allocations bypass the hooks, counters stay at zero\n");
+    }
+
+    UA_ByteString buf = encodeResponse(tags);
+    std::printf("ReadResponse with %zu DataValues, %zu bytes, %d cycles\n", tags, buf.length, cycles);
+    run("malloc", false, buf, tags, cycles);
+    run("cached", true, buf, tags, cycles);
+    UA_ByteString_clear(&buf);
+    return 0;
+}
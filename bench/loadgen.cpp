@@ -0,0 +1,220 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <open62541/server.h>
+#include <open62541/server_config_default.h>
+#include "../include/load_profile.hpp"
+
+// Генератор нагрузки: встроенный сервер open62541 с переменными по профилю
+// (см. load_profile.hpp), значения которых меняются с заданной частотой и всплесками.
+// Запуск: opcua_loadgen [--port порт] [--profile файл] [--group "<строка профиля>"]...
+//                       [--tags-out файл] [--period мс] [--tick мс]
+// Без профиля — одна группа "group Load 1000 double rate=1".
+// --tags-out пишет конфигурацию тегов для клиента с периодом опроса --period.
+// Метка времени источника — момент записи, поэтому клиент может считать
+// задержку доставки по ней (сервер и клиент на одной машине или с синхронизацией часов)
+
+namespace {
+
+UA_Boolean running = true;
+void onSignal(int) { running = false; }
+
+const UA_DataType* uaType(LoadGroup::Type type) {
+    switch (type) {
+    case LoadGroup::BOOL: return &UA_TYPES[UA_TYPES_BOOLEAN];
+    case LoadGroup::INT32: return &UA_TYPES[UA_TYPES_INT32];
+    case LoadGroup::INT64: return &UA_TYPES[UA_TYPES_INT64];
+    case LoadGroup::FLOAT: return &UA_TYPES[UA_TYPES_FLOAT];
+    case LoadGroup::DOUBLE: return &UA_TYPES[UA_TYPES_DOUBLE];
+    case LoadGroup::STRING: return &UA_TYPES[UA_TYPES_STRING];
+    }
+    return &UA_TYPES[UA_TYPES_DOUBLE];
+}
+
+struct Generator {
+    UA_Server* server;
+    std::vector<LoadGroup> groups;
+    LoadSchedule schedule;
+    std::chrono::steady_clock::time_point start;
+    std::vector<LoadSchedule::Change> changes;
+    // Значение собирается в общих буферах: запись в сервер его копирует
+    std::vector<uint8_t> values;
+    std::vector<std::string> texts;
+    std::vector<UA_String> strings;
+    uint64_t written;
+    uint64_t failed;
+    uint64_t reported;
+
+    explicit Generator(const std::vector<LoadGroup>& g)
+        : server(nullptr), groups(g), schedule(g), start(std::chrono::steady_clock::now()),
+          written(0), failed(0), reported(0) {}
+
+    // Каждое изменение отличается от предыдущего; элементы массива — синусоида со сдвигом фазы
+    void fill(const LoadGroup& g, uint32_t index, uint64_t round, UA_Variant& out) {
+        const UA_DataType* type = uaType(g.type);
+        size_t n = g.arraySize > 0 ? g.arraySize : 1;
+        values.resize(n * type->memSize);
+        if (g.type == LoadGroup::STRING) {
+            texts.resize(n);
+            strings.resize(n);
+        }
+        double phase = index * 0.37 + (double)round * 0.1;
+        for (size_t k = 0; k < n; ++k) {
+            double wave = 100.0 * std::sin(phase + 6.283185307179586 * (double)k / (double)n);
+            void* at = values.data() + k * type->memSize;
+            switch (g.type) {
+            case LoadGroup::BOOL: *(UA_Boolean*)at = ((round + index + k) & 1) != 0; break;
+            case LoadGroup::INT32:
+                *(UA_Int32*)at = g.arraySize ? (UA_Int32)(wave * 10) : (UA_Int32)(round * 7 + index);
+                break;
+            case LoadGroup::INT64:
+                *(UA_Int64*)at = g.arraySize ? (UA_Int64)(wave * 10) : (UA_Int64)(round * 7 + index);
+                break;
+            case LoadGroup::FLOAT: *(UA_Float*)at = (UA_Float)wave; break;
+            case LoadGroup::DOUBLE: *(UA_Double*)at = wave; break;
+            case LoadGroup::STRING:
+                texts[k] = g.name + "." + std::to_string(index) + "#" + std::to_string(round);
+                strings[k] = UA_String{texts[k].size(), (UA_Byte*)texts[k].data()};
+                break;
+            }
+        }
+        void* data = g.type == LoadGroup::STRING ? (void*)strings.data() : (void*)values.data();
+        if (g.arraySize > 0) UA_Variant_setArray(&out, data, n, type);
+        else UA_Variant_setScalar(&out, data, type);
+    }
+
+    void addNodes() {
+        size_t total = loadVariableCount(groups), added = 0;
+        for (const auto& g : groups) {
+            UA_ObjectAttributes folder = UA_ObjectAttributes_default;
+            folder.displayName = UA_LOCALIZEDTEXT((char*)"", (char*)g.name.c_str());
+            UA_NodeId folder_id = UA_NODEID_STRING(1, (char*)g.name.c_str());
+            UA_Server_addObjectNode(server, folder_id, UA_NODEID_NUMERIC(0, UA_NS0ID_OBJECTSFOLDER),
+                                    UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES),
+                                    UA_QUALIFIEDNAME(1, (char*)g.name.c_str()),
+                                    UA_NODEID_NUMERIC(0, UA_NS0ID_FOLDERTYPE), folder, nullptr, nullptr);
+
+            UA_UInt32 dims[1] = {g.arraySize};
+            for (uint32_t i = 0; i < g.count; ++i) {
+                std::string name = loadTagName(g, i);
+                UA_VariableAttributes attr = UA_VariableAttributes_default;
+                attr.displayName = UA_LOCALIZEDTEXT((char*)"", (char*)name.c_str());
+                attr.dataType = uaType(g.type)->typeId;
+                attr.accessLevel = UA_ACCESSLEVELMASK_READ | UA_ACCESSLEVELMASK_WRITE;
+                if (g.arraySize > 0) {
+                    attr.valueRank = UA_VALUERANK_ONE_DIMENSION;
+                    attr.arrayDimensions = dims;
+                    attr.arrayDimensionsSize = 1;
+                } else {
+                    attr.valueRank = UA_VALUERANK_SCALAR;
+                }
+                fill(g, i, 0, attr.value);
+                UA_StatusCode rc = UA_Server_addVariableNode(
+                    server, UA_NODEID_NUMERIC(1, g.firstId + i), folder_id,
+                    UA_NODEID_NUMERIC(0, UA_NS0ID_HASCOMPONENT), UA_QUALIFIEDNAME(1, (char*)name.c_str()),
+                    UA_NODEID_NUMERIC(0, UA_NS0ID_BASEDATAVARIABLETYPE), attr, nullptr, nullptr);
+                if (rc != UA_STATUSCODE_GOOD) {
+                    std::fprintf(stderr, "Cannot add %s: %s\n", name.c_str(), UA_StatusCode_name(rc));
+                    ++failed;
+                }
+                if (++added % 100000 == 0) std::fprintf(stderr, "added %zu of %zu variables\n", added, total);
+            }
+        }
+    }
+
+    void tick() {
+        uint64_t now_ms = (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start).count();
+        changes.clear();
+        schedule.advance(now_ms, changes);
+        UA_DataValue dv;
+        UA_DataValue_init(&dv);
+        dv.hasValue = true;
+        dv.sourceTimestamp = UA_DateTime_now();
+        dv.hasSourceTimestamp = true;
+        for (const auto& c : changes) {
+            const LoadGroup& g = groups[c.group];
+            fill(g, c.index, c.round + 1, dv.value);
+            if (UA_Server_writeDataValue(server, UA_NODEID_NUMERIC(1, g.firstId + c.index), dv) ==
+                UA_STATUSCODE_GOOD) {
+                ++written;
+            } else {
+                ++failed;
+            }
+        }
+    }
+
+    void report() {
+        double target = 0;
+        for (const auto& g : groups) target += g.averageRate() * g.count;
+        std::fprintf(stderr, "changes/s %llu (target avg %.0f)  skipped %llu  failed %llu\n",
+                     (unsigned long long)(written - reported), target,
+                     (unsigned long long)schedule.skipped(), (unsigned long long)failed);
+        reported = written;
+    }
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int port = 4840;
+    std::string profile_file;
+    std::string inline_profile;
+    std::string tags_out;
+    int period_ms = 500;
+    int tick_ms = 10;
+    for (int i = 1; i + 1 < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--port") port = std::stoi(argv[++i]);
+        else if (arg == "--profile") profile_file = argv[++i];
+        else if (arg == "--group") inline_profile += std::string("group ") + argv[++i] + "\n";
+        else if (arg == "--tags-out") tags_out = argv[++i];
+        else if (arg == "--period") period_ms = std::stoi(argv[++i]);
+        else if (arg == "--tick") tick_ms = std::max(1, std::stoi(argv[++i]));
+    }
+
+    std::vector<LoadGroup> groups;
+    std::string error;
+    bool ok;
+    if (!profile_file.empty()) ok = loadLoadProfile(profile_file, groups, &error);
+    else ok = parseLoadProfile(inline_profile.empty() ? "group Load 1000 double rate=1\n" : inline_profile,
+                               groups, &error);
+    if (!ok) {
+        std::fprintf(stderr, "Bad load profile: %s\n", error.c_str());
+        return 1;
+    }
+    if (!tags_out.empty() && !writeLoadTagConfig(groups, tags_out, (uint32_t)period_ms)) {
+        std::fprintf(stderr, "Cannot write %s\n", tags_out.c_str());
+        return 1;
+    }
+
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+
+    UA_Server* server = UA_Server_new();
+    UA_ServerConfig* config = UA_Server_getConfig(server);
+    UA_ServerConfig_setMinimal(config, (UA_UInt16)port, nullptr);
+    // Ограничения сервера не должны стать узким местом раньше клиента:
+    // один Read может запросить все переменные профиля
+    config->maxNodesPerRead = 0;
+    config->tcpMaxMsgSize = 0;
+    config->tcpMaxChunks = 0;
+
+    Generator gen(groups);
+    gen.server = server;
+    gen.addNodes();
+    std::fprintf(stderr, "serving %zu variables on port %d\n", loadVariableCount(groups), port);
+
+    gen.start = std::chrono::steady_clock::now();
+    UA_Server_addRepeatedCallback(server, [](UA_Server*, void* data) { ((Generator*)data)->tick(); },
+                                  &gen, tick_ms, nullptr);
+    UA_Server_addRepeatedCallback(server, [](UA_Server*, void* data) { ((Generator*)data)->report(); },
+                                  &gen, 1000, nullptr);
+    UA_StatusCode rc = UA_Server_run(server, &running);
+    UA_Server_delete(server);
+    return rc == UA_STATUSCODE_GOOD ? 0 : 1;
+}
@@ -0,0 +1,243 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <open62541/server.h>
+#include <open62541/server_config_default.h>
+#include <open62541/server_pubsub.h>
+#include "../include/latency_histogram.hpp"
+#include "../include/opcua_client.hpp"
+#include "../include/pubsub_source.hpp"
+
+// Проверка приёма PubSub через петлю: в этом же процессе поднимается издатель
+// (встроенный сервер open62541 с WriterGroup), который шлёт UADP NetworkMessage
+// с --fields полями каждые --interval мс; приём — PubSubSource в хранилище тегов.
+// Поле Clock — микросекунды монотонных часов в момент выборки издателем, по нему
+// считается задержка до приёмника. Остальные поля — синусоиды.
+// Запуск: opcua_pubsub_bench [--url opc.udp://224.0.0.22:4840] [--interface имя]
+//                            [--fields 16] [--interval 1] [--seconds 10]
+// Тот же издатель без приёма (для проверки монитора или коллектора): --publish-only;
+// строки для файла тегов печатаются при запуске
+
+namespace {
+
+const UA_UInt16 PUBLISHER_ID = 2234;
+const UA_UInt16 WRITER_GROUP_ID = 100;
+const UA_UInt16 DATASET_WRITER_ID = 62541;
+
+const auto EPOCH = std::chrono::steady_clock::now();
+std::atomic<uint64_t> samples_published(0);
+
+double clockMicros() {
+    return (double)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - EPOCH)
+        .count();
+}
+
+// Значение поля считается при каждой выборке издателя
+UA_StatusCode readField(UA_Server*, const UA_NodeId*, void*, const UA_NodeId*, void* context, UA_Boolean,
+                        const UA_NumericRange*, UA_DataValue* value) {
+    size_t index = (size_t)(uintptr_t)context;
+    UA_Double v;
+    if (index == 0) {
+        samples_published.fetch_add(1, std::memory_order_relaxed);
+        v = clockMicros();
+    } else {
+        v = std::sin(clockMicros() / 1e6 * 2 * M_PI * (double)index);
+    }
+    UA_Variant_setScalarCopy(&value->value, &v, &UA_TYPES[UA_TYPES_DOUBLE]);
+    value->hasValue = true;
+    return UA_STATUSCODE_GOOD;
+}
+
+std::string fieldName(size_t index) {
+    return index == 0 ? "Clock" : "F" + std::to_string(index);
+}
+
+struct Publisher {
+    UA_Server* server;
+    volatile UA_Boolean running;
+    std::thread thread;
+
+    Publisher() : server(nullptr), running(true) {}
+
+    bool start(const std::string& url, const std::string& iface, size_t fields, double intervalMs) {
+        server = UA_Server_new();
+        UA_ServerConfig* config = UA_Server_getConfig(server);
+        UA_ServerConfig_setMinimal(config, 0, nullptr);
+        config->tcpEnabled = false;
+
+        UA_PubSubConnectionConfig cc;
+        std::memset(&cc, 0, sizeof(cc));
+        cc.name = UA_STRING((char*)"bench publisher");
+        cc.enabled = true;
+        cc.transportProfileUri = UA_STRING((char*)"http://opcfoundation.org/UA-Profile/Transport/pubsub-udp-uadp");
+        UA_NetworkAddressUrlDataType address = {UA_STRING((char*)iface.c_str()), UA_STRING((char*)url.c_str())};
+        UA_Variant_setScalar(&cc.address, &address, &UA_TYPES[UA_TYPES_NETWORKADDRESSURLDATATYPE]);
+        cc.publisherIdType = UA_PUBLISHERIDTYPE_UINT16;
+        cc.publisherId.uint16 = PUBLISHER_ID;
+        UA_NodeId connection_id, pds_id, group_id, writer_id;
+        if (UA_Server_addPubSubConnection(server, &cc, &connection_id) != UA_STATUSCODE_GOOD) return false;
+
+        UA_PublishedDataSetConfig pds;
+        std::memset(&pds, 0, sizeof(pds));
+        pds.publishedDataSetType = UA_PUBSUB_DATASET_PUBLISHEDITEMS;
+        pds.name = UA_STRING((char*)"bench dataset");
+        if (UA_Server_addPublishedDataSet(server, &pds, &pds_id).addResult != UA_STATUSCODE_GOOD) return false;
+
+        for (size_t i = 0; i < fields; ++i) {
+            std::string name = fieldName(i);
+            UA_VariableAttributes attr = UA_VariableAttributes_default;
+            attr.dataType = UA_TYPES[UA_TYPES_DOUBLE].typeId;
+            attr.displayName = UA_LOCALIZEDTEXT((char*)"", (char*)name.c_str());
+            UA_DataSource source;
+            source.read = readField;
+            source.write = nullptr;
+            UA_NodeId node = UA_NODEID_NUMERIC(1, (UA_UInt32)i + 1);
+            UA_Server_addDataSourceVariableNode(server, node, UA_NODEID_NUMERIC(0, UA_NS0ID_OBJECTSFOLDER),
+                                                UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES),
+                                                UA_QUALIFIEDNAME(1, (char*)name.c_str()),
+                                                UA_NODEID_NUMERIC(0, UA_NS0ID_BASEDATAVARIABLETYPE), attr, source,
+                                                (void*)(uintptr_t)i, nullptr);
+            UA_DataSetFieldConfig fc;
+            std::memset(&fc, 0, sizeof(fc));
+            fc.dataSetFieldType = UA_PUBSUB_DATASETFIELD_VARIABLE;
+            fc.field.variable.fieldNameAlias = UA_STRING((char*)name.c_str());
+            fc.field.variable.publishParameters.publishedVariable = node;
+            fc.field.variable.publishParameters.attributeId = UA_ATTRIBUTEID_VALUE;
+            if (UA_Server_addDataSetField(server, pds_id, &fc, nullptr).result != UA_STATUSCODE_GOOD) return false;
+        }
+
+        UA_WriterGroupConfig wg;
+        std::memset(&wg, 0, sizeof(wg));
+        wg.name = UA_STRING((char*)"bench writer group");
+        wg.publishingInterval = intervalMs;
+        wg.writerGroupId = WRITER_GROUP_ID;
+        wg.encodingMimeType = UA_PUBSUB_ENCODING_UADP;
+        UA_UadpWriterGroupMessageDataType message;
+        UA_UadpWriterGroupMessageDataType_init(&message);
+        message.networkMessageContentMask =
+            (UA_UadpNetworkMessageContentMask)(UA_UADPNETWORKMESSAGECONTENTMASK_PUBLISHERID |
+                                               UA_UADPNETWORKMESSAGECONTENTMASK_GROUPHEADER |
+                                               UA_UADPNETWORKMESSAGECONTENTMASK_WRITERGROUPID |
+                                               UA_UADPNETWORKMESSAGECONTENTMASK_PAYLOADHEADER);
+        wg.messageSettings.encoding = UA_EXTENSIONOBJECT_DECODED;
+        wg.messageSettings.content.decoded.type = &UA_TYPES[UA_TYPES_UADPWRITERGROUPMESSAGEDATATYPE];
+        wg.messageSettings.content.decoded.data = &message;
+        if (UA_Server_addWriterGroup(server, connection_id, &wg, &group_id) != UA_STATUSCODE_GOOD) return false;
+
+        UA_DataSetWriterConfig dw;
+        std::memset(&dw, 0, sizeof(dw));
+        dw.name = UA_STRING((char*)"bench writer");
+        dw.dataSetWriterId = DATASET_WRITER_ID;
+        // Только ключевые кадры: дельта-кадры приёмник open62541 не разбирает
+        dw.keyFrameCount = 1;
+        if (UA_Server_addDataSetWriter(server, group_id, pds_id, &dw, &writer_id) != UA_STATUSCODE_GOOD) return false;
+        if (UA_Server_setWriterGroupOperational(server, group_id) != UA_STATUSCODE_GOOD) return false;
+
+        thread = std::thread([this] { UA_Server_run(server, &running); });
+        return true;
+    }
+
+    ~Publisher() {
+        running = false;
+        if (thread.joinable()) thread.join();
+        if (server) UA_Server_delete(server);
+    }
+};
+
+// Задержка от выборки издателем до приёмника хранилища
+class ClockSink : public OPCUAClient::ValueSink {
+public:
+    ClockSink() : clock_slot(0), messages(0) {}
+
+    void onValueChanged(size_t slot, const OPCUAClient::TagData& tag, const UA_DataValue&) override {
+        if (slot != clock_slot) return;
+        messages.fetch_add(1, std::memory_order_relaxed);
+        double age = clockMicros() - tag.value;
+        if (age >= 0) latency.record((uint64_t)(age * 1000));
+    }
+
+    size_t clock_slot;
+    std::atomic<uint64_t> messages;
+    LatencyHistogram latency;
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string url = "opc.udp://224.0.0.22:4840";
+    std::string iface;
+    size_t fields = 16;
+    double interval_ms = 1;
+    int seconds = 10;
+    bool publish_only = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--publish-only") publish_only = true;
+        else if (i + 1 >= argc) break;
+        else if (arg == "--url") url = argv[++i];
+        else if (arg == "--interface") iface = argv[++i];
+        else if (arg == "--fields") fields = (size_t)std::max(1, std::stoi(argv[++i]));
+        else if (arg == "--interval") interval_ms = std::max(0.1, std::stod(argv[++i]));
+        else if (arg == "--seconds") seconds = std::max(1, std::stoi(argv[++i]));
+    }
+
+    std::printf("pubsub bench %s%s%s\n", url.c_str(), iface.empty() ? "" : " ", iface.c_str());
+    std::printf("reader bench bench %u %u %u\n", PUBLISHER_ID, WRITER_GROUP_ID, DATASET_WRITER_ID);
+    for (size_t i = 0; i < fields; ++i) std::printf("field %s bench double\n", fieldName(i).c_str());
+    std::fflush(stdout);
+
+    Publisher publisher;
+    if (!publisher.start(url, iface, fields, interval_ms)) {
+        std::fprintf(stderr, "Cannot start publisher on %s\n", url.c_str());
+        return 1;
+    }
+    if (publish_only) {
+        std::this_thread::sleep_for(std::chrono::seconds(seconds));
+        std::printf("published %llu messages\n", (unsigned long long)samples_published.load());
+        return 0;
+    }
+
+    OPCUAClient client;
+    client.clearTags();
+    auto sink = std::make_shared<ClockSink>();
+    client.addSink(sink);
+    PubSubConfig config;
+    config.connections.push_back({"bench", url, iface});
+    config.readers.push_back({"bench", "bench", PUBLISHER_ID, WRITER_GROUP_ID, DATASET_WRITER_ID});
+    for (size_t i = 0; i < fields; ++i) config.fields.push_back({fieldName(i), "bench", UA_TYPES_DOUBLE});
+    PubSubSource source(client);
+    std::string error;
+    if (!source.configure(config, &error) || !source.start(&error)) {
+        std::fprintf(stderr, "Cannot start PubSub receiver: %s\n", error.c_str());
+        return 1;
+    }
+
+    // Первая секунда — разгон: сокеты, первые сообщения
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+    uint64_t published0 = samples_published.load();
+    uint64_t messages0 = sink->messages.load();
+    uint64_t values0 = source.received();
+    uint64_t batches0 = source.batches();
+    sink->latency.reset();
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    uint64_t published = samples_published.load() - published0;
+    uint64_t messages = sink->messages.load() - messages0;
+    uint64_t values = source.received() - values0;
+    uint64_t batches = source.batches() - batches0;
+    source.stop();
+
+    std::printf("published %llu messages, delivered %llu (%.2f%%), %.0f values/s, %.1f values per batch\n",
+                (unsigned long long)published, (unsigned long long)messages,
+                published ? 100.0 * (double)messages / (double)published : 0.0, (double)values / seconds,
+                batches ? (double)values / (double)batches : 0.0);
+    std::printf("latency p50 %s  p99 %s  p99.9 %s\n", formatNanos(sink->latency.percentile(0.5)).c_str(),
+                formatNanos(sink->latency.percentile(0.99)).c_str(),
+                formatNanos(sink->latency.percentile(0.999)).c_str());
+    return 0;
+}
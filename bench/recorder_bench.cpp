@@ -0,0 +1,87 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../include/recorder.hpp"
+
+// Бенчмарк стоимости записи сессии: поток изменений с заданной частотой
+// пачками по 10 мс (как цикл опроса), с записью и без. Процессорное время
+// считается по всему процессу, то есть вместе с потоком записи.
+// Запуск: opcua_recorder_bench [число тегов] [изменений в секунду] [секунд] [файл]
+
+namespace {
+
+struct Result {
+    double cpu_seconds;
+    double wall_seconds;
+};
+
+Result run(SessionRecorder* rec, std::vector<OPCUAClient::TagData>& tags, size_t rate, int seconds) {
+    const size_t per_cycle = rate / 100;
+    const int cycles = seconds * 100;
+    uint64_t n = 0;
+    // Каждый тег — случайное блуждание с шагом квантования 0.01, как у аналогового входа
+    std::vector<int32_t> level(tags.size(), 2000);
+    uint32_t seed = 12345;
+    std::clock_t c0 = std::clock();
+    auto t0 = std::chrono::steady_clock::now();
+    for (int cycle = 0; cycle < cycles; ++cycle) {
+        UA_DateTime source = UA_DateTime_now();
+        for (size_t k = 0; k < per_cycle; ++k, ++n) {
+            size_t slot = (size_t)(n % tags.size());
+            seed = seed * 1664525u + 1013904223u;
+            level[slot] += (int32_t)(seed >> 29) - 3;
+            double v = (double)level[slot] * 0.01;
+            UA_DataValue dv;
+            UA_DataValue_init(&dv);
+            UA_Variant_setScalar(&dv.value, &v, &UA_TYPES[UA_TYPES_DOUBLE]);
+            dv.hasValue = true;
+            dv.sourceTimestamp = source;
+            dv.hasSourceTimestamp = true;
+            tags[slot].value = v;
+            if (rec) rec->onValueChanged(slot, tags[slot], dv);
+        }
+        if (rec) rec->onCycleEnd();
+        std::this_thread::sleep_until(t0 + std::chrono::milliseconds(10 * (cycle + 1)));
+    }
+    if (rec) rec->close();
+    Result r;
+    r.cpu_seconds = (double)(std::clock() - c0) / CLOCKS_PER_SEC;
+    r.wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    return r;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t tag_count = argc > 1 ? (size_t)std::atol(argv[1]) : 10000;
+    size_t rate = argc > 2 ? (size_t)std::atol(argv[2]) : 100000;
+    int seconds = argc > 3 ? std::atoi(argv[3]) : 5;
+    std::string path = argc > 4 ? argv[4] : "recorder_bench.rec";
+
+    std::vector<OPCUAClient::TagData> tags;
+    for (size_t i = 0; i < tag_count; ++i) {
+        tags.emplace_back("Tag" + std::to_string(i), "ns=1;i=" + std::to_string(i));
+    }
+
+    Result base = run(nullptr, tags, rate, seconds);
+    SessionRecorder rec;
+    if (!rec.open(path, tags)) {
+        std::fprintf(stderr, "Cannot open %s\n", path.c_str());
+        return 1;
+    }
+    Result with = run(&rec, tags, rate, seconds);
+
+    uint64_t file_bytes = std::filesystem::file_size(path);
+    double added = (with.cpu_seconds / with.wall_seconds - base.cpu_seconds / base.wall_seconds) * 100.0;
+    std::printf("changes/s %zu  recorded %llu  dropped %llu\n", rate,
+                (unsigned long long)rec.recorded(), (unsigned long long)rec.dropped());
+    std::printf("cpu without %.2f%%  with %.2f%%  added %.2f%% of one core\n",
+                base.cpu_seconds / base.wall_seconds * 100.0, with.cpu_seconds / with.wall_seconds * 100.0, added);
+    std::printf("file %.1f bytes/change\n", rec.recorded() ? (double)file_bytes / (double)rec.recorded() : 0.0);
+    return 0;
+}
@@ -0,0 +1,244 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+#include "../include/load_profile.hpp"
+#include "../include/opcua_client.hpp"
+
+// Прогон сценария нагрузки против opcua_loadgen с тем же профилем:
+// клиент (opcua_logic) опрашивает всё больше переменных, пока не перестанет успевать.
+// На каждой ступени считаются доставленные изменения против ожидаемых по профилю,
+// длительность цикла опроса, возраст значения при приёме (по метке источника)
+// и занятая процессом память. Ступень насыщена, если доставлено меньше 95%
+// ожидаемого или p99 цикла опроса дольше периода; на ней прогон останавливается.
+// Запуск: opcua_scenario --profile файл [--url адрес] [--stages 1000,10000,100000,1000000]
+//                        [--seconds 20] [--warmup 3] [--period мс] [--csv файл] [--keep-going]
+
+namespace {
+
+// Приёмник считает изменения и возраст значений; вызывается в потоке опроса
+class ScenarioSink : public OPCUAClient::ValueSink {
+public:
+    ScenarioSink() : changes(0), cycles(0), cycle_now(0) {}
+
+    void onValueChanged(size_t, const OPCUAClient::TagData&, const UA_DataValue& dv) override {
+        changes.fetch_add(1, std::memory_order_relaxed);
+        if (!dv.hasSourceTimestamp) return;
+        if (cycle_now == 0) cycle_now = UA_DateTime_now();
+        if (cycle_now > dv.sourceTimestamp) age.record((uint64_t)(cycle_now - dv.sourceTimestamp) * 100);
+    }
+    void onCycleEnd() override {
+        cycle_now = 0;
+        cycles.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void reset() {
+        changes = 0;
+        age.reset();
+    }
+
+    std::atomic<uint64_t> changes;
+    std::atomic<uint64_t> cycles;
+    LatencyHistogram age;
+
+private:
+    UA_DateTime cycle_now;
+};
+
+struct StageResult {
+    size_t tags;
+    double expected;
+    double delivered;
+    uint64_t poll_p50;
+    uint64_t poll_p99;
+    uint64_t age_p50;
+    uint64_t age_p99;
+    double rss_mb;
+    double peak_mb;
+    bool saturated;
+};
+
+double residentMb() {
+#ifdef __linux__
+    std::ifstream statm("/proc/self/statm");
+    unsigned long long pages = 0, resident = 0;
+    if (statm >> pages >> resident) return (double)resident * (double)sysconf(_SC_PAGESIZE) / (1 << 20);
+#endif
+    return 0;
+}
+
+double peakMb() {
+#if defined(__unix__) || defined(__APPLE__)
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#ifdef __APPLE__
+        return (double)usage.ru_maxrss / (1 << 20);
+#else
+        return (double)usage.ru_maxrss / 1024;
+#endif
+    }
+#endif
+    return 0;
+}
+
+std::vector<size_t> parseStages(const std::string& text) {
+    std::vector<size_t> stages;
+    std::stringstream in(text);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        if (!item.empty()) stages.push_back((size_t)std::stoull(item));
+    }
+    return stages;
+}
+
+// Ожидаемые изменения в секунду для первых tags переменных профиля
+double expectedRate(const std::vector<LoadGroup>& groups, size_t tags, uint32_t periodMs) {
+    double rate = 0;
+    for (const auto& g : groups) {
+        size_t n = std::min<size_t>(tags, g.count);
+        rate += g.observableRate(periodMs) * (double)n;
+        tags -= n;
+    }
+    return rate;
+}
+
+void loadStage(OPCUAClient& client, const std::vector<LoadGroup>& groups, size_t tags, uint32_t periodMs) {
+    client.clearTags();
+    for (const auto& g : groups) {
+        size_t group = client.addGroup(g.name, periodMs);
+        for (uint32_t i = 0; i < g.count && tags > 0; ++i, --tags) {
+            client.addTag(loadTagName(g, i), "ns=1;i=" + std::to_string(g.firstId + i), group);
+        }
+    }
+}
+
+StageResult runStage(OPCUAClient& client, ScenarioSink& sink, const std::vector<LoadGroup>& groups,
+                     size_t tags, uint32_t periodMs, int warmup, int seconds) {
+    loadStage(client, groups, tags, periodMs);
+    LatencyHistogram poll_time;
+    auto t0 = std::chrono::steady_clock::now();
+    auto measure_from = t0 + std::chrono::seconds(warmup);
+    auto stop = measure_from + std::chrono::seconds(seconds);
+    bool measuring = false;
+    for (auto now = t0; now < stop; now = std::chrono::steady_clock::now()) {
+        if (!measuring && now >= measure_from) {
+            // Первые значения тегов и разгон кэшей в замер не входят
+            sink.reset();
+            measuring = true;
+        }
+        uint64_t cycles = sink.cycles.load();
+        auto p0 = std::chrono::steady_clock::now();
+        client.poll();
+        auto p1 = std::chrono::steady_clock::now();
+        if (measuring && sink.cycles.load() != cycles) {
+            poll_time.record((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(p1 - p0).count());
+        }
+        std::this_thread::sleep_until(p0 + std::chrono::milliseconds(10));
+    }
+
+    StageResult r;
+    r.tags = tags;
+    r.expected = expectedRate(groups, tags, periodMs);
+    r.delivered = (double)sink.changes.load() / seconds;
+    r.poll_p50 = poll_time.percentile(0.5);
+    r.poll_p99 = poll_time.percentile(0.99);
+    r.age_p50 = sink.age.percentile(0.5);
+    r.age_p99 = sink.age.percentile(0.99);
+    r.rss_mb = residentMb();
+    r.peak_mb = peakMb();
+    // Без единого цикла опроса ступень тоже считается насыщенной
+    r.saturated = poll_time.count() == 0 || r.delivered < 0.95 * r.expected ||
+                  r.poll_p99 > (uint64_t)periodMs * 1000000;
+    return r;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string url = "opc.tcp://127.0.0.1:4840";
+    std::string profile_file;
+    std::string stages_text = "1000,10000,100000,1000000";
+    int seconds = 20;
+    int warmup = 3;
+    int period_ms = 500;
+    std::string csv_file;
+    bool keep_going = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--keep-going") keep_going = true;
+        else if (i + 1 >= argc) break;
+        else if (arg == "--url") url = argv[++i];
+        else if (arg == "--profile") profile_file = argv[++i];
+        else if (arg == "--stages") stages_text = argv[++i];
+        else if (arg == "--seconds") seconds = std::max(1, std::stoi(argv[++i]));
+        else if (arg == "--warmup") warmup = std::max(0, std::stoi(argv[++i]));
+        else if (arg == "--period") period_ms = std::max(10, std::stoi(argv[++i]));
+        else if (arg == "--csv") csv_file = argv[++i];
+    }
+
+    std::vector<LoadGroup> groups;
+    std::string error;
+    if (profile_file.empty() || !loadLoadProfile(profile_file, groups, &error)) {
+        std::fprintf(stderr, "Bad load profile: %s\n", profile_file.empty() ? "--profile is required" : error.c_str());
+        return 1;
+    }
+    std::vector<size_t> stages = parseStages(stages_text);
+    size_t available = loadVariableCount(groups);
+
+    OPCUAClient client;
+    auto sink = std::make_shared<ScenarioSink>();
+    client.addSink(sink);
+    for (int attempt = 0; !client.connectToServer(url); ++attempt) {
+        if (attempt == 10) {
+            std::fprintf(stderr, "Cannot connect to %s\n", url.c_str());
+            return 1;
+        }
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+    }
+
+    FILE* csv = csv_file.empty() ? nullptr : std::fopen(csv_file.c_str(), "w");
+    if (csv) std::fprintf(csv, "tags,expected_per_s,delivered_per_s,poll_p50_ns,poll_p99_ns,age_p50_ns,age_p99_ns,rss_mb,peak_mb,saturated\n");
+    std::printf("%9s %12s %12s %6s %10s %10s %10s %10s %9s %9s  %s\n", "tags", "expected/s", "delivered/s",
+                "ratio", "poll p50", "poll p99", "age p50", "age p99", "rss MB", "peak MB", "verdict");
+
+    double base_mb = residentMb();
+    size_t last_ok = 0;
+    for (size_t stage : stages) {
+        size_t tags = std::min(stage, available);
+        StageResult r = runStage(client, *sink, groups, tags, (uint32_t)period_ms, warmup, seconds);
+        double ratio = r.expected > 0 ? r.delivered / r.expected : 1.0;
+        std::printf("%9zu %12.0f %12.0f %6.2f %10s %10s %10s %10s %9.1f %9.1f  %s\n", r.tags, r.expected,
+                    r.delivered, ratio, formatNanos(r.poll_p50).c_str(), formatNanos(r.poll_p99).c_str(),
+                    formatNanos(r.age_p50).c_str(), formatNanos(r.age_p99).c_str(), r.rss_mb, r.peak_mb,
+                    r.saturated ? "SATURATED" : "ok");
+        if (r.rss_mb > 0 && tags > 0) {
+            std::printf("%9s memory %.0f bytes/tag over idle\n", "", (r.rss_mb - base_mb) * (1 << 20) / tags);
+        }
+        std::fflush(stdout);
+        if (csv) {
+            std::fprintf(csv, "%zu,%.1f,%.1f,%llu,%llu,%llu,%llu,%.1f,%.1f,%d\n", r.tags, r.expected, r.delivered,
+                         (unsigned long long)r.poll_p50, (unsigned long long)r.poll_p99,
+                         (unsigned long long)r.age_p50, (unsigned long long)r.age_p99, r.rss_mb, r.peak_mb,
+                         r.saturated ? 1 : 0);
+        }
+        if (r.saturated && !keep_going) {
+            std::printf("breaking point between %zu and %zu tags\n", last_ok, tags);
+            break;
+        }
+        if (!r.saturated) last_ok = tags;
+        if (tags == available) break;
+    }
+    if (csv) std::fclose(csv);
+    client.disconnectFromServer();
+    return 0;
+}
@@ -0,0 +1,54 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "../include/latency_histogram.hpp"
+#include "../include/tag_search.hpp"
+
+// Цена поиска тегов в индексе из --tags тегов: короткий запрос (по началу),
+// точное имя и имя с опечаткой (по триграммам); первый короткий запрос сортирует список,
+// он попадает в max. Цель — единицы миллисекунд на 100 тыс.
+// Запуск: opcua_search_bench [--tags 100000] [--rounds 200]
+
+namespace {
+
+void run(TagIndex& index, const char* label, const std::string& query, int rounds) {
+    LatencyHistogram h;
+    size_t found = 0;
+    for (int r = 0; r < rounds; ++r) {
+        auto s0 = std::chrono::steady_clock::now();
+        found = index.search(query, 20).size();
+        h.record((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - s0)
+                     .count());
+    }
+    std::printf("%-8s %-16s found %3zu  p50 %10s  p99 %10s  max %10s\n", label, query.c_str(), found,
+                formatNanos(h.percentile(0.5)).c_str(), formatNanos(h.percentile(0.99)).c_str(),
+                formatNanos(h.max()).c_str());
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    uint32_t tags = 100000;
+    int rounds = 200;
+    for (int i = 1; i + 1 < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--tags") tags = (uint32_t)std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--rounds") rounds = std::max(1, std::atoi(argv[++i]));
+    }
+    TagIndex index;
+    auto t0 = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < tags; ++i) {
+        index.add(i, "Plant" + std::to_string(i % 97) + ".Unit" + std::to_string(i) + ".Flow",
+                  "ns=2;i=" + std::to_string(1000 + i));
+    }
+    auto built = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count();
+    std::printf("index of %u tags built in %s\n", tags, formatNanos((uint64_t)built).c_str());
+
+    run(index, "prefix", "pl", rounds);
+    run(index, "exact", "unit4242.flow", rounds);
+    run(index, "typo", "unti4242.flow", rounds);
+    return 0;
+}
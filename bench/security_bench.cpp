@@ -0,0 +1,210 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <open62541/server.h>
+#include <open62541/server_config_default.h>
+#include "../include/opcua_client.hpp"
+#include "../include/security.hpp"
+
+// Цена защищённого канала на локальном сервере-заглушке (встроенный open62541 в том же
+// процессе, сертификат самоподписанный, проверка сертификатов отключена с обеих сторон).
+// Для каждой политики (None — без защиты, остальные — Sign&Encrypt):
+//   connect — новый канал и новая сессия (OPN + CreateSession + ActivateSession),
+//   resume  — новый канал и прежняя сессия (OPN + ActivateSession), как после обрыва канала,
+//   read    — время updateValues над --tags переменными и значений в секунду.
+// Асимметричная криптография идёт только в connect и resume; read показывает цену
+// симметричной подписи и шифрования каждого сообщения.
+// Запуск: opcua_security_bench [--tags 1000] [--seconds 5] [--rounds 20] [--port 4850]
+//                              [--policies None,Basic256Sha256,Aes128_Sha256_RsaOaep]
+
+namespace {
+
+const char* SERVER_URI = "urn:open62541.server.application";
+const uint32_t FIRST_ID = 1000;
+
+struct BenchServer {
+    UA_Server* server;
+    volatile UA_Boolean running;
+    std::thread thread;
+
+    BenchServer() : server(nullptr), running(true) {}
+
+    bool start(uint16_t port, size_t tags) {
+        UA_ByteString certificate = UA_BYTESTRING_NULL;
+        UA_ByteString key = UA_BYTESTRING_NULL;
+        if (!createSelfSignedCertificate(SERVER_URI, certificate, key)) return false;
+        server = UA_Server_new();
+        UA_ServerConfig* config = UA_Server_getConfig(server);
+        UA_StatusCode rc = UA_ServerConfig_setDefaultWithSecurityPolicies(
+            config, port, &certificate, &key, nullptr, 0, nullptr, 0, nullptr, 0);
+        UA_ByteString_clear(&certificate);
+        UA_ByteString_clear(&key);
+        if (rc != UA_STATUSCODE_GOOD) return false;
+        // URI приложения должен совпадать с сертификатом
+        UA_String_clear(&config->applicationDescription.applicationUri);
+        config->applicationDescription.applicationUri = UA_STRING_ALLOC(SERVER_URI);
+        config->secureChannelPKI.clear(&config->secureChannelPKI);
+        UA_CertificateVerification_AcceptAll(&config->secureChannelPKI);
+        config->sessionPKI.clear(&config->sessionPKI);
+        UA_CertificateVerification_AcceptAll(&config->sessionPKI);
+        config->maxNodesPerRead = 0;
+        config->tcpMaxMsgSize = 0;
+        config->tcpMaxChunks = 0;
+
+        for (size_t i = 0; i < tags; ++i) {
+            UA_VariableAttributes attr = UA_VariableAttributes_default;
+            UA_Double value = (double)i;
+            UA_Variant_setScalar(&attr.value, &value, &UA_TYPES[UA_TYPES_DOUBLE]);
+            std::string name = "V" + std::to_string(i);
+            attr.displayName = UA_LOCALIZEDTEXT((char*)"", (char*)name.c_str());
+            UA_Server_addVariableNode(server, UA_NODEID_NUMERIC(1, FIRST_ID + (UA_UInt32)i),
+                                      UA_NODEID_NUMERIC(0, UA_NS0ID_OBJECTSFOLDER),
+                                      UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES),
+                                      UA_QUALIFIEDNAME(1, (char*)name.c_str()),
+                                      UA_NODEID_NUMERIC(0, UA_NS0ID_BASEDATAVARIABLETYPE), attr, nullptr, nullptr);
+        }
+        thread = std::thread([this] { UA_Server_run(server, &running); });
+        return true;
+    }
+
+    ~BenchServer() {
+        running = false;
+        if (thread.joinable()) thread.join();
+        if (server) UA_Server_delete(server);
+    }
+};
+
+struct PolicyResult {
+    std::string policy;
+    LatencyHistogram connect;
+    LatencyHistogram resume;
+    LatencyHistogram read;
+    double values_per_s;
+    std::string error;
+
+    PolicyResult() : values_per_s(0) {}
+};
+
+SecurityConfig securityFor(const std::string& policy) {
+    SecurityConfig s;
+    s.policy = policy;
+    s.acceptAnyServer = true;
+    return s;
+}
+
+uint64_t nanosSince(std::chrono::steady_clock::time_point t0) {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0)
+        .count();
+}
+
+// Рукопожатия на голом клиенте: полное подключение и возобновление сессии на новом канале
+bool measureHandshakes(PolicyResult& r, const std::string& url, int rounds) {
+    UA_Client* client = UA_Client_new();
+    UA_ClientConfig* config = UA_Client_getConfig(client);
+    UA_ClientConfig_setDefault(config);
+    bool ok = applySecurity(config, securityFor(r.policy), &r.error);
+    for (int i = 0; ok && i < rounds; ++i) {
+        auto t0 = std::chrono::steady_clock::now();
+        UA_StatusCode rc = UA_Client_connect(client, url.c_str());
+        if (rc == UA_STATUSCODE_GOOD) {
+            r.connect.record(nanosSince(t0));
+            UA_Client_disconnectSecureChannel(client);
+            t0 = std::chrono::steady_clock::now();
+            rc = UA_Client_connect(client, url.c_str());
+            if (rc == UA_STATUSCODE_GOOD) r.resume.record(nanosSince(t0));
+        }
+        if (rc != UA_STATUSCODE_GOOD) {
+            r.error = std::string("connect: ") + UA_StatusCode_name(rc);
+            ok = false;
+        }
+        UA_Client_disconnect(client);
+    }
+    UA_Client_delete(client);
+    return ok;
+}
+
+// Чтение через OPCUAClient — тот же путь, что у монитора и коллектора
+bool measureReads(PolicyResult& r, const std::string& url, size_t tags, int seconds) {
+    OPCUAClient client;
+    if (!client.configureSecurity(securityFor(r.policy), &r.error)) return false;
+    client.clearTags();
+    for (size_t i = 0; i < tags; ++i) {
+        client.addTag("V" + std::to_string(i), "ns=1;i=" + std::to_string(FIRST_ID + i));
+    }
+    if (!client.connectToServer(url)) {
+        r.error = "OPCUAClient cannot connect";
+        return false;
+    }
+    for (int i = 0; i < 5; ++i) client.updateValues();
+    uint64_t rounds = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    auto stop = t0 + std::chrono::seconds(seconds);
+    while (std::chrono::steady_clock::now() < stop) {
+        auto p0 = std::chrono::steady_clock::now();
+        client.updateValues();
+        r.read.record(nanosSince(p0));
+        ++rounds;
+    }
+    r.values_per_s = (double)(rounds * tags) / ((double)nanosSince(t0) / 1e9);
+    client.disconnectFromServer();
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t tags = 1000;
+    int seconds = 5;
+    int rounds = 20;
+    int port = 4850;
+    std::string policies_text = "None,Basic256Sha256,Aes128_Sha256_RsaOaep";
+    for (int i = 1; i + 1 < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--tags") tags = (size_t)std::max(1, std::stoi(argv[++i]));
+        else if (arg == "--seconds") seconds = std::max(1, std::stoi(argv[++i]));
+        else if (arg == "--rounds") rounds = std::max(1, std::stoi(argv[++i]));
+        else if (arg == "--port") port = std::stoi(argv[++i]);
+        else if (arg == "--policies") policies_text = argv[++i];
+    }
+
+    BenchServer server;
+    if (!server.start((uint16_t)port, tags)) {
+        std::fprintf(stderr, "Cannot start server on port %d (open62541 without encryption?)\n", port);
+        return 1;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    std::string url = "opc.tcp://127.0.0.1:" + std::to_string(port);
+
+    std::vector<std::unique_ptr<PolicyResult>> results;
+    std::stringstream in(policies_text);
+    std::string policy;
+    while (std::getline(in, policy, ',')) {
+        if (policy.empty()) continue;
+        results.emplace_back(new PolicyResult());
+        PolicyResult& r = *results.back();
+        r.policy = policy;
+        if (measureHandshakes(r, url, rounds)) measureReads(r, url, tags, seconds);
+    }
+
+    std::printf("%-24s %10s %10s %10s %10s %10s %10s %12s %8s\n", "policy", "connect50", "connect99", "resume50",
+                "resume99", "read p50", "read p99", "values/s", "vs None");
+    double base = 0;
+    for (const auto& r : results) {
+        if (!r->error.empty()) {
+            std::printf("%-24s %s\n", r->policy.c_str(), r->error.c_str());
+            continue;
+        }
+        if (base == 0 && r->policy == "None") base = r->values_per_s;
+        std::printf("%-24s %10s %10s %10s %10s %10s %10s %12.0f %8.2f\n", r->policy.c_str(),
+                    formatNanos(r->connect.percentile(0.5)).c_str(), formatNanos(r->connect.percentile(0.99)).c_str(),
+                    formatNanos(r->resume.percentile(0.5)).c_str(), formatNanos(r->resume.percentile(0.99)).c_str(),
+                    formatNanos(r->read.percentile(0.5)).c_str(), formatNanos(r->read.percentile(0.99)).c_str(),
+                    r->values_per_s, base > 0 ? r->values_per_s / base : 0.0);
+    }
+    return 0;
+}
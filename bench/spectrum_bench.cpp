@@ -0,0 +1,65 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "../include/latency_histogram.hpp"
+#include "../include/spectrum.hpp"
+
+// Цена пересчёта спектра: один сегмент --size отсчётов и запись из --segments сегментов
+// с перекрытием 50%. План строится один раз (первый вызов, печатается отдельно),
+// дальше расчёт идёт без выделений памяти. Цель — меньше 1 мс на 8k отсчётов.
+// Запуск: opcua_spectrum_bench [--size 8192] [--segments 4] [--rounds 2000]
+
+namespace {
+
+std::vector<double> signal(size_t n) {
+    std::vector<double> x(n);
+    for (size_t i = 0; i < n; ++i) {
+        double t = (double)i / 8192.0;
+        x[i] = 2.0 * std::sin(2 * 3.14159265358979 * 50 * t) + 0.5 * std::sin(2 * 3.14159265358979 * 1230 * t) +
+               0.1 * ((double)std::rand() / RAND_MAX - 0.5);
+    }
+    return x;
+}
+
+void run(const char* label, size_t size, size_t samples, int rounds) {
+    SpectrumAnalyzer analyzer(size, 0.5);
+    std::vector<double> x = signal(samples);
+    std::vector<double> out;
+    auto t0 = std::chrono::steady_clock::now();
+    analyzer.compute(x, out);
+    auto first = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count();
+    LatencyHistogram h;
+    for (int r = 0; r < rounds; ++r) {
+        // Новые данные на каждом круге, как при пересчёте по новому блоку
+        x[(size_t)r % x.size()] += 1e-6;
+        auto s0 = std::chrono::steady_clock::now();
+        analyzer.compute(x, out);
+        h.record((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - s0)
+                     .count());
+    }
+    std::printf("%-10s size %6zu  segments %3zu  first (with plan) %10s  p50 %10s  p99 %10s  max %10s\n", label,
+                analyzer.size(), analyzer.segments(), formatNanos((uint64_t)first).c_str(),
+                formatNanos(h.percentile(0.5)).c_str(), formatNanos(h.percentile(0.99)).c_str(),
+                formatNanos(h.max()).c_str());
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t size = 8192;
+    size_t segments = 4;
+    int rounds = 2000;
+    for (int i = 1; i + 1 < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--size") size = (size_t)std::max(8, std::atoi(argv[++i]));
+        else if (arg == "--segments") segments = (size_t)std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--rounds") rounds = std::max(1, std::atoi(argv[++i]));
+    }
+    run("block", size, size, rounds);
+    run("overlap", size, size + (segments - 1) * (size / 2), rounds);
+    return 0;
+}
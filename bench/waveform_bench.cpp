@@ -0,0 +1,81 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <open62541/types.h>
+#include "../include/waveform.hpp"
+
+// Преобразование осциллограммы в double: векторный путь convertSamples против цикла,
+// который выбирает тип на каждом отсчёте (как variantToDouble для скаляров).
+// Блок мал и лежит в L1, поэтому байты/с — предел самого преобразования;
+// --blocks больше числа блоков в L2 показывает упор в память.
+// Запуск: opcua_waveform_bench [--samples 4096] [--blocks 1] [--rounds 200000]
+
+namespace {
+
+// Ветвление по типу на каждом отсчёте — то, от чего уходит convertSamples.
+// Тип читается через volatile, чтобы компилятор не вынес проверку из цикла
+void convertPerSample(const UA_DataType* type, const void* data, size_t n, double* out) {
+    const UA_DataType* volatile current = type;
+    for (size_t i = 0; i < n; ++i) {
+        const UA_DataType* t = current;
+        if (t == &UA_TYPES[UA_TYPES_INT16]) out[i] = (double)((const int16_t*)data)[i];
+        else if (t == &UA_TYPES[UA_TYPES_FLOAT]) out[i] = (double)((const float*)data)[i];
+        else out[i] = 0;
+    }
+}
+
+template <typename T>
+void run(const char* label, int typeIndex, size_t samples, size_t blocks, int rounds) {
+    const UA_DataType* type = &UA_TYPES[typeIndex];
+    std::vector<T> in(samples * blocks);
+    for (size_t i = 0; i < in.size(); ++i) in[i] = (T)(1000.0 * std::sin((double)i * 0.01));
+    std::vector<double> out(samples * blocks);
+
+    auto measure = [&](bool vectorized) {
+        auto t0 = std::chrono::steady_clock::now();
+        for (int r = 0; r < rounds; ++r) {
+            size_t b = (size_t)r % blocks;
+            const T* src = in.data() + b * samples;
+            double* dst = out.data() + b * samples;
+            if (vectorized) convertSamples(src, samples, dst);
+            else convertPerSample(type, src, samples, dst);
+        }
+        auto t1 = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::nano>(t1 - t0).count() / rounds;
+    };
+    measure(true);
+    double ns_vec = measure(true);
+    double ns_scalar = measure(false);
+    // Прочитано sizeof(T) и записано 8 байт на отсчёт
+    double bytes = (double)samples * (sizeof(T) + sizeof(double));
+    std::printf("%-6s %6zu samples  vectorized %8.0f ns/block %6.1f GB/s   per-sample %8.0f ns/block %6.1f GB/s   x%.1f\n",
+                label, samples, ns_vec, bytes / ns_vec, ns_scalar, bytes / ns_scalar, ns_scalar / ns_vec);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t samples = 4096;
+    size_t blocks = 1;
+    int rounds = 200000;
+    for (int i = 1; i + 1 < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--samples") samples = (size_t)std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--blocks") blocks = (size_t)std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--rounds") rounds = std::max(1, std::atoi(argv[++i]));
+    }
+#if defined(__AVX2__)
+    std::printf("path: AVX2\n");
+#elif defined(__SSE2__)
+    std::printf("path: SSE2\n");
+#else
+    std::printf("path: compiler loop\n");
+#endif
+    run<int16_t>("Int16", UA_TYPES_INT16, samples, blocks, rounds);
+    run<float>("Float", UA_TYPES_FLOAT, samples, blocks, rounds);
+    return 0;
+}
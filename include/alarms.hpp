@@ -0,0 +1,93 @@
+#ifndef ALARMS_HPP
+#define ALARMS_HPP
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "opcua_client.hpp"
+#include "timing_wheel.hpp"
+
+struct AlarmRule {
+    enum Kind : uint8_t { HIHI, HI, LO, LOLO, ROC, STALE };
+
+    std::string tag;
+    Kind kind;
+    double limit;     // граница; для ROC — единиц в секунду, для STALE — миллисекунды
+    double deadband;  // гистерезис: тревога снимается, только отойдя от границы на deadband
+};
+
+// Движок тревог. Правила проиндексированы по слоту тега, и каждое изменение
+// значения проверяет только правила своего тега; кадры интерфейса тревоги не пересчитывают.
+// Устаревание проверяется в tick() по колесу таймеров: одна запись на правило,
+// сколько бы изменений ни приходило
+class AlarmEngine : public OPCUAClient::ValueSink {
+public:
+    struct Alarm {
+        std::string tag;
+        AlarmRule::Kind kind;
+        double value;
+        double limit;
+        UA_DateTime since;
+        bool acknowledged;
+    };
+
+    AlarmEngine();
+
+    size_t addRule(const AlarmRule& rule);
+    // Строки: <тег> <hihi|hi|lo|lolo|roc|stale> <граница> [гистерезис]; # — комментарий
+    bool loadRules(const std::string& path);
+    size_t ruleCount();
+
+    // Проверка устаревания; вызывается по концу цикла опроса и периодически снаружи,
+    // чтобы тревога сработала и тогда, когда опрос остановился
+    void tick();
+
+    // Активные тревоги, новые первыми
+    std::vector<Alarm> activeAlarms();
+    size_t unacknowledgedCount();
+    void acknowledgeAll();
+
+    void onValueChanged(size_t slot, const OPCUAClient::TagData& tag, const UA_DataValue& dv) override;
+    void onCycleEnd() override { tick(); }
+    // Перемотка назад: тревоги снимаются, скорость и устаревание считаются заново
+    void onReset() override;
+
+    static const char* kindName(AlarmRule::Kind kind);
+
+private:
+    struct RuleState {
+        AlarmRule::Kind kind;
+        bool active;
+        bool acknowledged;
+        bool has_prev;
+        int32_t active_pos;   // место в active или -1
+        double limit;
+        double deadband;
+        double value;         // последнее значение тега
+        double prev_value;    // для ROC
+        UA_DateTime prev_time;
+        int64_t last_change_ms;  // монотонное время, для STALE
+        UA_DateTime since;
+    };
+
+    void evaluateLocked(uint32_t id, double value, UA_DateTime time, int64_t now_ms);
+    void setActiveLocked(uint32_t id, bool active);
+    void bindSlotLocked(size_t slot, const std::string& name);
+    uint64_t tickOf(int64_t ms) const;
+
+    std::mutex mutex;
+    std::vector<RuleState> rules;
+    std::vector<std::string> rule_tags;
+    std::unordered_map<std::string, std::vector<uint32_t>> rules_by_name;
+    // Привязка к слотам строится лениво и сверяется по имени, поэтому
+    // переживает замену набора тегов (конфигурация, подключение к коллектору)
+    std::vector<std::string> slot_names;
+    std::vector<std::vector<uint32_t>> rules_by_slot;
+    std::vector<uint32_t> active;
+    TimingWheel stale_wheel;
+    std::vector<uint32_t> due;
+};
+
+#endif
@@ -0,0 +1,89 @@
+#ifndef CONNECTION_HEALTH_HPP
+#define CONNECTION_HEALTH_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <open62541/types.h>
+
+// Состояние сессии по результатам запросов: сглаженное время ответа,
+// серии ошибок, продления канала, последний Publish.
+// Коды перегрузки сервера (BadTooManyOperations, BadResourceUnavailable и т.п.)
+// отличаются от обрыва связи: на перегрузку клиент не переподключается,
+// а сбавляет темп — пауза между запросами опроса растёт вдвое, а после
+// BadTooManyOperations вдвое уменьшается число узлов в одном запросе.
+// Успешные запросы постепенно возвращают темп и размер запроса, но не выше
+// размера, на котором сервер уже отказывал
+class ConnectionHealth {
+public:
+    enum Outcome {
+        OK,
+        OVERLOAD,    // сервер жив, но просит сбавить нагрузку
+        DISCONNECT,  // канал или сессия потеряны
+        FAILURE      // прочие ошибки запроса
+    };
+    enum State { DOWN, HEALTHY, DEGRADED, OVERLOADED };
+
+    struct Snapshot {
+        State state;
+        double rttMs;       // EWMA времени ответа, 0 — ещё не было
+        double lastRttMs;
+        uint32_t consecutiveFailures;
+        uint64_t failures;
+        uint64_t overloads;
+        uint64_t disconnects;
+        uint64_t renewals;
+        UA_StatusCode lastError;
+        UA_DateTime lastSuccess;  // 0 — не было
+        UA_DateTime lastPublish;  // последний Publish с уведомлениями
+        bool publishStalled;      // сервер перестал отвечать на Publish подписки
+        uint32_t throttleMs;      // пауза между запросами опроса
+        uint32_t maxOperations;   // узлов в одном Read, 0 — без ограничения
+    };
+
+    static constexpr uint32_t MAX_THROTTLE_MS = 5000;
+
+    ConnectionHealth();
+
+    static Outcome classify(UA_StatusCode code);
+    static const char* stateName(State state);
+
+    // nowNs — монотонное время окончания запроса; operations — узлов в запросе
+    Outcome onRequest(UA_StatusCode code, uint64_t rttNanos, size_t operations, int64_t nowNs);
+    void onConnected();
+    // lost == false — отключились сами, обрывом не считается
+    void onDisconnected(bool lost = true);
+    void onRenewal();
+    void onPublish(UA_DateTime time);
+    void onPublishStalled();
+
+    // Можно ли отправлять следующий запрос опроса (пауза после перегрузки истекла)
+    bool mayRequest(int64_t nowNs);
+    uint32_t maxOperations();
+    Snapshot snapshot();
+
+private:
+    void throttleLocked(size_t operations, UA_StatusCode code);
+    void recoverLocked();
+
+    std::mutex mutex;
+    bool connected;
+    double rtt_ms;
+    double last_rtt_ms;
+    uint32_t consecutive_failures;
+    uint32_t consecutive_ok;
+    uint64_t failures;
+    uint64_t overloads;
+    uint64_t disconnects;
+    uint64_t renewals;
+    UA_StatusCode last_error;
+    UA_DateTime last_success;
+    UA_DateTime last_publish;
+    bool publish_stalled;
+    uint32_t throttle_ms;
+    uint32_t max_operations;
+    uint32_t operations_ceiling;  // наименьший размер запроса, на котором сервер отказал
+    int64_t next_request_ns;
+};
+
+#endif
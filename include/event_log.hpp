@@ -0,0 +1,45 @@
+#ifndef EVENT_LOG_HPP
+#define EVENT_LOG_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <open62541/types.h>
+
+// Событие OPC UA в компактном виде: фиксированный размер, без выделений памяти
+struct EventRecord {
+    UA_DateTime time;      // поле Time события или время приёма
+    UA_DateTime received;
+    uint16_t severity;
+    char source[38];
+    char type[24];
+    char message[176];     // Message и прочие выбранные поля "имя=значение"
+};
+
+// Журнал событий фиксированной ёмкости. При всплеске старые записи
+// перезаписываются: запись никогда не ждёт читателя, а читатель копирует
+// только видимое окно
+class EventLog {
+public:
+    explicit EventLog(size_t capacity = 65536);
+
+    void push(const EventRecord& record);
+    // Разбирает поля уведомления; fields — имена полей из select-выражения
+    static EventRecord decode(const std::vector<std::string>& fields, size_t count, const UA_Variant* values);
+
+    size_t size();
+    uint64_t total();        // принято за всё время
+    uint64_t overwritten();  // вытеснено из кольца
+
+    // Записи начиная с skip-й от самой новой, не больше count, новые первыми
+    void copyRecent(size_t skip, size_t count, std::vector<EventRecord>& out);
+
+private:
+    std::mutex mutex;
+    std::vector<EventRecord> ring;
+    uint64_t head;  // сколько записей принято
+};
+
+#endif
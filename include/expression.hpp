@@ -0,0 +1,109 @@
+#ifndef EXPRESSION_HPP
+#define EXPRESSION_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Выражение вычисляемого тега: "Voltage * Current", "(Temp - 32) / 1.8",
+// "Counter - prev(Counter)". Операции: + - * / ^, унарный минус, скобки,
+// функции abs, sqrt, min, max и prev (значение входа до последнего изменения).
+// Текст разбирается один раз в байткод стековой машины; входы — слоты хранилища тегов
+class Expression {
+public:
+    enum Op : uint8_t { CONST, LOAD, PREV, ADD, SUB, MUL, DIV, POW, NEG, ABS, SQRT, MIN, MAX };
+
+    struct Instr {
+        Op op;
+        uint32_t arg;  // индекс константы или слот входа
+    };
+
+    static constexpr int MAX_DEPTH = 32;
+
+    // Имя тега → слот; false — такого тега нет
+    using Resolver = std::function<bool(const std::string& name, uint32_t& slot)>;
+
+    bool compile(const std::string& text, const Resolver& resolve);
+    const std::string& error() const { return error_text; }
+
+    const std::vector<Instr>& code() const { return program; }
+    const std::vector<double>& constants() const { return consts; }
+    // Слоты входов без повторов
+    const std::vector<uint32_t>& inputs() const { return input_slots; }
+
+    // current/previous — значения, проиндексированные слотами
+    static double run(const Instr* code, size_t size, const double* consts,
+                      const double* current, const double* previous);
+    double evaluate(const double* current, const double* previous) const {
+        return run(program.data(), program.size(), consts.data(), current, previous);
+    }
+
+private:
+    std::vector<Instr> program;
+    std::vector<double> consts;
+    std::vector<uint32_t> input_slots;
+    std::string error_text;
+};
+
+// Набор вычисляемых тегов. Байткод всех выражений лежит в общих массивах,
+// пересчитываются только выражения, чьи входы изменились с прошлого вызова evaluate
+class ComputedTags {
+public:
+    ComputedTags() : first_dirty(0) {}
+
+    // Слот результата должен быть больше слотов всех входов: тогда зависимые
+    // выражения всегда идут позже своих входов и цепочка считается за один проход
+    bool add(uint32_t slot, const Expression& expr);
+    bool isComputed(uint32_t slot) const {
+        return slot < entry_of_slot.size() && entry_of_slot[slot] >= 0;
+    }
+    size_t size() const { return entries.size(); }
+    void clear();
+
+    // Новое значение слота: запоминает его и помечает зависимые выражения
+    void inputChanged(uint32_t slot, double value);
+
+    // Пересчитывает помеченные выражения по возрастанию слота и отдаёт
+    // результаты в publish(slot, value); publish может снова вызвать inputChanged
+    template <typename Publish>
+    void evaluate(Publish&& publish);
+
+private:
+    struct Entry {
+        uint32_t slot;
+        uint32_t code_begin;
+        uint32_t code_size;
+        uint32_t const_begin;
+    };
+
+    void ensureSlot(uint32_t slot);
+
+    std::vector<Expression::Instr> code;
+    std::vector<double> consts;
+    std::vector<Entry> entries;
+    std::vector<uint8_t> dirty;
+    size_t first_dirty;
+
+    // По слотам хранилища
+    std::vector<double> current;
+    std::vector<double> previous;
+    std::vector<std::vector<uint32_t>> dependents;  // индексы entries
+    std::vector<int32_t> entry_of_slot;
+};
+
+template <typename Publish>
+void ComputedTags::evaluate(Publish&& publish) {
+    for (size_t i = first_dirty; i < entries.size(); ++i) {
+        if (!dirty[i]) continue;
+        dirty[i] = 0;
+        const Entry& e = entries[i];
+        double value = Expression::run(&code[e.code_begin], e.code_size, consts.data() + e.const_begin,
+                                       current.data(), previous.data());
+        publish(e.slot, value);
+    }
+    first_dirty = entries.size();
+}
+
+#endif
@@ -0,0 +1,102 @@
+#ifndef FANOUT_HPP
+#define FANOUT_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <mutex>
+#include "opcua_client.hpp"
+
+// Двоичный протокол между коллектором и мониторами (Unix-сокет).
+// Кадр: [u8 тип][u32 длина][данные], числа в порядке байт хоста —
+// обе стороны всегда на одной машине.
+struct FanoutProtocol {
+    enum MessageType : uint8_t {
+        TAGS = 1,          // u32 n, затем n × (u16 len, имя, u16 len, NodeId)
+        DELTA = 2,         // u32 n, затем n × Entry
+        WRITE = 3,         // u32 слот, f64 значение (монитор -> коллектор)
+        WRITE_RESULT = 4   // u32 слот, u8 успех (только зрителю, приславшему WRITE)
+    };
+
+#pragma pack(push, 1)
+    struct Entry {
+        uint32_t slot;
+        uint32_t status;
+        double value;
+        int64_t sourceTime;
+    };
+#pragma pack(pop)
+
+    static const size_t HEADER_SIZE = 5;
+};
+
+// Сторона коллектора: раздаёт изменения тегов всем подключённым мониторам.
+// Одна OPC UA сессия обслуживает любое число зрителей.
+class FanoutServer : public OPCUAClient::ValueSink {
+public:
+    explicit FanoutServer(OPCUAClient& source);
+    ~FanoutServer() override;
+
+    bool listen(const std::string& path);
+    // Неблокирующе принимает новых клиентов и обрабатывает их запросы записи
+    void poll();
+    size_t clientCount() const { return clients.size(); }
+
+    void onValueChanged(size_t slot, const OPCUAClient::TagData& tag, const UA_DataValue& dv) override;
+    void onCycleEnd() override;
+
+private:
+    struct Peer {
+        int fd;
+        std::vector<char> inbox;
+        std::vector<char> outbox;
+    };
+
+    void sendTo(Peer& peer, const char* data, size_t len);
+    // Кадр TAGS и снимок значений его тегов, под state_mutex
+    void putAnnouncementLocked(std::vector<char>& frame, const std::vector<OPCUAClient::TagData>& tags);
+    void dropClosed();
+
+    OPCUAClient& source;
+    int listen_fd;
+    std::string socket_path;
+    std::vector<Peer> clients;
+
+    // Последнее значение каждого слота — для снимка новому клиенту — и чьё оно (имя, NodeId)
+    std::vector<FanoutProtocol::Entry> latest;
+    std::vector<std::pair<std::string, std::string>> latest_tags;
+    std::vector<char> seen;
+    std::vector<FanoutProtocol::Entry> pending;
+    // Последний разосланный список тегов (имя, NodeId) и поколение набора, по которому он снят
+    std::vector<std::pair<std::string, std::string>> announced;
+    uint64_t announced_generation;
+    std::mutex state_mutex;
+};
+
+// Сторона монитора: принимает дельты от коллектора и кладёт их в локальное хранилище тегов
+class FanoutClient {
+public:
+    explicit FanoutClient(OPCUAClient& store);
+    ~FanoutClient();
+
+    bool connect(const std::string& path);
+    bool isConnected() const { return fd >= 0; }
+    // Неблокирующе читает всё, что пришло, и применяет к хранилищу
+    void poll();
+    // Запись выполняет коллектор; ждём подтверждения не дольше timeoutMs
+    bool writeValue(const std::string& nodeId, double value, int timeoutMs = 1000);
+
+private:
+    bool readAvailable();
+    void handleFrames();
+    void disconnect();
+
+    OPCUAClient& store;
+    int fd;
+    std::vector<char> inbox;
+    std::vector<std::string> node_ids;
+    int pending_write_slot;
+    int write_result;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,60 @@
+#ifndef GORILLA_HPP
+#define GORILLA_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Сжатие ряда (время, значение) по схеме Gorilla (Pelkonen и др., VLDB 2015).
+// Время — миллисекунды, кодируется дельтой дельт:
+//   0 → '0';  [-64, 63] → '10' + 7 бит;  [-256, 255] → '110' + 9;  [-2048, 2047] → '1110' + 12;
+//   иначе '1111' + 64 бита (дополнительный код).
+// Значение — XOR с предыдущим:
+//   0 → '0';  значимые биты внутри прежнего окна → '10' + биты окна;
+//   иначе '11' + 5 бит ведущих нулей + 6 бит длины окна (64 → 0) + биты окна.
+// Первая точка блока — 64 бита времени и 64 бита значения. Биты пишутся от старшего
+// к младшему в 64-битные слова; блок декодируется целиком без выделений памяти
+class GorillaEncoder {
+public:
+    GorillaEncoder() { clear(); }
+
+    void clear();
+    void append(int64_t timeMs, double value);
+
+    size_t count() const { return points; }
+    int64_t firstTime() const { return first_time; }
+    int64_t lastTime() const { return prev_time; }
+    size_t bytes() const { return (bit_count + 7) / 8; }
+    // Слова данных; последнее заполнено до bits()
+    const std::vector<uint64_t>& words() const { return data; }
+    size_t bits() const { return bit_count; }
+
+private:
+    void put(uint64_t v, unsigned n);
+
+    std::vector<uint64_t> data;
+    size_t bit_count;
+    size_t points;
+    int64_t first_time;
+    int64_t prev_time;
+    int64_t prev_delta;
+    uint64_t prev_value;
+    unsigned prev_leading;
+    unsigned prev_trailing;
+};
+
+// Закрытый блок: данные больше не меняются, память — ровно по размеру
+struct GorillaBlock {
+    std::vector<uint64_t> words;
+    uint32_t count;
+    int64_t first;
+    int64_t last;
+
+    static GorillaBlock seal(const GorillaEncoder& encoder);
+    size_t bytes() const { return words.size() * sizeof(uint64_t); }
+};
+
+// Раскодирует count точек; false — данные короче, чем нужно для count точек
+bool gorillaDecode(const uint64_t* words, size_t wordCount, size_t count, int64_t* times, double* values);
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef HISTORY_HPP
+#define HISTORY_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "gorilla.hpp"
+#include "opcua_client.hpp"
+#include "rollup.hpp"
+
+// История значений для графиков: кольцо последних depth изменений каждого тега
+// (горячее окно, несжатое). Вытесненные из кольца значения с временем дописываются
+// в сжатый сегмент Gorilla (gorilla.hpp); заполненный сегмент закрывается, хранится
+// не больше maxSegments закрытых сегментов на тег. Каждое значение сразу попадает и в
+// свёртки 1 с / 1 мин / 1 ч (rollup.hpp), по которым графики масштабируются до 30 суток.
+// Пополняется приёмником в потоке опроса, поэтому кадр интерфейса копирует историю
+// только тех тегов, чьи графики на экране
+class HistorySink : public OPCUAClient::ValueSink {
+public:
+    explicit HistorySink(size_t depth = 100, size_t segmentSamples = 1024, size_t maxSegments = 16)
+        : depth(depth ? depth : 1), segment_samples(segmentSamples ? segmentSamples : 1), max_segments(maxSegments),
+          stored(0), packed_bytes(0), packed_samples(0), rollup_buckets(0) {}
+
+    // Значения горячего окна от старых к новым; false — истории ещё нет
+    bool copy(size_t slot, const std::string& name, std::vector<double>& out);
+    // Вся история тега начиная с fromMs (мс от 1970 г.): сжатые сегменты, целиком
+    // лежащие раньше fromMs, не раскодируются. Время точек — по метке источника
+    bool copySeries(size_t slot, const std::string& name, int64_t fromMs, std::vector<int64_t>& times,
+                    std::vector<double>& values);
+    // Сводка за [fromMs, toMs) по columns столбцам равной ширины (пустой столбец — count 0).
+    // Берётся самая грубая ступень свёртки, интервал которой не шире столбца; время раньше
+    // её начала — из следующих, более грубых. Столбец уже секунды — точки истории (tier -1).
+    // Стоимость — по числу интервалов в диапазоне, а не по его длине.
+    // before — значение, державшееся к fromMs (NaN, если раньше окна значений нет)
+    bool copyColumns(size_t slot, const std::string& name, int64_t fromMs, int64_t toMs, size_t columns,
+                     std::vector<RollupBucket>& out, int* tier = nullptr, double* before = nullptr);
+    size_t memoryBytes();
+    // Точек в сжатых сегментах и их объём (для оценки степени сжатия)
+    size_t packedSamples();
+    size_t packedBytes();
+
+    void onValueChanged(size_t slot, const OPCUAClient::TagData& tag, const UA_DataValue& dv) override;
+    void onReset() override;
+
+private:
+    struct Ring {
+        Ring() : head(0) {}
+
+        std::string name;  // сверяется, чтобы замена набора тегов не смешала истории
+        std::vector<double> values;
+        std::vector<int64_t> times;
+        size_t head;
+        GorillaEncoder open;  // вытесненные из кольца, сегмент ещё пополняется
+        std::deque<GorillaBlock> sealed;
+        RollupSeries rollups;
+    };
+
+    void resetLocked(Ring& r);
+    void copySeriesLocked(const Ring& r, int64_t fromMs, std::vector<int64_t>& times, std::vector<double>& values);
+    void beforeLocked(const Ring& r, int64_t fromMs, double& value);
+
+    size_t depth;
+    size_t segment_samples;
+    size_t max_segments;
+    size_t stored;  // значений во всех кольцах, чтобы объём считался за O(1)
+    size_t packed_bytes;  // сегментов, включая пополняемые
+    size_t packed_samples;
+    size_t rollup_buckets;
+    std::mutex mutex;
+    std::vector<Ring> rings;
+};
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef JSON_STREAM_HPP
+#define JSON_STREAM_HPP
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <mutex>
+#include "opcua_client.hpp"
+
+// Поток NDJSON: одна строка на каждое изменение DataValue.
+// Кодирование выполняет JSON-энкодер open62541 прямо в переиспользуемый буфер,
+// а запись на выход идёт пакетами (в конце цикла опроса или при заполнении буфера).
+class JsonStreamSink : public OPCUAClient::ValueSink {
+public:
+    // target: "-" — stdout (только для программ без экранного интерфейса),
+    // "unix:/path" — Unix-сокет, иначе путь к файлу
+    explicit JsonStreamSink(const std::string& target, size_t batchBytes = 64 * 1024);
+    ~JsonStreamSink() override;
+
+    bool isOpen() const { return out != nullptr; }
+    size_t linesWritten() const { return lines; }
+
+    void onValueChanged(size_t slot, const OPCUAClient::TagData& tag, const UA_DataValue& dv) override;
+    void onCycleEnd() override { flush(); }
+    void flush();
+
+private:
+    void appendRaw(const char* data, size_t len);
+    bool appendJson(const UA_DataValue& dv);
+    void flushLocked();
+
+    std::FILE* out;
+    bool owns_out;
+    std::vector<char> buffer;
+    size_t used;
+    size_t batch_limit;
+    size_t lines;
+    std::mutex buffer_mutex;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,63 @@
+#ifndef LATENCY_HISTOGRAM_HPP
+#define LATENCY_HISTOGRAM_HPP
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Гистограмма задержек в стиле HDR: логарифмические диапазоны, каждый
+// разбит на 32 линейных поддиапазона (относительная погрешность ~3%).
+// Запись — несколько атомарных операций без блокировок.
+class LatencyHistogram {
+public:
+    static constexpr int SUB_BITS = 5;
+    static constexpr int SUB_COUNT = 1 << SUB_BITS;
+    static constexpr int BUCKET_COUNT = (64 - SUB_BITS + 1) * SUB_COUNT;
+
+    LatencyHistogram();
+
+    void record(uint64_t nanos);
+    void reset();
+
+    uint64_t count() const { return total.load(std::memory_order_relaxed); }
+    uint64_t max() const { return max_value.load(std::memory_order_relaxed); }
+    uint64_t min() const;
+    uint64_t sum() const { return total_sum.load(std::memory_order_relaxed); }
+    // Число записей не больше nanos (с точностью до ширины диапазона)
+    uint64_t countAtOrBelow(uint64_t nanos) const;
+    // q в диапазоне [0, 1]; возвращает верхнюю границу диапазона, в который попал квантиль
+    uint64_t percentile(double q) const;
+
+    static int bucketIndex(uint64_t v);
+    static uint64_t bucketUpperBound(int index);
+
+private:
+    std::array<std::atomic<uint64_t>, BUCKET_COUNT> buckets;
+    std::atomic<uint64_t> total;
+    std::atomic<uint64_t> total_sum;
+    std::atomic<uint64_t> min_value;
+    std::atomic<uint64_t> max_value;
+};
+
+// Набор гистограмм по видам операций для одного сервера
+struct LatencyStats {
+    LatencyHistogram read;
+    LatencyHistogram write;
+    LatencyHistogram connect;
+};
+
+// Замер интервала: записывает длительность в гистограмму при выходе из области видимости
+class LatencyTimer {
+public:
+    explicit LatencyTimer(LatencyHistogram* h);
+    ~LatencyTimer();
+
+private:
+    LatencyHistogram* histogram;
+    int64_t start_ns;
+};
+
+std::string formatNanos(uint64_t nanos);
+
+#endif
\ No newline at end of file
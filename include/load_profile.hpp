@@ -0,0 +1,78 @@
+#ifndef LOAD_PROFILE_HPP
+#define LOAD_PROFILE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+// Профиль нагрузки для генератора (opcua_loadgen) и прогона сценариев (opcua_scenario).
+// Строки файла:
+//   group <имя> <число переменных> <тип> [array=N] [rate=изменений/с на переменную]
+//         [burst=период_мс/длительность_мс/множитель]
+// Типы: bool, int32, int64, float, double, string; array=0 — скаляр.
+// В начале каждого периода всплеска частота изменений на заданное время
+// умножается на множитель. Пустые строки и строки с # пропускаются.
+// Переменные нумеруются подряд по группам: NodeId ns=1;i=<firstId + индекс>,
+// имя тега <группа>.<индекс>
+struct LoadGroup {
+    enum Type { BOOL, INT32, INT64, FLOAT, DOUBLE, STRING };
+
+    std::string name;
+    uint32_t count;
+    Type type;
+    uint32_t arraySize;
+    double rate;
+    uint32_t burstPeriodMs;  // 0 — без всплесков
+    uint32_t burstMs;
+    double burstFactor;
+    uint32_t firstId;
+
+    // Изменений одной переменной за первые ms миллисекунд работы
+    double changesBy(uint64_t ms) const;
+    double averageRate() const;
+    // Изменений в секунду на переменную, которые увидит опрос с периодом periodMs:
+    // за период опрос замечает не больше одного
+    double observableRate(uint32_t periodMs) const;
+};
+
+static const size_t MAX_LOAD_VARIABLES = 1000000;
+
+bool parseLoadProfile(const std::string& text, std::vector<LoadGroup>& out, std::string* error = nullptr);
+bool loadLoadProfile(const std::string& path, std::vector<LoadGroup>& out, std::string* error = nullptr);
+bool parseLoadType(const std::string& name, LoadGroup::Type& out);
+const char* loadTypeName(LoadGroup::Type type);
+size_t loadVariableCount(const std::vector<LoadGroup>& groups);
+std::string loadTagName(const LoadGroup& group, uint32_t index);
+// Конфигурация тегов клиента (см. OPCUAClient::loadTagConfig) для первых limit переменных;
+// каждая группа профиля становится группой опроса с периодом periodMs
+bool writeLoadTagConfig(const std::vector<LoadGroup>& groups, const std::string& path, uint32_t periodMs,
+                        size_t limit = std::numeric_limits<size_t>::max());
+
+// Какие переменные менять: число изменений группы к моменту времени берётся
+// из профиля, переменные выбираются по кругу, поэтому каждая меняется с одной частотой.
+// Если генератор отстал больше чем на круг, лишние изменения пропускаются
+class LoadSchedule {
+public:
+    struct Change {
+        uint32_t group;
+        uint32_t index;
+        uint64_t round;  // номер изменения этой переменной
+    };
+
+    explicit LoadSchedule(const std::vector<LoadGroup>& groups);
+
+    // Изменения, наступившие к nowMs от начала работы, дописываются в out
+    void advance(uint64_t nowMs, std::vector<Change>& out);
+    uint64_t emitted() const { return total_emitted; }
+    uint64_t skipped() const { return total_skipped; }
+
+private:
+    std::vector<LoadGroup> groups;
+    std::vector<uint64_t> group_emitted;  // включая пропущенные
+    uint64_t total_emitted;
+    uint64_t total_skipped;
+};
+
+#endif
@@ -0,0 +1,101 @@
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "latency_histogram.hpp"
+
+// Счётчик, разнесённый по потокам: каждый поток пишет в свою строку кэша,
+// сумма собирается только при чтении (опрос Prometheus).
+class ShardedCounter {
+public:
+    static constexpr int SHARDS = 16;
+
+    ShardedCounter();
+    void inc(uint64_t n = 1);
+    uint64_t value() const;
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<uint64_t> v;
+    };
+    std::array<Shard, SHARDS> shards;
+};
+
+// Значение «как есть» (глубина очереди, объём памяти)
+class Gauge {
+public:
+    Gauge() : bits(0) {}
+    void set(double v);
+    double value() const;
+
+private:
+    std::atomic<uint64_t> bits;
+};
+
+// Реестр метрик процесса и выгрузка в текстовом формате Prometheus
+class MetricsRegistry {
+public:
+    static MetricsRegistry& instance();
+
+    // Возвращаемые ссылки действительны до конца работы процесса
+    ShardedCounter& counter(const std::string& name, const std::string& help);
+    Gauge& gauge(const std::string& name, const std::string& help);
+    LatencyHistogram& histogram(const std::string& name, const std::string& help);
+
+    // Дополнительный источник строк экспозиции (например, гистограммы клиента по серверам)
+    int addCollector(std::function<void(std::string&)> collector);
+    void removeCollector(int id);
+
+    std::string exposition();
+    // Для textfile-коллектора node_exporter: запись во временный файл и атомарный rename
+    bool writeTextfile(const std::string& path);
+
+    static void appendHistogram(std::string& out, const std::string& name,
+                                const std::string& labels, const LatencyHistogram& h);
+
+private:
+    MetricsRegistry() : next_collector_id(0) {}
+
+    struct Entry {
+        std::string help;
+        std::unique_ptr<ShardedCounter> counter;
+        std::unique_ptr<Gauge> gauge;
+        std::unique_ptr<LatencyHistogram> histogram;
+    };
+
+    std::map<std::string, Entry> entries;
+    // Источники вызываются под своим мьютексом, а не под registry_mutex: они берут
+    // блокировки клиента, под которыми метрики регистрируются при первом обращении.
+    // removeCollector ждёт окончания идущей выгрузки, поэтому источник не переживает владельца
+    std::map<int, std::function<void(std::string&)>> collectors;
+    int next_collector_id;
+    std::mutex registry_mutex;
+    std::mutex collectors_mutex;
+};
+
+// Минимальный HTTP-сервер на localhost: отдаёт /metrics, работает в своём потоке
+class MetricsHttpServer {
+public:
+    MetricsHttpServer();
+    ~MetricsHttpServer();
+
+    bool start(uint16_t port);
+    void stop();
+
+private:
+    void serve();
+
+    int listen_fd;
+    std::atomic<bool> running;
+    std::thread worker;
+};
+
+#endif
\ No newline at end of file
@@ -4,8 +4,22 @@
 #include <string>
 #include <vector>
 #include <mutex>
+#include <memory>
+#include <map>
+#include <unordered_map>
+#include <atomic>
+#include <chrono>
+#include <thread>
 #include <open62541/client_highlevel.h>
 #include <open62541/client_config_default.h>
+#include "latency_histogram.hpp"
+#include "connection_health.hpp"
+#include "security.hpp"
+#include "timing_wheel.hpp"
+#include "expression.hpp"
+#include "event_log.hpp"
+
+class ShmPublisher;
 
 class OPCUAClient {
 public:
@@ -14,28 +28,224 @@ public:
         std::string nodeId;
         double value;
         std::string timestamp;
-        std::string quality;
+        std::string quality;  // INIT — значения ещё не было, GOOD, BAD — последний ответ со статусом Bad
+        UA_StatusCode status;
+        UA_DateTime sourceTime;
+        UA_DateTime serverTime;
+        size_t group;
+        uint32_t pollMs;   // текущий интервал опроса (у адаптивных групп меняется)
+        uint64_t reads;    // значений получено чтением
+        uint64_t changes;  // из них с изменением
+        std::string expression;  // у вычисляемого тега; nodeId тогда пуст
+        // Длина массива у тега-осциллограммы (см. waveform.hpp), 0 — скаляр.
+        // value у такого тега — среднеквадратичное значение последнего массива
+        uint32_t samples;
+
+        TagData(std::string n, std::string id, size_t g = 0)
+            : name(n), nodeId(id), value(0.0), quality("INIT"),
+              status(UA_STATUSCODE_GOOD), sourceTime(0), serverTime(0), group(g),
+              pollMs(0), reads(0), changes(0), samples(0) {}
+    };
+
+    // Группа опроса. Если minPeriodMs < maxPeriodMs, интервал каждого тега
+    // подстраивается под частоту его изменений в этих пределах,
+    // начиная с periodMs; иначе все теги читаются ровно с periodMs
+    struct TagGroup {
+        std::string name;
+        uint32_t periodMs;
+        uint32_t minPeriodMs;
+        uint32_t maxPeriodMs;
+    };
 
-        TagData(std::string n, std::string id) 
-            : name(n), nodeId(id), value(0.0), quality("INIT") {}
+    // Получатель изменений значений (JSON-поток, журналы и т.п.).
+    // Порядок блокировок: tags_mutex, затем sinks_mutex. onCycleEnd идёт под одной
+    // sinks_mutex, поэтому приёмник не должен обращаться к OPCUAClient ни из одного
+    // из своих методов — всё нужное о теге приходит в TagData
+    class ValueSink {
+    public:
+        virtual ~ValueSink() = default;
+        // Вызывается под блокировкой тегов, поэтому должен работать быстро
+        virtual void onValueChanged(size_t slot, const TagData& tag, const UA_DataValue& dv) = 0;
+        // Конец цикла опроса: здесь удобно сбрасывать накопленный пакет
+        virtual void onCycleEnd() {}
+        // Время значений пошло назад (перемотка записи): ряды, свёртки и состояние по
+        // времени сбрасываются, дальше значения придут заново. Под теми же блокировками
+        virtual void onReset() {}
+    };
+
+    // Строка диагностики задержек: сервер, операция и квантили в наносекундах
+    struct LatencyRow {
+        std::string server;
+        std::string operation;
+        uint64_t count;
+        uint64_t p50;
+        uint64_t p99;
+        uint64_t p999;
+        uint64_t max;
     };
 
     OPCUAClient();
     ~OPCUAClient();
 
+    // Политика, режим и сертификаты канала (см. security.hpp); только до connectToServer
+    bool configureSecurity(const SecurityConfig& security, std::string* error = nullptr);
     bool connectToServer(const std::string& url);
     void disconnectFromServer();
+    // Сессия жива: сбрасывается, когда запрос или клиентская библиотека сообщают об обрыве
     bool isConnected() const { return connected; }
-    
+    // Время ответа, ошибки, продления канала и торможение при перегрузке сервера
+    ConnectionHealth::Snapshot connectionHealth() { return health.snapshot(); }
+
     std::vector<TagData> getTags();
+    // Один тег без копирования всего набора (видимые строки интерфейса)
+    bool getTag(size_t slot, TagData& out);
+    size_t tagCount();
+    // Меняется при любой смене набора тегов (clearTags, add*Tag): копии имён и
+    // индексы по слотам, снятые при другом значении, устарели
+    uint64_t tagSetGeneration() const { return tag_set_generation.load(std::memory_order_acquire); }
+    // Читает все теги одним запросом, независимо от расписания групп
     void updateValues();
+    // Читает теги, срок которых наступил, одним пакетным запросом
+    void poll();
+    // Фоновый поток опроса по расписанию (шаг 10 мс)
+    void startPolling();
+    void stopPolling();
     bool writeValue(const std::string& nodeId, double newValue);
 
+    // Набор тегов можно менять на лету (конфигурация, подключение к коллектору)
+    void clearTags();
+    size_t addTag(const std::string& name, const std::string& nodeId, size_t group = 0);
+    // Группа с таким именем уже есть — меняются её период и пределы;
+    // все периоды ограничены 10 мс .. 1 ч, пределы 0 — группа без адаптации
+    size_t addGroup(const std::string& name, uint32_t periodMs,
+                    uint32_t minPeriodMs = 0, uint32_t maxPeriodMs = 0);
+    std::vector<TagGroup> getGroups();
+    // Вычисляемый тег: выражение над уже добавленными тегами (см. expression.hpp).
+    // Пересчитывается, когда меняется любой из его входов
+    bool addComputedTag(const std::string& name, const std::string& expression,
+                        std::string* error = nullptr);
+    // Тег без опроса: значения приносит внешний источник через ingest (PubSub).
+    // source — описание источника вместо NodeId
+    size_t addExternalTag(const std::string& name, const std::string& source);
+    // Файл конфигурации заменяет набор тегов. Строки:
+    //   group <имя> <период_мс> [<мин_мс> <макс_мс>]
+    //   tag <имя> <nodeId> [группа]
+    //   calc <имя> <выражение до конца строки>
+    //   pubsub, reader, field — источник PubSub, их читает PubSubSource (pubsub_source.hpp)
+    // Пустые строки и строки с # пропускаются
+    bool loadTagConfig(const std::string& path);
+
+    void addSink(std::shared_ptr<ValueSink> sink);
+    // Публикация таблицы тегов в разделяемую память (см. shm_table.hpp);
+    // capacity == 0 — запас под текущий набор тегов
+    bool publishToSharedMemory(const std::string& name, uint32_t capacity = 0);
+
+    // Задержки connectToServer/updateValues/writeValue по каждому серверу
+    std::vector<LatencyRow> latencyReport();
+    bool dumpLatency(const std::string& path);
+    // Подписка на события узла-источника (ns=0;i=2253 — объект Server).
+    // fields — поля BaseEventType для select: Time, Severity, SourceName, Message, EventType...
+    // Уведомления принимает poll(); обработка события — только копия в кольцо журнала.
+    // Запрос запоминается: подписка создаётся сейчас, если есть соединение, и заново
+    // после каждого подключения. false — неверный NodeId или пустой список полей
+    bool subscribeEvents(const std::string& notifier, const std::vector<std::string>& fields,
+                         std::shared_ptr<EventLog> log);
+
+    // Внешние источники (коллектор, воспроизведение) кладут значения в то же хранилище
+    void ingest(size_t slot, const UA_DataValue& dv);
+    // Пачка значений под одной блокировкой; время в строке — момент вызова
+    void ingest(const uint32_t* slots, const UA_DataValue* values, size_t count);
+    void flushSinks();
+    // Вызывает onReset у всех приёмников (перемотка воспроизведения назад)
+    void resetSinks();
+
 private:
+    // Расписание одного тега (параллельно tags)
+    struct Schedule {
+        uint32_t periodTicks;
+        uint32_t minTicks;
+        uint32_t maxTicks;
+        uint64_t due;
+    };
+
+    void appendReadId(const std::string& nodeId);
+    // Возвращает true, если значение изменилось и ушло приёмникам
+    bool applyValueLocked(size_t slot, const UA_DataValue& dv, const char* timeText);
+    // adapt — результаты чтения по расписанию подстраивают интервалы тегов
+    void readSlots(const std::vector<uint32_t>& slots, bool adapt);
+    // Один запрос Read для части read_batch, под client_mutex; false — дальше не читать
+    bool readChunkLocked(size_t offset, size_t count, uint64_t generation, bool adapt);
+    // Обрыв сессии, под client_mutex: переподключается вызывающий (коллектор, интерфейс)
+    void dropSessionLocked();
+    void renewChannelLocked();
+    void adaptLocked(size_t slot, bool changed);
+    void applyGroupLocked(size_t slot);
+    void evaluateComputedLocked(const char* timeText);
+    uint64_t nowTick() const;
+
+    struct EventSubscription {
+        UA_NodeId notifier;
+        std::vector<std::string> fields;
+        std::shared_ptr<EventLog> log;
+    };
+    // Под client_mutex при наличии соединения
+    void resubscribeEventsLocked();
+    bool monitorEventsLocked(EventSubscription& sub);
+    static void eventCallback(UA_Client* client, UA_UInt32 subId, void* subContext,
+                              UA_UInt32 monId, void* monContext,
+                              size_t nEventFields, UA_Variant* eventFields);
+    static void stateCallback(UA_Client* client, UA_SecureChannelState channelState,
+                              UA_SessionState sessionState, UA_StatusCode connectStatus);
+    static void inactivityCallback(UA_Client* client, UA_UInt32 subId, void* subContext);
+    void installCallbacks(UA_ClientConfig* config);
+
     UA_Client *client;
-    bool connected;
+    std::atomic<bool> connected;
+    // Сетевые вызовы идут под этой блокировкой, а не под tags_mutex,
+    // чтобы медленный сервер не задерживал интерфейс и приёмники
+    std::mutex client_mutex;
     std::vector<TagData> tags;
+    std::unordered_map<std::string, size_t> slot_by_name;
+    ComputedTags computed;
     std::mutex tags_mutex;
+    // Меняется при clearTags: ответ, полученный для старого набора, отбрасывается
+    uint64_t tags_generation;
+    std::atomic<uint64_t> tag_set_generation;
+
+    // ReadValueId каждого тега собираются один раз; запрос — их подмножество
+    std::vector<UA_ReadValueId> read_ids;
+    // Буферы пакетного чтения, под client_mutex
+    std::vector<UA_ReadValueId> read_batch;
+    std::vector<uint32_t> read_batch_slots;
+
+    std::vector<TagGroup> groups;
+    std::vector<Schedule> schedules;
+    TimingWheel wheel;
+    std::chrono::steady_clock::time_point poll_epoch;
+    std::thread poll_thread;
+    std::atomic<bool> polling;
+
+    // Одна подписка на все источники событий; 0 — ещё не создана
+    std::atomic<UA_UInt32> subscription_id;
+    UA_UInt32 stale_subscription_id;  // подписка оборванного канала, удаляется после подключения
+    std::vector<std::unique_ptr<EventSubscription>> event_subscriptions;
+
+    std::vector<std::shared_ptr<ValueSink>> sinks;
+    std::mutex sinks_mutex;
+    // Таблица в разделяемой памяти освобождает слоты при clearTags, под tags_mutex
+    std::shared_ptr<ShmPublisher> shm_publisher;
+
+    // Гистограммы живут до конца работы клиента, поэтому указатель на текущую безопасен;
+    // сам указатель меняется и читается только под client_mutex
+    std::map<std::string, std::unique_ptr<LatencyStats>> latency_by_server;
+    LatencyStats* current_latency;
+    std::mutex latency_mutex;
+    bool had_session;
+    ConnectionHealth health;
+    // Когда в следующий раз пробовать продлить канал (монотонные нс), под client_mutex
+    int64_t next_renewal_ns;
+    int metrics_collector_id;
+    int tags_collector_id;
 };
 
 #endif
\ No newline at end of file
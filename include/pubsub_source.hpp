@@ -0,0 +1,119 @@
+#ifndef PUBSUB_SOURCE_HPP
+#define PUBSUB_SOURCE_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+#include <open62541/server.h>
+#include "opcua_client.hpp"
+
+// Источник значений OPC UA PubSub (UADP поверх UDP): контроллеры рассылают
+// NetworkMessage с циклом 1-10 мс, которого опрос сервера не выдерживает.
+// Настраивается строками того же файла конфигурации тегов (OPCUAClient::loadTagConfig их пропускает):
+//   pubsub <соединение> <opc.udp://адрес:порт> [сетевой интерфейс]
+//   reader <имя> <соединение> <PublisherId> <WriterGroupId> <DataSetWriterId>
+//   field <тег> <reader> <тип>
+// Поля DataSet нумеруются по порядку строк field своего reader; типы — bool, int16, uint16,
+// int32, uint32, int64, uint64, float, double (только скаляры). PublisherId — UInt16.
+// Разбираются только ключевые кадры: у издателя DataSetWriter должен быть с keyFrameCount = 1.
+// Каждое поле — отдельный тег без опроса; значение приходит с временем приёма (serverTime).
+// Приём идёт во встроенном сервере open62541 без TCP в собственном потоке. Декодер копирует
+// значение поля прямо в заранее выделенный буфер (externalDataValue), без Write в адресное
+// пространство; изменения за один проход цикла сети уходят в хранилище одной пачкой
+struct PubSubConnection {
+    std::string name;
+    std::string url;
+    std::string networkInterface;  // пусто — по умолчанию системы
+};
+
+struct PubSubReader {
+    std::string name;
+    std::string connection;
+    uint16_t publisherId;
+    uint16_t writerGroupId;
+    uint16_t dataSetWriterId;
+};
+
+struct PubSubField {
+    std::string tag;
+    std::string reader;
+    int type;  // индекс в UA_TYPES
+};
+
+struct PubSubConfig {
+    std::vector<PubSubConnection> connections;
+    std::vector<PubSubReader> readers;
+    std::vector<PubSubField> fields;
+};
+
+// Строки других видов (group, tag, calc) пропускаются; пустая конфигурация — не ошибка
+bool parsePubSubConfig(const std::string& text, PubSubConfig& out, std::string* error = nullptr);
+// Индекс UA_TYPES по имени типа поля, -1 — неизвестный
+int parsePubSubType(const std::string& name);
+// Значение поля в буфере декодера; false — тип не числовой
+bool pubsubFieldToDouble(int type, const void* data, double& out);
+
+class PubSubSource {
+public:
+    explicit PubSubSource(OPCUAClient& store);
+    ~PubSubSource();
+
+    // Разбирает файл конфигурации тегов и добавляет в хранилище теги полей.
+    // Вызывается после OPCUAClient::loadTagConfig: та заменяет весь набор тегов
+    bool loadConfig(const std::string& path, std::string* error = nullptr);
+    bool configure(const PubSubConfig& config, std::string* error = nullptr);
+    bool empty() const { return config.readers.empty(); }
+
+    // Поднимает соединения и читателей, затем запускает поток приёма
+    bool start(std::string* error = nullptr);
+    void stop();
+    bool running() const { return is_running.load(); }
+
+    uint64_t received() const { return values_received.load(std::memory_order_relaxed); }
+    uint64_t batches() const { return batches_delivered.load(std::memory_order_relaxed); }
+
+private:
+    // Буфер поля: декодер пишет в storage через value_ptr, afterWrite ставит значение в очередь.
+    // Декодер копирует memSize пришедшего типа, а не объявленного, поэтому буфер вмещает
+    // любой встроенный тип, если издатель прислал не то, что описано в field
+    struct Field {
+        PubSubSource* owner;
+        uint32_t slot;
+        int type;
+        UA_DataValue value;
+        UA_DataValue* value_ptr;
+        alignas(16) uint8_t storage[128];
+    };
+    struct Pending {
+        uint32_t slot;
+        double value;
+        UA_DateTime received;
+    };
+
+    static void afterWrite(UA_Server* server, const UA_NodeId* readerId, const UA_NodeId* readerGroupId,
+                           const UA_NodeId* targetId, void* context, UA_DataValue** value);
+    bool setup(std::string* error);
+    void receiveLoop();
+    void deliver();
+
+    OPCUAClient& store;
+    PubSubConfig config;
+    std::vector<uint32_t> slots;  // слот тега каждого поля config.fields
+
+    UA_Server* server;
+    // Размер задаётся один раз в start: декодер держит указатели на элементы
+    std::vector<Field> fields;
+    // Очередь и буферы пачки — только поток приёма, ёмкость сохраняется между проходами
+    std::vector<Pending> pending;
+    std::vector<uint32_t> batch_slots;
+    std::vector<UA_DataValue> batch_values;
+
+    std::thread receiver;
+    std::atomic<bool> is_running;
+    std::atomic<uint64_t> values_received;
+    std::atomic<uint64_t> batches_delivered;
+};
+
+#endif
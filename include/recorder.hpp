@@ -0,0 +1,184 @@
+#ifndef RECORDER_HPP
+#define RECORDER_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "opcua_client.hpp"
+
+// Файл записи сессии (числа little-endian):
+//   заголовок  "OPCUREC1", u32 число тегов, теги: (u16 len, имя, u16 len, NodeId)
+//   блоки      u32 "BLK2", u32 исходный размер, u32 сжатый размер, u32 записей,
+//              i64 время приёма первой и последней записи, затем данные блока
+//   индекс     u32 "IDX2", u32 блоков, блоки: (u64 смещение, i64 первое, i64 последнее, u32 записей,
+//              u32 записей TAG), в конце u64 смещение индекса и "OPCUIDX1"
+// Записи внутри блока — дельты от предыдущей записи того же блока (varint),
+// поэтому каждый блок читается независимо. Время приёма пишется только в первой
+// записи цикла опроса, дельтой дельт между циклами. Скалярный Double хранится без
+// типа и длины: первый в блоке для слота — 8 байтами, следующие — XOR с предыдущим
+// значением слота (значимые байты). Сжатие блока — LZ77 с 64-КБ окном;
+// если оно не дало выигрыша, блок хранится как есть (сжатый размер == исходному).
+// Блоки "BLK1" прежнего формата (время приёма в каждой записи, Double без XOR)
+// и индекс "IDX1" (без числа записей TAG) читаются. Файл без индекса (запись
+// оборвалась) читается сканированием блоков
+struct RecordedTag {
+    std::string name;
+    std::string nodeId;
+};
+
+struct RecordedChange {
+    enum Kind : uint8_t {
+        VALUE = 0,  // изменение значения
+        TAG = 1     // слот получил новый тег (набор тегов сменился во время записи)
+    };
+    Kind kind;
+    uint32_t slot;
+    UA_StatusCode status;
+    UA_DateTime received;    // время приёма клиентом
+    UA_DateTime sourceTime;  // 0 — нет в ответе
+    UA_DateTime serverTime;
+    // VALUE: Variant в двоичной кодировке OPC UA, пусто — ответ без значения;
+    // TAG: имя, '\0', NodeId
+    std::string bytes;
+};
+
+// Приёмник, записывающий каждое изменение в файл сессии.
+// onValueChanged только копирует запись в кольцевую очередь без блокировок;
+// кодирование, сжатие и запись на диск — в фоновом потоке.
+// Если поток записи отстаёт и очередь полна, запись теряется и учитывается в dropped()
+class SessionRecorder : public OPCUAClient::ValueSink {
+public:
+    static const size_t BLOCK_SIZE = 64 * 1024;
+
+    explicit SessionRecorder(size_t queueBytes = 4 << 20);
+    ~SessionRecorder() override;
+
+    // tags — набор тегов на момент начала записи (заголовок файла)
+    bool open(const std::string& path, const std::vector<OPCUAClient::TagData>& tags);
+    // Дописывает очередь и индекс блоков
+    void close();
+    bool isOpen() const { return file != nullptr; }
+
+    uint64_t recorded() const { return records_written.load(std::memory_order_relaxed); }
+    uint64_t dropped() const { return records_dropped.load(std::memory_order_relaxed); }
+
+    void onValueChanged(size_t slot, const OPCUAClient::TagData& tag, const UA_DataValue& dv) override;
+    void onCycleEnd() override { cycle_time = 0; }
+
+private:
+    struct BlockInfo {
+        uint64_t offset;
+        int64_t first;
+        int64_t last;
+        uint32_t records;
+        uint32_t tagRecords;
+    };
+
+    // Приёмники вызываются под блокировкой клиента, поэтому производитель всегда один.
+    // head — заголовок записи; размер и длину тела (всё после QueuedChange) проставляет enqueue
+    bool enqueue(const void* head, size_t headLen, const void* body, size_t bodyLen);
+    void writerLoop();
+    size_t drain();
+    void encodeEntry(const uint8_t* entry);
+    void flushBlock();
+
+    FILE* file;
+
+    // Очередь: записи переменной длины, выровненные на 8 байт.
+    // Голова и хвост в разных строках кэша; производитель перечитывает хвост,
+    // только когда по старому значению места не хватает
+    std::vector<uint8_t> queue;
+    size_t queue_mask;
+    alignas(64) std::atomic<uint64_t> queue_head;
+    uint64_t tail_cache;
+
+    // Имена тегов по слотам, как их видит производитель
+    std::vector<std::string> names;
+    std::vector<uint8_t> scratch;
+    UA_DateTime cycle_time;  // время приёма текущего цикла, 0 — ещё не взято
+
+    // Состояние потока записи
+    alignas(64) std::atomic<uint64_t> queue_tail;
+    int64_t cycle_received;
+    std::vector<uint8_t> block;
+    size_t block_len;
+    std::vector<uint8_t> packed;
+    uint32_t block_records;
+    uint32_t block_tag_records;
+    int64_t block_first;
+    int64_t block_last;
+    uint32_t prev_slot;
+    int64_t prev_received;
+    int64_t prev_source;
+    int64_t prev_server;
+    int64_t prev_cycle_gap;
+    // Предыдущий Double слота; действителен, если slot_block совпадает с номером блока
+    uint32_t block_serial;
+    std::vector<uint64_t> slot_double;
+    std::vector<uint32_t> slot_block;
+    uint64_t file_offset;
+    std::vector<BlockInfo> index;
+
+    std::thread writer;
+    std::mutex wake_mutex;
+    std::condition_variable wake;
+    bool stopping;
+    std::atomic<bool> accepting;
+
+    std::atomic<uint64_t> records_written;
+    std::atomic<uint64_t> records_dropped;
+};
+
+// Чтение файла сессии поблочно
+class RecordingReader {
+public:
+    struct Block {
+        uint64_t offset;
+        UA_DateTime first;
+        UA_DateTime last;
+        uint32_t records;
+        // Записей TAG в блоке; TAGS_UNKNOWN — индекс старого формата или восстановлен
+        uint32_t tagRecords;
+    };
+    static const uint32_t TAGS_UNKNOWN = 0xffffffffu;
+
+    RecordingReader() : file(nullptr), recovered(false), block_serial(0) {}
+    ~RecordingReader();
+
+    bool open(const std::string& path);
+    const std::vector<RecordedTag>& tags() const { return tag_table; }
+    const std::vector<Block>& blocks() const { return block_index; }
+    // true — индекса в файле не было, он восстановлен сканированием
+    bool indexRecovered() const { return recovered; }
+
+    bool readBlock(size_t i, std::vector<RecordedChange>& out);
+    // Variant записи VALUE вместе со статусом и метками времени
+    static bool toDataValue(const RecordedChange& change, UA_DataValue& out);
+
+private:
+    bool readIndex(uint64_t fileSize);
+    void scanBlocks(uint64_t fileSize);
+
+    FILE* file;
+    uint64_t data_start;
+    bool recovered;
+    std::vector<RecordedTag> tag_table;
+    std::vector<Block> block_index;
+    std::vector<uint8_t> raw;
+    std::vector<uint8_t> packed;
+    uint32_t block_serial;
+    std::vector<uint64_t> slot_double;
+    std::vector<uint32_t> slot_block;
+};
+
+// LZ77-сжатие блока; 0 — выход не поместился в out
+size_t lzCompress(const uint8_t* in, size_t len, uint8_t* out, size_t cap);
+// false — повреждённые данные или размер не совпал с ожидаемым
+bool lzDecompress(const uint8_t* in, size_t len, uint8_t* out, size_t expected);
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef REPLAY_HPP
+#define REPLAY_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "opcua_client.hpp"
+#include "recorder.hpp"
+
+// Воспроизведение записанной сессии (см. recorder.hpp) в хранилище тегов:
+// значения проходят через ingest/flushSinks, как при опросе или от коллектора,
+// поэтому приёмники и интерфейс работают без изменений и без сервера.
+// Темп задаётся по времени приёма записей: 1 — как в записи, N — в N раз быстрее,
+// 0 — без пауз. Перемотка ищет блок по индексу и продолжает с первой записи
+// не раньше заданного времени; значения тегов, не менявшихся после этой точки,
+// остаются прежними, пока не придёт их следующее изменение. Перемотка назад
+// сбрасывает накопленное приёмниками (ValueSink::onReset)
+class SessionPlayer {
+public:
+    explicit SessionPlayer(OPCUAClient& store);
+    ~SessionPlayer();
+
+    // Заменяет набор тегов хранилища тегами из заголовка записи
+    bool open(const std::string& path);
+
+    void setSpeed(double speed);
+    double speed();
+    void setPaused(bool paused);
+    bool paused();
+    void seek(UA_DateTime time);
+    void seekBy(int64_t delta);
+
+    UA_DateTime begin() const { return first_time; }
+    UA_DateTime end() const { return last_time; }
+    UA_DateTime position();
+    bool finished();
+    uint64_t applied() const { return records_applied.load(std::memory_order_relaxed); }
+
+    // Применяет записи, срок которых наступил (не больше maxRecords); возвращает их число
+    size_t step(size_t maxRecords = 4096);
+    // Фоновый поток воспроизведения
+    void start();
+    void stop();
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    bool loadBlockLocked(size_t block);
+    UA_DateTime positionLocked(Clock::time_point now) const;
+    void rebaseLocked(UA_DateTime at);
+    void applyLocked(const RecordedChange& change);
+    void addTagLocked(uint32_t slot, const std::string& name, const std::string& nodeId);
+    // Записи TAG блока; блок, где они по индексу есть, читается для этого один раз,
+    // при первой перемотке через него
+    const std::vector<RecordedChange>& blockTagsLocked(size_t block);
+    // Приводит хранилище к набору тегов table; совпадающий набор не трогает
+    void setTagTableLocked(const std::vector<RecordedTag>& table);
+
+    OPCUAClient& store;
+    RecordingReader reader;
+    std::mutex mutex;
+
+    // Текущий блок и позиция в нём
+    size_t block_index;
+    std::vector<RecordedChange> records;
+    size_t next_record;
+    bool at_end;
+
+    // Темп: позиция записи = base_time + (сейчас - base_wall) * speed
+    double play_speed;
+    bool is_paused;
+    UA_DateTime base_time;
+    Clock::time_point base_wall;
+    UA_DateTime last_applied;
+    UA_DateTime first_time;
+    UA_DateTime last_time;
+
+    // Теги по слотам, как их видит воспроизведение
+    std::vector<RecordedTag> tag_table;
+    std::vector<std::vector<RecordedChange>> block_tags;
+    std::vector<uint8_t> block_tags_read;
+
+    std::atomic<uint64_t> records_applied;
+    std::atomic<bool> running;
+    std::thread worker;
+};
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef ROLLUP_HPP
+#define ROLLUP_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Сводка значений за интервал [start, start + ширина ступени)
+struct RollupBucket {
+    int64_t start;  // мс от 1970 г.
+    double min;
+    double max;
+    double sum;
+    double last;
+    uint32_t count;
+
+    double mean() const { return count ? sum / (double)count : 0.0; }
+    void add(double v);
+    // b — более поздний интервал: last берётся из него, start остаётся
+    void merge(const RollupBucket& b);
+};
+
+// Ступени свёртки одного тега: 1 с, 1 мин, 1 ч. Каждая ступень — кольцо последних
+// непустых интервалов; значение добавляется во все ступени сразу, за O(1).
+// Интервалы без изменений не хранятся, поэтому редко меняющийся тег помнит дольше.
+// Значение с меткой раньше последнего интервала (часы источника ушли назад)
+// учитывается в последнем интервале
+class RollupSeries {
+public:
+    static const size_t TIERS = 3;
+    static int64_t tierMs(size_t tier);
+
+    // По умолчанию: 10 мин секундных интервалов, сутки минутных, 30 суток часовых
+    explicit RollupSeries(size_t secondBuckets = 600, size_t minuteBuckets = 1440, size_t hourBuckets = 720);
+
+    // Возвращает, сколько интервалов добавилось в память (для учёта объёма)
+    size_t add(int64_t timeMs, double value);
+    void clear();
+    // Интервалов во всех ступенях
+    size_t bucketCount() const;
+    // Начало самого старого интервала ступени; false — ступень пуста
+    bool oldest(size_t tier, int64_t& start) const;
+    // Интервалы ступени, пересекающие [fromMs, toMs), от старых к новым
+    void copy(size_t tier, int64_t fromMs, int64_t toMs, std::vector<RollupBucket>& out) const;
+    // Последнее значение интервала, начавшегося раньше ms, из самой мелкой ступени,
+    // которая помнит это время; false — ступени начинаются не раньше ms
+    bool lastBefore(int64_t ms, double& value) const;
+
+private:
+    struct Tier {
+        int64_t width;
+        size_t capacity;
+        std::vector<RollupBucket> buckets;
+        size_t head;  // самый старый интервал заполненного кольца
+    };
+
+    static size_t newest(const Tier& t);
+
+    Tier tiers[TIERS];
+};
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef SECURITY_HPP
+#define SECURITY_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <open62541/client.h>
+
+// Защищённый канал клиента.
+// policy — короткое имя (None, Basic256Sha256, Aes128_Sha256_RsaOaep, Aes256_Sha256_RsaPss)
+// или полный URI; mode — none, sign, signencrypt (пусто — signencrypt для политик
+// с шифрованием, none для None). Без сертификата и ключа создаётся самоподписанный
+// (RSA 2048, только в памяти процесса). trust — сертификаты серверов, которым
+// доверяем (DER или PEM); без них нужен явный acceptAnyServer.
+// Асимметричное рукопожатие (OPN, CreateSession) дорогое, поэтому канал
+// и сессия по умолчанию живут час: продления редки, а после обрыва канала
+// клиент активирует прежнюю сессию на новом канале вместо создания новой
+struct SecurityConfig {
+    std::string policy;
+    std::string mode;
+    std::string certificate;
+    std::string privateKey;
+    std::vector<std::string> trust;
+    bool acceptAnyServer;
+    uint32_t channelLifetimeMs;  // сервер может сократить до своего предела
+    uint32_t sessionTimeoutMs;
+
+    SecurityConfig()
+        : policy("None"), acceptAnyServer(false), channelLifetimeMs(3600 * 1000), sessionTimeoutMs(3600 * 1000) {}
+};
+
+// Полный URI политики; пустая строка — политика неизвестна
+std::string securityPolicyUri(const std::string& name);
+bool parseSecurityMode(const std::string& text, UA_MessageSecurityMode& out);
+// "a.der,b.pem" — список доверенных сертификатов, "any" — принимать любой сертификат сервера
+void parseTrustArgument(const std::string& text, SecurityConfig& out);
+
+// Настраивает конфигурацию клиента; вызывается до подключения
+bool applySecurity(UA_ClientConfig* config, const SecurityConfig& security, std::string* error = nullptr);
+
+// Самоподписанный сертификат (DER) и ключ; applicationUri попадает в SubjectAltName.
+// Результат освобождает вызывающий (UA_ByteString_clear)
+bool createSelfSignedCertificate(const std::string& applicationUri, UA_ByteString& certificate,
+                                 UA_ByteString& privateKey, uint16_t keyBits = 2048);
+bool loadByteString(const std::string& path, UA_ByteString& out);
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef SHM_TABLE_HPP
+#define SHM_TABLE_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include "opcua_client.hpp"
+
+// Таблица тегов в разделяемой памяти POSIX с фиксированной раскладкой.
+// Массивы хранятся по столбцам (SoA), у каждого слота свой seqlock-счётчик:
+// нечётное значение — идёт запись, читатель повторяет попытку.
+struct ShmLayout {
+    static const uint64_t MAGIC = 0x4F50435541544142ULL;  // "OPCUATAB"
+    static const uint32_t VERSION = 1;
+    static const size_t NAME_SIZE = 64;
+
+    struct Header {
+        uint64_t magic;
+        uint32_t version;
+        uint32_t capacity;
+        std::atomic<uint32_t> count;
+        uint32_t reserved;
+        // Смещения столбцов от начала сегмента
+        uint64_t valuesOffset;
+        uint64_t sourceTimeOffset;
+        uint64_t statusOffset;
+        uint64_t seqOffset;
+        uint64_t namesOffset;
+        uint64_t nodeIdsOffset;
+        uint64_t totalSize;
+    };
+
+    static uint64_t align(uint64_t v) { return (v + 63) & ~uint64_t(63); }
+    // Заполняет всё, кроме magic и count: magic публикуется отдельно, последним
+    static void describe(uint32_t capacity, Header& h);
+};
+
+// Запись таблицы: подключается к OPCUAClient как получатель изменений
+class ShmPublisher : public OPCUAClient::ValueSink {
+public:
+    ShmPublisher();
+    ~ShmPublisher() override;
+
+    bool create(const std::string& name, uint32_t capacity);
+    bool isOpen() const { return base != nullptr; }
+
+    void onValueChanged(size_t slot, const OPCUAClient::TagData& tag, const UA_DataValue& dv) override;
+    // Набор тегов сократился или заменён: слоты с count и дальше освобождаются.
+    // Вызывается владельцем под той же блокировкой, что и onValueChanged
+    void truncate(uint32_t count);
+
+private:
+    char* base;
+    size_t mapped;
+    std::string shm_name;
+};
+
+// Читатель: после open() не делает системных вызовов и не берёт блокировок
+class ShmTagReader {
+public:
+    struct Sample {
+        double value;
+        int64_t sourceTime;
+        uint32_t status;
+        uint32_t version;  // меняется при каждой записи слота
+    };
+
+    ShmTagReader();
+    ~ShmTagReader();
+
+    bool open(const std::string& name);
+    bool isOpen() const { return base != nullptr; }
+
+    uint32_t size() const;
+    std::string name(uint32_t slot) const;
+    std::string nodeId(uint32_t slot) const;
+    // Согласованное чтение слота; false — слот пуст или вне таблицы
+    bool read(uint32_t slot, Sample& out) const;
+
+private:
+    std::string readCell(uint32_t slot, uint64_t offset) const;
+
+    const char* base;
+    size_t mapped;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,71 @@
+#ifndef SPECTRUM_HPP
+#define SPECTRUM_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// БПФ вещественного сигнала длины n (степень двойки, не меньше 4): комплексное БПФ
+// половинной длины по чётным/нечётным отсчётам и разделение спектров.
+// Таблицы перестановки и поворотных множителей считаются в конструкторе; множители
+// каждого этапа лежат подряд, поэтому внутренний цикл читает их последовательно.
+// Рабочие буферы принадлежат плану — forward не выделяет память
+class FftPlan {
+public:
+    explicit FftPlan(size_t n);
+
+    size_t size() const { return n; }
+    // Бины 0..n/2 в re[0..n/2], im[0..n/2]
+    void forward(const double* in, double* re_out, double* im_out);
+
+private:
+    size_t n;
+    size_t half;
+    std::vector<uint32_t> bitrev;
+    std::vector<double> stage_re;  // exp(-2πij/len) для len = 2, 4, ..., half подряд
+    std::vector<double> stage_im;
+    std::vector<double> split_re;  // exp(-2πik/n), k = 0..half
+    std::vector<double> split_im;
+    std::vector<double> work_re;
+    std::vector<double> work_im;
+};
+
+// Амплитудный спектр по методу Уэлча: сегменты длины fftSize с перекрытием overlap
+// (доля, 0..0.9), окно Ханна, среднее по сегментам мощности. Из каждого сегмента
+// вычитается среднее, иначе постоянная составляющая забивает шкалу.
+// План и буферы переиспользуются между вызовами
+class SpectrumAnalyzer {
+public:
+    explicit SpectrumAnalyzer(size_t fftSize = 4096, double overlap = 0.5);
+
+    // Амплитуды бинов 0..size/2, бин k — частота k * fs / size. Если отсчётов меньше
+    // fftSize, размер — наибольшая степень двойки, которая в них помещается;
+    // меньше 8 отсчётов — false. Сегменты берутся от самых новых отсчётов
+    bool compute(const std::vector<double>& samples, std::vector<double>& out);
+    size_t size() const { return plan ? plan->size() : 0; }
+    size_t segments() const { return last_segments; }
+
+private:
+    void prepare(size_t n);
+
+    size_t max_size;
+    double overlap;
+    std::unique_ptr<FftPlan> plan;
+    std::vector<double> window;
+    double window_sum;
+    std::vector<double> segment;
+    std::vector<double> re;
+    std::vector<double> im;
+    std::vector<double> power;
+    size_t last_segments;
+};
+
+// Ряд, записанный по изменениям (times — мс, по возрастанию), на равномерную сетку
+// с шагом stepMs, кончающуюся на последней точке: в узле — последнее значение не позже
+// него, ведь между изменениями значение держится. Берутся последние maxPoints узлов.
+// Шаг 0 — медиана интервалов между точками. Возвращает шаг сетки, 0 — точек меньше двух
+int64_t resampleHold(const std::vector<int64_t>& times, const std::vector<double>& values, int64_t stepMs,
+                     size_t maxPoints, std::vector<double>& out);
+
+#endif
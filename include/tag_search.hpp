@@ -0,0 +1,46 @@
+#ifndef TAG_SEARCH_HPP
+#define TAG_SEARCH_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Нечёткий поиск тегов по имени и NodeId без учёта регистра.
+// Запрос от трёх символов ищется по триграммному индексу: кандидаты — теги,
+// с которыми совпадает хотя бы половина триграмм запроса (терпит опечатки),
+// точное вхождение и совпадение с начала поднимают тег выше.
+// Короткий запрос — поиск по началу имени или NodeId в отсортированном списке.
+// Не потокобезопасен: поиск переиспользует рабочие массивы
+class TagIndex {
+public:
+    TagIndex() : prefix_sorted(true) {}
+
+    void clear();
+    // id — слот тега, добавляются по возрастанию
+    void add(uint32_t id, const std::string& name, const std::string& nodeId);
+    size_t size() const { return ids.size(); }
+
+    // Слоты лучших совпадений, не больше limit
+    std::vector<uint32_t> search(const std::string& query, size_t limit);
+
+private:
+    void addTrigrams(const std::string& key, std::vector<uint32_t>& out) const;
+    std::vector<uint32_t> searchPrefix(const std::string& query, size_t limit);
+
+    std::vector<uint32_t> ids;
+    std::vector<std::string> names;    // в нижнем регистре
+    std::vector<std::string> node_ids;
+    std::unordered_map<uint32_t, std::vector<uint32_t>> postings;  // триграмма → позиции в ids
+
+    // Поля обоих видов вперемешку, сортируются перед первым коротким запросом
+    std::vector<std::pair<std::string, uint32_t>> prefixes;
+    bool prefix_sorted;
+
+    std::vector<uint16_t> hits;        // совпавших триграмм по позициям
+    std::vector<uint32_t> touched;
+};
+
+#endif
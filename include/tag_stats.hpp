@@ -0,0 +1,138 @@
+#ifndef TAG_STATS_HPP
+#define TAG_STATS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "opcua_client.hpp"
+
+// Моменты по алгоритму Уэлфорда: среднее и дисперсия без накопления сумм квадратов
+class RunningStats {
+public:
+    RunningStats() : n(0), mean_value(0.0), m2(0.0), min_value(0.0), max_value(0.0) {}
+
+    void add(double x);
+    uint64_t count() const { return n; }
+    double mean() const { return mean_value; }
+    double variance() const { return n > 1 ? m2 / (double)(n - 1) : 0.0; }
+    double stddev() const;
+    double min() const { return min_value; }
+    double max() const { return max_value; }
+
+private:
+    uint64_t n;
+    double mean_value;
+    double m2;
+    double min_value;
+    double max_value;
+};
+
+// Последние capacity значений: среднее и дисперсия — скользящим Уэлфордом,
+// минимум и максимум — монотонными очередями. Каждый add — O(1) (амортизированно)
+class SlidingWindow {
+public:
+    explicit SlidingWindow(size_t capacity);
+
+    void add(double x);
+    size_t size() const { return filled; }
+    double mean() const { return mean_value; }
+    double variance() const;
+    double stddev() const;
+    double min() const;
+    double max() const;
+
+private:
+    // Очередь номеров отсчётов фиксированной ёмкости
+    struct Wedge {
+        std::vector<uint64_t> seq;
+        size_t head;
+        size_t count;
+    };
+
+    double at(uint64_t s) const { return values[s % values.size()]; }
+    void pushWedge(Wedge& w, double x, bool keep_max);
+
+    std::vector<double> values;
+    uint64_t next_seq;
+    size_t filled;
+    double mean_value;
+    double m2;
+    Wedge max_wedge;
+    Wedge min_wedge;
+};
+
+// Оценка квантиля алгоритмом P² (Jain, Chlamtac): пять маркеров, O(1) на отсчёт
+class P2Quantile {
+public:
+    explicit P2Quantile(double q);
+
+    void add(double x);
+    void reset();
+    uint64_t count() const { return n; }
+    double value() const;
+
+private:
+    double p;
+    uint64_t n;
+    double heights[5];
+    double positions[5];
+    double desired[5];
+    double increments[5];
+};
+
+// Статистика одного тега: за всё время и по скользящему окну.
+// Квантили окна считаются парой P²-оценок, которые обнуляются по очереди
+// каждые window отсчётов; ответ даёт старшая, покрывающая от window до 2·window последних
+class TagStats {
+public:
+    struct Summary {
+        uint64_t count;     // всего отсчётов
+        size_t window;      // из них в окне
+        double mean;
+        double stddev;
+        double min;
+        double max;
+        double p50;
+        double p95;
+        double total_mean;
+        double total_stddev;
+    };
+
+    explicit TagStats(size_t window = 120);
+
+    void add(double x);
+    Summary summary() const;
+
+private:
+    size_t window_size;
+    RunningStats total;
+    SlidingWindow window;
+    P2Quantile p50[2];
+    P2Quantile p95[2];
+    int older;  // индекс пары, которая дольше копит отсчёты
+    size_t since_swap;
+};
+
+// Приёмник изменений: обновляет статистику тега на каждом изменении значения
+class StatsSink : public OPCUAClient::ValueSink {
+public:
+    explicit StatsSink(size_t window = 120) : window_size(window) {}
+
+    // false — по тегу ещё нет отсчётов
+    bool summary(size_t slot, const std::string& name, TagStats::Summary& out);
+
+    void onValueChanged(size_t slot, const OPCUAClient::TagData& tag, const UA_DataValue& dv) override;
+    void onReset() override;
+
+private:
+    size_t window_size;
+    std::mutex mutex;
+    // Имя сверяется, чтобы замена набора тегов не смешала статистику разных тегов
+    std::vector<std::string> names;
+    std::vector<std::unique_ptr<TagStats>> stats;
+};
+
+#endif
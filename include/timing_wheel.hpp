@@ -0,0 +1,43 @@
+#ifndef TIMING_WHEEL_HPP
+#define TIMING_WHEEL_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Иерархическое колесо таймеров: 4 уровня по 64 ячейки.
+// При шаге 10 мс уровни покрывают 0.64 с, 41 с, 44 мин и 46 ч;
+// вставка и срабатывание — O(1) на элемент (плюс редкие каскады между уровнями).
+class TimingWheel {
+public:
+    static constexpr int LEVELS = 4;
+    static constexpr int SLOT_BITS = 6;
+    static constexpr int SLOTS = 1 << SLOT_BITS;
+
+    explicit TimingWheel(uint64_t startTick = 0);
+
+    // Срок в прошлом срабатывает на ближайшем тике
+    void schedule(uint32_t id, uint64_t dueTick);
+    // Проходит все тики до nowTick включительно и дописывает сработавшие id в due
+    void advance(uint64_t nowTick, std::vector<uint32_t>& due);
+    void clear();
+
+    uint64_t currentTick() const { return current; }
+    size_t size() const { return pending; }
+
+private:
+    struct Entry {
+        uint32_t id;
+        uint64_t due;
+    };
+
+    void insert(const Entry& e);
+    void cascade(int level);
+
+    std::vector<Entry> slots[LEVELS][SLOTS];
+    std::vector<Entry> overflow;
+    uint64_t current;  // последний обработанный тик
+    size_t pending;
+};
+
+#endif
\ No newline at end of file
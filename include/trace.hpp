@@ -0,0 +1,46 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Трассировка в формате Chrome trace-event (открывается в Perfetto / chrome://tracing).
+// Каждый поток пишет события начала/конца в свой кольцевой буфер без блокировок,
+// фоновый поток забирает их и копит до выгрузки в JSON.
+// В выключенном состоянии TRACE_SCOPE стоит одну relaxed-загрузку флага.
+class Trace {
+public:
+    static bool enabled() { return enabled_flag.load(std::memory_order_relaxed); }
+    static void setEnabled(bool on);
+
+    // name должен жить всё время работы программы (строковый литерал)
+    static void begin(const char* name);
+    static void end(const char* name);
+
+    // Забирает накопленные события и пишет их в файл; буфер после записи очищается
+    static bool writeChromeJson(const std::string& path);
+    static size_t droppedEvents();
+
+private:
+    static std::atomic<bool> enabled_flag;
+};
+
+class TraceScope {
+public:
+    explicit TraceScope(const char* n) : name(Trace::enabled() ? n : nullptr) {
+        if (name) Trace::begin(name);
+    }
+    ~TraceScope() {
+        if (name) Trace::end(name);
+    }
+
+private:
+    const char* name;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(trace_scope_, __LINE__)(name)
+
+#endif
\ No newline at end of file
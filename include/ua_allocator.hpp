@@ -0,0 +1,56 @@
+#ifndef UA_ALLOCATOR_HPP
+#define UA_ALLOCATOR_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+// Аллокатор для open62541 (через UA_ENABLE_MALLOC_SINGLETON).
+// Память, освобождённую в течение цикла опроса, поток складывает в свой кэш
+// блоков по классам размеров и раздаёт её в следующем цикле, так что в
+// установившемся режиме декодирование ответа не обращается к системной куче.
+// Блоки — обычные блоки malloc без заголовков: если библиотека освободит
+// такой блок в другом потоке (или после снятия перехватчиков), это корректный free().
+class UaAllocator {
+public:
+    struct Stats {
+        uint64_t requests;       // вызовы malloc/calloc/realloc из open62541
+        uint64_t systemAllocs;   // из них дошли до системной кучи
+        uint64_t systemFrees;
+        uint64_t cachedBytes;    // сейчас лежит в кэше потока
+    };
+
+    // Собрана ли open62541 с заменяемыми функциями памяти
+    static bool available();
+
+    // Ставит перехватчики open62541 один раз на процесс, до появления других потоков,
+    // работающих с библиотекой. Поток без кэша они передают прямо в malloc/free
+    static void installHooks();
+    // Заводит кэш текущего потока (и ставит перехватчики, если их ещё нет).
+    // caching == false — только подсчёт, без кэша (для сравнения в бенчмарке).
+    // Кэш освобождается uninstallForThisThread или при завершении потока
+    static void installForThisThread(bool caching = true);
+    static void uninstallForThisThread();
+    static bool installedForThisThread();
+
+    static Stats threadStats();
+    // Возвращает лишнее системе, оставляя в кэше не больше keepBytes
+    static void trim(size_t keepBytes);
+
+    // Граница цикла опроса: после неё всё, что декодер выделил, снова в кэше
+    class CycleScope {
+    public:
+        CycleScope();
+        ~CycleScope();
+        uint64_t systemAllocs() const;
+
+    private:
+        uint64_t start_allocs;
+    };
+
+    static void* allocate(size_t size);
+    static void* allocateZeroed(size_t count, size_t size);
+    static void* reallocate(void* ptr, size_t size);
+    static void release(void* ptr);
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,65 @@
+#ifndef WAVEFORM_HPP
+#define WAVEFORM_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "opcua_client.hpp"
+
+// Теги-осциллограммы: датчики вибрации отдают массив отсчётов (обычно 4096 Float или Int16)
+// за одно чтение. Тип массива проверяется один раз на блок, дальше — преобразование без
+// ветвлений на отсчёт: SSE2 на x86-64, AVX2 при сборке с OPCUA_NATIVE_ARCH, иначе цикл,
+// который векторизует компилятор
+
+// Числовой массив в варианте (Int16, UInt16, Int32, UInt32, Float, Double); 0 — не массив
+// или тип не числовой
+size_t waveformLength(const UA_Variant& v);
+// Отсчёты массива в out[0..waveformLength); false — вариант не осциллограмма
+bool convertWaveform(const UA_Variant& v, double* out);
+void convertSamples(const int16_t* in, size_t n, double* out);
+void convertSamples(const float* in, size_t n, double* out);
+// Среднеквадратичное значение массива — скалярное значение тега-осциллограммы
+// (графики трендов, тревоги, вычисляемые теги)
+bool waveformRms(const UA_Variant& v, double& out);
+
+// История осциллограмм: кольцо последних depth блоков каждого тега. Буферы блоков
+// выделяются при первом заполнении и дальше переиспользуются
+class WaveformSink : public OPCUAClient::ValueSink {
+public:
+    explicit WaveformSink(size_t depth = 8) : depth(depth ? depth : 1), stored(0) {}
+
+    // Последний блок тега. sequence — номер уже полученного блока: если новее нет,
+    // out не трогается (интерфейс и спектр не пересчитываются без новых данных).
+    // false — у тега нет осциллограмм
+    bool latest(size_t slot, const std::string& name, std::vector<double>& out, uint64_t& sequence);
+    // Последние samples отсчётов подряд по нескольким блокам (скользящее окно);
+    // отсчётов может оказаться меньше, если столько ещё не пришло
+    bool recent(size_t slot, const std::string& name, size_t samples, std::vector<double>& out,
+                uint64_t& sequence);
+    size_t memoryBytes();
+
+    void onValueChanged(size_t slot, const OPCUAClient::TagData& tag, const UA_DataValue& dv) override;
+    void onReset() override;
+
+private:
+    struct Block {
+        UA_DateTime time;
+        std::vector<double> samples;
+    };
+    struct Ring {
+        std::string name;
+        std::vector<Block> blocks;
+        size_t head;       // куда ляжет следующий блок
+        size_t count;
+        uint64_t sequence;  // блоков получено всего, 0 — ещё ни одного
+    };
+
+    size_t depth;
+    size_t stored;  // отсчётов во всех кольцах
+    std::mutex mutex;
+    std::vector<Ring> rings;
+};
+
+#endif
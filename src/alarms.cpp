@@ -0,0 +1,242 @@
+#include "../include/alarms.hpp"
+#include "../include/metrics.hpp"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+namespace {
+
+// Шаг колеса устаревания
+const int STALE_TICK_MS = 100;
+
+int64_t monotonicMs() {
+    return UA_DateTime_nowMonotonic() / UA_DATETIME_MSEC;
+}
+
+struct AlarmMetrics {
+    Gauge& active;
+    ShardedCounter& activations;
+};
+
+AlarmMetrics& metrics() {
+    auto& r = MetricsRegistry::instance();
+    static AlarmMetrics m{
+        r.gauge("opcua_alarms_active", "Currently active alarms"),
+        r.counter("opcua_alarm_activations_total", "Alarm activations"),
+    };
+    return m;
+}
+
+bool parseKind(const std::string& text, AlarmRule::Kind& kind) {
+    static const std::pair<const char*, AlarmRule::Kind> names[] = {
+        {"hihi", AlarmRule::HIHI}, {"hi", AlarmRule::HI}, {"lo", AlarmRule::LO},
+        {"lolo", AlarmRule::LOLO}, {"roc", AlarmRule::ROC}, {"stale", AlarmRule::STALE},
+    };
+    for (const auto& n : names) {
+        if (text == n.first) {
+            kind = n.second;
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+AlarmEngine::AlarmEngine() : stale_wheel(tickOf(monotonicMs())) {}
+
+uint64_t AlarmEngine::tickOf(int64_t ms) const {
+    return (uint64_t)(ms / STALE_TICK_MS);
+}
+
+const char* AlarmEngine::kindName(AlarmRule::Kind kind) {
+    switch (kind) {
+    case AlarmRule::HIHI: return "HIHI";
+    case AlarmRule::HI: return "HI";
+    case AlarmRule::LO: return "LO";
+    case AlarmRule::LOLO: return "LOLO";
+    case AlarmRule::ROC: return "ROC";
+    case AlarmRule::STALE: return "STALE";
+    }
+    return "?";
+}
+
+size_t AlarmEngine::addRule(const AlarmRule& rule) {
+    std::lock_guard<std::mutex> lock(mutex);
+    uint32_t id = (uint32_t)rules.size();
+    int64_t now = monotonicMs();
+    rules.push_back({rule.kind, false, false, false, -1, rule.limit, std::max(0.0, rule.deadband),
+                     0.0, 0.0, 0, now, 0});
+    rule_tags.push_back(rule.tag);
+    rules_by_name[rule.tag].push_back(id);
+    // Привязки к слотам пересобираются при следующих изменениях
+    slot_names.clear();
+    rules_by_slot.clear();
+    if (rule.kind == AlarmRule::STALE) {
+        stale_wheel.schedule(id, tickOf(now + (int64_t)rule.limit));
+    }
+    return id;
+}
+
+bool AlarmEngine::loadRules(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) return false;
+
+    std::vector<AlarmRule> parsed;
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        AlarmRule rule{"", AlarmRule::HI, 0.0, 0.0};
+        std::string kind;
+        if (!(fields >> rule.tag) || rule.tag[0] == '#') continue;
+        if (!(fields >> kind >> rule.limit) || !parseKind(kind, rule.kind)) return false;
+        fields >> rule.deadband;
+        parsed.push_back(rule);
+    }
+    for (const auto& rule : parsed) addRule(rule);
+    return true;
+}
+
+size_t AlarmEngine::ruleCount() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return rules.size();
+}
+
+void AlarmEngine::bindSlotLocked(size_t slot, const std::string& name) {
+    if (slot >= slot_names.size()) {
+        slot_names.resize(slot + 1);
+        rules_by_slot.resize(slot + 1);
+    }
+    slot_names[slot] = name;
+    auto it = rules_by_name.find(name);
+    if (it != rules_by_name.end()) rules_by_slot[slot] = it->second;
+    else rules_by_slot[slot].clear();
+}
+
+void AlarmEngine::onValueChanged(size_t slot, const OPCUAClient::TagData& tag, const UA_DataValue& dv) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (slot >= slot_names.size() || slot_names[slot] != tag.name) bindSlotLocked(slot, tag.name);
+    const auto& ids = rules_by_slot[slot];
+    if (ids.empty()) return;
+    // Плохой статус приходит с последним хорошим значением: это не новый отсчёт —
+    // ни для границ и скорости, ни как признак жизни для устаревания
+    if (tag.quality == "BAD") return;
+
+    UA_DateTime time = dv.hasSourceTimestamp ? dv.sourceTimestamp : UA_DateTime_now();
+    int64_t now = monotonicMs();
+    for (uint32_t id : ids) evaluateLocked(id, tag.value, time, now);
+}
+
+void AlarmEngine::evaluateLocked(uint32_t id, double value, UA_DateTime time, int64_t now_ms) {
+    RuleState& r = rules[id];
+    r.value = value;
+    bool on = r.active;
+    switch (r.kind) {
+    case AlarmRule::HIHI:
+    case AlarmRule::HI:
+        on = value > (r.active ? r.limit - r.deadband : r.limit);
+        break;
+    case AlarmRule::LO:
+    case AlarmRule::LOLO:
+        on = value < (r.active ? r.limit + r.deadband : r.limit);
+        break;
+    case AlarmRule::ROC:
+        // Скорость — по меткам источника между соседними изменениями
+        if (r.has_prev && time > r.prev_time) {
+            double rate = std::fabs(value - r.prev_value) * UA_DATETIME_SEC / (double)(time - r.prev_time);
+            on = rate > (r.active ? r.limit - r.deadband : r.limit);
+        }
+        r.prev_value = value;
+        r.prev_time = time;
+        r.has_prev = true;
+        break;
+    case AlarmRule::STALE:
+        r.last_change_ms = now_ms;
+        if (r.active) {
+            on = false;
+            // Пока тревога горела, правила в колесе не было
+            stale_wheel.schedule(id, tickOf(now_ms + (int64_t)r.limit));
+        }
+        break;
+    }
+    if (on != r.active) setActiveLocked(id, on);
+}
+
+void AlarmEngine::setActiveLocked(uint32_t id, bool on) {
+    RuleState& r = rules[id];
+    r.active = on;
+    if (on) {
+        r.acknowledged = false;
+        r.since = UA_DateTime_now();
+        r.active_pos = (int32_t)active.size();
+        active.push_back(id);
+        metrics().activations.inc();
+    } else {
+        // Удаление за O(1): на место снятой тревоги встаёт последняя
+        uint32_t last = active.back();
+        active[r.active_pos] = last;
+        rules[last].active_pos = r.active_pos;
+        active.pop_back();
+        r.active_pos = -1;
+    }
+    metrics().active.set((double)active.size());
+}
+
+void AlarmEngine::onReset() {
+    std::lock_guard<std::mutex> lock(mutex);
+    int64_t now = monotonicMs();
+    for (uint32_t id = 0; id < rules.size(); ++id) {
+        RuleState& r = rules[id];
+        r.has_prev = false;
+        r.last_change_ms = now;
+        // Горящее правило устаревания не стоит в колесе; остальные доберут остаток в tick()
+        if (r.active && r.kind == AlarmRule::STALE) stale_wheel.schedule(id, tickOf(now + (int64_t)r.limit));
+        r.active = false;
+        r.active_pos = -1;
+    }
+    active.clear();
+    metrics().active.set(0.0);
+}
+
+void AlarmEngine::tick() {
+    std::lock_guard<std::mutex> lock(mutex);
+    int64_t now = monotonicMs();
+    due.clear();
+    stale_wheel.advance(tickOf(now), due);
+    for (uint32_t id : due) {
+        RuleState& r = rules[id];
+        int64_t deadline = r.last_change_ms + (int64_t)r.limit;
+        if (now >= deadline) {
+            setActiveLocked(id, true);
+        } else {
+            // Значение менялось после постановки в колесо: ждём остаток
+            stale_wheel.schedule(id, tickOf(deadline));
+        }
+    }
+}
+
+std::vector<AlarmEngine::Alarm> AlarmEngine::activeAlarms() {
+    std::vector<Alarm> result;
+    std::lock_guard<std::mutex> lock(mutex);
+    result.reserve(active.size());
+    for (uint32_t id : active) {
+        const RuleState& r = rules[id];
+        result.push_back({rule_tags[id], r.kind, r.value, r.limit, r.since, r.acknowledged});
+    }
+    std::sort(result.begin(), result.end(),
+              [](const Alarm& a, const Alarm& b) { return a.since > b.since; });
+    return result;
+}
+
+size_t AlarmEngine::unacknowledgedCount() {
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t n = 0;
+    for (uint32_t id : active) n += rules[id].acknowledged ? 0 : 1;
+    return n;
+}
+
+void AlarmEngine::acknowledgeAll() {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (uint32_t id : active) rules[id].acknowledged = true;
+}
@@ -0,0 +1,123 @@
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include "../include/opcua_client.hpp"
+#include "../include/fanout.hpp"
+#include "../include/metrics.hpp"
+#include "../include/recorder.hpp"
+#include "../include/pubsub_source.hpp"
+
+// Коллектор: одна сессия OPC UA на всех локальных зрителей.
+// Запуск: opcua_collector [--url адрес] [--socket путь] [--period мс] [--shm имя]
+//                        [--metrics-port порт] [--metrics-file путь] [--tags файл]
+//                        [--record файл] [--security политика] [--mode sign|signencrypt]
+//                        [--cert файл --key файл] [--trust файлы через запятую|any]
+// --period задаёт период группы default; остальные группы — из файла тегов,
+// там же строки pubsub/reader/field — теги, приходящие по UDP (см. pubsub_source.hpp)
+
+namespace {
+std::atomic<bool> running(true);
+void onSignal(int) { running = false; }
+}
+
+int main(int argc, char** argv) {
+    std::string url = "opc.tcp://127.0.0.1:4840";
+    std::string socket_path = "/tmp/opcua_monitor.sock";
+    int period_ms = 0;  // 0 — период группы default из конфигурации (500 мс)
+    std::string shm_name;
+    int metrics_port = 0;
+    std::string metrics_file;
+    std::string tags_file;
+    std::string record_file;
+    SecurityConfig security;
+    for (int i = 1; i + 1 < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--url") url = argv[++i];
+        else if (arg == "--socket") socket_path = argv[++i];
+        else if (arg == "--period") period_ms = std::stoi(argv[++i]);
+        else if (arg == "--shm") shm_name = argv[++i];
+        else if (arg == "--metrics-port") metrics_port = std::stoi(argv[++i]);
+        else if (arg == "--metrics-file") metrics_file = argv[++i];
+        else if (arg == "--tags") tags_file = argv[++i];
+        else if (arg == "--record") record_file = argv[++i];
+        else if (arg == "--security") security.policy = argv[++i];
+        else if (arg == "--mode") security.mode = argv[++i];
+        else if (arg == "--cert") security.certificate = argv[++i];
+        else if (arg == "--key") security.privateKey = argv[++i];
+        else if (arg == "--trust") parseTrustArgument(argv[++i], security);
+    }
+
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+
+    OPCUAClient client;
+    if (!tags_file.empty() && !client.loadTagConfig(tags_file)) {
+        std::fprintf(stderr, "Cannot load tag config %s\n", tags_file.c_str());
+        return 1;
+    }
+    PubSubSource pubsub(client);
+    std::string pubsub_error;
+    if (!tags_file.empty() && !pubsub.loadConfig(tags_file, &pubsub_error)) {
+        std::fprintf(stderr, "Bad PubSub config in %s: %s\n", tags_file.c_str(), pubsub_error.c_str());
+        return 1;
+    }
+    std::string security_error;
+    if (!client.configureSecurity(security, &security_error)) {
+        std::fprintf(stderr, "Bad security settings: %s\n", security_error.c_str());
+        return 1;
+    }
+    if (period_ms > 0) client.addGroup("default", (uint32_t)period_ms);
+    auto server = std::make_shared<FanoutServer>(client);
+    if (!server->listen(socket_path)) {
+        std::fprintf(stderr, "Cannot listen on %s\n", socket_path.c_str());
+        return 1;
+    }
+    client.addSink(server);
+    auto recorder = std::make_shared<SessionRecorder>();
+    if (!record_file.empty()) {
+        if (!recorder->open(record_file, client.getTags())) {
+            std::fprintf(stderr, "Cannot record to %s\n", record_file.c_str());
+            return 1;
+        }
+        client.addSink(recorder);
+    }
+    if (!shm_name.empty() && !client.publishToSharedMemory(shm_name)) {
+        std::fprintf(stderr, "Cannot create shared memory %s\n", shm_name.c_str());
+    }
+    // Приём PubSub — после приёмников, чтобы первые значения дошли до зрителей и записи
+    if (!pubsub.empty() && !pubsub.start(&pubsub_error)) {
+        std::fprintf(stderr, "Cannot start PubSub receiver: %s\n", pubsub_error.c_str());
+        return 1;
+    }
+
+    MetricsHttpServer metrics_server;
+    if (metrics_port > 0 && !metrics_server.start((uint16_t)metrics_port)) {
+        std::fprintf(stderr, "Cannot serve metrics on port %d\n", metrics_port);
+    }
+
+    auto last_attempt = std::chrono::steady_clock::time_point();
+    auto last_textfile = std::chrono::steady_clock::time_point();
+    while (running) {
+        auto now = std::chrono::steady_clock::now();
+        if (!client.isConnected() && now - last_attempt >= std::chrono::seconds(1)) {
+            last_attempt = now;
+            if (!client.connectToServer(url)) {
+                std::fprintf(stderr, "Cannot connect to %s, retrying\n", url.c_str());
+            }
+        }
+        // Чтение наступивших по расписанию тегов, затем зрители и их запросы записи
+        client.poll();
+        server->poll();
+        if (!metrics_file.empty() && now - last_textfile >= std::chrono::seconds(1)) {
+            last_textfile = now;
+            MetricsRegistry::instance().writeTextfile(metrics_file);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    recorder->close();
+    return 0;
+}
@@ -0,0 +1,174 @@
+#include "../include/connection_health.hpp"
+#include <algorithm>
+
+namespace {
+
+// Коды, после которых имеет смысл уменьшить число узлов в запросе
+bool requestTooBig(UA_StatusCode code) {
+    return code == UA_STATUSCODE_BADTOOMANYOPERATIONS || code == UA_STATUSCODE_BADREQUESTTOOLARGE ||
+           code == UA_STATUSCODE_BADRESPONSETOOLARGE;
+}
+
+} // namespace
+
+ConnectionHealth::ConnectionHealth()
+    : connected(false), rtt_ms(0), last_rtt_ms(0), consecutive_failures(0), consecutive_ok(0),
+      failures(0), overloads(0), disconnects(0), renewals(0), last_error(UA_STATUSCODE_GOOD),
+      last_success(0), last_publish(0), publish_stalled(false), throttle_ms(0), max_operations(0),
+      operations_ceiling(0), next_request_ns(0) {}
+
+ConnectionHealth::Outcome ConnectionHealth::classify(UA_StatusCode code) {
+    // Good и Uncertain — ответ получен
+    if ((code & 0x80000000) == 0) return OK;
+    switch (code) {
+    case UA_STATUSCODE_BADTOOMANYOPERATIONS:
+    case UA_STATUSCODE_BADREQUESTTOOLARGE:
+    case UA_STATUSCODE_BADRESPONSETOOLARGE:
+    case UA_STATUSCODE_BADRESOURCEUNAVAILABLE:
+    case UA_STATUSCODE_BADOUTOFMEMORY:
+    case UA_STATUSCODE_BADTCPSERVERTOOBUSY:
+    case UA_STATUSCODE_BADTOOMANYSESSIONS:
+    case UA_STATUSCODE_BADMAXCONNECTIONSREACHED:
+    case UA_STATUSCODE_BADREQUESTTIMEOUT:
+        return OVERLOAD;
+    case UA_STATUSCODE_BADCONNECTIONCLOSED:
+    case UA_STATUSCODE_BADSECURECHANNELCLOSED:
+    case UA_STATUSCODE_BADSECURECHANNELIDINVALID:
+    case UA_STATUSCODE_BADSESSIONCLOSED:
+    case UA_STATUSCODE_BADSESSIONIDINVALID:
+    case UA_STATUSCODE_BADSESSIONNOTACTIVATED:
+    case UA_STATUSCODE_BADNOTCONNECTED:
+    case UA_STATUSCODE_BADSERVERNOTCONNECTED:
+    case UA_STATUSCODE_BADCOMMUNICATIONERROR:
+    case UA_STATUSCODE_BADNOCOMMUNICATION:
+    case UA_STATUSCODE_BADCONNECTIONREJECTED:
+    case UA_STATUSCODE_BADDISCONNECT:
+    case UA_STATUSCODE_BADSHUTDOWN:
+    case UA_STATUSCODE_BADSERVERHALTED:
+        return DISCONNECT;
+    default:
+        return FAILURE;
+    }
+}
+
+const char* ConnectionHealth::stateName(State state) {
+    switch (state) {
+    case DOWN: return "down";
+    case HEALTHY: return "healthy";
+    case DEGRADED: return "degraded";
+    case OVERLOADED: return "overloaded";
+    }
+    return "";
+}
+
+ConnectionHealth::Outcome ConnectionHealth::onRequest(UA_StatusCode code, uint64_t rttNanos, size_t operations,
+                                                      int64_t nowNs) {
+    Outcome outcome = classify(code);
+    std::lock_guard<std::mutex> lock(mutex);
+    if (outcome == OK) {
+        // Сглаживание как у SRTT в TCP: вес нового замера 1/8
+        last_rtt_ms = (double)rttNanos / 1e6;
+        rtt_ms = rtt_ms == 0 ? last_rtt_ms : rtt_ms + (last_rtt_ms - rtt_ms) / 8;
+        consecutive_failures = 0;
+        last_success = UA_DateTime_now();
+        recoverLocked();
+    } else {
+        ++failures;
+        ++consecutive_failures;
+        consecutive_ok = 0;
+        last_error = code;
+        if (outcome == OVERLOAD) {
+            ++overloads;
+            throttleLocked(operations, code);
+        }
+    }
+    next_request_ns = nowNs + (int64_t)throttle_ms * 1000000;
+    return outcome;
+}
+
+void ConnectionHealth::throttleLocked(size_t operations, UA_StatusCode code) {
+    throttle_ms = std::min(MAX_THROTTLE_MS, std::max<uint32_t>(100, throttle_ms * 2));
+    if (requestTooBig(code) && operations > 1) {
+        // Размер, на котором сервер отказал, — потолок для дальнейшего роста
+        operations_ceiling = (uint32_t)operations;
+        uint32_t half = (uint32_t)(operations / 2);
+        max_operations = max_operations ? std::min(max_operations, half) : half;
+    }
+}
+
+void ConnectionHealth::recoverLocked() {
+    ++consecutive_ok;
+    throttle_ms = throttle_ms * 3 / 4;
+    if (throttle_ms < 10) throttle_ms = 0;
+    if (max_operations && consecutive_ok % 32 == 0) {
+        uint32_t grown = max_operations + max_operations / 4 + 1;
+        max_operations = operations_ceiling ? std::min(grown, operations_ceiling - 1) : grown;
+    }
+}
+
+void ConnectionHealth::onConnected() {
+    std::lock_guard<std::mutex> lock(mutex);
+    connected = true;
+    consecutive_failures = 0;
+    publish_stalled = false;
+    throttle_ms = 0;
+    next_request_ns = 0;
+    // Новая сессия может быть с другим сервером: его пределы выясняются заново
+    max_operations = 0;
+    operations_ceiling = 0;
+}
+
+void ConnectionHealth::onDisconnected(bool lost) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (connected && lost) ++disconnects;
+    connected = false;
+}
+
+void ConnectionHealth::onRenewal() {
+    std::lock_guard<std::mutex> lock(mutex);
+    ++renewals;
+}
+
+void ConnectionHealth::onPublish(UA_DateTime time) {
+    std::lock_guard<std::mutex> lock(mutex);
+    last_publish = time;
+    publish_stalled = false;
+}
+
+void ConnectionHealth::onPublishStalled() {
+    std::lock_guard<std::mutex> lock(mutex);
+    publish_stalled = true;
+}
+
+bool ConnectionHealth::mayRequest(int64_t nowNs) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return nowNs >= next_request_ns;
+}
+
+uint32_t ConnectionHealth::maxOperations() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return max_operations;
+}
+
+ConnectionHealth::Snapshot ConnectionHealth::snapshot() {
+    std::lock_guard<std::mutex> lock(mutex);
+    Snapshot s;
+    s.state = !connected ? DOWN
+              : throttle_ms > 0 ? OVERLOADED
+              : consecutive_failures > 0 || publish_stalled ? DEGRADED
+              : HEALTHY;
+    s.rttMs = rtt_ms;
+    s.lastRttMs = last_rtt_ms;
+    s.consecutiveFailures = consecutive_failures;
+    s.failures = failures;
+    s.overloads = overloads;
+    s.disconnects = disconnects;
+    s.renewals = renewals;
+    s.lastError = last_error;
+    s.lastSuccess = last_success;
+    s.lastPublish = last_publish;
+    s.publishStalled = publish_stalled;
+    s.throttleMs = throttle_ms;
+    s.maxOperations = max_operations;
+    return s;
+}
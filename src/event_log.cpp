@@ -0,0 +1,133 @@
+#include "../include/event_log.hpp"
+#include "../include/metrics.hpp"
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+struct EventMetrics {
+    ShardedCounter& events;
+    ShardedCounter& overwritten;
+};
+
+EventMetrics& metrics() {
+    auto& r = MetricsRegistry::instance();
+    static EventMetrics m{
+        r.counter("opcua_events_total", "OPC UA events received"),
+        r.counter("opcua_events_overwritten_total", "Events pushed out of the event log ring"),
+    };
+    return m;
+}
+
+void copyText(char* dst, size_t cap, const char* src, size_t len) {
+    len = std::min(len, cap - 1);
+    std::memcpy(dst, src, len);
+    dst[len] = '\0';
+}
+
+// Текст скалярного значения поля; неизвестные типы — имя типа
+size_t variantToText(const UA_Variant& v, char* buf, size_t cap) {
+    if (!v.type || !UA_Variant_isScalar(&v)) return (size_t)std::snprintf(buf, cap, "-");
+    const void* d = v.data;
+    if (v.type == &UA_TYPES[UA_TYPES_STRING]) {
+        const UA_String* s = (const UA_String*)d;
+        copyText(buf, cap, (const char*)s->data, s->length);
+        return std::strlen(buf);
+    }
+    if (v.type == &UA_TYPES[UA_TYPES_LOCALIZEDTEXT]) {
+        const UA_LocalizedText* t = (const UA_LocalizedText*)d;
+        copyText(buf, cap, (const char*)t->text.data, t->text.length);
+        return std::strlen(buf);
+    }
+    if (v.type == &UA_TYPES[UA_TYPES_NODEID]) {
+        const UA_NodeId* id = (const UA_NodeId*)d;
+        if (id->identifierType == UA_NODEIDTYPE_NUMERIC) {
+            return (size_t)std::snprintf(buf, cap, "ns=%u;i=%u", (unsigned)id->namespaceIndex,
+                                         (unsigned)id->identifier.numeric);
+        }
+        UA_String s = UA_STRING_NULL;
+        UA_NodeId_print(id, &s);
+        copyText(buf, cap, (const char*)s.data, s.length);
+        UA_String_clear(&s);
+        return std::strlen(buf);
+    }
+    if (v.type == &UA_TYPES[UA_TYPES_DOUBLE]) return (size_t)std::snprintf(buf, cap, "%g", *(const UA_Double*)d);
+    if (v.type == &UA_TYPES[UA_TYPES_FLOAT]) return (size_t)std::snprintf(buf, cap, "%g", *(const UA_Float*)d);
+    if (v.type == &UA_TYPES[UA_TYPES_BOOLEAN]) return (size_t)std::snprintf(buf, cap, "%s", *(const UA_Boolean*)d ? "true" : "false");
+    if (v.type == &UA_TYPES[UA_TYPES_UINT16]) return (size_t)std::snprintf(buf, cap, "%u", (unsigned)*(const UA_UInt16*)d);
+    if (v.type == &UA_TYPES[UA_TYPES_INT32]) return (size_t)std::snprintf(buf, cap, "%d", (int)*(const UA_Int32*)d);
+    if (v.type == &UA_TYPES[UA_TYPES_UINT32]) return (size_t)std::snprintf(buf, cap, "%u", (unsigned)*(const UA_UInt32*)d);
+    if (v.type == &UA_TYPES[UA_TYPES_INT64]) return (size_t)std::snprintf(buf, cap, "%" PRId64, (int64_t)*(const UA_Int64*)d);
+    return (size_t)std::snprintf(buf, cap, "<%s>", v.type->typeName);
+}
+
+} // namespace
+
+EventLog::EventLog(size_t capacity) : ring(std::max<size_t>(capacity, 1)), head(0) {}
+
+EventRecord EventLog::decode(const std::vector<std::string>& fields, size_t count, const UA_Variant* values) {
+    EventRecord r;
+    std::memset(&r, 0, sizeof(r));
+    r.received = UA_DateTime_now();
+    r.time = r.received;
+
+    size_t used = 0;
+    char text[176];
+    for (size_t i = 0; i < count && i < fields.size(); ++i) {
+        const std::string& name = fields[i];
+        const UA_Variant& v = values[i];
+        if (name == "Time" && UA_Variant_hasScalarType(&v, &UA_TYPES[UA_TYPES_DATETIME])) {
+            r.time = *(const UA_DateTime*)v.data;
+        } else if (name == "Severity" && UA_Variant_hasScalarType(&v, &UA_TYPES[UA_TYPES_UINT16])) {
+            r.severity = *(const UA_UInt16*)v.data;
+        } else if (name == "SourceName") {
+            variantToText(v, r.source, sizeof(r.source));
+        } else if (name == "EventType") {
+            variantToText(v, r.type, sizeof(r.type));
+        } else if (used + 1 < sizeof(r.message)) {
+            // Message идёт как есть, остальные поля — "имя=значение"
+            size_t n = variantToText(v, text, sizeof(text));
+            n = std::min(n, sizeof(text) - 1);
+            int written = name == "Message"
+                ? std::snprintf(r.message + used, sizeof(r.message) - used, "%s%.*s", used ? " " : "", (int)n, text)
+                : std::snprintf(r.message + used, sizeof(r.message) - used, "%s%s=%.*s",
+                                used ? " " : "", name.c_str(), (int)n, text);
+            if (written > 0) used = std::min(used + (size_t)written, sizeof(r.message) - 1);
+        }
+    }
+    return r;
+}
+
+void EventLog::push(const EventRecord& record) {
+    metrics().events.inc();
+    std::lock_guard<std::mutex> lock(mutex);
+    if (head >= ring.size()) metrics().overwritten.inc();
+    ring[head % ring.size()] = record;
+    ++head;
+}
+
+size_t EventLog::size() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return (size_t)std::min<uint64_t>(head, ring.size());
+}
+
+uint64_t EventLog::total() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return head;
+}
+
+uint64_t EventLog::overwritten() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return head > ring.size() ? head - ring.size() : 0;
+}
+
+void EventLog::copyRecent(size_t skip, size_t count, std::vector<EventRecord>& out) {
+    out.clear();
+    std::lock_guard<std::mutex> lock(mutex);
+    uint64_t available = std::min<uint64_t>(head, ring.size());
+    for (uint64_t i = skip; i < available && out.size() < count; ++i) {
+        out.push_back(ring[(head - 1 - i) % ring.size()]);
+    }
+}
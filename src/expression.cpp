@@ -0,0 +1,294 @@
+#include "../include/expression.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+
+namespace {
+
+// Рекурсивный спуск:
+//   expr    := term (('+' | '-') term)*
+//   term    := unary (('*' | '/') unary)*
+//   unary   := '-' unary | power
+//   power   := primary ('^' unary)?
+//   primary := число | имя | функция '(' аргументы ')' | '(' expr ')'
+struct Parser {
+    const std::string& text;
+    const Expression::Resolver& resolve;
+    std::vector<Expression::Instr>& code;
+    std::vector<double>& consts;
+    std::vector<uint32_t>& inputs;
+    std::string& error;
+    size_t pos;
+    int depth;
+    int max_depth;
+
+    void skipSpaces() {
+        while (pos < text.size() && std::isspace((unsigned char)text[pos])) ++pos;
+    }
+
+    bool accept(char c) {
+        skipSpaces();
+        if (pos < text.size() && text[pos] == c) {
+            ++pos;
+            return true;
+        }
+        return false;
+    }
+
+    bool fail(const std::string& what) {
+        if (error.empty()) error = what + " at " + std::to_string(pos);
+        return false;
+    }
+
+    void push(Expression::Op op, uint32_t arg) {
+        code.push_back({op, arg});
+        if (op == Expression::CONST || op == Expression::LOAD || op == Expression::PREV) {
+            max_depth = std::max(max_depth, ++depth);
+        } else if (op != Expression::NEG && op != Expression::ABS && op != Expression::SQRT) {
+            --depth;  // бинарные операции снимают со стека на одно значение больше, чем кладут
+        }
+    }
+
+    void pushConst(double v) {
+        consts.push_back(v);
+        push(Expression::CONST, (uint32_t)(consts.size() - 1));
+    }
+
+    // Операции над константами сворачиваются при разборе; последние CONST
+    // в коде всегда ссылаются на последние элементы consts
+    void emitBinary(Expression::Op op) {
+        size_t n = code.size();
+        if (n >= 2 && code[n - 1].op == Expression::CONST && code[n - 2].op == Expression::CONST) {
+            const Expression::Instr ops[3] = {{Expression::CONST, 0}, {Expression::CONST, 1}, {op, 0}};
+            double folded = Expression::run(ops, 3, &consts[consts.size() - 2], nullptr, nullptr);
+            code.resize(n - 2);
+            consts.resize(consts.size() - 2);
+            depth -= 2;
+            pushConst(folded);
+            return;
+        }
+        push(op, 0);
+    }
+
+    void emitUnary(Expression::Op op) {
+        if (!code.empty() && code.back().op == Expression::CONST) {
+            const Expression::Instr ops[2] = {{Expression::CONST, 0}, {op, 0}};
+            consts.back() = Expression::run(ops, 2, &consts.back(), nullptr, nullptr);
+            return;
+        }
+        push(op, 0);
+    }
+
+    void addInput(uint32_t slot) {
+        if (std::find(inputs.begin(), inputs.end(), slot) == inputs.end()) inputs.push_back(slot);
+    }
+
+    bool parseName(std::string& name) {
+        skipSpaces();
+        size_t start = pos;
+        while (pos < text.size() && (std::isalnum((unsigned char)text[pos]) ||
+                                     text[pos] == '_' || text[pos] == '.')) {
+            ++pos;
+        }
+        name = text.substr(start, pos - start);
+        return !name.empty();
+    }
+
+    bool primary() {
+        skipSpaces();
+        if (pos >= text.size()) return fail("unexpected end");
+        char c = text[pos];
+        if (std::isdigit((unsigned char)c) || c == '.') {
+            const char* begin = text.c_str() + pos;
+            char* end = nullptr;
+            double v = std::strtod(begin, &end);
+            if (end == begin) return fail("bad number");
+            pos += end - begin;
+            pushConst(v);
+            return true;
+        }
+        if (accept('(')) {
+            if (!expr()) return false;
+            return accept(')') || fail("expected ')'");
+        }
+
+        std::string name;
+        if (!parseName(name)) return fail("unexpected character");
+        if (!accept('(')) {
+            uint32_t slot;
+            if (!resolve(name, slot)) return fail("unknown tag '" + name + "'");
+            addInput(slot);
+            push(Expression::LOAD, slot);
+            return true;
+        }
+
+        if (name == "prev") {
+            std::string arg;
+            uint32_t slot;
+            if (!parseName(arg)) return fail("prev() expects a tag name");
+            if (!resolve(arg, slot)) return fail("unknown tag '" + arg + "'");
+            addInput(slot);
+            push(Expression::PREV, slot);
+            return accept(')') || fail("expected ')'");
+        }
+        if (name == "abs" || name == "sqrt") {
+            if (!expr()) return false;
+            if (!accept(')')) return fail("expected ')'");
+            emitUnary(name == "abs" ? Expression::ABS : Expression::SQRT);
+            return true;
+        }
+        if (name == "min" || name == "max") {
+            Expression::Op op = name == "min" ? Expression::MIN : Expression::MAX;
+            if (!expr()) return false;
+            int args = 1;
+            while (accept(',')) {
+                if (!expr()) return false;
+                emitBinary(op);
+                ++args;
+            }
+            if (args < 2) return fail(name + "() expects at least two arguments");
+            return accept(')') || fail("expected ')'");
+        }
+        return fail("unknown function '" + name + "'");
+    }
+
+    bool power() {
+        if (!primary()) return false;
+        if (accept('^')) {
+            if (!unary()) return false;
+            emitBinary(Expression::POW);
+        }
+        return true;
+    }
+
+    bool unary() {
+        if (accept('-')) {
+            if (!unary()) return false;
+            emitUnary(Expression::NEG);
+            return true;
+        }
+        return power();
+    }
+
+    bool term() {
+        if (!unary()) return false;
+        for (;;) {
+            if (accept('*')) {
+                if (!unary()) return false;
+                emitBinary(Expression::MUL);
+            } else if (accept('/')) {
+                if (!unary()) return false;
+                emitBinary(Expression::DIV);
+            } else {
+                return true;
+            }
+        }
+    }
+
+    bool expr() {
+        if (!term()) return false;
+        for (;;) {
+            if (accept('+')) {
+                if (!term()) return false;
+                emitBinary(Expression::ADD);
+            } else if (accept('-')) {
+                if (!term()) return false;
+                emitBinary(Expression::SUB);
+            } else {
+                return true;
+            }
+        }
+    }
+};
+
+} // namespace
+
+bool Expression::compile(const std::string& text, const Resolver& resolve) {
+    program.clear();
+    consts.clear();
+    input_slots.clear();
+    error_text.clear();
+
+    Parser p{text, resolve, program, consts, input_slots, error_text, 0, 0, 0};
+    if (!p.expr()) return false;
+    p.skipSpaces();
+    if (p.pos != text.size()) return p.fail("unexpected character");
+    if (p.max_depth > MAX_DEPTH) return p.fail("expression too deep");
+    return true;
+}
+
+double Expression::run(const Instr* code, size_t size, const double* consts,
+                       const double* current, const double* previous) {
+    double stack[MAX_DEPTH];
+    int sp = 0;
+    for (size_t i = 0; i < size; ++i) {
+        const Instr& in = code[i];
+        switch (in.op) {
+        case CONST: stack[sp++] = consts[in.arg]; break;
+        case LOAD: stack[sp++] = current[in.arg]; break;
+        case PREV: stack[sp++] = previous[in.arg]; break;
+        case ADD: --sp; stack[sp - 1] += stack[sp]; break;
+        case SUB: --sp; stack[sp - 1] -= stack[sp]; break;
+        case MUL: --sp; stack[sp - 1] *= stack[sp]; break;
+        case DIV: --sp; stack[sp - 1] /= stack[sp]; break;
+        case POW: --sp; stack[sp - 1] = std::pow(stack[sp - 1], stack[sp]); break;
+        case MIN: --sp; stack[sp - 1] = std::min(stack[sp - 1], stack[sp]); break;
+        case MAX: --sp; stack[sp - 1] = std::max(stack[sp - 1], stack[sp]); break;
+        case NEG: stack[sp - 1] = -stack[sp - 1]; break;
+        case ABS: stack[sp - 1] = std::fabs(stack[sp - 1]); break;
+        case SQRT: stack[sp - 1] = std::sqrt(stack[sp - 1]); break;
+        }
+    }
+    return sp > 0 ? stack[0] : 0.0;
+}
+
+void ComputedTags::ensureSlot(uint32_t slot) {
+    if (slot < current.size()) return;
+    current.resize(slot + 1, 0.0);
+    previous.resize(slot + 1, 0.0);
+    dependents.resize(slot + 1);
+    entry_of_slot.resize(slot + 1, -1);
+}
+
+bool ComputedTags::add(uint32_t slot, const Expression& expr) {
+    for (uint32_t in : expr.inputs()) {
+        if (in >= slot) return false;
+    }
+    if (isComputed(slot)) return false;
+    ensureSlot(slot);
+
+    uint32_t index = (uint32_t)entries.size();
+    entries.push_back({slot, (uint32_t)code.size(), (uint32_t)expr.code().size(), (uint32_t)consts.size()});
+    code.insert(code.end(), expr.code().begin(), expr.code().end());
+    consts.insert(consts.end(), expr.constants().begin(), expr.constants().end());
+    for (uint32_t in : expr.inputs()) dependents[in].push_back(index);
+    entry_of_slot[slot] = (int32_t)index;
+
+    // Новое выражение считается при ближайшем evaluate
+    dirty.push_back(1);
+    first_dirty = std::min<size_t>(first_dirty, index);
+    return true;
+}
+
+void ComputedTags::clear() {
+    code.clear();
+    consts.clear();
+    entries.clear();
+    dirty.clear();
+    first_dirty = 0;
+    current.clear();
+    previous.clear();
+    dependents.clear();
+    entry_of_slot.clear();
+}
+
+void ComputedTags::inputChanged(uint32_t slot, double value) {
+    ensureSlot(slot);
+    previous[slot] = current[slot];
+    current[slot] = value;
+    for (uint32_t index : dependents[slot]) {
+        dirty[index] = 1;
+        first_dirty = std::min<size_t>(first_dirty, index);
+    }
+}
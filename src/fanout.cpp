@@ -0,0 +1,471 @@
+#include "../include/fanout.hpp"
+#include "../include/metrics.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <csignal>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+namespace {
+
+// Клиент, не успевающий забирать данные, отключается вместо роста очереди
+const size_t MAX_OUTBOX = 8 * 1024 * 1024;
+
+struct PendingWrite {
+    int fd;  // зритель, которому вернуть результат
+    uint32_t slot;
+    double value;
+    std::string nodeId;
+};
+
+void putFrameHeader(std::vector<char>& out, uint8_t type, uint32_t len) {
+    out.push_back((char)type);
+    const char* p = (const char*)&len;
+    out.insert(out.end(), p, p + sizeof(len));
+}
+
+template <typename T>
+void putPod(std::vector<char>& out, const T& v) {
+    const char* p = (const char*)&v;
+    out.insert(out.end(), p, p + sizeof(T));
+}
+
+template <typename T>
+T getPod(const char* p) {
+    T v;
+    std::memcpy(&v, p, sizeof(T));
+    return v;
+}
+
+void putString(std::vector<char>& out, const std::string& s) {
+    uint16_t len = (uint16_t)std::min<size_t>(s.size(), 0xFFFF);
+    putPod(out, len);
+    out.insert(out.end(), s.data(), s.data() + len);
+}
+
+void putTagsFrame(std::vector<char>& frame, const std::vector<OPCUAClient::TagData>& tags) {
+    std::vector<char> body;
+    putPod(body, (uint32_t)tags.size());
+    for (const auto& t : tags) {
+        putString(body, t.name);
+        putString(body, t.nodeId);
+    }
+    putFrameHeader(frame, FanoutProtocol::TAGS, (uint32_t)body.size());
+    frame.insert(frame.end(), body.begin(), body.end());
+}
+
+void putDeltaFrame(std::vector<char>& frame, const std::vector<FanoutProtocol::Entry>& entries) {
+    uint32_t len = (uint32_t)(sizeof(uint32_t) + entries.size() * sizeof(FanoutProtocol::Entry));
+    putFrameHeader(frame, FanoutProtocol::DELTA, len);
+    putPod(frame, (uint32_t)entries.size());
+    const char* p = (const char*)entries.data();
+    frame.insert(frame.end(), p, p + entries.size() * sizeof(FanoutProtocol::Entry));
+}
+
+#ifndef _WIN32
+bool setNonBlocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+bool fillAddress(const std::string& path, sockaddr_un& addr) {
+    if (path.size() >= sizeof(addr.sun_path)) return false;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+
+// Читает всё доступное без блокировки; false — соединение закрыто
+bool drainSocket(int fd, std::vector<char>& inbox) {
+    char buf[16384];
+    for (;;) {
+        ssize_t n = recv(fd, buf, sizeof(buf), 0);
+        if (n > 0) { inbox.insert(inbox.end(), buf, buf + n); continue; }
+        if (n == 0) return false;
+        return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+    }
+}
+#endif
+
+} // namespace
+
+// ---------------- FanoutServer ----------------
+
+FanoutServer::FanoutServer(OPCUAClient& source)
+    : source(source), listen_fd(-1), announced_generation(0) {}
+
+FanoutServer::~FanoutServer() {
+#ifndef _WIN32
+    for (auto& peer : clients) if (peer.fd >= 0) close(peer.fd);
+    if (listen_fd >= 0) {
+        close(listen_fd);
+        unlink(socket_path.c_str());
+    }
+#endif
+}
+
+bool FanoutServer::listen(const std::string& path) {
+#ifndef _WIN32
+    std::signal(SIGPIPE, SIG_IGN);
+    sockaddr_un addr;
+    if (!fillAddress(path, addr)) return false;
+    unlink(path.c_str());
+    listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd < 0) return false;
+    if (bind(listen_fd, (sockaddr*)&addr, sizeof(addr)) != 0 ||
+        ::listen(listen_fd, 64) != 0 || !setNonBlocking(listen_fd)) {
+        close(listen_fd);
+        listen_fd = -1;
+        return false;
+    }
+    socket_path = path;
+    announced_generation = source.tagSetGeneration();
+    for (const auto& t : source.getTags()) announced.emplace_back(t.name, t.nodeId);
+    return true;
+#else
+    (void)path;
+    return false;
+#endif
+}
+
+void FanoutServer::poll() {
+#ifndef _WIN32
+    if (listen_fd < 0) return;
+
+    std::vector<int> fresh;
+    for (;;) {
+        int fd = accept(listen_fd, nullptr, nullptr);
+        if (fd < 0) break;
+        setNonBlocking(fd);
+        fresh.push_back(fd);
+    }
+
+    // Список тегов берём до state_mutex: порядок блокировок как в onValueChanged.
+    // Здесь, а не в onCycleEnd: тот вызывается под sinks_mutex, а хранилище берёт
+    // tags_mutex раньше sinks_mutex. Поколение — до списка: смена между ними
+    // объявится ещё раз в следующем вызове
+    uint64_t generation = source.tagSetGeneration();
+    bool changed = generation != announced_generation;
+    std::vector<OPCUAClient::TagData> tags;
+    if (changed || !fresh.empty()) tags = source.getTags();
+
+    std::vector<PendingWrite> writes;
+    {
+        std::lock_guard<std::mutex> lock(state_mutex);
+        if (changed) {
+            // Набор тегов сменился — вырос, заменён или сократился: всем новый список
+            announced_generation = generation;
+            announced.clear();
+            for (const auto& t : tags) announced.emplace_back(t.name, t.nodeId);
+            std::vector<char> frame;
+            putAnnouncementLocked(frame, tags);
+            for (auto& peer : clients) sendTo(peer, frame.data(), frame.size());
+        }
+        for (int fd : fresh) {
+            clients.push_back(Peer{fd, {}, {}});
+            Peer& peer = clients.back();
+            std::vector<char> frame;
+            putAnnouncementLocked(frame, tags);
+            sendTo(peer, frame.data(), frame.size());
+        }
+
+        for (auto& peer : clients) {
+            if (peer.fd < 0) continue;
+            if (!peer.outbox.empty()) {
+                std::vector<char> rest;
+                rest.swap(peer.outbox);
+                sendTo(peer, rest.data(), rest.size());
+            }
+            if (!drainSocket(peer.fd, peer.inbox)) {
+                close(peer.fd);
+                peer.fd = -1;
+                continue;
+            }
+            size_t off = 0;
+            while (peer.inbox.size() - off >= FanoutProtocol::HEADER_SIZE) {
+                uint8_t type = (uint8_t)peer.inbox[off];
+                uint32_t len = getPod<uint32_t>(&peer.inbox[off + 1]);
+                if (peer.inbox.size() - off - FanoutProtocol::HEADER_SIZE < len) break;
+                const char* body = &peer.inbox[off + FanoutProtocol::HEADER_SIZE];
+                if (type == FanoutProtocol::WRITE && len >= 12) {
+                    // Слот зрителя — из разосланного ему списка, NodeId берём оттуда же
+                    uint32_t slot = getPod<uint32_t>(body);
+                    std::string nodeId = slot < announced.size() ? announced[slot].second : std::string();
+                    writes.push_back(PendingWrite{peer.fd, slot, getPod<double>(body + 4), nodeId});
+                }
+                off += FanoutProtocol::HEADER_SIZE + len;
+            }
+            peer.inbox.erase(peer.inbox.begin(), peer.inbox.begin() + off);
+        }
+        dropClosed();
+    }
+
+    // Запись выполняется вне state_mutex: она обращается к серверу OPC UA
+    for (const auto& w : writes) {
+        bool ok = !w.nodeId.empty() && source.writeValue(w.nodeId, w.value);
+        std::vector<char> frame;
+        putFrameHeader(frame, FanoutProtocol::WRITE_RESULT, 5);
+        putPod(frame, w.slot);
+        frame.push_back(ok ? 1 : 0);
+        // Ответ — только запросившему: другой зритель мог ждать результата по тому же слоту
+        std::lock_guard<std::mutex> lock(state_mutex);
+        for (auto& peer : clients) {
+            if (peer.fd == w.fd) sendTo(peer, frame.data(), frame.size());
+        }
+    }
+#endif
+}
+
+void FanoutServer::sendTo(Peer& peer, const char* data, size_t len) {
+#ifndef _WIN32
+    if (peer.fd < 0) return;
+    if (peer.outbox.empty()) {
+        ssize_t n = send(peer.fd, data, len, 0);
+        if (n < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                close(peer.fd);
+                peer.fd = -1;
+                return;
+            }
+            n = 0;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    if (len == 0) return;
+    if (peer.outbox.size() + len > MAX_OUTBOX) {
+        close(peer.fd);
+        peer.fd = -1;
+        peer.outbox.clear();
+        return;
+    }
+    peer.outbox.insert(peer.outbox.end(), data, data + len);
+#else
+    (void)peer; (void)data; (void)len;
+#endif
+}
+
+void FanoutServer::dropClosed() {
+    size_t j = 0;
+    for (size_t i = 0; i < clients.size(); ++i) {
+        if (clients[i].fd >= 0) {
+            if (i != j) clients[j] = std::move(clients[i]);
+            ++j;
+        }
+    }
+    clients.resize(j);
+}
+
+void FanoutServer::onValueChanged(size_t slot, const OPCUAClient::TagData& tag, const UA_DataValue&) {
+    std::lock_guard<std::mutex> lock(state_mutex);
+    FanoutProtocol::Entry e;
+    e.slot = (uint32_t)slot;
+    e.status = tag.status;
+    e.value = tag.value;
+    e.sourceTime = tag.sourceTime;
+    if (slot >= latest.size()) {
+        latest.resize(slot + 1);
+        latest_tags.resize(slot + 1);
+        seen.resize(slot + 1, 0);
+    }
+    latest[slot] = e;
+    latest_tags[slot].first = tag.name;
+    latest_tags[slot].second = tag.nodeId;
+    seen[slot] = 1;
+    // Значение тега, которого нет в разосланном списке (набор сменился, а poll ещё
+    // не объявил новый), уходит снимком вместе со следующим списком
+    if (slot < announced.size() && announced[slot].first == tag.name && announced[slot].second == tag.nodeId) {
+        pending.push_back(e);
+    }
+}
+
+void FanoutServer::putAnnouncementLocked(std::vector<char>& frame, const std::vector<OPCUAClient::TagData>& tags) {
+    putTagsFrame(frame, tags);
+    // Снимок последних значений, чтобы зритель не ждал изменений (TAGS сбрасывает его
+    // хранилище); только значения тех тегов, что стоят в списке на своих слотах
+    std::vector<FanoutProtocol::Entry> snapshot;
+    for (size_t i = 0; i < latest.size() && i < tags.size(); ++i) {
+        if (seen[i] && latest_tags[i].first == tags[i].name && latest_tags[i].second == tags[i].nodeId) {
+            snapshot.push_back(latest[i]);
+        }
+    }
+    putDeltaFrame(frame, snapshot);
+}
+
+void FanoutServer::onCycleEnd() {
+    std::lock_guard<std::mutex> lock(state_mutex);
+    std::vector<char> frame;
+    if (!pending.empty()) {
+        putDeltaFrame(frame, pending);
+        pending.clear();
+    }
+    if (frame.empty()) return;
+    // Один и тот же кадр уходит всем клиентам — кодирование не зависит от их числа
+    for (auto& peer : clients) sendTo(peer, frame.data(), frame.size());
+    dropClosed();
+
+    static Gauge& queue_bytes = MetricsRegistry::instance().gauge(
+        "opcua_fanout_queue_bytes", "Bytes waiting in viewer send queues");
+    static Gauge& viewers = MetricsRegistry::instance().gauge(
+        "opcua_fanout_clients", "Connected viewers");
+    size_t queued = 0;
+    for (const auto& peer : clients) queued += peer.outbox.size();
+    queue_bytes.set((double)queued);
+    viewers.set((double)clients.size());
+}
+
+// ---------------- FanoutClient ----------------
+
+FanoutClient::FanoutClient(OPCUAClient& store)
+    : store(store), fd(-1), pending_write_slot(-1), write_result(-1) {}
+
+FanoutClient::~FanoutClient() {
+    disconnect();
+}
+
+bool FanoutClient::connect(const std::string& path) {
+#ifndef _WIN32
+    std::signal(SIGPIPE, SIG_IGN);
+    sockaddr_un addr;
+    if (!fillAddress(path, addr)) return false;
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return false;
+    if (::connect(fd, (sockaddr*)&addr, sizeof(addr)) != 0 || !setNonBlocking(fd)) {
+        disconnect();
+        return false;
+    }
+    return true;
+#else
+    (void)path;
+    return false;
+#endif
+}
+
+void FanoutClient::disconnect() {
+#ifndef _WIN32
+    if (fd >= 0) close(fd);
+#endif
+    fd = -1;
+}
+
+bool FanoutClient::readAvailable() {
+#ifndef _WIN32
+    if (fd < 0) return false;
+    if (!drainSocket(fd, inbox)) {
+        disconnect();
+        return false;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+void FanoutClient::poll() {
+    readAvailable();
+    handleFrames();
+}
+
+void FanoutClient::handleFrames() {
+    size_t off = 0;
+    bool had_delta = false;
+    while (inbox.size() - off >= FanoutProtocol::HEADER_SIZE) {
+        uint8_t type = (uint8_t)inbox[off];
+        uint32_t len = getPod<uint32_t>(&inbox[off + 1]);
+        if (inbox.size() - off - FanoutProtocol::HEADER_SIZE < len) break;
+        const char* body = &inbox[off + FanoutProtocol::HEADER_SIZE];
+        const char* end = body + len;
+
+        if (type == FanoutProtocol::TAGS && len >= 4) {
+            uint32_t n = getPod<uint32_t>(body);
+            const char* p = body + 4;
+            store.clearTags();
+            node_ids.clear();
+            for (uint32_t i = 0; i < n && p + 2 <= end; ++i) {
+                uint16_t nl = getPod<uint16_t>(p); p += 2;
+                std::string name(p, std::min<size_t>(nl, end - p)); p += nl;
+                if (p + 2 > end) break;
+                uint16_t il = getPod<uint16_t>(p); p += 2;
+                std::string id(p, std::min<size_t>(il, end - p)); p += il;
+                store.addTag(name, id);
+                node_ids.push_back(id);
+            }
+        } else if (type == FanoutProtocol::DELTA && len >= 4) {
+            uint32_t n = getPod<uint32_t>(body);
+            const char* p = body + 4;
+            for (uint32_t i = 0; i < n && p + sizeof(FanoutProtocol::Entry) <= end; ++i) {
+                auto e = getPod<FanoutProtocol::Entry>(p);
+                p += sizeof(FanoutProtocol::Entry);
+
+                UA_DataValue dv;
+                UA_DataValue_init(&dv);
+                UA_Variant_setScalar(&dv.value, &e.value, &UA_TYPES[UA_TYPES_DOUBLE]);
+                dv.hasValue = true;
+                dv.status = e.status;
+                dv.hasStatus = e.status != UA_STATUSCODE_GOOD;
+                dv.sourceTimestamp = e.sourceTime;
+                dv.hasSourceTimestamp = e.sourceTime != 0;
+                // Значение лежит на стеке, поэтому dv не очищается
+                store.ingest(e.slot, dv);
+            }
+            had_delta = true;
+        } else if (type == FanoutProtocol::WRITE_RESULT && len >= 5) {
+            if ((int)getPod<uint32_t>(body) == pending_write_slot) write_result = body[4] ? 1 : 0;
+        }
+        off += FanoutProtocol::HEADER_SIZE + len;
+    }
+    inbox.erase(inbox.begin(), inbox.begin() + off);
+    if (had_delta) store.flushSinks();
+}
+
+bool FanoutClient::writeValue(const std::string& nodeId, double value, int timeoutMs) {
+#ifndef _WIN32
+    if (fd < 0) return false;
+    int slot = -1;
+    for (size_t i = 0; i < node_ids.size(); ++i) {
+        if (node_ids[i] == nodeId) { slot = (int)i; break; }
+    }
+    if (slot < 0) return false;
+
+    std::vector<char> frame;
+    putFrameHeader(frame, FanoutProtocol::WRITE, 12);
+    putPod(frame, (uint32_t)slot);
+    putPod(frame, value);
+    size_t sent = 0;
+    while (sent < frame.size()) {
+        ssize_t n = send(fd, frame.data() + sent, frame.size() - sent, 0);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) continue;
+            disconnect();
+            return false;
+        }
+        sent += (size_t)n;
+    }
+
+    pending_write_slot = slot;
+    write_result = -1;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    while (write_result < 0 && fd >= 0) {
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - std::chrono::steady_clock::now()).count();
+        if (left <= 0) break;
+        pollfd pfd{fd, POLLIN, 0};
+        ::poll(&pfd, 1, (int)left);
+        poll();
+    }
+    pending_write_slot = -1;
+    return write_result == 1;
+#else
+    (void)nodeId; (void)value; (void)timeoutMs;
+    return false;
+#endif
+}
\ No newline at end of file
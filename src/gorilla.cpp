@@ -0,0 +1,204 @@
+#include "../include/gorilla.hpp"
+#include <cstring>
+
+namespace {
+
+const unsigned NO_WINDOW = 64;
+
+unsigned leadingZeros(uint64_t x) {
+#if defined(__GNUC__)
+    return (unsigned)__builtin_clzll(x);
+#else
+    unsigned n = 0;
+    while (!(x & (1ull << 63))) {
+        x <<= 1;
+        ++n;
+    }
+    return n;
+#endif
+}
+
+unsigned trailingZeros(uint64_t x) {
+#if defined(__GNUC__)
+    return (unsigned)__builtin_ctzll(x);
+#else
+    unsigned n = 0;
+    while (!(x & 1)) {
+        x >>= 1;
+        ++n;
+    }
+    return n;
+#endif
+}
+
+uint64_t doubleBits(double v) {
+    uint64_t b;
+    std::memcpy(&b, &v, sizeof(b));
+    return b;
+}
+
+double bitsDouble(uint64_t b) {
+    double v;
+    std::memcpy(&v, &b, sizeof(v));
+    return v;
+}
+
+int64_t signExtend(uint64_t v, unsigned n) {
+    return (int64_t)(v << (64 - n)) >> (64 - n);
+}
+
+// Чтение битов от старшего к младшему; выход за конец данных запоминается в failed
+class BitReader {
+public:
+    BitReader(const uint64_t* words, size_t count) : words(words), limit(count * 64), pos(0), failed(false) {}
+
+    uint64_t read(unsigned n) {
+        if (pos + n > limit) {
+            failed = true;
+            return 0;
+        }
+        size_t w = pos >> 6;
+        unsigned off = (unsigned)(pos & 63);
+        uint64_t v = words[w] << off;
+        if (off + n > 64) v |= words[w + 1] >> (64 - off);
+        pos += n;
+        return n == 64 ? v : v >> (64 - n);
+    }
+    bool bit() { return read(1) != 0; }
+    bool ok() const { return !failed; }
+
+private:
+    const uint64_t* words;
+    size_t limit;
+    size_t pos;
+    bool failed;
+};
+
+} // namespace
+
+void GorillaEncoder::clear() {
+    data.clear();
+    bit_count = 0;
+    points = 0;
+    first_time = 0;
+    prev_time = 0;
+    prev_delta = 0;
+    prev_value = 0;
+    prev_leading = NO_WINDOW;
+    prev_trailing = 0;
+}
+
+void GorillaEncoder::put(uint64_t v, unsigned n) {
+    if (n < 64) v &= (1ull << n) - 1;
+    unsigned used = (unsigned)(bit_count & 63);
+    if (used == 0) data.push_back(0);
+    unsigned free = 64 - used;
+    if (n <= free) {
+        data.back() |= v << (free - n);
+    } else {
+        data.back() |= v >> (n - free);
+        data.push_back(v << (64 - (n - free)));
+    }
+    bit_count += n;
+}
+
+void GorillaEncoder::append(int64_t timeMs, double value) {
+    uint64_t bits = doubleBits(value);
+    if (points == 0) {
+        put((uint64_t)timeMs, 64);
+        put(bits, 64);
+        first_time = prev_time = timeMs;
+        prev_value = bits;
+        ++points;
+        return;
+    }
+
+    int64_t delta = timeMs - prev_time;
+    int64_t dod = delta - prev_delta;
+    if (dod == 0) {
+        put(0, 1);
+    } else if (dod >= -64 && dod <= 63) {
+        put(0x2, 2);
+        put((uint64_t)dod, 7);
+    } else if (dod >= -256 && dod <= 255) {
+        put(0x6, 3);
+        put((uint64_t)dod, 9);
+    } else if (dod >= -2048 && dod <= 2047) {
+        put(0xe, 4);
+        put((uint64_t)dod, 12);
+    } else {
+        put(0xf, 4);
+        put((uint64_t)dod, 64);
+    }
+    prev_delta = delta;
+    prev_time = timeMs;
+
+    uint64_t x = bits ^ prev_value;
+    prev_value = bits;
+    if (x == 0) {
+        put(0, 1);
+    } else {
+        unsigned leading = leadingZeros(x);
+        unsigned trailing = trailingZeros(x);
+        if (leading > 31) leading = 31;  // поле длины — 5 бит
+        if (prev_leading != NO_WINDOW && leading >= prev_leading && trailing >= prev_trailing) {
+            // Значимые биты помещаются в прежнее окно: его границы не повторяются
+            put(0x2, 2);
+            put(x >> prev_trailing, 64 - prev_leading - prev_trailing);
+        } else {
+            unsigned significant = 64 - leading - trailing;
+            put(0x3, 2);
+            put(leading, 5);
+            put(significant & 63, 6);
+            put(x >> trailing, significant);
+            prev_leading = leading;
+            prev_trailing = trailing;
+        }
+    }
+    ++points;
+}
+
+GorillaBlock GorillaBlock::seal(const GorillaEncoder& encoder) {
+    GorillaBlock b;
+    b.words.assign(encoder.words().begin(), encoder.words().end());
+    b.count = (uint32_t)encoder.count();
+    b.first = encoder.firstTime();
+    b.last = encoder.lastTime();
+    return b;
+}
+
+bool gorillaDecode(const uint64_t* words, size_t wordCount, size_t count, int64_t* times, double* values) {
+    if (count == 0) return true;
+    BitReader in(words, wordCount);
+    int64_t time = (int64_t)in.read(64);
+    uint64_t value = in.read(64);
+    int64_t delta = 0;
+    unsigned leading = 0;
+    unsigned trailing = 0;
+    times[0] = time;
+    values[0] = bitsDouble(value);
+    for (size_t i = 1; i < count && in.ok(); ++i) {
+        if (in.bit()) {
+            int64_t dod;
+            if (!in.bit()) dod = signExtend(in.read(7), 7);
+            else if (!in.bit()) dod = signExtend(in.read(9), 9);
+            else if (!in.bit()) dod = signExtend(in.read(12), 12);
+            else dod = (int64_t)in.read(64);
+            delta += dod;
+        }
+        time += delta;
+
+        if (in.bit()) {
+            if (in.bit()) {
+                leading = (unsigned)in.read(5);
+                unsigned significant = (unsigned)in.read(6);
+                if (significant == 0) significant = 64;
+                trailing = 64 - leading - significant;
+            }
+            value ^= in.read(64 - leading - trailing) << trailing;
+        }
+        times[i] = time;
+        values[i] = bitsDouble(value);
+    }
+    return in.ok();
+}
@@ -0,0 +1,222 @@
+#include "../include/history.hpp"
+#include <algorithm>
+#include <limits>
+
+bool HistorySink::copy(size_t slot, const std::string& name, std::vector<double>& out) {
+    out.clear();
+    std::lock_guard<std::mutex> lock(mutex);
+    if (slot >= rings.size() || rings[slot].values.empty() || rings[slot].name != name) return false;
+    const Ring& r = rings[slot];
+    // Пока кольцо не заполнено, head указывает за последним значением
+    if (r.values.size() < depth) {
+        out = r.values;
+    } else {
+        out.insert(out.end(), r.values.begin() + r.head, r.values.end());
+        out.insert(out.end(), r.values.begin(), r.values.begin() + r.head);
+    }
+    return true;
+}
+
+bool HistorySink::copySeries(size_t slot, const std::string& name, int64_t fromMs, std::vector<int64_t>& times,
+                             std::vector<double>& values) {
+    times.clear();
+    values.clear();
+    std::lock_guard<std::mutex> lock(mutex);
+    if (slot >= rings.size() || rings[slot].values.empty() || rings[slot].name != name) return false;
+    copySeriesLocked(rings[slot], fromMs, times, values);
+    return true;
+}
+
+void HistorySink::copySeriesLocked(const Ring& r, int64_t fromMs, std::vector<int64_t>& times,
+                                   std::vector<double>& values) {
+    auto decode = [&](const std::vector<uint64_t>& words, size_t count) {
+        size_t at = times.size();
+        times.resize(at + count);
+        values.resize(at + count);
+        if (!gorillaDecode(words.data(), words.size(), count, times.data() + at, values.data() + at)) {
+            times.resize(at);
+            values.resize(at);
+        }
+    };
+    for (const auto& b : r.sealed) {
+        if (b.last >= fromMs) decode(b.words, b.count);
+    }
+    if (r.open.count() > 0 && r.open.lastTime() >= fromMs) decode(r.open.words(), r.open.count());
+    size_t filled = r.values.size();
+    size_t start = filled < depth ? 0 : r.head;
+    for (size_t i = 0; i < filled; ++i) {
+        size_t k = (start + i) % filled;
+        times.push_back(r.times[k]);
+        values.push_back(r.values[k]);
+    }
+    // Сегмент, начатый раньше fromMs, раскодирован целиком — лишние точки убираются
+    size_t kept = 0;
+    for (size_t i = 0; i < times.size(); ++i) {
+        if (times[i] < fromMs) continue;
+        times[kept] = times[i];
+        values[kept] = values[i];
+        ++kept;
+    }
+    times.resize(kept);
+    values.resize(kept);
+}
+
+bool HistorySink::copyColumns(size_t slot, const std::string& name, int64_t fromMs, int64_t toMs, size_t columns,
+                              std::vector<RollupBucket>& out, int* tier, double* before) {
+    out.assign(columns, RollupBucket{0, 0, 0, 0, 0, 0});
+    if (tier) *tier = -1;
+    if (before) *before = std::numeric_limits<double>::quiet_NaN();
+    if (columns == 0 || toMs <= fromMs) return false;
+    const int64_t span = toMs - fromMs;
+    auto column = [&](int64_t t) {
+        size_t c = (size_t)((std::max(t, fromMs) - fromMs) * (int64_t)columns / span);
+        return std::min(c, columns - 1);
+    };
+    int chosen = -1;
+    for (size_t t = 0; t < RollupSeries::TIERS; ++t) {
+        if (RollupSeries::tierMs(t) * (int64_t)columns <= span) chosen = (int)t;
+    }
+    if (tier) *tier = chosen;
+
+    std::vector<int64_t> times;
+    std::vector<double> values;
+    std::vector<RollupBucket> pieces[RollupSeries::TIERS];
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (slot >= rings.size() || rings[slot].values.empty() || rings[slot].name != name) return false;
+        const Ring& r = rings[slot];
+        // Источники от мелкого к грубому; каждый следующий покрывает время до начала предыдущего
+        int64_t covered = toMs;
+        if (chosen < 0) {
+            copySeriesLocked(r, fromMs, times, values);
+            if (!times.empty()) covered = times.front();
+        }
+        for (size_t t = chosen < 0 ? 0 : (size_t)chosen; t < RollupSeries::TIERS && covered > fromMs; ++t) {
+            r.rollups.copy(t, fromMs, covered, pieces[t]);
+            // Интервал, заходящий на время более мелкого источника, учёл бы его значения дважды
+            if (covered < toMs) {
+                while (!pieces[t].empty() && pieces[t].back().start + RollupSeries::tierMs(t) > covered) {
+                    pieces[t].pop_back();
+                }
+            }
+            int64_t start;
+            if (r.rollups.oldest(t, start) && start < covered) covered = start;
+        }
+        if (before) beforeLocked(r, fromMs, *before);
+    }
+
+    // Слияние от старых к новым: грубые ступени покрывают более раннее время
+    for (size_t t = RollupSeries::TIERS; t-- > 0;) {
+        for (const auto& b : pieces[t]) out[column(b.start)].merge(b);
+    }
+    for (size_t i = 0; i < times.size(); ++i) {
+        if (times[i] >= toMs) break;
+        double v = values[i];
+        out[column(times[i])].merge(RollupBucket{times[i], v, v, v, v, 1});
+    }
+    for (size_t c = 0; c < columns; ++c) out[c].start = fromMs + span * (int64_t)c / (int64_t)columns;
+    return true;
+}
+
+void HistorySink::beforeLocked(const Ring& r, int64_t fromMs, double& value) {
+    // Кольцо точное, но короткое; что старше его — по ступеням свёртки
+    size_t filled = r.values.size();
+    size_t start = filled < depth ? 0 : r.head;
+    if (filled && r.times[start] < fromMs) {
+        for (size_t i = filled; i-- > 0;) {
+            size_t k = (start + i) % filled;
+            if (r.times[k] < fromMs) {
+                value = r.values[k];
+                return;
+            }
+        }
+    }
+    r.rollups.lastBefore(fromMs, value);
+}
+
+size_t HistorySink::memoryBytes() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return rings.capacity() * sizeof(Ring) + stored * (sizeof(double) + sizeof(int64_t)) + packed_bytes +
+           rollup_buckets * sizeof(RollupBucket);
+}
+
+size_t HistorySink::packedSamples() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return packed_samples;
+}
+
+size_t HistorySink::packedBytes() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return packed_bytes;
+}
+
+void HistorySink::resetLocked(Ring& r) {
+    stored -= r.values.size();
+    r.values.clear();
+    r.times.clear();
+    r.head = 0;
+    packed_samples -= r.open.count();
+    packed_bytes -= r.open.words().size() * sizeof(uint64_t);
+    r.open.clear();
+    for (const auto& b : r.sealed) {
+        packed_samples -= b.count;
+        packed_bytes -= b.bytes();
+    }
+    r.sealed.clear();
+    rollup_buckets -= r.rollups.bucketCount();
+    r.rollups.clear();
+}
+
+void HistorySink::onReset() {
+    // Ряды и свёртки рассчитаны на возрастающее время
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto& r : rings) resetLocked(r);
+}
+
+void HistorySink::onValueChanged(size_t slot, const OPCUAClient::TagData& tag, const UA_DataValue& dv) {
+    // Плохое качество значение не меняет — в истории повторилось бы прежнее
+    if (tag.quality == "BAD") return;
+    UA_DateTime t = dv.hasSourceTimestamp && dv.sourceTimestamp ? dv.sourceTimestamp : UA_DateTime_now();
+    int64_t ms = (t - UA_DATETIME_UNIX_EPOCH) / UA_DATETIME_MSEC;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (slot >= rings.size()) rings.resize(slot + 1);
+    Ring& r = rings[slot];
+    if (r.name != tag.name) {
+        resetLocked(r);
+        r.name = tag.name;
+    }
+    rollup_buckets += r.rollups.add(ms, tag.value);
+    if (r.values.size() < depth) {
+        // Кольцо растёт до depth и дальше не перераспределяется
+        if (r.values.capacity() < depth) {
+            r.values.reserve(depth);
+            r.times.reserve(depth);
+        }
+        r.values.push_back(tag.value);
+        r.times.push_back(ms);
+        ++stored;
+        r.head = r.values.size() % depth;
+        return;
+    }
+
+    // Самое старое значение кольца уходит в сжатый сегмент
+    size_t words_before = r.open.words().size();
+    r.open.append(r.times[r.head], r.values[r.head]);
+    packed_bytes += (r.open.words().size() - words_before) * sizeof(uint64_t);
+    ++packed_samples;
+    if (r.open.count() >= segment_samples) {
+        packed_bytes -= r.open.words().size() * sizeof(uint64_t);
+        r.sealed.push_back(GorillaBlock::seal(r.open));
+        packed_bytes += r.sealed.back().bytes();
+        r.open.clear();
+        if (r.sealed.size() > max_segments) {
+            packed_samples -= r.sealed.front().count;
+            packed_bytes -= r.sealed.front().bytes();
+            r.sealed.pop_front();
+        }
+    }
+    r.values[r.head] = tag.value;
+    r.times[r.head] = ms;
+    r.head = (r.head + 1) % depth;
+}
@@ -0,0 +1,127 @@
+#include "../include/json_stream.hpp"
+#include <cstring>
+#include <csignal>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+std::FILE* openUnixSocket(const std::string& path) {
+#ifndef _WIN32
+    // Отключившийся читатель не должен ронять процесс через SIGPIPE
+    std::signal(SIGPIPE, SIG_IGN);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return nullptr;
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    if (connect(fd, (sockaddr*)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return nullptr;
+    }
+    return fdopen(fd, "w");
+#else
+    (void)path;
+    return nullptr;
+#endif
+}
+
+// Экранирование имён тегов для JSON (кавычки, обратный слэш, управляющие символы)
+std::string escapeJson(const std::string& s) {
+    std::string r;
+    r.reserve(s.size());
+    for (char c : s) {
+        if (c == '"' || c == '\\') { r += '\\'; r += c; }
+        else if ((unsigned char)c < 0x20) {
+            char buf[8];
+            std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+            r += buf;
+        } else r += c;
+    }
+    return r;
+}
+
+} // namespace
+
+JsonStreamSink::JsonStreamSink(const std::string& target, size_t batchBytes)
+    : out(nullptr), owns_out(true), buffer(batchBytes + 4096), used(0),
+      batch_limit(batchBytes), lines(0) {
+    if (target == "-") {
+        out = stdout;
+        owns_out = false;
+    } else if (target.rfind("unix:", 0) == 0) {
+        out = openUnixSocket(target.substr(5));
+    } else {
+        out = std::fopen(target.c_str(), "ab");
+    }
+    // Буферизацию делаем сами, stdio только мешает пакетной записи
+    if (out) std::setvbuf(out, nullptr, _IONBF, 0);
+}
+
+JsonStreamSink::~JsonStreamSink() {
+    flush();
+    if (out && owns_out) std::fclose(out);
+}
+
+void JsonStreamSink::appendRaw(const char* data, size_t len) {
+    if (buffer.size() - used < len) buffer.resize(used + len + 4096);
+    std::memcpy(buffer.data() + used, data, len);
+    used += len;
+}
+
+bool JsonStreamSink::appendJson(const UA_DataValue& dv) {
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        // Энкодер пишет в хвост нашего буфера без собственных аллокаций
+        UA_ByteString view;
+        view.data = (UA_Byte*)buffer.data() + used;
+        view.length = buffer.size() - used;
+        UA_StatusCode res = UA_encodeJson(&dv, &UA_TYPES[UA_TYPES_DATAVALUE], &view, nullptr);
+        if (res == UA_STATUSCODE_GOOD) {
+            used += view.length;
+            return true;
+        }
+        if (res != UA_STATUSCODE_BADENCODINGLIMITSEXCEEDED) return false;
+        size_t need = UA_calcSizeJson(&dv, &UA_TYPES[UA_TYPES_DATAVALUE], nullptr);
+        if (need == 0) return false;
+        buffer.resize(used + need + 4096);
+    }
+    return false;
+}
+
+void JsonStreamSink::onValueChanged(size_t slot, const OPCUAClient::TagData& tag, const UA_DataValue& dv) {
+    if (!out) return;
+    std::lock_guard<std::mutex> lock(buffer_mutex);
+
+    size_t line_start = used;
+    std::string head = "{\"slot\":" + std::to_string(slot) +
+                       ",\"tag\":\"" + escapeJson(tag.name) +
+                       "\",\"nodeId\":\"" + escapeJson(tag.nodeId) + "\",\"dv\":";
+    appendRaw(head.data(), head.size());
+    if (!appendJson(dv)) {
+        used = line_start;  // недокодированная строка не должна попасть в поток
+        return;
+    }
+    appendRaw("}\n", 2);
+    ++lines;
+
+    if (used >= batch_limit) flushLocked();
+}
+
+void JsonStreamSink::flush() {
+    std::lock_guard<std::mutex> lock(buffer_mutex);
+    flushLocked();
+}
+
+void JsonStreamSink::flushLocked() {
+    if (!out || used == 0) return;
+    if (std::fwrite(buffer.data(), 1, used, out) != used) {
+        // Получатель закрыл сокет или кончилось место — дальше не пишем
+        if (owns_out) std::fclose(out);
+        out = nullptr;
+    }
+    used = 0;
+}
\ No newline at end of file
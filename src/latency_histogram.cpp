@@ -0,0 +1,100 @@
+#include "../include/latency_histogram.hpp"
+#include <chrono>
+#include <cstdio>
+
+namespace {
+
+int highestBit(uint64_t v) {
+    int msb = 0;
+    while (v >>= 1) ++msb;
+    return msb;
+}
+
+int64_t steadyNanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+LatencyHistogram::LatencyHistogram() {
+    reset();
+}
+
+int LatencyHistogram::bucketIndex(uint64_t v) {
+    // Значения меньше 2*SUB_COUNT хранятся точно, дальше — с шагом 2^shift
+    if (v < (uint64_t)(2 * SUB_COUNT)) return (int)v;
+    int shift = highestBit(v) - SUB_BITS;
+    return (shift + 1) * SUB_COUNT + (int)((v >> shift) - SUB_COUNT);
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(int index) {
+    if (index < 2 * SUB_COUNT) return (uint64_t)index;
+    int shift = index / SUB_COUNT - 1;
+    uint64_t sub = (uint64_t)(index % SUB_COUNT + SUB_COUNT);
+    return ((sub + 1) << shift) - 1;
+}
+
+void LatencyHistogram::record(uint64_t nanos) {
+    buckets[bucketIndex(nanos)].fetch_add(1, std::memory_order_relaxed);
+    total.fetch_add(1, std::memory_order_relaxed);
+    total_sum.fetch_add(nanos, std::memory_order_relaxed);
+
+    uint64_t cur = max_value.load(std::memory_order_relaxed);
+    while (nanos > cur && !max_value.compare_exchange_weak(cur, nanos, std::memory_order_relaxed)) {}
+    cur = min_value.load(std::memory_order_relaxed);
+    while (nanos < cur && !min_value.compare_exchange_weak(cur, nanos, std::memory_order_relaxed)) {}
+}
+
+void LatencyHistogram::reset() {
+    for (auto& b : buckets) b.store(0, std::memory_order_relaxed);
+    total.store(0, std::memory_order_relaxed);
+    total_sum.store(0, std::memory_order_relaxed);
+    min_value.store(UINT64_MAX, std::memory_order_relaxed);
+    max_value.store(0, std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::min() const {
+    uint64_t v = min_value.load(std::memory_order_relaxed);
+    return v == UINT64_MAX ? 0 : v;
+}
+
+uint64_t LatencyHistogram::percentile(double q) const {
+    uint64_t n = count();
+    if (n == 0) return 0;
+    if (q >= 1.0) return max();
+    uint64_t rank = (uint64_t)(q * (double)n) + 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKET_COUNT; ++i) {
+        seen += buckets[i].load(std::memory_order_relaxed);
+        if (seen >= rank) {
+            // Граница диапазона не может быть больше реально наблюдённого максимума
+            uint64_t upper = bucketUpperBound(i);
+            uint64_t mx = max();
+            return upper < mx ? upper : mx;
+        }
+    }
+    return max();
+}
+
+uint64_t LatencyHistogram::countAtOrBelow(uint64_t nanos) const {
+    int last = bucketIndex(nanos);
+    uint64_t n = 0;
+    for (int i = 0; i <= last; ++i) n += buckets[i].load(std::memory_order_relaxed);
+    return n;
+}
+
+LatencyTimer::LatencyTimer(LatencyHistogram* h) : histogram(h), start_ns(steadyNanos()) {}
+
+LatencyTimer::~LatencyTimer() {
+    if (histogram) histogram->record((uint64_t)(steadyNanos() - start_ns));
+}
+
+std::string formatNanos(uint64_t nanos) {
+    char buf[32];
+    if (nanos < 1000) std::snprintf(buf, sizeof(buf), "%lluns", (unsigned long long)nanos);
+    else if (nanos < 1000000) std::snprintf(buf, sizeof(buf), "%.1fus", nanos / 1e3);
+    else if (nanos < 1000000000ULL) std::snprintf(buf, sizeof(buf), "%.2fms", nanos / 1e6);
+    else std::snprintf(buf, sizeof(buf), "%.2fs", nanos / 1e9);
+    return buf;
+}
\ No newline at end of file
@@ -0,0 +1,177 @@
+#include "../include/load_profile.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+namespace {
+
+const char* TYPE_NAMES[] = {"bool", "int32", "int64", "float", "double", "string"};
+
+bool fail(std::string* error, size_t line, const std::string& what) {
+    if (error) *error = "line " + std::to_string(line) + ": " + what;
+    return false;
+}
+
+bool parseNumber(const std::string& text, double& out) {
+    char* end = nullptr;
+    out = std::strtod(text.c_str(), &end);
+    return !text.empty() && *end == '\0' && std::isfinite(out) && out >= 0;
+}
+
+} // namespace
+
+double LoadGroup::changesBy(uint64_t ms) const {
+    double active = (double)ms;
+    if (burstPeriodMs > 0) {
+        uint64_t on = (ms / burstPeriodMs) * burstMs + std::min<uint64_t>(ms % burstPeriodMs, burstMs);
+        active += (burstFactor - 1.0) * (double)on;
+    }
+    return rate * active / 1000.0;
+}
+
+double LoadGroup::averageRate() const {
+    if (burstPeriodMs == 0) return rate;
+    return rate * (1.0 + (burstFactor - 1.0) * burstMs / burstPeriodMs);
+}
+
+double LoadGroup::observableRate(uint32_t periodMs) const {
+    double cap = periodMs > 0 ? 1000.0 / periodMs : rate * std::max(1.0, burstFactor);
+    if (burstPeriodMs == 0) return std::min(rate, cap);
+    double share = (double)burstMs / burstPeriodMs;
+    return share * std::min(rate * burstFactor, cap) + (1.0 - share) * std::min(rate, cap);
+}
+
+bool parseLoadType(const std::string& name, LoadGroup::Type& out) {
+    for (int i = 0; i <= LoadGroup::STRING; ++i) {
+        if (name == TYPE_NAMES[i]) {
+            out = (LoadGroup::Type)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* loadTypeName(LoadGroup::Type type) {
+    return TYPE_NAMES[type];
+}
+
+bool parseLoadProfile(const std::string& text, std::vector<LoadGroup>& out, std::string* error) {
+    // Профиль разбирается целиком, чтобы ошибка не оставила половину групп
+    std::vector<LoadGroup> groups;
+    size_t total = 0;
+    std::istringstream in(text);
+    std::string line;
+    for (size_t number = 1; std::getline(in, line); ++number) {
+        std::istringstream fields(line);
+        std::string kind;
+        if (!(fields >> kind) || kind[0] == '#') continue;
+        if (kind != "group") return fail(error, number, "unknown directive " + kind);
+
+        LoadGroup g{"", 0, LoadGroup::DOUBLE, 0, 1.0, 0, 0, 1.0, 0};
+        std::string type;
+        if (!(fields >> g.name >> g.count >> type)) return fail(error, number, "expected group <name> <count> <type>");
+        if (!parseLoadType(type, g.type)) return fail(error, number, "unknown type " + type);
+        if (g.count == 0) return fail(error, number, "group " + g.name + " is empty");
+        for (const auto& other : groups) {
+            if (other.name == g.name) return fail(error, number, "duplicate group " + g.name);
+        }
+
+        std::string option;
+        while (fields >> option) {
+            size_t eq = option.find('=');
+            std::string key = option.substr(0, eq);
+            std::string value = eq == std::string::npos ? std::string() : option.substr(eq + 1);
+            double number_value;
+            if (key == "array" && parseNumber(value, number_value)) {
+                g.arraySize = (uint32_t)number_value;
+            } else if (key == "rate" && parseNumber(value, number_value)) {
+                g.rate = number_value;
+            } else if (key == "burst") {
+                unsigned period = 0, length = 0;
+                double factor = 0;
+                char tail;
+                if (std::sscanf(value.c_str(), "%u/%u/%lf%c", &period, &length, &factor, &tail) != 3 ||
+                    period == 0 || length > period || !(factor >= 0)) {
+                    return fail(error, number, "burst must be period_ms/length_ms/factor");
+                }
+                g.burstPeriodMs = period;
+                g.burstMs = length;
+                g.burstFactor = factor;
+            } else {
+                return fail(error, number, "bad option " + option);
+            }
+        }
+
+        g.firstId = (uint32_t)(total + 1);
+        total += g.count;
+        if (total > MAX_LOAD_VARIABLES) {
+            return fail(error, number, "more than " + std::to_string(MAX_LOAD_VARIABLES) + " variables");
+        }
+        groups.push_back(g);
+    }
+    if (groups.empty()) {
+        if (error) *error = "no groups";
+        return false;
+    }
+    out.swap(groups);
+    return true;
+}
+
+bool loadLoadProfile(const std::string& path, std::vector<LoadGroup>& out, std::string* error) {
+    std::ifstream in(path);
+    if (!in) {
+        if (error) *error = "cannot open " + path;
+        return false;
+    }
+    std::stringstream text;
+    text << in.rdbuf();
+    return parseLoadProfile(text.str(), out, error);
+}
+
+size_t loadVariableCount(const std::vector<LoadGroup>& groups) {
+    size_t n = 0;
+    for (const auto& g : groups) n += g.count;
+    return n;
+}
+
+std::string loadTagName(const LoadGroup& group, uint32_t index) {
+    return group.name + "." + std::to_string(index);
+}
+
+bool writeLoadTagConfig(const std::vector<LoadGroup>& groups, const std::string& path, uint32_t periodMs,
+                        size_t limit) {
+    std::ofstream out(path);
+    if (!out) return false;
+    for (const auto& g : groups) out << "group " << g.name << " " << periodMs << "\n";
+    for (const auto& g : groups) {
+        for (uint32_t i = 0; i < g.count && limit > 0; ++i, --limit) {
+            out << "tag " << loadTagName(g, i) << " ns=1;i=" << (g.firstId + i) << " " << g.name << "\n";
+        }
+    }
+    return (bool)out;
+}
+
+LoadSchedule::LoadSchedule(const std::vector<LoadGroup>& groups)
+    : groups(groups), group_emitted(groups.size(), 0), total_emitted(0), total_skipped(0) {}
+
+void LoadSchedule::advance(uint64_t nowMs, std::vector<Change>& out) {
+    for (size_t g = 0; g < groups.size(); ++g) {
+        const LoadGroup& group = groups[g];
+        // Цель считается от начала работы, а не накапливается по шагам, поэтому не уплывает
+        uint64_t target = (uint64_t)std::floor(group.changesBy(nowMs) * group.count);
+        uint64_t from = group_emitted[g];
+        if (target <= from) continue;
+        if (target - from > group.count) {
+            total_skipped += target - from - group.count;
+            from = target - group.count;
+        }
+        for (uint64_t k = from; k < target; ++k) {
+            out.push_back({(uint32_t)g, (uint32_t)(k % group.count), k / group.count});
+        }
+        total_emitted += target - from;
+        group_emitted[g] = target;
+    }
+}
@@ -1,40 +1,356 @@
 #include <ftxui/dom/elements.hpp>
 #include <ftxui/screen/screen.hpp>
+#include <ftxui/screen/terminal.hpp>
 #include <ftxui/component/component.hpp>
 #include <ftxui/component/screen_interactive.hpp>
-#include <map>
+#include <ftxui/dom/node.hpp>
+#include <cmath>
+#include <cstdio>
 #include <thread>
 #include <atomic>
 #include <string>
 #include <vector>
 #include <algorithm>
+#include <memory>
+#include <unordered_map>
 #include "../include/opcua_client.hpp"
+#include "../include/json_stream.hpp"
+#include "../include/fanout.hpp"
+#include "../include/metrics.hpp"
+#include "../include/trace.hpp"
+#include "../include/alarms.hpp"
+#include "../include/tag_stats.hpp"
+#include "../include/tag_search.hpp"
+#include "../include/history.hpp"
+#include "../include/recorder.hpp"
+#include "../include/replay.hpp"
+#include "../include/pubsub_source.hpp"
+#include "../include/waveform.hpp"
+#include "../include/spectrum.hpp"
 
 using namespace ftxui;
 
-int main() {
+// Узел-обёртка: показывает в трассе, сколько времени FTXUI тратит на
+// расчёт размеров, раскладку и отрисовку дерева элементов
+class TracedNode : public Node {
+public:
+    explicit TracedNode(Element child) : Node(Elements{std::move(child)}) {}
+
+    void ComputeRequirement() override {
+        TRACE_SCOPE("ftxui_requirement");
+        Node::ComputeRequirement();
+        requirement_ = children_[0]->requirement();
+    }
+    void SetBox(Box box) override {
+        TRACE_SCOPE("ftxui_layout");
+        Node::SetBox(box);
+        children_[0]->SetBox(box);
+    }
+    void Render(Screen& screen) override {
+        TRACE_SCOPE("ftxui_render");
+        Node::Render(screen);
+    }
+};
+
+Element traced(Element child) {
+    return std::make_shared<TracedNode>(std::move(child));
+}
+
+// Осциллограмма: тысячи отсчётов на несколько десятков колонок, в каждой — пик своего
+// участка, чтобы короткие всплески не терялись при прореживании
+Element waveformGraph(std::shared_ptr<std::vector<double>> samples) {
+    return graph([samples](int w, int h) {
+        TRACE_SCOPE("waveform_series");
+        std::vector<int> r(w, 0);
+        const auto& s = *samples;
+        if (s.empty() || w <= 0 || h == 0) return r;
+        auto [min_it, max_it] = std::minmax_element(s.begin(), s.end());
+        double min_v = *min_it;
+        double span = *max_it - min_v;
+        if (span == 0) span = 1.0;
+        size_t columns = std::min((size_t)w, s.size());
+        for (size_t c = 0; c < columns; ++c) {
+            size_t from = c * s.size() / columns;
+            size_t to = (c + 1) * s.size() / columns;
+            double peak = *std::max_element(s.begin() + from, s.begin() + to);
+            r[w - columns + c] = static_cast<int>((peak - min_v) * h / span);
+        }
+        return r;
+    });
+}
+
+// Спектр столбцами: бины без постоянной составляющей, в колонке — наибольший,
+// высота в дБ от пика всего спектра (шкала 60 дБ)
+Element spectrumGraph(std::shared_ptr<std::vector<double>> bins) {
+    return graph([bins](int w, int h) {
+        TRACE_SCOPE("spectrum_series");
+        std::vector<int> r(w, 0);
+        const auto& b = *bins;
+        if (b.size() < 2 || w <= 0 || h == 0) return r;
+        double peak = *std::max_element(b.begin() + 1, b.end());
+        if (peak <= 0) return r;
+        const double RANGE_DB = 60.0;
+        size_t count = b.size() - 1;
+        size_t columns = std::min((size_t)w, count);
+        for (size_t c = 0; c < columns; ++c) {
+            size_t from = 1 + c * count / columns;
+            size_t to = 1 + (c + 1) * count / columns;
+            double v = *std::max_element(b.begin() + from, b.begin() + to);
+            double db = v > 0 ? 20 * std::log10(v / peak) : -RANGE_DB;
+            r[c] = static_cast<int>(std::max(0.0, (db + RANGE_DB) / RANGE_DB) * h);
+        }
+        return r;
+    });
+}
+
+int main(int argc, char** argv) {
+    // Параметры командной строки: --url <адрес>, --json <файл|unix:/путь> (stdout занят экраном),
+    // --attach <сокет коллектора> — работать через opcua_collector без своей сессии,
+    // --shm <имя> — публиковать таблицу тегов в разделяемую память,
+    // --latency-dump <файл> — сохранить гистограммы задержек при выходе,
+    // --metrics-port <порт> / --metrics-file <путь> — метрики в формате Prometheus,
+    // --trace-file <путь> — куда писать трассировку (включается/выключается F3),
+    // --tags <файл> — группы опроса и теги (см. OPCUAClient::loadTagConfig), в том числе
+    //   теги PubSub (см. pubsub_source.hpp),
+    // --alarms <файл> — правила тревог (см. AlarmEngine::loadRules), F4 — квитировать,
+    // --events <NodeId источника> [--event-fields Time,Severity,...] — журнал событий (F5),
+    // --record <файл> — записать все изменения значений в файл сессии (см. recorder.hpp),
+    // --replay <файл> [--speed N] — воспроизвести запись без сервера (N: 1 — как было, 0 — без пауз);
+    //   F6 — пауза, F7/F8 — на 10 с назад/вперёд, F9 — сменить скорость,
+    // --security <политика> [--mode sign|signencrypt] [--cert файл --key файл] [--trust файлы|any] —
+    //   защищённый канал (см. security.hpp), по умолчанию None,
+    // F10 — спектр выбранного тега (см. spectrum.hpp): --fft-size <отсчётов> (4096),
+    //   --fft-window <отсчётов> — окно по нескольким блокам осциллограммы вместо последнего блока,
+    //   --sample-rate <Гц> — частота дискретизации осциллограмм для шкалы частот,
+    // --history-segments <N> — сжатых сегментов истории на тег (по 1024 точки, 16),
+    // F11/F12 — масштаб графиков по времени: шире/уже, от последних изменений до 30 суток
+    std::string url = "opc.tcp://127.0.0.1:4840";
+    std::string json_target;
+    std::string attach_path;
+    std::string shm_name;
+    std::string latency_dump;
+    int metrics_port = 0;
+    std::string metrics_file;
+    std::string trace_file = "opcua_trace.json";
+    std::string tags_file;
+    std::string alarms_file;
+    std::string event_notifier;
+    std::string event_fields = "Time,Severity,SourceName,EventType,Message";
+    std::string record_file;
+    std::string replay_file;
+    double replay_speed = 1.0;
+    SecurityConfig security;
+    size_t fft_size = 4096;
+    size_t fft_window = 0;
+    double sample_rate = 0;
+    size_t history_segments = 16;
+    for (int i = 1; i + 1 < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--url") url = argv[++i];
+        else if (arg == "--json") json_target = argv[++i];
+        else if (arg == "--attach") attach_path = argv[++i];
+        else if (arg == "--shm") shm_name = argv[++i];
+        else if (arg == "--latency-dump") latency_dump = argv[++i];
+        else if (arg == "--metrics-port") metrics_port = std::stoi(argv[++i]);
+        else if (arg == "--metrics-file") metrics_file = argv[++i];
+        else if (arg == "--trace-file") trace_file = argv[++i];
+        else if (arg == "--tags") tags_file = argv[++i];
+        else if (arg == "--alarms") alarms_file = argv[++i];
+        else if (arg == "--events") event_notifier = argv[++i];
+        else if (arg == "--event-fields") event_fields = argv[++i];
+        else if (arg == "--record") record_file = argv[++i];
+        else if (arg == "--replay") replay_file = argv[++i];
+        else if (arg == "--speed") replay_speed = std::stod(argv[++i]);
+        else if (arg == "--security") security.policy = argv[++i];
+        else if (arg == "--mode") security.mode = argv[++i];
+        else if (arg == "--cert") security.certificate = argv[++i];
+        else if (arg == "--key") security.privateKey = argv[++i];
+        else if (arg == "--trust") parseTrustArgument(argv[++i], security);
+        else if (arg == "--fft-size") fft_size = (size_t)std::stoul(argv[++i]);
+        else if (arg == "--fft-window") fft_window = (size_t)std::stoul(argv[++i]);
+        else if (arg == "--sample-rate") sample_rate = std::stod(argv[++i]);
+        else if (arg == "--history-segments") history_segments = (size_t)std::stoul(argv[++i]);
+    }
+
+    if (json_target == "-") {
+        std::fprintf(stderr, "--json -: stdout is owned by the full-screen UI, use a file or unix:/path\n");
+        return 1;
+    }
+
     OPCUAClient client;
-    // Подключаемся к серверу (убедись, что адрес верный)
-    client.connectToServer("opc.tcp://127.0.0.1:4840");
+    if (!tags_file.empty() && !client.loadTagConfig(tags_file)) {
+        std::fprintf(stderr, "Cannot load tag config %s\n", tags_file.c_str());
+        return 1;
+    }
+    // Строки pubsub/reader/field того же файла — теги, которые приходят по UDP без опроса
+    PubSubSource pubsub(client);
+    std::string pubsub_error;
+    if (!tags_file.empty() && !pubsub.loadConfig(tags_file, &pubsub_error)) {
+        std::fprintf(stderr, "Bad PubSub config in %s: %s\n", tags_file.c_str(), pubsub_error.c_str());
+        return 1;
+    }
+    std::string security_error;
+    if (!client.configureSecurity(security, &security_error)) {
+        std::fprintf(stderr, "Bad security settings: %s\n", security_error.c_str());
+        return 1;
+    }
+    if (!json_target.empty()) {
+        client.addSink(std::make_shared<JsonStreamSink>(json_target));
+    }
+    if (!shm_name.empty()) client.publishToSharedMemory(shm_name);
+    auto alarms = std::make_shared<AlarmEngine>();
+    if (!alarms_file.empty() && !alarms->loadRules(alarms_file)) {
+        std::fprintf(stderr, "Cannot load alarm rules %s\n", alarms_file.c_str());
+        return 1;
+    }
+    client.addSink(alarms);
+    auto event_log = std::make_shared<EventLog>();
+    auto tag_stats = std::make_shared<StatsSink>();
+    client.addSink(tag_stats);
+    // История графиков пишется по изменениям, а не по кадрам отрисовки
+    auto history = std::make_shared<HistorySink>(100, 1024, history_segments);
+    client.addSink(history);
+    // Теги-массивы: последние блоки отсчётов для вида осциллограммы
+    auto waveforms = std::make_shared<WaveformSink>();
+    client.addSink(waveforms);
+    auto recorder = std::make_shared<SessionRecorder>();
+    if (!record_file.empty()) {
+        if (!recorder->open(record_file, client.getTags())) {
+            std::fprintf(stderr, "Cannot record to %s\n", record_file.c_str());
+            return 1;
+        }
+        client.addSink(recorder);
+    }
+    FanoutClient collector(client);
+    SessionPlayer player(client);
+    bool replaying = !replay_file.empty();
+    bool attached = !replaying && !attach_path.empty();
+    if (replaying) {
+        // Без сервера: записанные значения идут через то же хранилище и приёмники
+        if (!player.open(replay_file)) {
+            std::fprintf(stderr, "Cannot open recording %s\n", replay_file.c_str());
+            return 1;
+        }
+        player.setSpeed(replay_speed);
+        player.start();
+    } else if (attached) {
+        attached = collector.connect(attach_path);
+    } else {
+        if (!pubsub.empty() && !pubsub.start(&pubsub_error)) {
+            std::fprintf(stderr, "Cannot start PubSub receiver: %s\n", pubsub_error.c_str());
+            return 1;
+        }
+        // Подписка на события запоминается клиентом и создаётся при каждом подключении,
+        // поэтому запрашивается до первого connectToServer
+        if (!event_notifier.empty()) {
+            std::vector<std::string> fields;
+            size_t start = 0;
+            while (start <= event_fields.size()) {
+                size_t comma = event_fields.find(',', start);
+                if (comma == std::string::npos) comma = event_fields.size();
+                if (comma > start) fields.push_back(event_fields.substr(start, comma - start));
+                start = comma + 1;
+            }
+            if (!client.subscribeEvents(event_notifier, fields, event_log)) {
+                std::fprintf(stderr, "Bad event source %s or empty --event-fields\n", event_notifier.c_str());
+                return 1;
+            }
+        }
+        // Подключаемся к серверу (убедись, что адрес верный)
+        client.connectToServer(url);
+        // Опрос идёт по расписанию групп в своём потоке, отрисовка его не ждёт
+        client.startPolling();
+    }
+
+    MetricsHttpServer metrics_server;
+    if (metrics_port > 0) metrics_server.start((uint16_t)metrics_port);
+    auto& render_time = MetricsRegistry::instance().histogram(
+        "opcua_render_duration_seconds", "Time to build one TUI frame");
+    auto& history_bytes = MetricsRegistry::instance().gauge(
+        "opcua_history_bytes", "Memory held by chart histories");
+    auto& history_ratio = MetricsRegistry::instance().gauge(
+        "opcua_history_compression_ratio", "Raw (16 bytes per point) to packed size of chart history segments");
 
     auto screen = ScreenInteractive::Fullscreen();
-    
-    // Хранилище историй: Имя тега -> Список значений (double для точности)
-    std::map<std::string, std::vector<double>> histories;
-    
+
     std::string input_val = "";
-    std::string status = "Status: OK";
+    std::string status = (attach_path.empty() || attached) ? "Status: OK" : "Error: collector unavailable";
     int selected = 0;
+    bool show_diag = false;  // панель диагностики задержек (F2)
+    bool show_events = false;  // журнал событий (F5), листается PageUp/PageDown
+    size_t event_scroll = 0;
+    const size_t EVENT_ROWS = 12;
+    std::vector<EventRecord> event_window;
+
+    // Поиск тега: индекс строится при смене набора тегов, запрос — при изменении строки
+    const size_t MAX_MATCHES = 200;
+    TagIndex tag_index;
+    std::string search_query;
+    std::string indexed_query;
+    std::vector<uint32_t> matches;  // слоты тегов в порядке меню
+    std::vector<std::string> tag_names;  // имена по слотам на момент построения индекса
+    uint64_t indexed_generation = ~(uint64_t)0;  // поколение набора тегов в индексе
+    auto search_field = Input(&search_query, "search name / NodeId");
+
+    // Сетка графиков: рисуется только страница, помещающаяся на экран (PageUp/PageDown)
+    const int CHART_WIDTH = 40;
+    const int CHART_HEIGHT = 9;
+    const int CONTROLS_HEIGHT = 18;
+    size_t chart_page = 0;
+    // Осциллограммы на экране: блок копируется из приёмника, только когда пришёл новый
+    struct WaveView {
+        std::string name;
+        uint64_t sequence;
+        std::shared_ptr<std::vector<double>> samples;
+    };
+    std::unordered_map<size_t, WaveView> wave_views;
+    // Масштаб графиков: 0 — последние изменения из горячего окна, иначе окно времени
+    // до текущего момента (при воспроизведении — до позиции записи), сводка по столбцам
+    const int64_t ZOOM_MS[] = {0, 60000, 600000, 3600000, 6 * 3600000LL, 86400000LL, 7 * 86400000LL,
+                               30 * 86400000LL};
+    const char* const ZOOM_NAMES[] = {"last changes", "1 min", "10 min", "1 h", "6 h", "1 d", "7 d", "30 d"};
+    const size_t ZOOM_LEVELS = sizeof(ZOOM_MS) / sizeof(ZOOM_MS[0]);
+    const char* const TIER_NAMES[] = {"points", "1 s", "1 min", "1 h"};
+    size_t zoom = 0;
+    std::vector<RollupBucket> zoom_columns;
+
+    // Спектр выбранного тега (F10). Пересчитывается, только когда у тега новые данные:
+    // у осциллограммы — новый блок, у скалярного тега — новые изменения в истории.
+    // Окно скалярного тега — до 4 * --fft-size узлов сетки опроса
+    bool show_spectrum = false;
+    const int SPECTRUM_HEIGHT = 12;
+    SpectrumAnalyzer analyzer(fft_size, 0.5);
+    std::string spectrum_tag;
+    uint64_t spectrum_token = 0;
+    double spectrum_rate = 0;
+    std::vector<double> spectrum_input;
+    std::vector<int64_t> spectrum_times;
+    std::vector<double> spectrum_values;
+    auto spectrum = std::make_shared<std::vector<double>>();
+
+    // Список имен для меню выбора — только найденные теги
+    std::vector<std::string> names;
 
     // Компоненты ввода
     auto input_field = Input(&input_val, "0.0");
     
     auto btn = Button(" SEND ", [&] {
-        auto tags = client.getTags();
-        if (selected < tags.size()) {
+        if (replaying) {
+            status = "Error: replay is read-only";
+            return;
+        }
+        OPCUAClient::TagData tag("", "");
+        if (selected < (int)matches.size() && client.getTag(matches[selected], tag)) {
+            // Набор мог смениться после кадра: пишем только в тег, имя которого на экране
+            if (selected >= (int)names.size() || tag.name != names[selected]) {
+                status = "Error: tag list changed, select again";
+                return;
+            }
             try {
                 double v = std::stod(input_val);
-                if (client.writeValue(tags[selected].nodeId, v)) {
+                bool ok = attached ? collector.writeValue(tag.nodeId, v)
+                                   : client.writeValue(tag.nodeId, v);
+                if (ok) {
                     status = "Done: " + std::to_string(v);
                 } else {
                     status = "Fail: Server error";
@@ -45,31 +361,125 @@ int main() {
         }
     });
 
-    // Список имен для меню выбора
-    std::vector<std::string> names = {"Temperature", "Voltage"};
     auto menu = Menu(&names, &selected);
 
-    auto renderer = Renderer(Container::Vertical({menu, input_field, btn}), [&] {
-        client.updateValues();
-        auto tags = client.getTags();
-        Elements charts;
+    auto renderer = Renderer(Container::Vertical({search_field, menu, input_field, btn}), [&] {
+        TRACE_SCOPE("frame");
+        LatencyTimer frame_timer(&render_time);
+        if (attached) collector.poll();
+        // Каждый кадр работает только с видимыми тегами: полная копия набора —
+        // лишь при его смене, история и серии — только для графиков на экране
+        // Индекс строится заново при любой смене набора, в том числе на набор того же
+        // размера (перемотка записи, новый список от коллектора, перечитанный файл)
+        size_t tag_count = client.tagCount();
+        uint64_t generation = client.tagSetGeneration();
+        bool reindexed = generation != indexed_generation;
+        if (reindexed) {
+            indexed_generation = generation;
+            auto all = client.getTags();
+            tag_count = all.size();
+            tag_index.clear();
+            tag_names.clear();
+            for (size_t i = 0; i < all.size(); ++i) {
+                tag_index.add((uint32_t)i, all[i].name, all[i].nodeId);
+                tag_names.push_back(all[i].name);
+            }
+        }
+        if (reindexed || search_query != indexed_query) {
+            TRACE_SCOPE("tag_search");
+            matches = tag_index.search(search_query, MAX_MATCHES);
+            indexed_query = search_query;
+            names.clear();
+            for (uint32_t slot : matches) names.push_back(tag_names[slot]);
+            if (selected >= (int)names.size()) selected = 0;
+            chart_page = 0;
+        }
 
-        for (const auto& tag : tags) {
-            // 1. Обновляем историю конкретного тега
-            auto& history = histories[tag.name];
-            history.push_back(tag.value);
-            if (history.size() > 100) history.erase(history.begin());
+        // Сетка графиков: на странице столько, сколько помещается на экране.
+        // При непустом поиске на сетке найденные теги, иначе все по порядку слотов
+        auto dims = Terminal::Size();
+        int reserved = CONTROLS_HEIGHT + (show_events ? (int)EVENT_ROWS + 3 : 0) + (show_diag ? 8 : 0) +
+                       (show_spectrum ? SPECTRUM_HEIGHT : 0);
+        size_t grid_cols = (size_t)std::max(1, dims.dimx / CHART_WIDTH);
+        size_t grid_rows = (size_t)std::max(1, (dims.dimy - reserved) / CHART_HEIGHT);
+        size_t page_size = grid_cols * grid_rows;
+        bool filtered = !search_query.empty();
+        size_t listed = filtered ? matches.size() : tag_count;
+        size_t last_page = listed > 0 ? (listed - 1) / page_size : 0;
+        chart_page = std::min(chart_page, last_page);
+        size_t first = chart_page * page_size;
+        size_t end = std::min(listed, first + page_size);
 
-            // Сохраняем данные для использования внутри лямбды
-            std::string tagName = tag.name; 
-            double currentVal = tag.value;
+        Elements chart_rows;
+        Elements charts;
+        OPCUAClient::TagData tag("", "");
+        UA_DateTime zoom_end = replaying ? player.position() : UA_DateTime_now();
+        int64_t zoom_to = (zoom_end - UA_DATETIME_UNIX_EPOCH) / UA_DATETIME_MSEC;
+        size_t zoom_width = (size_t)std::max(1, dims.dimx / (int)grid_cols - 2);
+        int zoom_tier = -1;
+        for (size_t i = first; i < end; ++i) {
+            size_t slot = filtered ? matches[i] : i;
+            if (!client.getTag(slot, tag)) continue;
+            TRACE_SCOPE("build_chart");
+            // Заполненный ряд закрывается перед следующим графиком, последний — после цикла
+            if (charts.size() == grid_cols) {
+                chart_rows.push_back(hbox(std::move(charts)) | size(HEIGHT, EQUAL, CHART_HEIGHT));
+                charts.clear();
+            }
+            if (tag.samples > 0) {
+                WaveView& view = wave_views[slot];
+                if (view.name != tag.name || !view.samples) {
+                    view = {tag.name, 0, std::make_shared<std::vector<double>>()};
+                }
+                if (waveforms->latest(slot, tag.name, *view.samples, view.sequence)) {
+                    charts.push_back(vbox({
+                        hbox({text(tag.name + " rms " + std::to_string(tag.value).substr(0, 6)) | bold |
+                                  color(Color::Yellow),
+                              text("  [" + std::to_string(view.samples->size()) + " pts]") | dim}),
+                        text(" waveform") | dim,
+                        waveformGraph(view.samples) | flex | color(Color::CyanLight) | border
+                    }) | flex);
+                    continue;
+                }
+            }
+            // 1. Снимок истории тега (пополняется приёмником по изменениям)
+            auto series = std::make_shared<std::vector<double>>();
+            if (zoom == 0) {
+                history->copy(slot, tag.name, *series);
+            } else {
+                double before;
+                if (history->copyColumns(slot, tag.name, zoom_to - ZOOM_MS[zoom], zoom_to, zoom_width,
+                                         zoom_columns, &zoom_tier, &before)) {
+                    // По точке на столбец: среднее, а без изменений — последнее значение до него;
+                    // до первого изменения в окне держится значение из-за окна
+                    double held = std::isnan(before) ? tag.value : before;
+                    for (const auto& c : zoom_columns) {
+                        series->push_back(c.count ? c.mean() : held);
+                        if (c.count) held = c.last;
+                    }
+                }
+            }
+
+            std::string rate = tag.pollMs ? "  [" + std::to_string(tag.pollMs) + " ms]" : "";
+            // Статистика по последним изменениям считается в приёмнике, здесь только снимок
+            std::string stats_text;
+            TagStats::Summary st;
+            if (tag_stats->summary(slot, tag.name, st)) {
+                char buf[128];
+                std::snprintf(buf, sizeof(buf), "  avg %.4g sd %.3g  [%.4g..%.4g]  p50 %.4g p95 %.4g",
+                              st.mean, st.stddev, st.min, st.max, st.p50, st.p95);
+                stats_text = buf;
+            }
 
             // 2. Отрисовка графика с масштабированием
             charts.push_back(vbox({
-                text(tagName + ": " + std::to_string(currentVal).substr(0, 6)) | bold | color(Color::Yellow),
-                graph([&histories, tagName](int w, int h) {
+                hbox({text(tag.name + ": " + std::to_string(tag.value).substr(0, 6)) | bold | color(Color::Yellow),
+                      text(rate) | dim}),
+                text(stats_text) | dim,
+                graph([series](int w, int h) {
+                    TRACE_SCOPE("chart_series");
                     std::vector<int> r(w, 0);
-                    const auto& his = histories[tagName];
+                    const auto& his = *series;
                     if (his.empty() || h == 0) return r;
 
                     // Находим min/max для того, чтобы график занимал всё окно
@@ -83,7 +493,7 @@ int main() {
                         min_v -= 1.0;
                     }
 
-                    for (int i = 0; i < w && i < his.size(); ++i) {
+                    for (int i = 0; i < w && i < (int)his.size(); ++i) {
                         double val = his[his.size() - 1 - i];
                         // Пропорция: текущее значение относительно диапазона, умноженное на высоту h
                         r[w - 1 - i] = static_cast<int>((val - min_v) * h / (max_v - min_v));
@@ -92,40 +502,295 @@ int main() {
                 }) | flex | color(Color::GreenLight) | border
             }) | flex);
         }
+        if (!charts.empty()) {
+            while (charts.size() < grid_cols) charts.push_back(filler());
+            chart_rows.push_back(hbox(std::move(charts)) | size(HEIGHT, EQUAL, CHART_HEIGHT));
+        }
+
+        history_bytes.set((double)(history->memoryBytes() + waveforms->memoryBytes()));
+        size_t packed_bytes = history->packedBytes();
+        if (packed_bytes) history_ratio.set((double)(history->packedSamples() * 16) / (double)packed_bytes);
 
         // 3. Компоновка интерфейса
-        return vbox({
-            text(" OPC UA TUI MONITOR ") | bold | center | border | color(Color::Cyan),
-            hbox({
+        Elements layout;
+        layout.push_back(text(" OPC UA TUI MONITOR ") | bold | center | border | color(Color::Cyan));
+        if (replaying) {
+            UA_DateTimeStruct t = UA_DateTime_toStruct(player.position() + UA_DateTime_localTimeUtcOffset());
+            char line[128];
+            double sp = player.speed();
+            char rate[16];
+            if (sp > 0) std::snprintf(rate, sizeof(rate), "%gx", sp);
+            else std::snprintf(rate, sizeof(rate), "max");
+            std::snprintf(line, sizeof(line), " REPLAY %04u-%02u-%02u %02u:%02u:%02u.%03u  %s%s%s",
+                          (unsigned)t.year, (unsigned)t.month, (unsigned)t.day, (unsigned)t.hour,
+                          (unsigned)t.min, (unsigned)t.sec, (unsigned)t.milliSec,
+                          rate,
+                          player.paused() ? "  [paused]" : "", player.finished() ? "  [end]" : "");
+            layout.push_back(hbox({text(line) | bold, filler(),
+                                   text(" F6 pause  F7/F8 -/+10 s  F9 speed ") | dim}) | color(Color::Magenta));
+        } else if (!attached) {
+            // Состояние сессии: время ответа, ошибки, продления канала, торможение при перегрузке
+            auto h = client.connectionHealth();
+            char line[160];
+            int n = std::snprintf(line, sizeof(line),
+                                  " LINK %s  rtt %.1f ms (last %.1f)  fail %u/%llu  overload %llu  renew %llu",
+                                  ConnectionHealth::stateName(h.state), h.rttMs, h.lastRttMs,
+                                  h.consecutiveFailures, (unsigned long long)h.failures,
+                                  (unsigned long long)h.overloads, (unsigned long long)h.renewals);
+            if (h.lastPublish != 0 && n > 0 && n < (int)sizeof(line)) {
+                std::snprintf(line + n, sizeof(line) - n, "  publish %llds ago%s",
+                              (long long)((UA_DateTime_now() - h.lastPublish) / UA_DATETIME_SEC),
+                              h.publishStalled ? " [stalled]" : "");
+            }
+            std::string extra;
+            if (h.throttleMs > 0) extra += " throttle " + std::to_string(h.throttleMs) + " ms ";
+            if (h.maxOperations > 0) extra += " max " + std::to_string(h.maxOperations) + " nodes/read ";
+            if (h.consecutiveFailures > 0) extra += std::string(" ") + UA_StatusCode_name(h.lastError) + " ";
+            Color c = h.state == ConnectionHealth::HEALTHY ? Color::Green
+                      : h.state == ConnectionHealth::DOWN  ? Color::Red
+                                                           : Color::Yellow;
+            layout.push_back(hbox({text(line), filler(), text(extra) | bold}) | color(c));
+        }
+
+        // Баннер тревог: самая свежая тревога и сколько ещё активно
+        auto active_alarms = alarms->activeAlarms();
+        if (!active_alarms.empty()) {
+            const auto& a = active_alarms.front();
+            std::string line = " ALARM " + a.tag + " " + AlarmEngine::kindName(a.kind) + " " +
+                               std::to_string(a.value).substr(0, 8);
+            if (active_alarms.size() > 1) line += "  (+" + std::to_string(active_alarms.size() - 1) + " more)";
+            bool unacked = false;
+            for (const auto& x : active_alarms) unacked = unacked || !x.acknowledged;
+            layout.push_back(hbox({text(line) | bold, filler(), text(unacked ? " F4 ack " : " ack ")}) |
+                             inverted | color(unacked ? Color::Red : Color::Yellow));
+        }
+        layout.push_back(hbox({
                 vbox({ 
                     text(" SELECT TAG ") | bold, 
-                    menu->Render() | border 
+                    hbox(text(" / "), search_field->Render()),
+                    menu->Render() | vscroll_indicator | frame | border | flex
                 }) | size(WIDTH, EQUAL, 25),
                 vbox({text(" WRITE VALUE ") | bold, 
                     hbox(text(" New: "), input_field->Render()) | border, 
                     btn->Render() | center,
                     text(status) | center | color(status.find("Done") != std::string::npos ? Color::Green : Color::Red)
                 }) | flex
-            }) | size(HEIGHT, EQUAL, 10),
-            separator(),
-            hbox(std::move(charts)) | flex 
-        }) | border;
+            }) | size(HEIGHT, EQUAL, 10));
+
+        if (show_diag) {
+            Elements rows;
+            rows.push_back(text(" LATENCY (F2) ") | bold);
+            for (const auto& r : client.latencyReport()) {
+                if (r.count == 0) continue;
+                rows.push_back(hbox({
+                    text(r.server) | size(WIDTH, EQUAL, 30),
+                    text(r.operation) | size(WIDTH, EQUAL, 9),
+                    text("n=" + std::to_string(r.count)) | size(WIDTH, EQUAL, 10),
+                    text("p50 " + formatNanos(r.p50)) | size(WIDTH, EQUAL, 14),
+                    text("p99 " + formatNanos(r.p99)) | size(WIDTH, EQUAL, 14),
+                    text("p999 " + formatNanos(r.p999)) | size(WIDTH, EQUAL, 15),
+                    text("max " + formatNanos(r.max)) | color(Color::Red),
+                }));
+            }
+            layout.push_back(vbox(std::move(rows)) | border);
+        }
+
+        if (show_spectrum) {
+            OPCUAClient::TagData st("", "");
+            bool have = selected < (int)matches.size() && client.getTag(matches[selected], st);
+            if (have) {
+                size_t slot = matches[selected];
+                if (st.name != spectrum_tag) {
+                    spectrum_tag = st.name;
+                    spectrum_token = 0;
+                    spectrum->clear();
+                }
+                bool fresh = false;
+                if (st.samples > 0) {
+                    uint64_t seq = spectrum_token;
+                    bool ok = fft_window > 0
+                                  ? waveforms->recent(slot, st.name, fft_window, spectrum_input, seq)
+                                  : waveforms->latest(slot, st.name, spectrum_input, seq);
+                    fresh = ok && seq != spectrum_token;
+                    spectrum_token = seq;
+                    spectrum_rate = sample_rate;
+                } else if (st.changes != spectrum_token) {
+                    // История скалярного тега пишется по изменениям — перед БПФ она кладётся
+                    // на равномерную сетку с шагом опроса (без него — медиана интервалов)
+                    int64_t from = st.pollMs ? zoom_to - (int64_t)st.pollMs * (int64_t)(fft_size * 4) : 0;
+                    int64_t step = 0;
+                    if (history->copySeries(slot, st.name, from, spectrum_times, spectrum_values)) {
+                        step = resampleHold(spectrum_times, spectrum_values, st.pollMs, fft_size * 4, spectrum_input);
+                    }
+                    fresh = step > 0;
+                    spectrum_token = st.changes;
+                    spectrum_rate = step > 0 ? 1000.0 / (double)step : 0;
+                }
+                if (fresh) {
+                    TRACE_SCOPE("spectrum");
+                    if (!analyzer.compute(spectrum_input, *spectrum)) spectrum->clear();
+                }
+            }
+            std::string head = " SPECTRUM (F10) " + (have ? st.name : std::string("no tag selected"));
+            if (have && spectrum->size() > 1) {
+                size_t peak = std::max_element(spectrum->begin() + 1, spectrum->end()) - spectrum->begin();
+                char line[160];
+                if (spectrum_rate > 0) {
+                    std::snprintf(line, sizeof(line), "  %zu pts x%zu, %.4g Hz/bin, peak %.4g Hz  %.4g",
+                                  analyzer.size(), analyzer.segments(), spectrum_rate / (double)analyzer.size(),
+                                  (double)peak * spectrum_rate / (double)analyzer.size(), (*spectrum)[peak]);
+                } else {
+                    std::snprintf(line, sizeof(line), "  %zu pts x%zu, peak bin %zu  %.4g", analyzer.size(),
+                                  analyzer.segments(), peak, (*spectrum)[peak]);
+                }
+                head += line;
+            } else if (have) {
+                head += "  (not enough data)";
+            }
+            layout.push_back(vbox({text(head) | bold,
+                                   spectrumGraph(spectrum) | flex | color(Color::Magenta)}) |
+                             border | size(HEIGHT, EQUAL, SPECTRUM_HEIGHT));
+        }
+
+        if (show_events) {
+            // Копируется и рисуется только видимое окно, сколько бы событий ни было в журнале
+            size_t stored = event_log->size();
+            if (event_scroll + EVENT_ROWS > stored) event_scroll = stored > EVENT_ROWS ? stored - EVENT_ROWS : 0;
+            event_log->copyRecent(event_scroll, EVENT_ROWS, event_window);
+            Elements rows;
+            rows.push_back(text(" EVENTS (F5) " + std::to_string(event_scroll + 1) + "-" +
+                                std::to_string(event_scroll + event_window.size()) + " of " +
+                                std::to_string(stored) + ", total " + std::to_string(event_log->total())) | bold);
+            for (const auto& e : event_window) {
+                UA_DateTimeStruct t = UA_DateTime_toStruct(e.time + UA_DateTime_localTimeUtcOffset());
+                char when[16];
+                std::snprintf(when, sizeof(when), "%02u:%02u:%02u.%03u", (unsigned)t.hour,
+                              (unsigned)t.min, (unsigned)t.sec, (unsigned)t.milliSec);
+                Color c = e.severity >= 700 ? Color::Red : e.severity >= 400 ? Color::Yellow : Color::White;
+                rows.push_back(hbox({
+                    text(when) | size(WIDTH, EQUAL, 14),
+                    text(std::to_string(e.severity)) | size(WIDTH, EQUAL, 6) | color(c),
+                    text(e.source) | size(WIDTH, EQUAL, 20),
+                    text(e.type) | size(WIDTH, EQUAL, 16),
+                    text(e.message),
+                }));
+            }
+            layout.push_back(vbox(std::move(rows)) | border);
+        }
+
+        layout.push_back(separator());
+        layout.push_back(text(" charts " + std::to_string(listed ? first + 1 : 0) + "-" + std::to_string(end) +
+                              " of " + std::to_string(listed) + "  (PgUp/PgDn)  range " + ZOOM_NAMES[zoom] +
+                              (zoom ? std::string(" by ") + TIER_NAMES[zoom_tier + 1] : std::string()) +
+                              "  (F11/F12)") | dim);
+        layout.push_back(vbox(std::move(chart_rows)) | flex);
+        return traced(vbox(std::move(layout)) | border);
+    });
+
+    auto app = CatchEvent(renderer, [&](Event event) {
+        if (replaying && event == Event::F6) {
+            player.setPaused(!player.paused());
+            return true;
+        }
+        if (replaying && (event == Event::F7 || event == Event::F8)) {
+            player.seekBy((event == Event::F7 ? -10 : 10) * UA_DATETIME_SEC);
+            return true;
+        }
+        if (replaying && event == Event::F9) {
+            // 1x → 2x → 10x → 100x → без пауз → 1x
+            double sp = player.speed();
+            player.setSpeed(sp <= 0 ? 1 : sp < 2 ? 2 : sp < 10 ? 10 : sp < 100 ? 100 : 0);
+            return true;
+        }
+        if (event == Event::F5) {
+            show_events = !show_events;
+            event_scroll = 0;
+            return true;
+        }
+        if (show_events && event == Event::PageDown) {
+            event_scroll += EVENT_ROWS;
+            return true;
+        }
+        if (show_events && event == Event::PageUp) {
+            event_scroll = event_scroll > EVENT_ROWS ? event_scroll - EVENT_ROWS : 0;
+            return true;
+        }
+        // Без журнала событий PageUp/PageDown листают сетку графиков
+        if (event == Event::PageDown) {
+            ++chart_page;
+            return true;
+        }
+        if (event == Event::PageUp) {
+            if (chart_page > 0) --chart_page;
+            return true;
+        }
+        if (event == Event::F4) {
+            alarms->acknowledgeAll();
+            return true;
+        }
+        if (event == Event::F11) {
+            if (zoom + 1 < ZOOM_LEVELS) ++zoom;
+            return true;
+        }
+        if (event == Event::F12) {
+            if (zoom > 0) --zoom;
+            return true;
+        }
+        if (event == Event::F10) {
+            show_spectrum = !show_spectrum;
+            return true;
+        }
+        if (event == Event::F2) {
+            show_diag = !show_diag;
+            return true;
+        }
+        if (event == Event::F3) {
+            // Повторное нажатие выключает запись и сохраняет трассу
+            bool on = !Trace::enabled();
+            Trace::setEnabled(on);
+            if (!on) {
+                status = Trace::writeChromeJson(trace_file) ? "Trace: " + trace_file
+                                                            : "Error: cannot write trace";
+            } else {
+                status = "Trace: recording (F3 to stop)";
+            }
+            return true;
+        }
+        return false;
     });
 
     // Фоновый поток для авто-обновления экрана (2 раза в секунду)
     std::atomic<bool> run(true);
     std::thread ui_thread([&] {
+        int reconnect_wait = 0;
         while(run) { 
             std::this_thread::sleep_for(std::chrono::milliseconds(500)); 
+            // Тревоги устаревания должны срабатывать и когда значения не приходят
+            alarms->tick();
+            // Потерянную сессию восстанавливаем не чаще раза в 2 с;
+            // пока идёт подключение, экран не обновляется
+            if (!replaying && !attached && !client.isConnected() && ++reconnect_wait >= 4) {
+                reconnect_wait = 0;
+                client.connectToServer(url);
+            }
             screen.PostEvent(Event::Custom); 
+            if (!metrics_file.empty()) MetricsRegistry::instance().writeTextfile(metrics_file);
         }
     });
 
-    screen.Loop(renderer);
+    screen.Loop(app);
     
     // Чистое завершение
     run = false; 
     if(ui_thread.joinable()) ui_thread.join();
+    player.stop();
+    client.stopPolling();
+    recorder->close();
+    if (!latency_dump.empty()) client.dumpLatency(latency_dump);
+    if (Trace::enabled()) {
+        Trace::setEnabled(false);
+        Trace::writeChromeJson(trace_file);
+    }
     
     return 0;
 }
\ No newline at end of file
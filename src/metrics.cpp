@@ -0,0 +1,233 @@
+#include "../include/metrics.hpp"
+#include <cstdio>
+#include <cstring>
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+namespace {
+
+// Номер шарда закрепляется за потоком при первом обращении
+int shardForThread() {
+    static std::atomic<int> next(0);
+    thread_local int shard = next.fetch_add(1, std::memory_order_relaxed) % ShardedCounter::SHARDS;
+    return shard;
+}
+
+// Границы корзин гистограмм в секундах, общие для всех метрик задержек
+const double BUCKET_BOUNDS[] = {0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01,
+                                0.025, 0.05, 0.1, 0.25, 0.5, 1.0, 2.5, 5.0, 10.0};
+
+std::string formatDouble(double v) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%.15g", v);
+    return buf;
+}
+
+} // namespace
+
+ShardedCounter::ShardedCounter() {
+    for (auto& s : shards) s.v.store(0, std::memory_order_relaxed);
+}
+
+void ShardedCounter::inc(uint64_t n) {
+    shards[shardForThread()].v.fetch_add(n, std::memory_order_relaxed);
+}
+
+uint64_t ShardedCounter::value() const {
+    uint64_t sum = 0;
+    for (const auto& s : shards) sum += s.v.load(std::memory_order_relaxed);
+    return sum;
+}
+
+void Gauge::set(double v) {
+    uint64_t b;
+    std::memcpy(&b, &v, sizeof(b));
+    bits.store(b, std::memory_order_relaxed);
+}
+
+double Gauge::value() const {
+    uint64_t b = bits.load(std::memory_order_relaxed);
+    double v;
+    std::memcpy(&v, &b, sizeof(v));
+    return v;
+}
+
+MetricsRegistry& MetricsRegistry::instance() {
+    static MetricsRegistry registry;
+    return registry;
+}
+
+ShardedCounter& MetricsRegistry::counter(const std::string& name, const std::string& help) {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    Entry& e = entries[name];
+    if (!e.counter) {
+        e.help = help;
+        e.counter.reset(new ShardedCounter());
+    }
+    return *e.counter;
+}
+
+Gauge& MetricsRegistry::gauge(const std::string& name, const std::string& help) {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    Entry& e = entries[name];
+    if (!e.gauge) {
+        e.help = help;
+        e.gauge.reset(new Gauge());
+    }
+    return *e.gauge;
+}
+
+LatencyHistogram& MetricsRegistry::histogram(const std::string& name, const std::string& help) {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    Entry& e = entries[name];
+    if (!e.histogram) {
+        e.help = help;
+        e.histogram.reset(new LatencyHistogram());
+    }
+    return *e.histogram;
+}
+
+int MetricsRegistry::addCollector(std::function<void(std::string&)> collector) {
+    std::lock_guard<std::mutex> lock(collectors_mutex);
+    int id = next_collector_id++;
+    collectors[id] = std::move(collector);
+    return id;
+}
+
+void MetricsRegistry::removeCollector(int id) {
+    std::lock_guard<std::mutex> lock(collectors_mutex);
+    collectors.erase(id);
+}
+
+void MetricsRegistry::appendHistogram(std::string& out, const std::string& name,
+                                      const std::string& labels, const LatencyHistogram& h) {
+    std::string prefix = labels.empty() ? "" : labels + ",";
+    for (double bound : BUCKET_BOUNDS) {
+        out += name + "_bucket{" + prefix + "le=\"" + formatDouble(bound) + "\"} " +
+               std::to_string(h.countAtOrBelow((uint64_t)(bound * 1e9))) + "\n";
+    }
+    out += name + "_bucket{" + prefix + "le=\"+Inf\"} " + std::to_string(h.count()) + "\n";
+    std::string braces = labels.empty() ? "" : "{" + labels + "}";
+    out += name + "_sum" + braces + " " + formatDouble(h.sum() / 1e9) + "\n";
+    out += name + "_count" + braces + " " + std::to_string(h.count()) + "\n";
+}
+
+std::string MetricsRegistry::exposition() {
+    std::string out;
+    {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        for (const auto& item : entries) {
+            const std::string& name = item.first;
+            const Entry& e = item.second;
+            out += "# HELP " + name + " " + e.help + "\n";
+            if (e.counter) {
+                out += "# TYPE " + name + " counter\n";
+                out += name + " " + std::to_string(e.counter->value()) + "\n";
+            } else if (e.gauge) {
+                out += "# TYPE " + name + " gauge\n";
+                out += name + " " + formatDouble(e.gauge->value()) + "\n";
+            } else if (e.histogram) {
+                out += "# TYPE " + name + " histogram\n";
+                appendHistogram(out, name, "", *e.histogram);
+            }
+        }
+    }
+    std::lock_guard<std::mutex> lock(collectors_mutex);
+    for (const auto& c : collectors) c.second(out);
+    return out;
+}
+
+bool MetricsRegistry::writeTextfile(const std::string& path) {
+    std::string body = exposition();
+    std::string tmp = path + ".tmp";
+    std::FILE* f = std::fopen(tmp.c_str(), "w");
+    if (!f) return false;
+    bool ok = std::fwrite(body.data(), 1, body.size(), f) == body.size();
+    ok = (std::fclose(f) == 0) && ok;
+    return ok && std::rename(tmp.c_str(), path.c_str()) == 0;
+}
+
+// ---------------- MetricsHttpServer ----------------
+
+MetricsHttpServer::MetricsHttpServer() : listen_fd(-1), running(false) {}
+
+MetricsHttpServer::~MetricsHttpServer() {
+    stop();
+}
+
+bool MetricsHttpServer::start(uint16_t port) {
+#ifndef _WIN32
+    listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd < 0) return false;
+    int one = 1;
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);  // только localhost
+    if (bind(listen_fd, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(listen_fd, 8) != 0) {
+        close(listen_fd);
+        listen_fd = -1;
+        return false;
+    }
+    running = true;
+    worker = std::thread([this] { serve(); });
+    return true;
+#else
+    (void)port;
+    return false;
+#endif
+}
+
+void MetricsHttpServer::stop() {
+    running = false;
+    if (worker.joinable()) worker.join();
+#ifndef _WIN32
+    if (listen_fd >= 0) close(listen_fd);
+#endif
+    listen_fd = -1;
+}
+
+void MetricsHttpServer::serve() {
+#ifndef _WIN32
+    while (running) {
+        // Короткий таймаут, чтобы stop() не ждал следующего запроса
+        pollfd pfd{listen_fd, POLLIN, 0};
+        if (::poll(&pfd, 1, 200) <= 0) continue;
+        int fd = accept(listen_fd, nullptr, nullptr);
+        if (fd < 0) continue;
+
+        char req[1024];
+        ssize_t n = recv(fd, req, sizeof(req) - 1, 0);
+        std::string response;
+        if (n > 0) {
+            req[n] = '\0';
+            if (std::strncmp(req, "GET /metrics", 12) == 0) {
+                std::string body = MetricsRegistry::instance().exposition();
+                response = "HTTP/1.1 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n"
+                           "Content-Length: " + std::to_string(body.size()) +
+                           "\r\nConnection: close\r\n\r\n" + body;
+            } else {
+                response = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+            }
+            size_t sent = 0;
+            while (sent < response.size()) {
+                ssize_t k = send(fd, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+                if (k <= 0) break;
+                sent += (size_t)k;
+            }
+        }
+        close(fd);
+    }
+#endif
+}
\ No newline at end of file
@@ -1,65 +1,908 @@
 #include "../include/opcua_client.hpp"
+#include "../include/shm_table.hpp"
+#include "../include/metrics.hpp"
+#include "../include/trace.hpp"
+#include "../include/ua_allocator.hpp"
+#include "../include/waveform.hpp"
+#include <open62541/client_subscriptions.h>
+#include <algorithm>
 #include <chrono>
+#include <cmath>
 #include <ctime>
 #include <cstdio>
+#include <fstream>
+#include <limits>
+#include <sstream>
 
-OPCUAClient::OPCUAClient() : connected(false) {
+namespace {
+
+// Шаг колеса опроса
+const int TICK_MS = 10;
+const uint32_t MIN_PERIOD_MS = 10;
+const uint32_t MAX_PERIOD_MS = 3600 * 1000;
+
+bool parseNodeId(const std::string& text, UA_NodeId& out) {
+    int ns, id;
+    if (sscanf(text.c_str(), "ns=%d;i=%d", &ns, &id) != 2) return false;
+    out = UA_NODEID_NUMERIC((UA_UInt16)ns, (UA_UInt32)id);
+    return true;
+}
+
+// Счётчики процесса; шардированы по потокам, суммируются только при выгрузке
+struct ClientMetrics {
+    ShardedCounter& reads;
+    ShardedCounter& readFailures;
+    ShardedCounter& changes;
+    ShardedCounter& writes;
+    ShardedCounter& writeFailures;
+    ShardedCounter& reconnects;
+    ShardedCounter& connectFailures;
+    ShardedCounter& overloads;
+    ShardedCounter& disconnects;
+    ShardedCounter& renewals;
+    ShardedCounter& eventSubscribeFailures;
+    Gauge& rtt;
+};
+
+ClientMetrics& metrics() {
+    auto& r = MetricsRegistry::instance();
+    static ClientMetrics m{
+        r.counter("opcua_reads_total", "Values read from OPC UA servers"),
+        r.counter("opcua_read_failures_total", "Read requests that failed as a whole"),
+        r.counter("opcua_notifications_total", "Value changes delivered to sinks"),
+        r.counter("opcua_writes_total", "Write requests"),
+        r.counter("opcua_write_failures_total", "Write requests rejected or failed"),
+        r.counter("opcua_reconnects_total", "Successful connects after a previous session"),
+        r.counter("opcua_connect_failures_total", "Failed connection attempts"),
+        r.counter("opcua_overloads_total", "Requests rejected because the server is overloaded"),
+        r.counter("opcua_disconnects_total", "Sessions lost after a request or channel failure"),
+        r.counter("opcua_channel_renewals_total", "Secure channel renewals started by the client"),
+        r.counter("opcua_event_subscribe_failures_total", "Event subscriptions or monitored items the server refused"),
+        r.gauge("opcua_request_rtt_seconds", "Smoothed round-trip time of successful requests"),
+    };
+    return m;
+}
+
+std::string escapeLabel(const std::string& s) {
+    std::string r;
+    for (char c : s) {
+        if (c == '"' || c == '\\') r += '\\';
+        r += c;
+    }
+    return r;
+}
+
+int64_t steadyNanos() {
+    return (int64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool variantToDouble(const UA_Variant& v, double& out) {
+    if (!UA_Variant_isScalar(&v)) return false;
+    if (v.type == &UA_TYPES[UA_TYPES_DOUBLE]) out = *(UA_Double*)v.data;
+    else if (v.type == &UA_TYPES[UA_TYPES_FLOAT]) out = (double)*(UA_Float*)v.data;
+    else return false;
+    return true;
+}
+
+} // namespace
+
+OPCUAClient::OPCUAClient()
+    : connected(false), tags_generation(0), tag_set_generation(0), poll_epoch(std::chrono::steady_clock::now()),
+      polling(false), subscription_id(0), stale_subscription_id(0), current_latency(nullptr), had_session(false),
+      next_renewal_ns(0) {
+    if (UaAllocator::available()) UaAllocator::installHooks();
     client = UA_Client_new();
-    UA_ClientConfig_setDefault(UA_Client_getConfig(client));
-    tags.emplace_back("Temperature", "ns=2;i=1");
-    tags.emplace_back("Voltage", "ns=2;i=2");
+    UA_ClientConfig* config = UA_Client_getConfig(client);
+    UA_ClientConfig_setDefault(config);
+    installCallbacks(config);
+    groups.push_back({"default", 500, 500, 500});
+    addTag("Temperature", "ns=2;i=1");
+    addTag("Voltage", "ns=2;i=2");
+
+    metrics_collector_id = MetricsRegistry::instance().addCollector([this](std::string& out) {
+        out += "# HELP opcua_operation_duration_seconds Duration of client operations per server\n";
+        out += "# TYPE opcua_operation_duration_seconds histogram\n";
+        std::lock_guard<std::mutex> lock(latency_mutex);
+        for (const auto& entry : latency_by_server) {
+            std::string server = "server=\"" + escapeLabel(entry.first) + "\"";
+            MetricsRegistry::appendHistogram(out, "opcua_operation_duration_seconds",
+                                             server + ",op=\"connect\"", entry.second->connect);
+            MetricsRegistry::appendHistogram(out, "opcua_operation_duration_seconds",
+                                             server + ",op=\"read\"", entry.second->read);
+            MetricsRegistry::appendHistogram(out, "opcua_operation_duration_seconds",
+                                             server + ",op=\"write\"", entry.second->write);
+        }
+    });
+    // Эффективная частота опроса по тегам: rate(opcua_tag_reads_total) в Prometheus
+    tags_collector_id = MetricsRegistry::instance().addCollector([this](std::string& out) {
+        std::string reads, changes, intervals;
+        char buf[64];
+        {
+            std::lock_guard<std::mutex> lock(tags_mutex);
+            for (const auto& tag : tags) {
+                std::string label = "{tag=\"" + escapeLabel(tag.name) + "\"} ";
+                std::snprintf(buf, sizeof(buf), "%llu\n", (unsigned long long)tag.reads);
+                reads += "opcua_tag_reads_total" + label + buf;
+                std::snprintf(buf, sizeof(buf), "%llu\n", (unsigned long long)tag.changes);
+                changes += "opcua_tag_changes_total" + label + buf;
+                std::snprintf(buf, sizeof(buf), "%.15g\n", tag.pollMs / 1000.0);
+                intervals += "opcua_tag_poll_interval_seconds" + label + buf;
+            }
+        }
+        out += "# HELP opcua_tag_reads_total Values read per tag\n";
+        out += "# TYPE opcua_tag_reads_total counter\n" + reads;
+        out += "# HELP opcua_tag_changes_total Value changes observed per tag\n";
+        out += "# TYPE opcua_tag_changes_total counter\n" + changes;
+        out += "# HELP opcua_tag_poll_interval_seconds Current polling interval per tag\n";
+        out += "# TYPE opcua_tag_poll_interval_seconds gauge\n" + intervals;
+    });
 }
 
 OPCUAClient::~OPCUAClient() {
+    stopPolling();
+    MetricsRegistry::instance().removeCollector(metrics_collector_id);
+    MetricsRegistry::instance().removeCollector(tags_collector_id);
     if (connected) UA_Client_disconnect(client);
     UA_Client_delete(client);
 }
 
+void OPCUAClient::installCallbacks(UA_ClientConfig* config) {
+    // Обрыв канала и молчание подписки видны сразу, а не только по следующему запросу
+    config->clientContext = this;
+    config->stateCallback = stateCallback;
+    config->subscriptionInactivityCallback = inactivityCallback;
+}
+bool OPCUAClient::configureSecurity(const SecurityConfig& security, std::string* error) {
+    std::lock_guard<std::mutex> lock(client_mutex);
+    if (connected) {
+        if (error) *error = "security is configured before connecting";
+        return false;
+    }
+    UA_ClientConfig* config = UA_Client_getConfig(client);
+    if (!applySecurity(config, security, error)) return false;
+    // Настройка шифрования заново заполняет конфигурацию по умолчанию
+    installCallbacks(config);
+    return true;
+}
 bool OPCUAClient::connectToServer(const std::string& url) {
+    // Чтение и запись берут current_latency под client_mutex, поэтому и меняется он под ним
+    std::lock_guard<std::mutex> lock(client_mutex);
+    {
+        std::lock_guard<std::mutex> stats_lock(latency_mutex);
+        auto& stats = latency_by_server[url];
+        if (!stats) stats.reset(new LatencyStats());
+        current_latency = stats.get();
+    }
+    LatencyTimer timer(&current_latency->connect);
     UA_StatusCode retval = UA_Client_connect(client, url.c_str());
     connected = (retval == UA_STATUSCODE_GOOD);
+    if (!connected) {
+        metrics().connectFailures.inc();
+        health.onRequest(retval, 0, 0, steadyNanos());
+    } else {
+        if (had_session) metrics().reconnects.inc();
+        health.onConnected();
+        next_renewal_ns = 0;
+        resubscribeEventsLocked();
+    }
+    had_session = had_session || connected;
     return connected;
 }
 
-void OPCUAClient::updateValues() {
+void OPCUAClient::disconnectFromServer() {
+    std::lock_guard<std::mutex> lock(client_mutex);
     if (!connected) return;
+    connected = false;
+    health.onDisconnected(false);
+    // Сессия закрывается, подписка уходит вместе с ней; новая — при следующем подключении
+    subscription_id = 0;
+    stale_subscription_id = 0;
+    UA_Client_disconnect(client);
+}
+
+void OPCUAClient::dropSessionLocked() {
+    // Флаг сбрасывается до отключения, чтобы stateCallback не учёл обрыв второй раз.
+    // Закрывается только канал: сессия остаётся на сервере, и следующий connectToServer
+    // активирует её на новом канале (ActivateSession) без CreateSession и повторной
+    // проверки сертификатов сессии. Если сервер её уже забыл, библиотека создаст новую
+    connected = false;
+    health.onDisconnected();
+    metrics().disconnects.inc();
+    // Подписка пересоздаётся после подключения; старая удаляется, если сессия её сохранила
+    if (subscription_id != 0) stale_subscription_id = subscription_id.exchange(0);
+    UA_Client_disconnectSecureChannel(client);
+}
+
+void OPCUAClient::renewChannelLocked() {
+    // Канал продлевается между циклами опроса, а не посреди чтения. Библиотека отвечает
+    // GoodCallAgain, пока не прошли 3/4 срока; после запуска продления следующая проверка —
+    // через полсрока, чтобы не слать повторный OPN до прихода ответа на первый
+    int64_t now = steadyNanos();
+    if (now < next_renewal_ns) return;
+    UA_StatusCode rc = UA_Client_renewSecureChannel(client);
+    if (rc == UA_STATUSCODE_GOOD) {
+        health.onRenewal();
+        metrics().renewals.inc();
+        next_renewal_ns = now + (int64_t)UA_Client_getConfig(client)->secureChannelLifeTime * 500000;
+    } else {
+        next_renewal_ns = now + 1000000000;
+    }
+}
+
+void OPCUAClient::stateCallback(UA_Client* client, UA_SecureChannelState channelState,
+                                UA_SessionState, UA_StatusCode connectStatus) {
+    // Вызывается изнутри вызовов библиотеки, то есть уже под client_mutex
+    auto* self = static_cast<OPCUAClient*>(UA_Client_getContext(client));
+    if (!self || !self->connected) return;
+    if (channelState == UA_SECURECHANNELSTATE_CLOSED || connectStatus != UA_STATUSCODE_GOOD) {
+        self->connected = false;
+        self->health.onDisconnected();
+        metrics().disconnects.inc();
+    }
+}
+
+void OPCUAClient::inactivityCallback(UA_Client* client, UA_UInt32, void*) {
+    auto* self = static_cast<OPCUAClient*>(UA_Client_getContext(client));
+    if (self) self->health.onPublishStalled();
+}
+
+void OPCUAClient::appendReadId(const std::string& nodeId) {
+    // Числовые NodeId не владеют памятью, поэтому вектор можно держать без UA_clear
+    UA_ReadValueId rvid;
+    UA_ReadValueId_init(&rvid);
+    rvid.attributeId = UA_ATTRIBUTEID_VALUE;
+    parseNodeId(nodeId, rvid.nodeId);
+    read_ids.push_back(rvid);
+}
+
+void OPCUAClient::updateValues() {
+    std::vector<uint32_t> all;
+    {
+        std::lock_guard<std::mutex> lock(tags_mutex);
+        all.resize(tags.size());
+        for (size_t i = 0; i < all.size(); ++i) all[i] = (uint32_t)i;
+    }
+    readSlots(all, false);
+}
+
+uint64_t OPCUAClient::nowTick() const {
+    return (uint64_t)(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - poll_epoch).count() / TICK_MS);
+}
+
+void OPCUAClient::applyGroupLocked(size_t slot) {
+    const TagGroup& g = groups[tags[slot].group];
+    Schedule& s = schedules[slot];
+    s.minTicks = std::max<uint32_t>(1, g.minPeriodMs / TICK_MS);
+    s.maxTicks = std::max<uint32_t>(1, g.maxPeriodMs / TICK_MS);
+    // Фиксированная группа — сразу её период; адаптивная сохраняет выученный интервал
+    if (s.minTicks == s.maxTicks || s.periodTicks == 0) s.periodTicks = std::max<uint32_t>(1, g.periodMs / TICK_MS);
+    s.periodTicks = std::min(std::max(s.periodTicks, s.minTicks), s.maxTicks);
+    tags[slot].pollMs = s.periodTicks * TICK_MS;
+}
+
+void OPCUAClient::adaptLocked(size_t slot, bool changed) {
+    Schedule& s = schedules[slot];
+    if (s.minTicks == s.maxTicks) return;
+    // Изменение — интервал вдвое короче, тишина — на четверть длиннее.
+    // Равновесие — когда изменение видно примерно в каждом четвёртом чтении:
+    // изменчивые теги быстро догоняют, стабильные постепенно уходят к maxPeriodMs
+    uint32_t next = changed ? s.periodTicks / 2 : s.periodTicks + (s.periodTicks + 3) / 4;
+    s.periodTicks = std::min(std::max(next, s.minTicks), s.maxTicks);
+    tags[slot].pollMs = s.periodTicks * TICK_MS;
+}
+
+void OPCUAClient::poll() {
+    if (connected) {
+        std::lock_guard<std::mutex> lock(client_mutex);
+        // Ответы Publish с событиями; чтения тегов идут своим запросом ниже
+        if (subscription_id != 0 &&
+            ConnectionHealth::classify(UA_Client_run_iterate(client, 0)) == ConnectionHealth::DISCONNECT) {
+            dropSessionLocked();
+        }
+        if (connected) renewChannelLocked();
+    }
+    // После отказа перегруженного сервера опрос выжидает паузу;
+    // наступившие теги остаются в колесе и читаются одним запросом после неё
+    if (connected && !health.mayRequest(steadyNanos())) return;
+
+    std::vector<uint32_t> due;
+    uint64_t generation;
+    {
+        std::lock_guard<std::mutex> lock(tags_mutex);
+        generation = tags_generation;
+        wheel.advance(nowTick(), due);
+    }
+    if (due.empty()) return;
+    readSlots(due, true);
+
+    // Следующий срок считается после чтения, чтобы учесть новый интервал
     std::lock_guard<std::mutex> lock(tags_mutex);
+    if (generation != tags_generation) return;
+    uint64_t now = nowTick();
+    for (uint32_t slot : due) {
+        // Пропущенные из-за задержки периоды не навёрстываются пачкой:
+        // следующий срок — ближайший по сетке тега после текущего тика
+        Schedule& s = schedules[slot];
+        uint64_t next = s.due + s.periodTicks;
+        if (next <= now) next += (now - next) / s.periodTicks * s.periodTicks + s.periodTicks;
+        s.due = next;
+        wheel.schedule(slot, next);
+    }
+}
+
+void OPCUAClient::startPolling() {
+    if (polling.exchange(true)) return;
+    poll_thread = std::thread([this] {
+        // Кэш блоков только у потока опроса: чтения из других потоков идут в системную кучу,
+        // а кэш уходит вместе с потоком
+        if (UaAllocator::available()) UaAllocator::installForThisThread();
+        auto next = std::chrono::steady_clock::now();
+        while (polling.load()) {
+            poll();
+            next += std::chrono::milliseconds(TICK_MS);
+            auto now = std::chrono::steady_clock::now();
+            if (next < now) next = now;
+            std::this_thread::sleep_until(next);
+        }
+    });
+}
 
-    for (auto& tag : tags) {
-        UA_Variant val;
-        UA_Variant_init(&val);
-        int ns, id;
-        if(sscanf(tag.nodeId.c_str(), "ns=%d;i=%d", &ns, &id) == 2) {
-            UA_NodeId nid = UA_NODEID_NUMERIC((UA_UInt16)ns, (UA_UInt32)id);
-            if (UA_Client_readValueAttribute(client, nid, &val) == UA_STATUSCODE_GOOD) {
-                if (val.type == &UA_TYPES[UA_TYPES_DOUBLE]) tag.value = *(UA_Double*)val.data;
-                else if (val.type == &UA_TYPES[UA_TYPES_FLOAT]) tag.value = (double)*(UA_Float*)val.data;
-                
-                auto now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
-                char buf[12];
-                std::strftime(buf, sizeof(buf), "%H:%M:%S", std::localtime(&now));
-                tag.timestamp = buf;
-                tag.quality = "GOOD";
+void OPCUAClient::stopPolling() {
+    polling = false;
+    if (poll_thread.joinable()) poll_thread.join();
+}
+
+void OPCUAClient::readSlots(const std::vector<uint32_t>& slots, bool adapt) {
+    if (!connected || slots.empty()) return;
+    TRACE_SCOPE("readSlots");
+    std::lock_guard<std::mutex> client_lock(client_mutex);
+
+    // В потоке опроса декодирование ответа берёт память из его кэша блоков
+    {
+        UaAllocator::CycleScope arena_cycle;
+        uint64_t generation;
+        {
+            std::lock_guard<std::mutex> lock(tags_mutex);
+            generation = tags_generation;
+            read_batch.clear();
+            read_batch_slots.clear();
+            for (uint32_t slot : slots) {
+                // Вычисляемые и внешние теги не читаются: у них нет NodeId
+                if (slot >= read_ids.size() || UA_NodeId_isNull(&read_ids[slot].nodeId)) continue;
+                read_batch.push_back(read_ids[slot]);
+                read_batch_slots.push_back(slot);
             }
         }
-        UA_Variant_clear(&val);
+        if (read_batch.empty()) return;
+
+        // Все наступившие теги читаются одним запросом, пока сервер не пожаловался
+        // на его размер; тогда — несколькими запросами не больше допустимого
+        size_t limit = health.maxOperations();
+        if (limit == 0) limit = read_batch.size();
+        for (size_t offset = 0; offset < read_batch.size(); offset += limit) {
+            if (!readChunkLocked(offset, std::min(limit, read_batch.size() - offset), generation, adapt)) break;
+        }
     }
+
+    flushSinks();
+}
+
+bool OPCUAClient::readChunkLocked(size_t offset, size_t count, uint64_t generation, bool adapt) {
+    UA_ReadRequest request;
+    UA_ReadRequest_init(&request);
+    request.nodesToRead = read_batch.data() + offset;
+    request.nodesToReadSize = count;
+    request.timestampsToReturn = UA_TIMESTAMPSTORETURN_BOTH;
+
+    UA_ReadResponse response;
+    int64_t started = steadyNanos();
+    {
+        TRACE_SCOPE("Service_read");
+        response = UA_Client_Service_read(client, request);
+    }
+    int64_t finished = steadyNanos();
+    if (current_latency) current_latency->read.record((uint64_t)(finished - started));
+
+    UA_StatusCode result = response.responseHeader.serviceResult;
+    if (result == UA_STATUSCODE_GOOD && response.resultsSize != count) result = UA_STATUSCODE_BADUNEXPECTEDERROR;
+    ConnectionHealth::Outcome outcome = health.onRequest(result, (uint64_t)(finished - started), count, finished);
+    if (outcome == ConnectionHealth::OK) {
+        metrics().rtt.set(health.snapshot().rttMs / 1000.0);
+        auto now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+        char buf[12];
+        std::strftime(buf, sizeof(buf), "%H:%M:%S", std::localtime(&now));
+
+        std::lock_guard<std::mutex> lock(tags_mutex);
+        if (generation == tags_generation) {
+            metrics().reads.inc(count);
+            std::lock_guard<std::mutex> sinks_lock(sinks_mutex);
+            for (size_t i = 0; i < count; ++i) {
+                uint32_t slot = read_batch_slots[offset + i];
+                TagData& tag = tags[slot];
+                // Первое значение тега — не изменение, а начальное состояние;
+                // новая метка времени при том же значении интервал не сокращает
+                bool known = tag.quality == "GOOD";
+                double before = tag.value;
+                UA_StatusCode status_before = tag.status;
+                applyValueLocked(slot, response.results[i], buf);
+                tag.reads++;
+                if (adapt && known) {
+                    adaptLocked(slot, tag.value != before || tag.status != status_before);
+                }
+            }
+            evaluateComputedLocked(buf);
+        }
+    } else {
+        metrics().readFailures.inc();
+        if (outcome == ConnectionHealth::OVERLOAD) metrics().overloads.inc();
+        if (outcome == ConnectionHealth::DISCONNECT) dropSessionLocked();
+    }
+    // Массив запроса принадлежит нам, поэтому очищается только ответ
+    UA_ReadResponse_clear(&response);
+    return outcome == ConnectionHealth::OK;
+}
+
+bool OPCUAClient::applyValueLocked(size_t slot, const UA_DataValue& dv, const char* timeText) {
+    TagData& tag = tags[slot];
+    UA_StatusCode status = dv.hasStatus ? dv.status : UA_STATUSCODE_GOOD;
+    if (status != UA_STATUSCODE_GOOD || !dv.hasValue) {
+        // Переход в плохое качество — тоже изменение: приёмники получают статус,
+        // значение тега остаётся последним хорошим. Зависимым вычисляемым тегам — NaN
+        bool changed = tag.quality != "BAD" || status != tag.status;
+        if (!changed) return false;
+        computed.inputChanged((uint32_t)slot, std::numeric_limits<double>::quiet_NaN());
+        tag.status = status;
+        if (dv.hasSourceTimestamp) tag.sourceTime = dv.sourceTimestamp;
+        if (dv.hasServerTimestamp) tag.serverTime = dv.serverTimestamp;
+        tag.timestamp = timeText;
+        tag.quality = "BAD";
+        metrics().changes.inc();
+        tag.changes++;
+        for (auto& sink : sinks) sink->onValueChanged(slot, tag, dv);
+        return true;
+    }
+
+    double value = tag.value;
+    // Массив отсчётов — осциллограмма: скалярное значение тега — её СКЗ
+    size_t samples = waveformLength(dv.value);
+    if (samples > 0) waveformRms(dv.value, value);
+    else variantToDouble(dv.value, value);
+    if (value != tag.value || tag.quality != "GOOD") computed.inputChanged((uint32_t)slot, value);
+    UA_DateTime srcTime = dv.hasSourceTimestamp ? dv.sourceTimestamp : 0;
+    // Осциллограмма без метки источника считается новой при каждом чтении:
+    // по одному СКЗ повтор массива не отличить от нового
+    bool changed = tag.quality != "GOOD" || value != tag.value ||
+                   srcTime != tag.sourceTime || status != tag.status || (samples > 0 && srcTime == 0);
+
+    tag.value = value;
+    tag.status = status;
+    tag.sourceTime = srcTime;
+    tag.serverTime = dv.hasServerTimestamp ? dv.serverTimestamp : 0;
+    tag.timestamp = timeText;
+    tag.quality = "GOOD";
+    tag.samples = (uint32_t)samples;
+
+    if (changed) {
+        metrics().changes.inc();
+        tag.changes++;
+        for (auto& sink : sinks) sink->onValueChanged(slot, tag, dv);
+    }
+    return changed;
+}
+
+bool OPCUAClient::subscribeEvents(const std::string& notifier, const std::vector<std::string>& fields,
+                                  std::shared_ptr<EventLog> log) {
+    UA_NodeId notifier_id;
+    if (fields.empty() || !parseNodeId(notifier, notifier_id)) return false;
+    std::lock_guard<std::mutex> lock(client_mutex);
+    // Контекст живёт до конца работы клиента и переиспользуется при каждой переподписке
+    event_subscriptions.push_back(
+        std::unique_ptr<EventSubscription>(new EventSubscription{notifier_id, fields, std::move(log)}));
+    if (!connected) return true;
+    if (subscription_id == 0) {
+        resubscribeEventsLocked();
+        return true;
+    }
+    monitorEventsLocked(*event_subscriptions.back());
+    return true;
+}
+
+void OPCUAClient::resubscribeEventsLocked() {
+    if (event_subscriptions.empty()) return;
+    // Подписка прежнего канала могла уцелеть вместе с сессией — её элементы дублировали бы события
+    UA_UInt32 stale = stale_subscription_id;
+    stale_subscription_id = 0;
+    if (stale != 0) UA_Client_Subscriptions_deleteSingle(client, stale);
+
+    UA_CreateSubscriptionRequest request = UA_CreateSubscriptionRequest_default();
+    request.requestedPublishingInterval = 100.0;
+    request.maxNotificationsPerPublish = 0;  // всплеск при аварии уходит целиком
+    UA_CreateSubscriptionResponse response =
+        UA_Client_Subscriptions_create(client, request, nullptr, nullptr, nullptr);
+    if (response.responseHeader.serviceResult == UA_STATUSCODE_GOOD) subscription_id = response.subscriptionId;
+    UA_CreateSubscriptionResponse_clear(&response);
+    if (subscription_id == 0) {
+        metrics().eventSubscribeFailures.inc();
+        return;
+    }
+    for (auto& sub : event_subscriptions) monitorEventsLocked(*sub);
+}
+
+bool OPCUAClient::monitorEventsLocked(EventSubscription& sub) {
+    const std::vector<std::string>& fields = sub.fields;
+    UA_EventFilter filter;
+    UA_EventFilter_init(&filter);
+    filter.selectClauses = (UA_SimpleAttributeOperand*)
+        UA_Array_new(fields.size(), &UA_TYPES[UA_TYPES_SIMPLEATTRIBUTEOPERAND]);
+    filter.selectClausesSize = fields.size();
+    for (size_t i = 0; i < fields.size(); ++i) {
+        UA_SimpleAttributeOperand& clause = filter.selectClauses[i];
+        clause.typeDefinitionId = UA_NODEID_NUMERIC(0, UA_NS0ID_BASEEVENTTYPE);
+        clause.browsePathSize = 1;
+        clause.browsePath = (UA_QualifiedName*)UA_Array_new(1, &UA_TYPES[UA_TYPES_QUALIFIEDNAME]);
+        clause.browsePath[0] = UA_QUALIFIEDNAME_ALLOC(0, fields[i].c_str());
+        clause.attributeId = UA_ATTRIBUTEID_VALUE;
+    }
+
+    UA_MonitoredItemCreateRequest item;
+    UA_MonitoredItemCreateRequest_init(&item);
+    item.itemToMonitor.nodeId = sub.notifier;
+    item.itemToMonitor.attributeId = UA_ATTRIBUTEID_EVENTNOTIFIER;
+    item.monitoringMode = UA_MONITORINGMODE_REPORTING;
+    UA_ExtensionObject_setValue(&item.requestedParameters.filter, &filter, &UA_TYPES[UA_TYPES_EVENTFILTER]);
+    // Очередь на сервере переживает всплеск между двумя Publish
+    item.requestedParameters.queueSize = 10000;
+    item.requestedParameters.discardOldest = true;
+
+    UA_MonitoredItemCreateResult result = UA_Client_MonitoredItems_createEvent(
+        client, subscription_id, UA_TIMESTAMPSTORETURN_BOTH, item, &sub, eventCallback, nullptr);
+    bool ok = result.statusCode == UA_STATUSCODE_GOOD;
+    UA_MonitoredItemCreateResult_clear(&result);
+    UA_EventFilter_clear(&filter);
+    if (!ok) metrics().eventSubscribeFailures.inc();
+    return ok;
+}
+
+void OPCUAClient::eventCallback(UA_Client* client, UA_UInt32, void*, UA_UInt32, void* monContext,
+                                size_t nEventFields, UA_Variant* eventFields) {
+    // Вызывается из UA_Client_run_iterate под client_mutex; теги не блокируются
+    auto* sub = static_cast<EventSubscription*>(monContext);
+    sub->log->push(EventLog::decode(sub->fields, nEventFields, eventFields));
+    static_cast<OPCUAClient*>(UA_Client_getContext(client))->health.onPublish(UA_DateTime_now());
+}
+
+void OPCUAClient::ingest(size_t slot, const UA_DataValue& dv) {
+    std::lock_guard<std::mutex> lock(tags_mutex);
+    if (slot >= tags.size()) return;
+
+    // Время в строке берём из метки источника, если она есть
+    UA_DateTime t = dv.hasSourceTimestamp ? dv.sourceTimestamp : UA_DateTime_now();
+    UA_DateTimeStruct dts = UA_DateTime_toStruct(t + UA_DateTime_localTimeUtcOffset());
+    char buf[12];
+    std::snprintf(buf, sizeof(buf), "%02u:%02u:%02u",
+                  (unsigned)dts.hour, (unsigned)dts.min, (unsigned)dts.sec);
+
+    std::lock_guard<std::mutex> sinks_lock(sinks_mutex);
+    applyValueLocked(slot, dv, buf);
+    evaluateComputedLocked(buf);
+}
+
+void OPCUAClient::ingest(const uint32_t* slots, const UA_DataValue* values, size_t count) {
+    auto now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+    char buf[12];
+    std::strftime(buf, sizeof(buf), "%H:%M:%S", std::localtime(&now));
+
+    std::lock_guard<std::mutex> lock(tags_mutex);
+    std::lock_guard<std::mutex> sinks_lock(sinks_mutex);
+    for (size_t i = 0; i < count; ++i) {
+        if (slots[i] < tags.size()) applyValueLocked(slots[i], values[i], buf);
+    }
+    evaluateComputedLocked(buf);
+}
+
+void OPCUAClient::evaluateComputedLocked(const char* timeText) {
+    if (computed.size() == 0) return;
+    UA_DateTime now = UA_DateTime_now();
+    computed.evaluate([&](uint32_t slot, double value) {
+        TagData& tag = tags[slot];
+        if (tag.quality == "GOOD" && value == tag.value) return;
+        // NaN не равен себе: без этой проверки плохой результат применялся бы каждый цикл
+        if (!std::isfinite(value) && tag.quality == "BAD" && tag.status == UA_STATUSCODE_BADOUTOFRANGE) return;
+        // Значение живёт на стеке: DataValue только передаётся приёмникам и не очищается
+        UA_DataValue dv;
+        UA_DataValue_init(&dv);
+        UA_Variant_setScalar(&dv.value, &value, &UA_TYPES[UA_TYPES_DOUBLE]);
+        dv.hasValue = true;
+        dv.sourceTimestamp = now;
+        dv.hasSourceTimestamp = true;
+        if (!std::isfinite(value)) {
+            dv.status = UA_STATUSCODE_BADOUTOFRANGE;
+            dv.hasStatus = true;
+        }
+        applyValueLocked(slot, dv, timeText);
+    });
+}
+
+void OPCUAClient::flushSinks() {
+    TRACE_SCOPE("flushSinks");
+    std::lock_guard<std::mutex> sinks_lock(sinks_mutex);
+    for (auto& sink : sinks) sink->onCycleEnd();
+}
+
+void OPCUAClient::resetSinks() {
+    std::lock_guard<std::mutex> lock(tags_mutex);
+    std::lock_guard<std::mutex> sinks_lock(sinks_mutex);
+    for (auto& sink : sinks) sink->onReset();
+}
+
+void OPCUAClient::clearTags() {
+    std::lock_guard<std::mutex> lock(tags_mutex);
+    tags.clear();
+    slot_by_name.clear();
+    computed.clear();
+    read_ids.clear();
+    schedules.clear();
+    wheel.clear();
+    ++tags_generation;
+    tag_set_generation.fetch_add(1, std::memory_order_release);
+    if (shm_publisher) shm_publisher->truncate(0);
+}
+
+size_t OPCUAClient::addTag(const std::string& name, const std::string& nodeId, size_t group) {
+    std::lock_guard<std::mutex> lock(tags_mutex);
+    if (group >= groups.size()) group = 0;
+    tags.emplace_back(name, nodeId, group);
+    slot_by_name.emplace(name, tags.size() - 1);
+    appendReadId(nodeId);
+    // Первое чтение — на ближайшем тике, дальше по периоду группы
+    uint64_t due = wheel.currentTick() + 1;
+    schedules.push_back({0, 0, 0, due});
+    applyGroupLocked(tags.size() - 1);
+    wheel.schedule((uint32_t)(tags.size() - 1), due);
+    tag_set_generation.fetch_add(1, std::memory_order_release);
+    return tags.size() - 1;
+}
+
+bool OPCUAClient::addComputedTag(const std::string& name, const std::string& expression,
+                                 std::string* error) {
+    std::lock_guard<std::mutex> lock(tags_mutex);
+    Expression expr;
+    bool ok = expr.compile(expression, [this](const std::string& input, uint32_t& slot) {
+        auto it = slot_by_name.find(input);
+        if (it == slot_by_name.end()) return false;
+        slot = (uint32_t)it->second;
+        return true;
+    });
+    if (!ok) {
+        if (error) *error = expr.error();
+        return false;
+    }
+
+    // Слот занимается как у обычного тега, но в колесо опроса не попадает
+    uint32_t slot = (uint32_t)tags.size();
+    tags.emplace_back(name, "", 0);
+    tags.back().expression = expression;
+    slot_by_name.emplace(name, slot);
+    appendReadId("");
+    schedules.push_back({0, 0, 0, 0});
+    computed.add(slot, expr);
+    tag_set_generation.fetch_add(1, std::memory_order_release);
+    return true;
+}
+
+size_t OPCUAClient::addExternalTag(const std::string& name, const std::string& source) {
+    std::lock_guard<std::mutex> lock(tags_mutex);
+    // Как у вычисляемого тега: слот и расписание есть, в колесо опроса не попадает
+    tags.emplace_back(name, source, 0);
+    slot_by_name.emplace(name, tags.size() - 1);
+    appendReadId("");
+    schedules.push_back({0, 0, 0, 0});
+    tag_set_generation.fetch_add(1, std::memory_order_release);
+    return tags.size() - 1;
+}
+
+size_t OPCUAClient::addGroup(const std::string& name, uint32_t periodMs,
+                             uint32_t minPeriodMs, uint32_t maxPeriodMs) {
+    auto clampPeriod = [](uint32_t ms) { return std::min(std::max(ms, MIN_PERIOD_MS), MAX_PERIOD_MS); };
+    periodMs = clampPeriod(periodMs);
+    if (minPeriodMs == 0 && maxPeriodMs == 0) {
+        minPeriodMs = maxPeriodMs = periodMs;
+    } else {
+        minPeriodMs = clampPeriod(minPeriodMs);
+        maxPeriodMs = std::max(clampPeriod(maxPeriodMs), minPeriodMs);
+        periodMs = std::min(std::max(periodMs, minPeriodMs), maxPeriodMs);
+    }
+
+    std::lock_guard<std::mutex> lock(tags_mutex);
+    size_t index = 0;
+    while (index < groups.size() && groups[index].name != name) ++index;
+    if (index == groups.size()) {
+        groups.push_back({name, periodMs, minPeriodMs, maxPeriodMs});
+        return index;
+    }
+    // Новые параметры применяются к тегам группы со следующего чтения
+    groups[index] = {name, periodMs, minPeriodMs, maxPeriodMs};
+    for (size_t i = 0; i < tags.size(); ++i) {
+        if (tags[i].group == index) applyGroupLocked(i);
+    }
+    return index;
+}
+
+std::vector<OPCUAClient::TagGroup> OPCUAClient::getGroups() {
+    std::lock_guard<std::mutex> lock(tags_mutex);
+    return groups;
+}
+
+bool OPCUAClient::loadTagConfig(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) return false;
+
+    // Файл разбирается целиком до применения, чтобы ошибка не оставила половину набора
+    std::vector<TagGroup> new_groups;
+    std::vector<std::pair<TagData, std::string>> new_tags;
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        std::string kind;
+        if (!(fields >> kind) || kind[0] == '#') continue;
+        if (kind == "group") {
+            TagGroup g{"", 0, 0, 0};
+            if (!(fields >> g.name >> g.periodMs)) return false;
+            // Пределы адаптации необязательны, но задаются парой
+            if (fields >> g.minPeriodMs && !(fields >> g.maxPeriodMs)) return false;
+            new_groups.push_back(g);
+        } else if (kind == "tag") {
+            std::string name, nodeId, group = "default";
+            if (!(fields >> name >> nodeId)) return false;
+            fields >> group;
+            UA_NodeId check;
+            if (!parseNodeId(nodeId, check)) return false;
+            new_tags.push_back({TagData(name, nodeId), group});
+        } else if (kind == "calc") {
+            // Выражение проверяется по тегам, объявленным выше в этом же файле
+            TagData t("", "");
+            if (!(fields >> t.name) || !std::getline(fields, t.expression)) return false;
+            t.expression.erase(0, t.expression.find_first_not_of(" \t"));
+            Expression check;
+            bool ok = check.compile(t.expression, [&new_tags](const std::string& input, uint32_t& slot) {
+                for (slot = 0; slot < new_tags.size(); ++slot) {
+                    if (new_tags[slot].first.name == input) return true;
+                }
+                return false;
+            });
+            if (!ok) return false;
+            new_tags.push_back({t, "default"});
+        } else if (kind == "pubsub" || kind == "reader" || kind == "field") {
+            // Источник PubSub настраивает и проверяет PubSubSource::loadConfig
+            continue;
+        } else {
+            return false;
+        }
+    }
+
+    std::map<std::string, size_t> group_index;
+    for (const auto& g : getGroups()) group_index.emplace(g.name, group_index.size());
+    for (const auto& t : new_tags) {
+        bool known = group_index.count(t.second) > 0;
+        for (const auto& g : new_groups) known = known || g.name == t.second;
+        if (!known) return false;
+    }
+    for (const auto& g : new_groups) {
+        group_index[g.name] = addGroup(g.name, g.periodMs, g.minPeriodMs, g.maxPeriodMs);
+    }
+
+    clearTags();
+    for (const auto& t : new_tags) {
+        if (!t.first.expression.empty()) addComputedTag(t.first.name, t.first.expression);
+        else addTag(t.first.name, t.first.nodeId, group_index[t.second]);
+    }
+    return true;
 }
 
 bool OPCUAClient::writeValue(const std::string& nodeId, double newValue) {
     if (!connected) return false;
-    UA_Variant val;
-    UA_Variant_init(&val);
-    UA_Variant_setScalarCopy(&val, &newValue, &UA_TYPES[UA_TYPES_DOUBLE]);
-    int ns, id;
-    sscanf(nodeId.c_str(), "ns=%d;i=%d", &ns, &id);
-    UA_NodeId nid = UA_NODEID_NUMERIC((UA_UInt16)ns, (UA_UInt32)id);
-    UA_StatusCode res = UA_Client_writeValueAttribute(client, nid, &val);
-    UA_Variant_clear(&val);
+    UA_WriteValue item;
+    UA_WriteValue_init(&item);
+    if (!parseNodeId(nodeId, item.nodeId)) return false;
+    item.attributeId = UA_ATTRIBUTEID_VALUE;
+    // Значение живёт на стеке: запрос только кодируется и не очищается
+    UA_Variant_setScalar(&item.value.value, &newValue, &UA_TYPES[UA_TYPES_DOUBLE]);
+    item.value.hasValue = true;
+    UA_WriteRequest request;
+    UA_WriteRequest_init(&request);
+    request.nodesToWrite = &item;
+    request.nodesToWriteSize = 1;
+
+    UA_StatusCode res;
+    {
+        std::lock_guard<std::mutex> lock(client_mutex);
+        int64_t started = steadyNanos();
+        UA_WriteResponse response = UA_Client_Service_write(client, request);
+        int64_t finished = steadyNanos();
+        if (current_latency) current_latency->write.record((uint64_t)(finished - started));
+        // Состояние связи — по результату запроса; отказ в записи узла связь не портит
+        ConnectionHealth::Outcome outcome = health.onRequest(response.responseHeader.serviceResult,
+                                                             (uint64_t)(finished - started), 1, finished);
+        res = response.responseHeader.serviceResult;
+        if (res == UA_STATUSCODE_GOOD) {
+            res = response.resultsSize == 1 ? response.results[0] : UA_STATUSCODE_BADUNEXPECTEDERROR;
+        }
+        if (outcome == ConnectionHealth::OVERLOAD) metrics().overloads.inc();
+        if (outcome == ConnectionHealth::DISCONNECT) dropSessionLocked();
+        UA_WriteResponse_clear(&response);
+    }
+    metrics().writes.inc();
+    if (res != UA_STATUSCODE_GOOD) metrics().writeFailures.inc();
     return (res == UA_STATUSCODE_GOOD);
 }
 
 std::vector<OPCUAClient::TagData> OPCUAClient::getTags() {
+    TRACE_SCOPE("getTags");
     std::lock_guard<std::mutex> lock(tags_mutex);
     return tags;
+}
+
+bool OPCUAClient::getTag(size_t slot, TagData& out) {
+    std::lock_guard<std::mutex> lock(tags_mutex);
+    if (slot >= tags.size()) return false;
+    out = tags[slot];
+    return true;
+}
+
+size_t OPCUAClient::tagCount() {
+    std::lock_guard<std::mutex> lock(tags_mutex);
+    return tags.size();
+}
+
+void OPCUAClient::addSink(std::shared_ptr<ValueSink> sink) {
+    std::lock_guard<std::mutex> lock(sinks_mutex);
+    sinks.push_back(std::move(sink));
+}
+
+bool OPCUAClient::publishToSharedMemory(const std::string& name, uint32_t capacity) {
+    if (capacity == 0) {
+        std::lock_guard<std::mutex> lock(tags_mutex);
+        capacity = (uint32_t)std::max<size_t>(1024, tags.size() * 2);
+    }
+    auto publisher = std::make_shared<ShmPublisher>();
+    if (!publisher->create(name, capacity)) return false;
+    addSink(publisher);
+    std::lock_guard<std::mutex> lock(tags_mutex);
+    shm_publisher = publisher;
+    return true;
+}
+
+std::vector<OPCUAClient::LatencyRow> OPCUAClient::latencyReport() {
+    std::vector<LatencyRow> rows;
+    std::lock_guard<std::mutex> lock(latency_mutex);
+    for (const auto& entry : latency_by_server) {
+        const std::pair<const char*, const LatencyHistogram*> ops[] = {
+            {"connect", &entry.second->connect},
+            {"read", &entry.second->read},
+            {"write", &entry.second->write},
+        };
+        for (const auto& op : ops) {
+            rows.push_back({entry.first, op.first, op.second->count(),
+                            op.second->percentile(0.50), op.second->percentile(0.99),
+                            op.second->percentile(0.999), op.second->max()});
+        }
+    }
+    return rows;
+}
+
+bool OPCUAClient::dumpLatency(const std::string& path) {
+    std::FILE* f = std::fopen(path.c_str(), "w");
+    if (!f) return false;
+    std::fprintf(f, "%-40s %-8s %10s %12s %12s %12s %12s\n",
+                 "server", "op", "count", "p50_ns", "p99_ns", "p999_ns", "max_ns");
+    for (const auto& r : latencyReport()) {
+        std::fprintf(f, "%-40s %-8s %10llu %12llu %12llu %12llu %12llu\n",
+                     r.server.c_str(), r.operation.c_str(), (unsigned long long)r.count,
+                     (unsigned long long)r.p50, (unsigned long long)r.p99,
+                     (unsigned long long)r.p999, (unsigned long long)r.max);
+    }
+    std::fclose(f);
+    return true;
 }
\ No newline at end of file
@@ -0,0 +1,357 @@
+#include "../include/pubsub_source.hpp"
+#include "../include/metrics.hpp"
+#include <open62541/server_config_default.h>
+#include <open62541/server_pubsub.h>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+namespace {
+
+struct PubSubMetrics {
+    ShardedCounter& values;
+    ShardedCounter& batches;
+};
+
+PubSubMetrics& metrics() {
+    auto& r = MetricsRegistry::instance();
+    static PubSubMetrics m{
+        r.counter("opcua_pubsub_values_total", "DataSetField values received over PubSub"),
+        r.counter("opcua_pubsub_batches_total", "Batches of PubSub values handed to the tag store"),
+    };
+    return m;
+}
+
+const char* UDP_UADP_PROFILE = "http://opcfoundation.org/UA-Profile/Transport/pubsub-udp-uadp";
+
+bool fail(std::string* error, size_t line, const std::string& what) {
+    if (error) *error = "line " + std::to_string(line) + ": " + what;
+    return false;
+}
+
+bool parseId(const std::string& text, uint16_t& out) {
+    char* end = nullptr;
+    unsigned long v = std::strtoul(text.c_str(), &end, 10);
+    if (text.empty() || *end != '\0' || v > 0xFFFF) return false;
+    out = (uint16_t)v;
+    return true;
+}
+
+} // namespace
+
+int parsePubSubType(const std::string& name) {
+    if (name == "bool") return UA_TYPES_BOOLEAN;
+    if (name == "int16") return UA_TYPES_INT16;
+    if (name == "uint16") return UA_TYPES_UINT16;
+    if (name == "int32") return UA_TYPES_INT32;
+    if (name == "uint32") return UA_TYPES_UINT32;
+    if (name == "int64") return UA_TYPES_INT64;
+    if (name == "uint64") return UA_TYPES_UINT64;
+    if (name == "float") return UA_TYPES_FLOAT;
+    if (name == "double") return UA_TYPES_DOUBLE;
+    return -1;
+}
+
+bool pubsubFieldToDouble(int type, const void* data, double& out) {
+    switch (type) {
+    case UA_TYPES_BOOLEAN: out = *(const UA_Boolean*)data ? 1.0 : 0.0; break;
+    case UA_TYPES_INT16: out = *(const UA_Int16*)data; break;
+    case UA_TYPES_UINT16: out = *(const UA_UInt16*)data; break;
+    case UA_TYPES_INT32: out = *(const UA_Int32*)data; break;
+    case UA_TYPES_UINT32: out = *(const UA_UInt32*)data; break;
+    case UA_TYPES_INT64: out = (double)*(const UA_Int64*)data; break;
+    case UA_TYPES_UINT64: out = (double)*(const UA_UInt64*)data; break;
+    case UA_TYPES_FLOAT: out = *(const UA_Float*)data; break;
+    case UA_TYPES_DOUBLE: out = *(const UA_Double*)data; break;
+    default: return false;
+    }
+    return true;
+}
+
+bool parsePubSubConfig(const std::string& text, PubSubConfig& out, std::string* error) {
+    PubSubConfig config;
+    std::istringstream in(text);
+    std::string line;
+    for (size_t number = 1; std::getline(in, line); ++number) {
+        std::istringstream fields(line);
+        std::string kind;
+        if (!(fields >> kind) || kind[0] == '#') continue;
+        if (kind == "pubsub") {
+            PubSubConnection c;
+            if (!(fields >> c.name >> c.url)) return fail(error, number, "expected pubsub <name> <url> [interface]");
+            fields >> c.networkInterface;
+            if (c.url.compare(0, 10, "opc.udp://") != 0) return fail(error, number, "only opc.udp:// is supported");
+            for (const auto& other : config.connections) {
+                if (other.name == c.name) return fail(error, number, "duplicate connection " + c.name);
+            }
+            config.connections.push_back(c);
+        } else if (kind == "reader") {
+            PubSubReader r;
+            std::string publisher, group, writer;
+            if (!(fields >> r.name >> r.connection >> publisher >> group >> writer)) {
+                return fail(error, number, "expected reader <name> <connection> <PublisherId> <WriterGroupId> <DataSetWriterId>");
+            }
+            if (!parseId(publisher, r.publisherId) || !parseId(group, r.writerGroupId) ||
+                !parseId(writer, r.dataSetWriterId)) {
+                return fail(error, number, "ids must be 0..65535");
+            }
+            bool known = false;
+            for (const auto& c : config.connections) known = known || c.name == r.connection;
+            if (!known) return fail(error, number, "unknown connection " + r.connection);
+            for (const auto& other : config.readers) {
+                if (other.name == r.name) return fail(error, number, "duplicate reader " + r.name);
+            }
+            config.readers.push_back(r);
+        } else if (kind == "field") {
+            PubSubField f;
+            std::string type;
+            if (!(fields >> f.tag >> f.reader >> type)) return fail(error, number, "expected field <tag> <reader> <type>");
+            f.type = parsePubSubType(type);
+            if (f.type < 0) return fail(error, number, "unknown type " + type);
+            bool known = false;
+            for (const auto& r : config.readers) known = known || r.name == f.reader;
+            if (!known) return fail(error, number, "unknown reader " + f.reader);
+            for (const auto& other : config.fields) {
+                if (other.tag == f.tag) return fail(error, number, "duplicate field tag " + f.tag);
+            }
+            config.fields.push_back(f);
+        }
+    }
+    for (const auto& r : config.readers) {
+        bool used = false;
+        for (const auto& f : config.fields) used = used || f.reader == r.name;
+        if (!used) {
+            if (error) *error = "reader " + r.name + " has no fields";
+            return false;
+        }
+    }
+    out = config;
+    return true;
+}
+
+PubSubSource::PubSubSource(OPCUAClient& s)
+    : store(s), server(nullptr), is_running(false), values_received(0), batches_delivered(0) {}
+
+PubSubSource::~PubSubSource() {
+    stop();
+}
+
+bool PubSubSource::loadConfig(const std::string& path, std::string* error) {
+    std::ifstream in(path);
+    if (!in) {
+        if (error) *error = "cannot open " + path;
+        return false;
+    }
+    std::stringstream text;
+    text << in.rdbuf();
+    PubSubConfig parsed;
+    return parsePubSubConfig(text.str(), parsed, error) && configure(parsed, error);
+}
+
+bool PubSubSource::configure(const PubSubConfig& c, std::string* error) {
+    if (is_running) {
+        if (error) *error = "PubSub source is already running";
+        return false;
+    }
+    std::vector<OPCUAClient::TagData> existing = store.getTags();
+    for (const auto& f : c.fields) {
+        for (const auto& t : existing) {
+            if (t.name == f.tag) {
+                if (error) *error = "tag " + f.tag + " is already defined";
+                return false;
+            }
+        }
+    }
+    config = c;
+    slots.clear();
+    for (const auto& f : config.fields) {
+        slots.push_back((uint32_t)store.addExternalTag(f.tag, "pubsub:" + f.reader));
+    }
+    return true;
+}
+
+bool PubSubSource::setup(std::string* error) {
+    UA_ServerConfig* sc = UA_Server_getConfig(server);
+    UA_ServerConfig_setMinimal(sc, 0, nullptr);
+    // Только приём UDP: клиентам этот сервер не виден
+    sc->tcpEnabled = false;
+
+    fields.clear();
+    fields.resize(config.fields.size());
+    UA_StatusCode rc = UA_STATUSCODE_GOOD;
+    for (const auto& c : config.connections) {
+        UA_PubSubConnectionConfig cc;
+        std::memset(&cc, 0, sizeof(cc));
+        cc.name = UA_STRING((char*)c.name.c_str());
+        cc.enabled = true;
+        cc.transportProfileUri = UA_STRING((char*)UDP_UADP_PROFILE);
+        UA_NetworkAddressUrlDataType address;
+        address.networkInterface = UA_STRING((char*)c.networkInterface.c_str());
+        address.url = UA_STRING((char*)c.url.c_str());
+        UA_Variant_setScalar(&cc.address, &address, &UA_TYPES[UA_TYPES_NETWORKADDRESSURLDATATYPE]);
+        cc.publisherIdType = UA_PUBLISHERIDTYPE_UINT16;
+        UA_NodeId connection_id, group_id;
+        rc = UA_Server_addPubSubConnection(server, &cc, &connection_id);
+        if (rc != UA_STATUSCODE_GOOD) break;
+
+        UA_ReaderGroupConfig gc;
+        std::memset(&gc, 0, sizeof(gc));
+        gc.name = cc.name;
+        rc = UA_Server_addReaderGroup(server, connection_id, &gc, &group_id);
+        if (rc != UA_STATUSCODE_GOOD) break;
+        rc = UA_Server_setReaderGroupOperational(server, group_id);
+        if (rc != UA_STATUSCODE_GOOD) break;
+
+        for (const auto& r : config.readers) {
+            if (r.connection != c.name) continue;
+            std::vector<size_t> members;
+            for (size_t i = 0; i < config.fields.size(); ++i) {
+                if (config.fields[i].reader == r.name) members.push_back(i);
+            }
+
+            UA_DataSetReaderConfig reader_config;
+            std::memset(&reader_config, 0, sizeof(reader_config));
+            reader_config.name = UA_STRING((char*)r.name.c_str());
+            UA_UInt16 publisher = r.publisherId;
+            UA_Variant_setScalar(&reader_config.publisherId, &publisher, &UA_TYPES[UA_TYPES_UINT16]);
+            reader_config.writerGroupId = r.writerGroupId;
+            reader_config.dataSetWriterId = r.dataSetWriterId;
+            // Метаданные описывают поля так, как их шлёт контроллер; addDataSetReader их копирует
+            UA_DataSetMetaDataType& meta = reader_config.dataSetMetaData;
+            UA_DataSetMetaDataType_init(&meta);
+            meta.fields = (UA_FieldMetaData*)UA_Array_new(members.size(), &UA_TYPES[UA_TYPES_FIELDMETADATA]);
+            meta.fieldsSize = members.size();
+            for (size_t k = 0; k < members.size(); ++k) {
+                const PubSubField& f = config.fields[members[k]];
+                const UA_DataType* type = &UA_TYPES[f.type];
+                UA_NodeId_copy(&type->typeId, &meta.fields[k].dataType);
+                meta.fields[k].builtInType = (UA_Byte)type->typeId.identifier.numeric;
+                meta.fields[k].valueRank = -1;
+                meta.fields[k].name = UA_STRING_ALLOC(f.tag.c_str());
+            }
+            UA_NodeId reader_id;
+            rc = UA_Server_addDataSetReader(server, group_id, &reader_config, &reader_id);
+            UA_DataSetMetaDataType_clear(&meta);
+            if (rc != UA_STATUSCODE_GOOD) break;
+
+            std::vector<UA_FieldTargetVariable> targets(members.size());
+            for (size_t k = 0; k < members.size(); ++k) {
+                size_t index = members[k];
+                const UA_DataType* type = &UA_TYPES[config.fields[index].type];
+                Field& field = fields[index];
+                field.owner = this;
+                field.slot = slots[index];
+                field.type = config.fields[index].type;
+                std::memset(field.storage, 0, sizeof(field.storage));
+                UA_DataValue_init(&field.value);
+                UA_Variant_setScalar(&field.value.value, field.storage, type);
+                field.value.value.storageType = UA_VARIANT_DATA_NODELETE;
+                field.value.hasValue = true;
+                field.value_ptr = &field.value;
+
+                // Узел-зеркало нужен только как цель поля; значение в него не пишется
+                UA_NodeId node = UA_NODEID_NUMERIC(1, (UA_UInt32)index + 1);
+                UA_VariableAttributes attr = UA_VariableAttributes_default;
+                attr.dataType = type->typeId;
+                attr.valueRank = UA_VALUERANK_SCALAR;
+                UA_Variant_setScalar(&attr.value, field.storage, type);
+                attr.displayName = UA_LOCALIZEDTEXT((char*)"", (char*)config.fields[index].tag.c_str());
+                rc = UA_Server_addVariableNode(server, node, UA_NODEID_NUMERIC(0, UA_NS0ID_OBJECTSFOLDER),
+                                               UA_NODEID_NUMERIC(0, UA_NS0ID_ORGANIZES),
+                                               UA_QUALIFIEDNAME(1, (char*)config.fields[index].tag.c_str()),
+                                               UA_NODEID_NUMERIC(0, UA_NS0ID_BASEDATAVARIABLETYPE), attr,
+                                               nullptr, nullptr);
+                if (rc != UA_STATUSCODE_GOOD) break;
+
+                UA_FieldTargetVariable& t = targets[k];
+                std::memset(&t, 0, sizeof(t));
+                UA_FieldTargetDataType_init(&t.targetVariable);
+                t.targetVariable.attributeId = UA_ATTRIBUTEID_VALUE;
+                t.targetVariable.targetNodeId = node;
+                t.externalDataValue = &field.value_ptr;
+                t.targetVariableContext = &field;
+                t.afterWrite = afterWrite;
+            }
+            if (rc != UA_STATUSCODE_GOOD) break;
+            rc = UA_Server_DataSetReader_createTargetVariables(server, reader_id, targets.size(), targets.data());
+            if (rc != UA_STATUSCODE_GOOD) break;
+        }
+        if (rc != UA_STATUSCODE_GOOD) break;
+    }
+    if (rc != UA_STATUSCODE_GOOD) {
+        if (error) *error = std::string("PubSub setup failed: ") + UA_StatusCode_name(rc);
+        return false;
+    }
+
+    // Запас на несколько сообщений каждого поля за проход, дальше ёмкость растёт по надобности
+    pending.reserve(fields.size() * 8 + 64);
+    batch_slots.reserve(pending.capacity());
+    batch_values.reserve(pending.capacity());
+    return true;
+}
+
+bool PubSubSource::start(std::string* error) {
+    if (is_running) return true;
+    if (config.readers.empty()) {
+        if (error) *error = "no PubSub readers configured";
+        return false;
+    }
+    server = UA_Server_new();
+    if (!setup(error) || UA_Server_run_startup(server) != UA_STATUSCODE_GOOD) {
+        if (error && error->empty()) *error = "cannot start PubSub receiver";
+        UA_Server_delete(server);
+        server = nullptr;
+        return false;
+    }
+    is_running = true;
+    receiver = std::thread([this] { receiveLoop(); });
+    return true;
+}
+
+void PubSubSource::stop() {
+    if (!is_running.exchange(false)) return;
+    if (receiver.joinable()) receiver.join();
+    UA_Server_run_shutdown(server);
+    UA_Server_delete(server);
+    server = nullptr;
+}
+
+void PubSubSource::receiveLoop() {
+    while (is_running.load()) {
+        // Ждёт сокеты или ближайший таймер сервера; декодер вызывает afterWrite на каждое поле
+        UA_Server_run_iterate(server, true);
+        deliver();
+    }
+}
+
+void PubSubSource::afterWrite(UA_Server*, const UA_NodeId*, const UA_NodeId*, const UA_NodeId*, void* context,
+                              UA_DataValue**) {
+    Field* field = (Field*)context;
+    double value;
+    if (!pubsubFieldToDouble(field->type, field->storage, value)) return;
+    field->owner->pending.push_back({field->slot, value, UA_DateTime_now()});
+}
+
+void PubSubSource::deliver() {
+    if (pending.empty()) return;
+    size_t n = pending.size();
+    batch_slots.resize(n);
+    batch_values.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        UA_DataValue& dv = batch_values[i];
+        UA_DataValue_init(&dv);
+        UA_Variant_setScalar(&dv.value, &pending[i].value, &UA_TYPES[UA_TYPES_DOUBLE]);
+        dv.hasValue = true;
+        dv.serverTimestamp = pending[i].received;
+        dv.hasServerTimestamp = true;
+        batch_slots[i] = pending[i].slot;
+    }
+    store.ingest(batch_slots.data(), batch_values.data(), n);
+    store.flushSinks();
+    pending.clear();
+    values_received.fetch_add(n, std::memory_order_relaxed);
+    batches_delivered.fetch_add(1, std::memory_order_relaxed);
+    metrics().values.inc(n);
+    metrics().batches.inc();
+}
@@ -0,0 +1,837 @@
+#include "../include/recorder.hpp"
+#include "../include/metrics.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace {
+
+struct RecorderMetrics {
+    ShardedCounter& records;
+    ShardedCounter& dropped;
+    ShardedCounter& bytes;
+};
+
+RecorderMetrics& metrics() {
+    auto& r = MetricsRegistry::instance();
+    static RecorderMetrics m{
+        r.counter("opcua_recorder_records_total", "Value changes written to the session recording"),
+        r.counter("opcua_recorder_dropped_total", "Value changes lost because the recorder queue was full"),
+        r.counter("opcua_recorder_bytes_total", "Compressed bytes written to the session recording"),
+    };
+    return m;
+}
+
+const char FILE_MAGIC[8] = {'O', 'P', 'C', 'U', 'R', 'E', 'C', '1'};
+const char INDEX_TRAILER[8] = {'O', 'P', 'C', 'U', 'I', 'D', 'X', '1'};
+const uint32_t BLOCK_MAGIC_V1 = 0x314b4c42;  // "BLK1", только чтение
+const uint32_t BLOCK_MAGIC = 0x324b4c42;     // "BLK2"
+const uint32_t INDEX_MAGIC_V1 = 0x31584449;  // "IDX1", только чтение
+const uint32_t INDEX_MAGIC = 0x32584449;     // "IDX2"
+const size_t BLOCK_HEADER = 32;
+const size_t INDEX_ENTRY_V1 = 28;
+const size_t INDEX_ENTRY = 32;
+const uint32_t MAX_SLOTS = 1u << 24;
+
+enum EntryFlags : uint8_t {
+    HAS_SOURCE = 1,
+    HAS_SERVER = 2,
+    HAS_STATUS = 4,
+    IS_DOUBLE = 8,  // значение — 8 байт скалярного Double
+    // Только в BLK2; вид записи — бит 4
+    NEW_CYCLE = 0x20,  // запись открывает цикл опроса: за слотом идёт время приёма
+    XOR_DOUBLE = 0x40  // Double — XOR с предыдущим Double того же слота в блоке
+};
+
+// Заголовок записи в очереди. За ним по флагам — i64 sourceTime, i64 serverTime,
+// u32 статус, затем байты значения или имени тега. Запись держится короткой:
+// поток записи читает строки кэша, только что записанные другим ядром
+struct QueuedChange {
+    uint32_t size;    // вся запись с выравниванием
+    uint8_t kind;     // RecordedChange::Kind, CYCLE или PAD
+    uint8_t flags;    // HAS_SOURCE | HAS_SERVER | HAS_STATUS
+    uint16_t reserved;
+    uint32_t length;  // байт тела без выравнивания
+    uint32_t slot;
+};
+const uint8_t CYCLE = 0xfe;  // начало цикла опроса, тело — i64 время приёма
+const uint8_t PAD = 0xff;    // остаток кольца до конца, пропускается
+const uint8_t DOUBLE_TYPE_ID = 11;
+
+bool hostIsLittleEndian() {
+    uint16_t x = 1;
+    uint8_t b;
+    std::memcpy(&b, &x, 1);
+    return b == 1;
+}
+
+int seek64(FILE* f, uint64_t offset) {
+#ifdef _WIN32
+    return _fseeki64(f, (__int64)offset, SEEK_SET);
+#else
+    return fseeko(f, (off_t)offset, SEEK_SET);
+#endif
+}
+
+uint64_t fileSize64(FILE* f) {
+#ifdef _WIN32
+    _fseeki64(f, 0, SEEK_END);
+    return (uint64_t)_ftelli64(f);
+#else
+    fseeko(f, 0, SEEK_END);
+    return (uint64_t)ftello(f);
+#endif
+}
+
+template <typename T>
+void put(std::vector<uint8_t>& out, T v) {
+    size_t at = out.size();
+    out.resize(at + sizeof(T));
+    std::memcpy(&out[at], &v, sizeof(T));
+}
+
+template <typename T>
+T get(const uint8_t* p) {
+    T v;
+    std::memcpy(&v, p, sizeof(T));
+    return v;
+}
+
+uint8_t* putVarint(uint8_t* p, uint64_t v) {
+    while (v >= 0x80) {
+        *p++ = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    *p++ = (uint8_t)v;
+    return p;
+}
+
+bool getVarint(const uint8_t*& p, const uint8_t* end, uint64_t& v) {
+    v = 0;
+    for (int shift = 0; shift < 64 && p < end; shift += 7) {
+        uint8_t b = *p++;
+        v |= (uint64_t)(b & 0x7f) << shift;
+        if (!(b & 0x80)) return true;
+    }
+    return false;
+}
+
+uint64_t zigzag(int64_t v) {
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+int64_t unzigzag(uint64_t v) {
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+uint32_t read32(const uint8_t* p) {
+    return get<uint32_t>(p);
+}
+
+// XOR соседних значений датчика: знак, порядок и старшие биты мантиссы обычно
+// совпадают, у квантованных значений нулевые и младшие байты. Управляющий байт —
+// (младших нулевых байт << 4) | значимых байт, 0 — значение не изменилось;
+// значимые байты пишутся следом, little-endian. Выравнивание по байтам оставляет
+// повторы видимыми для LZ-сжатия блока
+uint8_t* putXor(uint8_t* p, uint64_t x) {
+    if (x == 0) {
+        *p++ = 0;
+        return p;
+    }
+    unsigned trailing = 0;
+    while (!(x & 0xff)) {
+        x >>= 8;
+        ++trailing;
+    }
+    unsigned count = 1;
+    while (count < 8 - trailing && (x >> (8 * count))) ++count;
+    *p++ = (uint8_t)((trailing << 4) | count);
+    for (unsigned i = 0; i < count; ++i, x >>= 8) *p++ = (uint8_t)x;
+    return p;
+}
+
+bool getXor(const uint8_t*& p, const uint8_t* end, uint64_t& x) {
+    if (p >= end) return false;
+    uint8_t control = *p++;
+    unsigned trailing = control >> 4;
+    unsigned count = control & 15;
+    if (trailing + count > 8 || (size_t)(end - p) < count) return false;
+    x = 0;
+    for (unsigned i = 0; i < count; ++i) x |= (uint64_t)p[i] << (8 * (trailing + i));
+    p += count;
+    return true;
+}
+
+} // namespace
+
+// Формат сжатых данных — последовательности в духе LZ4:
+// [токен: длина литералов (4 бита) | длина совпадения - 4 (4 бита)][доп. байты длины литералов]
+// [литералы][u16 смещение][доп. байты длины совпадения]; последняя последовательность — только литералы
+size_t lzCompress(const uint8_t* in, size_t len, uint8_t* out, size_t cap) {
+    const int HASH_BITS = 12;
+    const size_t MIN_MATCH = 4;
+    uint32_t table[1 << HASH_BITS] = {};  // позиция + 1
+    size_t op = 0;
+
+    auto putLength = [&](size_t v) {
+        while (v >= 255) {
+            if (op >= cap) return false;
+            out[op++] = 255;
+            v -= 255;
+        }
+        if (op >= cap) return false;
+        out[op++] = (uint8_t)v;
+        return true;
+    };
+    auto emit = [&](size_t anchor, size_t literals, size_t offset, size_t match) {
+        size_t ml = match ? match - MIN_MATCH : 0;
+        if (op >= cap) return false;
+        out[op++] = (uint8_t)((std::min<size_t>(literals, 15) << 4) | std::min<size_t>(ml, 15));
+        if (literals >= 15 && !putLength(literals - 15)) return false;
+        if (op + literals > cap) return false;
+        std::memcpy(out + op, in + anchor, literals);
+        op += literals;
+        if (!match) return true;
+        if (op + 2 > cap) return false;
+        out[op++] = (uint8_t)offset;
+        out[op++] = (uint8_t)(offset >> 8);
+        return ml < 15 || putLength(ml - 15);
+    };
+
+    size_t ip = 0;
+    size_t anchor = 0;
+    size_t misses = 0;
+    while (ip + MIN_MATCH <= len) {
+        uint32_t seq = read32(in + ip);
+        uint32_t h = (seq * 2654435761u) >> (32 - HASH_BITS);
+        size_t cand = table[h];
+        table[h] = (uint32_t)(ip + 1);
+        if (cand && ip - (cand - 1) <= 0xffff && read32(in + cand - 1) == seq) {
+            size_t from = cand - 1;
+            size_t match = MIN_MATCH;
+            while (ip + match < len && in[from + match] == in[ip + match]) ++match;
+            if (!emit(anchor, ip - anchor, ip - from, match)) return 0;
+            ip += match;
+            anchor = ip;
+            misses = 0;
+        } else {
+            // На несжимаемых участках шаг растёт, как в LZ4
+            ip += 1 + (misses++ >> 5);
+        }
+    }
+    if (!emit(anchor, len - anchor, 0, 0)) return 0;
+    return op;
+}
+
+bool lzDecompress(const uint8_t* in, size_t len, uint8_t* out, size_t expected) {
+    const uint8_t* ip = in;
+    const uint8_t* end = in + len;
+    size_t op = 0;
+
+    auto getLength = [&](size_t& v) {
+        uint8_t b;
+        do {
+            if (ip >= end) return false;
+            b = *ip++;
+            v += b;
+        } while (b == 255);
+        return true;
+    };
+
+    while (ip < end) {
+        uint8_t token = *ip++;
+        size_t literals = token >> 4;
+        if (literals == 15 && !getLength(literals)) return false;
+        if (literals > (size_t)(end - ip) || op + literals > expected) return false;
+        std::memcpy(out + op, ip, literals);
+        ip += literals;
+        op += literals;
+        if (ip == end) break;
+
+        if (end - ip < 2) return false;
+        size_t offset = (size_t)ip[0] | ((size_t)ip[1] << 8);
+        ip += 2;
+        size_t match = token & 15;
+        if (match == 15 && !getLength(match)) return false;
+        match += 4;
+        if (offset == 0 || offset > op || op + match > expected) return false;
+        // Совпадение может перекрывать само себя — копируем по байту
+        for (size_t i = 0; i < match; ++i, ++op) out[op] = out[op - offset];
+    }
+    return op == expected;
+}
+
+SessionRecorder::SessionRecorder(size_t queueBytes)
+    : file(nullptr), queue_head(0), tail_cache(0), cycle_time(0), queue_tail(0), cycle_received(0), block_len(0),
+      block_records(0), block_tag_records(0), block_first(0), block_last(0), prev_slot(0), prev_received(0),
+      prev_source(0), prev_server(0), prev_cycle_gap(0), block_serial(0), file_offset(0), stopping(false),
+      accepting(false), records_written(0), records_dropped(0) {
+    size_t cap = 4096;
+    while (cap < queueBytes) cap <<= 1;
+    queue.resize(cap);
+    queue_mask = cap - 1;
+    block.resize(BLOCK_SIZE);
+    packed.resize(BLOCK_SIZE + BLOCK_SIZE / 2);
+}
+
+SessionRecorder::~SessionRecorder() {
+    close();
+}
+
+bool SessionRecorder::open(const std::string& path, const std::vector<OPCUAClient::TagData>& tags) {
+    close();
+    file = std::fopen(path.c_str(), "wb");
+    if (!file) return false;
+
+    std::vector<uint8_t> header(FILE_MAGIC, FILE_MAGIC + sizeof(FILE_MAGIC));
+    put<uint32_t>(header, (uint32_t)tags.size());
+    names.clear();
+    for (const auto& t : tags) {
+        put<uint16_t>(header, (uint16_t)std::min<size_t>(t.name.size(), 0xffff));
+        header.insert(header.end(), t.name.begin(), t.name.begin() + std::min<size_t>(t.name.size(), 0xffff));
+        put<uint16_t>(header, (uint16_t)std::min<size_t>(t.nodeId.size(), 0xffff));
+        header.insert(header.end(), t.nodeId.begin(), t.nodeId.begin() + std::min<size_t>(t.nodeId.size(), 0xffff));
+        names.push_back(t.name);
+    }
+    if (std::fwrite(header.data(), 1, header.size(), file) != header.size()) {
+        std::fclose(file);
+        file = nullptr;
+        return false;
+    }
+    file_offset = header.size();
+    index.clear();
+    block_len = 0;
+    block_records = 0;
+    block_tag_records = 0;
+    queue_head.store(0);
+    queue_tail.store(0);
+    tail_cache = 0;
+    stopping = false;
+    writer = std::thread(&SessionRecorder::writerLoop, this);
+    accepting.store(true, std::memory_order_release);
+    return true;
+}
+
+void SessionRecorder::close() {
+    if (!file) return;
+    accepting.store(false, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    if (writer.joinable()) writer.join();
+
+    // Индекс в конце файла: без него файл всё равно читается сканированием блоков
+    std::vector<uint8_t> tail;
+    put<uint32_t>(tail, INDEX_MAGIC);
+    put<uint32_t>(tail, (uint32_t)index.size());
+    for (const auto& b : index) {
+        put<uint64_t>(tail, b.offset);
+        put<int64_t>(tail, b.first);
+        put<int64_t>(tail, b.last);
+        put<uint32_t>(tail, b.records);
+        put<uint32_t>(tail, b.tagRecords);
+    }
+    put<uint64_t>(tail, file_offset);
+    tail.insert(tail.end(), INDEX_TRAILER, INDEX_TRAILER + sizeof(INDEX_TRAILER));
+    std::fwrite(tail.data(), 1, tail.size(), file);
+    std::fclose(file);
+    file = nullptr;
+}
+
+bool SessionRecorder::enqueue(const void* head, size_t headLen, const void* body, size_t bodyLen) {
+    size_t cap = queue.size();
+    size_t total = (headLen + bodyLen + 7) & ~(size_t)7;
+    uint64_t h = queue_head.load(std::memory_order_relaxed);
+    size_t pos = (size_t)(h & queue_mask);
+    size_t to_end = cap - pos;
+    size_t need = total + (total > to_end ? to_end : 0);
+    if (need > cap - (size_t)(h - tail_cache)) tail_cache = queue_tail.load(std::memory_order_acquire);
+    if (total > cap / 2 || need > cap - (size_t)(h - tail_cache)) {
+        records_dropped.fetch_add(1, std::memory_order_relaxed);
+        metrics().dropped.inc();
+        return false;
+    }
+    if (total > to_end) {
+        // Запись не делится: хвост кольца помечается пропуском
+        uint32_t skip = (uint32_t)to_end;
+        std::memcpy(&queue[pos], &skip, sizeof(skip));
+        queue[pos + 4] = PAD;
+        h += to_end;
+        pos = 0;
+    }
+    std::memcpy(&queue[pos], head, headLen);
+    if (bodyLen) std::memcpy(&queue[pos + headLen], body, bodyLen);
+    uint32_t size = (uint32_t)total;
+    uint32_t length = (uint32_t)(headLen + bodyLen - sizeof(QueuedChange));
+    std::memcpy(&queue[pos], &size, sizeof(size));
+    std::memcpy(&queue[pos + 8], &length, sizeof(length));
+    queue_head.store(h + total, std::memory_order_release);
+    return true;
+}
+
+void SessionRecorder::onValueChanged(size_t slot, const OPCUAClient::TagData& tag, const UA_DataValue& dv) {
+    if (!accepting.load(std::memory_order_acquire)) return;
+
+    QueuedChange q;
+    std::memset(&q, 0, sizeof(q));
+    // Значения одного цикла опроса пришли одним ответом — время приёма у них общее
+    // Состояние меняется только после того, как запись легла в очередь: потерянная
+    // метка цикла или запись тега повторяются со следующим значением, а само значение
+    // без них отбрасывается, чтобы не попасть в чужой цикл или к чужому тегу
+    if (!cycle_time) {
+        UA_DateTime now = UA_DateTime_now();
+        q.kind = CYCLE;
+        if (!enqueue(&q, sizeof(q), &now, sizeof(now))) {
+            records_dropped.fetch_add(1, std::memory_order_relaxed);
+            metrics().dropped.inc();
+            return;
+        }
+        cycle_time = now;
+    }
+    q.slot = (uint32_t)slot;
+
+    // Новый тег в слоте (смена набора, подключение к коллектору) записывается перед значением
+    if (slot >= names.size() || names[slot] != tag.name) {
+        std::string body = tag.name;
+        body.push_back('\0');
+        body += tag.nodeId;
+        q.kind = RecordedChange::TAG;
+        if (!enqueue(&q, sizeof(q), body.data(), body.size())) {
+            records_dropped.fetch_add(1, std::memory_order_relaxed);
+            metrics().dropped.inc();
+            return;
+        }
+        if (slot >= names.size()) names.resize(slot + 1);
+        names[slot] = tag.name;
+    }
+
+    uint8_t head[sizeof(QueuedChange) + 24];
+    size_t head_len = sizeof(q);
+    q.kind = RecordedChange::VALUE;
+    if (dv.hasSourceTimestamp && dv.sourceTimestamp) {
+        q.flags |= HAS_SOURCE;
+        std::memcpy(head + head_len, &dv.sourceTimestamp, 8);
+        head_len += 8;
+    }
+    if (dv.hasServerTimestamp && dv.serverTimestamp) {
+        q.flags |= HAS_SERVER;
+        std::memcpy(head + head_len, &dv.serverTimestamp, 8);
+        head_len += 8;
+    }
+    if (dv.hasStatus && dv.status != UA_STATUSCODE_GOOD) {
+        q.flags |= HAS_STATUS;
+        std::memcpy(head + head_len, &dv.status, 4);
+        head_len += 4;
+    }
+    std::memcpy(head, &q, sizeof(q));
+
+    const UA_Variant& v = dv.value;
+    if (!dv.hasValue || !v.type) {
+        enqueue(head, head_len, nullptr, 0);
+        return;
+    }
+    // Скаляр числового типа кодируется в OPC UA как байт типа и значение
+    // little-endian — это копия памяти без вызова кодировщика
+    static const bool little_endian = hostIsLittleEndian();
+    if (little_endian && UA_Variant_isScalar(&v) && v.type->typeKind <= UA_DATATYPEKIND_DOUBLE &&
+        v.type->typeId.identifierType == UA_NODEIDTYPE_NUMERIC) {
+        uint8_t buf[16];
+        buf[0] = (uint8_t)v.type->typeId.identifier.numeric;
+        std::memcpy(buf + 1, v.data, v.type->memSize);
+        enqueue(head, head_len, buf, 1 + (size_t)v.type->memSize);
+        return;
+    }
+    size_t size = UA_calcSizeBinary(&v, &UA_TYPES[UA_TYPES_VARIANT]);
+    if (scratch.size() < size) scratch.resize(size);
+    UA_ByteString out;
+    out.length = size;
+    out.data = scratch.data();
+    if (size == 0 || UA_encodeBinary(&v, &UA_TYPES[UA_TYPES_VARIANT], &out) != UA_STATUSCODE_GOOD) {
+        enqueue(head, head_len, nullptr, 0);
+        return;
+    }
+    enqueue(head, head_len, scratch.data(), size);
+}
+
+size_t SessionRecorder::drain() {
+    uint64_t t = queue_tail.load(std::memory_order_relaxed);
+    uint64_t h = queue_head.load(std::memory_order_acquire);
+    size_t n = 0;
+    while (t < h) {
+        const uint8_t* entry = &queue[(size_t)(t & queue_mask)];
+        uint32_t size = get<uint32_t>(entry);
+        if (entry[4] == CYCLE) {
+            cycle_received = get<int64_t>(entry + sizeof(QueuedChange));
+        } else if (entry[4] != PAD) {
+            encodeEntry(entry);
+            ++n;
+        }
+        t += size;
+    }
+    queue_tail.store(t, std::memory_order_release);
+    return n;
+}
+
+void SessionRecorder::encodeEntry(const uint8_t* entry) {
+    QueuedChange q;
+    std::memcpy(&q, entry, sizeof(q));
+    const uint8_t* body = entry + sizeof(q);
+    int64_t source = 0, server = 0;
+    uint32_t status = 0;
+    if (q.flags & HAS_SOURCE) {
+        source = get<int64_t>(body);
+        body += 8;
+    }
+    if (q.flags & HAS_SERVER) {
+        server = get<int64_t>(body);
+        body += 8;
+    }
+    if (q.flags & HAS_STATUS) {
+        status = get<uint32_t>(body);
+        body += 4;
+    }
+    size_t body_len = q.length - (size_t)(body - entry - sizeof(q));
+    int64_t received = cycle_received;
+
+    // Заголовок записи в блоке — не больше 1 + 6 varint по 10 байт
+    const size_t MAX_HEAD = 64;
+    if (block_records && block_len + MAX_HEAD + body_len > BLOCK_SIZE) flushBlock();
+    if (block_records == 0) {
+        block_first = received;
+        prev_slot = 0;
+        prev_received = 0;
+        prev_source = 0;
+        prev_server = 0;
+        prev_cycle_gap = 0;
+        ++block_serial;
+    }
+    if (block.size() < block_len + MAX_HEAD + body_len) block.resize(block_len + MAX_HEAD + body_len);
+
+    bool is_double = q.kind == RecordedChange::VALUE && body_len == 9 && body[0] == DOUBLE_TYPE_ID;
+    bool new_cycle = block_records == 0 || received != prev_received;
+    bool xor_double = false;
+    if (is_double) {
+        if (q.slot >= slot_block.size()) {
+            slot_block.resize(q.slot + 1, 0);
+            slot_double.resize(q.slot + 1, 0);
+        }
+        xor_double = slot_block[q.slot] == block_serial;
+    }
+    uint8_t flags = (uint8_t)((q.kind << 4) | q.flags);
+    if (is_double) flags |= IS_DOUBLE;
+    if (new_cycle) flags |= NEW_CYCLE;
+    if (xor_double) flags |= XOR_DOUBLE;
+    uint8_t* p = &block[block_len];
+    *p++ = flags;
+    p = putVarint(p, zigzag((int64_t)q.slot - (int64_t)prev_slot));
+    // Записи одного цикла делят время приёма; между циклами пишется дельта дельт,
+    // при ровном периоде опроса — около нуля. Первый цикл блока — абсолютное время
+    if (new_cycle) {
+        int64_t gap = received - prev_received;
+        p = putVarint(p, zigzag(gap - prev_cycle_gap));
+        if (block_records) prev_cycle_gap = gap;
+    }
+    // Метки источника и сервера — от предыдущих таких же в блоке (у тегов одного ПЛК они совпадают)
+    if (source) p = putVarint(p, zigzag(source - (prev_source ? prev_source : received)));
+    if (server) p = putVarint(p, zigzag(server - (prev_server ? prev_server : received)));
+    if (status) p = putVarint(p, status);
+    if (is_double) {
+        uint64_t bits = get<uint64_t>(body + 1);
+        if (xor_double) {
+            p = putXor(p, bits ^ slot_double[q.slot]);
+        } else {
+            std::memcpy(p, body + 1, 8);
+            p += 8;
+        }
+        slot_double[q.slot] = bits;
+        slot_block[q.slot] = block_serial;
+    } else {
+        p = putVarint(p, body_len);
+        if (body_len) std::memcpy(p, body, body_len);
+        p += body_len;
+    }
+    block_len = (size_t)(p - block.data());
+
+    prev_slot = q.slot;
+    prev_received = received;
+    if (source) prev_source = source;
+    if (server) prev_server = server;
+    block_last = received;
+    ++block_records;
+    if (q.kind == RecordedChange::TAG) ++block_tag_records;
+}
+
+void SessionRecorder::flushBlock() {
+    if (!block_records) return;
+    // Сжатый блок должен быть строго меньше исходного: равные размеры означают «без сжатия»
+    size_t packed_len = lzCompress(block.data(), block_len, packed.data(),
+                                   std::min(packed.size(), block_len - 1));
+    const uint8_t* data = packed_len ? packed.data() : block.data();
+    if (!packed_len) packed_len = block_len;
+
+    std::vector<uint8_t> header;
+    header.reserve(BLOCK_HEADER);
+    put<uint32_t>(header, BLOCK_MAGIC);
+    put<uint32_t>(header, (uint32_t)block_len);
+    put<uint32_t>(header, (uint32_t)packed_len);
+    put<uint32_t>(header, block_records);
+    put<int64_t>(header, block_first);
+    put<int64_t>(header, block_last);
+    std::fwrite(header.data(), 1, header.size(), file);
+    std::fwrite(data, 1, packed_len, file);
+    // Блок сразу уходит в ОС: при падении процесса теряется только недописанный
+    std::fflush(file);
+
+    index.push_back({file_offset, block_first, block_last, block_records, block_tag_records});
+    file_offset += BLOCK_HEADER + packed_len;
+    records_written.fetch_add(block_records, std::memory_order_relaxed);
+    metrics().records.inc(block_records);
+    metrics().bytes.inc(BLOCK_HEADER + packed_len);
+    block_len = 0;
+    block_records = 0;
+    block_tag_records = 0;
+}
+
+void SessionRecorder::writerLoop() {
+    auto last_flush = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock(wake_mutex);
+    while (!stopping) {
+        wake.wait_for(lock, std::chrono::milliseconds(50));
+        lock.unlock();
+        drain();
+        // Неполный блок дописывается хотя бы раз в секунду
+        auto now = std::chrono::steady_clock::now();
+        if (now - last_flush >= std::chrono::seconds(1)) {
+            flushBlock();
+            last_flush = now;
+        }
+        lock.lock();
+    }
+    lock.unlock();
+    drain();
+    flushBlock();
+}
+
+RecordingReader::~RecordingReader() {
+    if (file) std::fclose(file);
+}
+
+bool RecordingReader::open(const std::string& path) {
+    if (file) std::fclose(file);
+    tag_table.clear();
+    block_index.clear();
+    recovered = false;
+    file = std::fopen(path.c_str(), "rb");
+    if (!file) return false;
+
+    char magic[8];
+    uint32_t count = 0;
+    if (std::fread(magic, 1, 8, file) != 8 || std::memcmp(magic, FILE_MAGIC, 8) != 0 ||
+        std::fread(&count, 4, 1, file) != 1) {
+        std::fclose(file);
+        file = nullptr;
+        return false;
+    }
+    uint64_t offset = 12;
+    for (uint32_t i = 0; i < count; ++i) {
+        RecordedTag t;
+        for (std::string* s : {&t.name, &t.nodeId}) {
+            uint16_t len = 0;
+            if (std::fread(&len, 2, 1, file) != 1) {
+                std::fclose(file);
+                file = nullptr;
+                return false;
+            }
+            s->resize(len);
+            if (len && std::fread(&(*s)[0], 1, len, file) != len) {
+                std::fclose(file);
+                file = nullptr;
+                return false;
+            }
+            offset += 2 + len;
+        }
+        tag_table.push_back(t);
+    }
+    data_start = offset;
+
+    uint64_t size = fileSize64(file);
+    if (!readIndex(size)) {
+        recovered = true;
+        scanBlocks(size);
+    }
+    return true;
+}
+
+bool RecordingReader::readIndex(uint64_t fileSize) {
+    if (fileSize < data_start + 24) return false;
+    uint8_t trailer[16];
+    if (seek64(file, fileSize - 16) != 0 || std::fread(trailer, 1, 16, file) != 16 ||
+        std::memcmp(trailer + 8, INDEX_TRAILER, 8) != 0) {
+        return false;
+    }
+    uint64_t at = get<uint64_t>(trailer);
+    uint8_t head[8];
+    if (at < data_start || at + 8 > fileSize - 16 || seek64(file, at) != 0 ||
+        std::fread(head, 1, 8, file) != 8 ||
+        (get<uint32_t>(head) != INDEX_MAGIC && get<uint32_t>(head) != INDEX_MAGIC_V1)) {
+        return false;
+    }
+    bool v2 = get<uint32_t>(head) == INDEX_MAGIC;
+    size_t entry_size = v2 ? INDEX_ENTRY : INDEX_ENTRY_V1;
+    uint32_t n = get<uint32_t>(head + 4);
+    if (at + 8 + (uint64_t)n * entry_size + 16 != fileSize) return false;
+    std::vector<uint8_t> entries((size_t)n * entry_size);
+    if (n && std::fread(entries.data(), 1, entries.size(), file) != entries.size()) return false;
+    for (uint32_t i = 0; i < n; ++i) {
+        const uint8_t* e = &entries[(size_t)i * entry_size];
+        block_index.push_back({get<uint64_t>(e), get<int64_t>(e + 8), get<int64_t>(e + 16), get<uint32_t>(e + 24),
+                               v2 ? get<uint32_t>(e + 28) : TAGS_UNKNOWN});
+    }
+    return true;
+}
+
+void RecordingReader::scanBlocks(uint64_t fileSize) {
+    uint64_t at = data_start;
+    uint8_t head[BLOCK_HEADER];
+    while (at + BLOCK_HEADER <= fileSize) {
+        if (seek64(file, at) != 0 || std::fread(head, 1, BLOCK_HEADER, file) != BLOCK_HEADER ||
+            (get<uint32_t>(head) != BLOCK_MAGIC && get<uint32_t>(head) != BLOCK_MAGIC_V1)) {
+            break;
+        }
+        uint32_t packed_len = get<uint32_t>(head + 8);
+        // Недописанный последний блок отбрасывается
+        if (at + BLOCK_HEADER + packed_len > fileSize) break;
+        block_index.push_back({at, get<int64_t>(head + 16), get<int64_t>(head + 24), get<uint32_t>(head + 12),
+                               TAGS_UNKNOWN});
+        at += BLOCK_HEADER + packed_len;
+    }
+}
+
+bool RecordingReader::readBlock(size_t i, std::vector<RecordedChange>& out) {
+    out.clear();
+    if (!file || i >= block_index.size()) return false;
+    uint8_t head[BLOCK_HEADER];
+    if (seek64(file, block_index[i].offset) != 0 || std::fread(head, 1, BLOCK_HEADER, file) != BLOCK_HEADER) {
+        return false;
+    }
+    uint32_t magic = get<uint32_t>(head);
+    if (magic != BLOCK_MAGIC && magic != BLOCK_MAGIC_V1) return false;
+    bool v2 = magic == BLOCK_MAGIC;
+    uint32_t raw_len = get<uint32_t>(head + 4);
+    uint32_t packed_len = get<uint32_t>(head + 8);
+    uint32_t records = get<uint32_t>(head + 12);
+    raw.resize(raw_len);
+    if (packed_len == raw_len) {
+        if (raw_len && std::fread(raw.data(), 1, raw_len, file) != raw_len) return false;
+    } else {
+        packed.resize(packed_len);
+        if (std::fread(packed.data(), 1, packed_len, file) != packed_len ||
+            !lzDecompress(packed.data(), packed_len, raw.data(), raw_len)) {
+            return false;
+        }
+    }
+
+    out.reserve(records);
+    const uint8_t* p = raw.data();
+    const uint8_t* end = p + raw.size();
+    uint32_t prev_slot = 0;
+    int64_t prev_received = 0;
+    int64_t prev_source = 0;
+    int64_t prev_server = 0;
+    int64_t prev_cycle_gap = 0;
+    ++block_serial;
+    while (p < end) {
+        RecordedChange c;
+        uint8_t flags = *p++;
+        uint64_t v;
+        c.kind = (RecordedChange::Kind)(v2 ? (flags >> 4) & 1 : flags >> 4);
+        if (!getVarint(p, end, v)) return false;
+        c.slot = (uint32_t)((int64_t)prev_slot + unzigzag(v));
+        if (!v2) {
+            if (!getVarint(p, end, v)) return false;
+            c.received = prev_received + unzigzag(v);
+        } else if (flags & NEW_CYCLE) {
+            if (!getVarint(p, end, v)) return false;
+            int64_t gap = prev_cycle_gap + unzigzag(v);
+            c.received = prev_received + gap;
+            if (!out.empty()) prev_cycle_gap = gap;
+        } else {
+            if (out.empty()) return false;
+            c.received = prev_received;
+        }
+        c.sourceTime = c.serverTime = 0;
+        c.status = UA_STATUSCODE_GOOD;
+        if (flags & HAS_SOURCE) {
+            if (!getVarint(p, end, v)) return false;
+            c.sourceTime = (prev_source ? prev_source : c.received) + unzigzag(v);
+            prev_source = c.sourceTime;
+        }
+        if (flags & HAS_SERVER) {
+            if (!getVarint(p, end, v)) return false;
+            c.serverTime = (prev_server ? prev_server : c.received) + unzigzag(v);
+            prev_server = c.serverTime;
+        }
+        if (flags & HAS_STATUS) {
+            if (!getVarint(p, end, v)) return false;
+            c.status = (UA_StatusCode)v;
+        }
+        if (flags & IS_DOUBLE) {
+            uint64_t bits;
+            if (v2 && (flags & XOR_DOUBLE)) {
+                // Слот уже встречался в блоке с Double — иначе файл повреждён
+                if (c.slot >= slot_block.size() || slot_block[c.slot] != block_serial || !getXor(p, end, bits)) {
+                    return false;
+                }
+                bits ^= slot_double[c.slot];
+            } else {
+                if (end - p < 8) return false;
+                bits = get<uint64_t>(p);
+                p += 8;
+            }
+            if (v2) {
+                // Номер слота берётся из файла: явно испорченный не раздувает таблицу
+                if (c.slot >= MAX_SLOTS) return false;
+                if (c.slot >= slot_block.size()) {
+                    slot_block.resize(c.slot + 1, 0);
+                    slot_double.resize(c.slot + 1, 0);
+                }
+                slot_double[c.slot] = bits;
+                slot_block[c.slot] = block_serial;
+            }
+            char raw_double[8];
+            std::memcpy(raw_double, &bits, 8);
+            c.bytes.assign(1, (char)DOUBLE_TYPE_ID);
+            c.bytes.append(raw_double, 8);
+        } else {
+            if (!getVarint(p, end, v) || v > (uint64_t)(end - p)) return false;
+            c.bytes.assign((const char*)p, (size_t)v);
+            p += v;
+        }
+        prev_slot = c.slot;
+        prev_received = c.received;
+        out.push_back(std::move(c));
+    }
+    return out.size() == records;
+}
+
+bool RecordingReader::toDataValue(const RecordedChange& change, UA_DataValue& out) {
+    UA_DataValue_init(&out);
+    if (change.kind != RecordedChange::VALUE) return false;
+    out.status = change.status;
+    out.hasStatus = change.status != UA_STATUSCODE_GOOD;
+    out.sourceTimestamp = change.sourceTime;
+    out.hasSourceTimestamp = change.sourceTime != 0;
+    out.serverTimestamp = change.serverTime;
+    out.hasServerTimestamp = change.serverTime != 0;
+    if (change.bytes.empty()) return true;
+    UA_ByteString in;
+    in.length = change.bytes.size();
+    in.data = (UA_Byte*)const_cast<char*>(change.bytes.data());
+    if (UA_decodeBinary(&in, &out.value, &UA_TYPES[UA_TYPES_VARIANT], nullptr) != UA_STATUSCODE_GOOD) {
+        return false;
+    }
+    out.hasValue = true;
+    return true;
+}
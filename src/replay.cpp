@@ -0,0 +1,254 @@
+#include "../include/replay.hpp"
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+// Тело записи TAG: имя, '\0', NodeId
+RecordedTag parseTagRecord(const RecordedChange& change) {
+    size_t zero = change.bytes.find('\0');
+    RecordedTag t;
+    t.name = change.bytes.substr(0, zero);
+    t.nodeId = zero == std::string::npos ? std::string() : change.bytes.substr(zero + 1);
+    return t;
+}
+
+} // namespace
+
+SessionPlayer::SessionPlayer(OPCUAClient& store)
+    : store(store), block_index(0), next_record(0), at_end(true), play_speed(1.0), is_paused(false),
+      base_time(0), base_wall(Clock::now()), last_applied(0), first_time(0), last_time(0),
+      records_applied(0), running(false) {}
+
+SessionPlayer::~SessionPlayer() {
+    stop();
+}
+
+bool SessionPlayer::open(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!reader.open(path)) return false;
+
+    tag_table = reader.tags();
+    store.clearTags();
+    for (const auto& t : tag_table) store.addTag(t.name, t.nodeId);
+
+    const auto& blocks = reader.blocks();
+    first_time = blocks.empty() ? 0 : blocks.front().first;
+    last_time = blocks.empty() ? 0 : blocks.back().last;
+    records.clear();
+    next_record = 0;
+    block_tags.assign(blocks.size(), {});
+    block_tags_read.assign(blocks.size(), 0);
+    at_end = !loadBlockLocked(0);
+    last_applied = first_time;
+    rebaseLocked(first_time);
+    return true;
+}
+
+bool SessionPlayer::loadBlockLocked(size_t block) {
+    if (block >= reader.blocks().size() || !reader.readBlock(block, records)) return false;
+    block_index = block;
+    next_record = 0;
+    return true;
+}
+
+UA_DateTime SessionPlayer::positionLocked(Clock::time_point now) const {
+    if (is_paused) return base_time;
+    if (play_speed <= 0) return last_applied;
+    double ticks = std::chrono::duration<double>(now - base_wall).count() * UA_DATETIME_SEC * play_speed;
+    return std::min(last_time, base_time + (UA_DateTime)ticks);
+}
+
+void SessionPlayer::rebaseLocked(UA_DateTime at) {
+    base_time = at;
+    base_wall = Clock::now();
+}
+
+UA_DateTime SessionPlayer::position() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return positionLocked(Clock::now());
+}
+
+bool SessionPlayer::finished() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return at_end;
+}
+
+void SessionPlayer::setSpeed(double speed) {
+    std::lock_guard<std::mutex> lock(mutex);
+    rebaseLocked(positionLocked(Clock::now()));
+    play_speed = std::max(0.0, speed);
+}
+
+double SessionPlayer::speed() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return play_speed;
+}
+
+void SessionPlayer::setPaused(bool paused) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (paused == is_paused) return;
+    UA_DateTime at = positionLocked(Clock::now());
+    is_paused = paused;
+    rebaseLocked(at);
+}
+
+bool SessionPlayer::paused() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return is_paused;
+}
+
+void SessionPlayer::seek(UA_DateTime time) {
+    std::lock_guard<std::mutex> lock(mutex);
+    time = std::max(first_time, std::min(last_time, time));
+    // Назад: приёмники уже видели более поздние метки, а ряды и свёртки рассчитаны на
+    // возрастающее время — их состояние сбрасывается до повторного воспроизведения
+    if (time < last_applied) store.resetSinks();
+    // Первый блок, который заканчивается не раньше нужного времени
+    const auto& blocks = reader.blocks();
+    auto it = std::lower_bound(blocks.begin(), blocks.end(), time,
+                               [](const RecordingReader::Block& b, UA_DateTime t) { return b.last < t; });
+    size_t target = (size_t)(it - blocks.begin());
+    // Набор тегов на момент перемотки: заголовок и все записи TAG раньше этой точки,
+    // в том числе из пропущенных блоков — иначе значения попали бы в слоты с чужими именами
+    std::vector<RecordedTag> table = reader.tags();
+    auto apply = [&table](const RecordedChange& c) {
+        if (c.slot >= table.size()) table.resize(c.slot + 1);
+        table[c.slot] = parseTagRecord(c);
+    };
+    for (size_t b = 0; b < target && b < blocks.size(); ++b) {
+        for (const auto& c : blockTagsLocked(b)) apply(c);
+    }
+    if (it == blocks.end() || !loadBlockLocked(target)) {
+        setTagTableLocked(table);
+        at_end = true;
+        return;
+    }
+    auto rec = std::lower_bound(records.begin(), records.end(), time,
+                                [](const RecordedChange& c, UA_DateTime t) { return c.received < t; });
+    for (auto r = records.begin(); r != rec; ++r) {
+        if (r->kind == RecordedChange::TAG) apply(*r);
+    }
+    setTagTableLocked(table);
+    next_record = (size_t)(rec - records.begin());
+    at_end = false;
+    last_applied = time;
+    rebaseLocked(time);
+}
+
+void SessionPlayer::seekBy(int64_t delta) {
+    seek(position() + delta);
+}
+
+const std::vector<RecordedChange>& SessionPlayer::blockTagsLocked(size_t block) {
+    // Блок без записей TAG по индексу не читается; неизвестно (старый или восстановленный индекс) — читается
+    if (!block_tags_read[block] && reader.blocks()[block].tagRecords != 0) {
+        std::vector<RecordedChange> all;
+        if (reader.readBlock(block, all)) {
+            for (auto& c : all) {
+                if (c.kind == RecordedChange::TAG) block_tags[block].push_back(std::move(c));
+            }
+        }
+        block_tags_read[block] = 1;
+    }
+    return block_tags[block];
+}
+
+void SessionPlayer::setTagTableLocked(const std::vector<RecordedTag>& table) {
+    size_t common = 0;
+    while (common < table.size() && common < tag_table.size() && table[common].name == tag_table[common].name &&
+           table[common].nodeId == tag_table[common].nodeId) {
+        ++common;
+    }
+    if (common == table.size() && common == tag_table.size()) return;
+    bool extends = common == tag_table.size() && store.tagCount() == tag_table.size();
+    tag_table = table;
+    if (extends) {
+        // Только новые слоты: значения уже воспроизведённых тегов остаются
+        for (size_t s = common; s < tag_table.size(); ++s) store.addTag(tag_table[s].name, tag_table[s].nodeId);
+    } else {
+        store.clearTags();
+        for (const auto& t : tag_table) store.addTag(t.name, t.nodeId);
+    }
+}
+
+void SessionPlayer::addTagLocked(uint32_t slot, const std::string& name, const std::string& nodeId) {
+    if (slot < tag_table.size() && tag_table[slot].name == name) return;
+    bool replaced = slot < store.tagCount();
+    if (slot >= tag_table.size()) tag_table.resize(slot + 1);
+    tag_table[slot] = {name, nodeId};
+    if (replaced) {
+        // В записанной сессии набор тегов сменился: слоты в хранилище не переименовываются
+        store.clearTags();
+        for (const auto& t : tag_table) store.addTag(t.name, t.nodeId);
+    } else {
+        for (size_t s = store.tagCount(); s <= slot; ++s) store.addTag(tag_table[s].name, tag_table[s].nodeId);
+    }
+}
+
+void SessionPlayer::applyLocked(const RecordedChange& change) {
+    if (change.kind == RecordedChange::TAG) {
+        RecordedTag t = parseTagRecord(change);
+        addTagLocked(change.slot, t.name, t.nodeId);
+        return;
+    }
+    UA_DataValue dv;
+    if (RecordingReader::toDataValue(change, dv)) store.ingest(change.slot, dv);
+    UA_DataValue_clear(&dv);
+}
+
+size_t SessionPlayer::step(size_t maxRecords) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (is_paused || at_end) return 0;
+    UA_DateTime target = play_speed > 0 ? positionLocked(Clock::now()) : std::numeric_limits<UA_DateTime>::max();
+
+    size_t n = 0;
+    bool unflushed = false;
+    while (n < maxRecords) {
+        if (next_record >= records.size()) {
+            if (!loadBlockLocked(block_index + 1)) {
+                at_end = true;
+                break;
+            }
+            continue;
+        }
+        const RecordedChange& c = records[next_record];
+        if (c.received > target) break;
+        // Записи одного цикла опроса доходят до приёмников одним пакетом, как при записи
+        if (unflushed && c.received != last_applied) {
+            store.flushSinks();
+            unflushed = false;
+        }
+        applyLocked(c);
+        last_applied = c.received;
+        ++next_record;
+        ++n;
+        unflushed = true;
+    }
+    if (unflushed) store.flushSinks();
+    records_applied.fetch_add(n, std::memory_order_relaxed);
+    return n;
+}
+
+void SessionPlayer::start() {
+    if (running.exchange(true)) return;
+    {
+        // Время между open и start не считается временем воспроизведения
+        std::lock_guard<std::mutex> lock(mutex);
+        rebaseLocked(positionLocked(base_wall));
+    }
+    worker = std::thread([this] {
+        const size_t BATCH = 4096;
+        while (running.load()) {
+            size_t n = step(BATCH);
+            // Без пауз — пока есть записи; по времени — шаг 5 мс, если пачка не упёрлась в предел
+            bool more = n == BATCH || (n > 0 && speed() <= 0);
+            if (!more) std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+    });
+}
+
+void SessionPlayer::stop() {
+    if (!running.exchange(false)) return;
+    if (worker.joinable()) worker.join();
+}
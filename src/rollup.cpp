@@ -0,0 +1,127 @@
+#include "../include/rollup.hpp"
+#include <algorithm>
+
+namespace {
+
+const int64_t TIER_MS[RollupSeries::TIERS] = {1000, 60 * 1000, 60 * 60 * 1000};
+
+// Начало интервала ширины width, содержащего t (и для t < 0)
+int64_t floorTo(int64_t t, int64_t width) {
+    int64_t q = t / width;
+    if (t % width < 0) --q;
+    return q * width;
+}
+
+} // namespace
+
+void RollupBucket::add(double v) {
+    if (v < min) min = v;
+    if (v > max) max = v;
+    sum += v;
+    last = v;
+    ++count;
+}
+
+void RollupBucket::merge(const RollupBucket& b) {
+    if (!b.count) return;
+    if (!count) {
+        *this = b;
+        return;
+    }
+    min = std::min(min, b.min);
+    max = std::max(max, b.max);
+    sum += b.sum;
+    count += b.count;
+    last = b.last;
+}
+
+int64_t RollupSeries::tierMs(size_t tier) {
+    return TIER_MS[tier];
+}
+
+RollupSeries::RollupSeries(size_t secondBuckets, size_t minuteBuckets, size_t hourBuckets) {
+    size_t capacity[TIERS] = {secondBuckets, minuteBuckets, hourBuckets};
+    for (size_t i = 0; i < TIERS; ++i) tiers[i] = {TIER_MS[i], std::max<size_t>(capacity[i], 1), {}, 0};
+}
+
+size_t RollupSeries::newest(const Tier& t) {
+    return t.buckets.size() < t.capacity ? t.buckets.size() - 1 : (t.head + t.capacity - 1) % t.capacity;
+}
+
+size_t RollupSeries::add(int64_t timeMs, double value) {
+    size_t added = 0;
+    for (Tier& t : tiers) {
+        int64_t start = floorTo(timeMs, t.width);
+        if (!t.buckets.empty()) {
+            RollupBucket& last = t.buckets[newest(t)];
+            if (start <= last.start) {
+                last.add(value);
+                continue;
+            }
+        }
+        RollupBucket b{start, value, value, value, value, 1};
+        if (t.buckets.size() < t.capacity) {
+            // Кольцо растёт по мере надобности, но не дальше capacity
+            if (t.buckets.size() == t.buckets.capacity()) {
+                t.buckets.reserve(std::min(t.capacity, std::max<size_t>(16, t.buckets.size() * 2)));
+            }
+            t.buckets.push_back(b);
+            ++added;
+        } else {
+            t.buckets[t.head] = b;
+            t.head = (t.head + 1) % t.capacity;
+        }
+    }
+    return added;
+}
+
+void RollupSeries::clear() {
+    for (Tier& t : tiers) {
+        t.buckets.clear();
+        t.head = 0;
+    }
+}
+
+size_t RollupSeries::bucketCount() const {
+    size_t n = 0;
+    for (const Tier& t : tiers) n += t.buckets.size();
+    return n;
+}
+
+bool RollupSeries::oldest(size_t tier, int64_t& start) const {
+    const Tier& t = tiers[tier];
+    if (t.buckets.empty()) return false;
+    start = t.buckets[t.buckets.size() < t.capacity ? 0 : t.head].start;
+    return true;
+}
+
+void RollupSeries::copy(size_t tier, int64_t fromMs, int64_t toMs, std::vector<RollupBucket>& out) const {
+    out.clear();
+    const Tier& t = tiers[tier];
+    size_t n = t.buckets.size();
+    size_t first = n < t.capacity ? 0 : t.head;
+    // От новых к старым, пока интервалы пересекают диапазон: просмотр — O(результата)
+    for (size_t i = n; i-- > 0;) {
+        const RollupBucket& b = t.buckets[(first + i) % n];
+        if (b.start + t.width <= fromMs) break;
+        if (b.start < toMs) out.push_back(b);
+    }
+    std::reverse(out.begin(), out.end());
+}
+
+bool RollupSeries::lastBefore(int64_t ms, double& value) const {
+    for (const Tier& t : tiers) {
+        size_t n = t.buckets.size();
+        size_t first = n < t.capacity ? 0 : t.head;
+        if (n == 0 || t.buckets[first].start >= ms) continue;
+        // После самого старого интервала ступень полна: ближайший к ms в ней и есть последний
+        for (size_t i = n; i-- > 0;) {
+            const RollupBucket& b = t.buckets[(first + i) % n];
+            if (b.start < ms) {
+                value = b.last;
+                return true;
+            }
+        }
+    }
+    return false;
+}
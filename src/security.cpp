@@ -0,0 +1,143 @@
+#include "../include/security.hpp"
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <open62541/client_config_default.h>
+#include <open62541/plugin/create_certificate.h>
+#include <open62541/plugin/log_stdout.h>
+
+namespace {
+
+const char* POLICY_PREFIX = "http://opcfoundation.org/UA/SecurityPolicy#";
+
+bool fail(std::string* error, const std::string& message) {
+    if (error) *error = message;
+    return false;
+}
+
+} // namespace
+
+std::string securityPolicyUri(const std::string& name) {
+    static const char* known[] = {"None", "Basic128Rsa15", "Basic256", "Basic256Sha256",
+                                  "Aes128_Sha256_RsaOaep", "Aes256_Sha256_RsaPss"};
+    for (const char* policy : known) {
+        if (name == policy || name == POLICY_PREFIX + std::string(policy)) return POLICY_PREFIX + std::string(policy);
+    }
+    return "";
+}
+
+bool parseSecurityMode(const std::string& text, UA_MessageSecurityMode& out) {
+    if (text == "none") out = UA_MESSAGESECURITYMODE_NONE;
+    else if (text == "sign") out = UA_MESSAGESECURITYMODE_SIGN;
+    else if (text == "signencrypt") out = UA_MESSAGESECURITYMODE_SIGNANDENCRYPT;
+    else return false;
+    return true;
+}
+
+void parseTrustArgument(const std::string& text, SecurityConfig& out) {
+    out.trust.clear();
+    out.acceptAnyServer = false;
+    std::stringstream in(text);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        if (item == "any") out.acceptAnyServer = true;
+        else if (!item.empty()) out.trust.push_back(item);
+    }
+}
+
+bool loadByteString(const std::string& path, UA_ByteString& out) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+    std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if (data.empty()) return false;
+    if (UA_ByteString_allocBuffer(&out, data.size()) != UA_STATUSCODE_GOOD) return false;
+    std::memcpy(out.data, data.data(), data.size());
+    return true;
+}
+
+bool createSelfSignedCertificate(const std::string& applicationUri, UA_ByteString& certificate,
+                                 UA_ByteString& privateKey, uint16_t keyBits) {
+#ifdef UA_ENABLE_ENCRYPTION
+    UA_String subject[2] = {UA_STRING_STATIC("C=DE"), UA_STRING_STATIC("CN=opcua-monitor")};
+    std::string uri = "URI:" + applicationUri;
+    UA_String san[2] = {UA_STRING((char*)uri.c_str()), UA_STRING_STATIC("DNS:localhost")};
+    UA_KeyValueMap params = UA_KEYVALUEMAP_NULL;
+    UA_UInt16 bits = keyBits;
+    UA_KeyValueMap_setScalar(&params, UA_QUALIFIEDNAME(0, (char*)"key-size-bits"), &bits, &UA_TYPES[UA_TYPES_UINT16]);
+    UA_StatusCode rc = UA_CreateCertificate(UA_Log_Stdout, subject, 2, san, 2, UA_CERTIFICATEFORMAT_DER, &params,
+                                            &privateKey, &certificate);
+    UA_KeyValueMap_clear(&params);
+    return rc == UA_STATUSCODE_GOOD;
+#else
+    (void)applicationUri;
+    (void)certificate;
+    (void)privateKey;
+    (void)keyBits;
+    return false;
+#endif
+}
+
+bool applySecurity(UA_ClientConfig* config, const SecurityConfig& security, std::string* error) {
+    std::string uri = securityPolicyUri(security.policy);
+    if (uri.empty()) return fail(error, "unknown security policy " + security.policy);
+    bool none = uri == POLICY_PREFIX + std::string("None");
+    UA_MessageSecurityMode mode = none ? UA_MESSAGESECURITYMODE_NONE : UA_MESSAGESECURITYMODE_SIGNANDENCRYPT;
+    if (!security.mode.empty() && !parseSecurityMode(security.mode, mode)) {
+        return fail(error, "unknown security mode " + security.mode);
+    }
+    if (none != (mode == UA_MESSAGESECURITYMODE_NONE)) {
+        return fail(error, "security mode none goes only with policy None");
+    }
+
+    if (!none) {
+#ifdef UA_ENABLE_ENCRYPTION
+        if (security.certificate.empty() != security.privateKey.empty()) {
+            return fail(error, "certificate and private key are given together");
+        }
+        if (security.trust.empty() && !security.acceptAnyServer) {
+            return fail(error, "no trusted server certificates (use --trust any to accept any)");
+        }
+        UA_ByteString certificate = UA_BYTESTRING_NULL;
+        UA_ByteString key = UA_BYTESTRING_NULL;
+        std::vector<UA_ByteString> trust(security.trust.size(), UA_BYTESTRING_NULL);
+        std::string message;
+        if (security.certificate.empty()) {
+            // URI в сертификате обязан совпадать с applicationUri клиента, иначе сервер откажет
+            std::string app(config->clientDescription.applicationUri.data,
+                            config->clientDescription.applicationUri.data + config->clientDescription.applicationUri.length);
+            if (!createSelfSignedCertificate(app, certificate, key)) message = "cannot create client certificate";
+        } else if (!loadByteString(security.certificate, certificate)) {
+            message = "cannot read " + security.certificate;
+        } else if (!loadByteString(security.privateKey, key)) {
+            message = "cannot read " + security.privateKey;
+        }
+        for (size_t i = 0; i < trust.size() && message.empty(); ++i) {
+            if (!loadByteString(security.trust[i], trust[i])) message = "cannot read " + security.trust[i];
+        }
+        if (message.empty()) {
+            // Конфигурация копирует сертификаты, свои буферы освобождаем ниже
+            UA_StatusCode rc = UA_ClientConfig_setDefaultEncryption(config, certificate, key, trust.data(),
+                                                                    trust.size(), nullptr, 0);
+            if (rc != UA_STATUSCODE_GOOD) message = std::string("encryption setup failed: ") + UA_StatusCode_name(rc);
+        }
+        UA_ByteString_clear(&certificate);
+        UA_ByteString_clear(&key);
+        for (auto& t : trust) UA_ByteString_clear(&t);
+        if (!message.empty()) return fail(error, message);
+        if (security.acceptAnyServer) {
+            config->certificateVerification.clear(&config->certificateVerification);
+            UA_CertificateVerification_AcceptAll(&config->certificateVerification);
+        }
+#else
+        return fail(error, "open62541 is built without encryption");
+#endif
+    }
+
+    UA_String_clear(&config->securityPolicyUri);
+    config->securityPolicyUri = UA_STRING_ALLOC(uri.c_str());
+    config->securityMode = mode;
+    if (security.channelLifetimeMs) config->secureChannelLifeTime = security.channelLifetimeMs;
+    if (security.sessionTimeoutMs) config->requestedSessionTimeout = security.sessionTimeoutMs;
+    return true;
+}
@@ -0,0 +1,246 @@
+#include "../include/shm_table.hpp"
+#include <algorithm>
+#include <cstring>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+template <typename T>
+T* column(char* base, uint64_t offset) { return reinterpret_cast<T*>(base + offset); }
+
+template <typename T>
+const T* column(const char* base, uint64_t offset) { return reinterpret_cast<const T*>(base + offset); }
+
+const ShmLayout::Header* header(const char* base) {
+    return reinterpret_cast<const ShmLayout::Header*>(base);
+}
+
+// Строки имён тоже пишутся под seqlock, поэтому копируются побайтно без strlen
+std::string readName(const char* cell) {
+    size_t len = 0;
+    while (len < ShmLayout::NAME_SIZE && cell[len]) ++len;
+    return std::string(cell, len);
+}
+
+void writeName(char* cell, const std::string& s) {
+    size_t len = std::min(s.size(), ShmLayout::NAME_SIZE - 1);
+    std::memcpy(cell, s.data(), len);
+    cell[len] = '\0';
+}
+
+// Совпадает ли ячейка со строкой с учётом обрезки до NAME_SIZE - 1
+bool sameName(const char* cell, const std::string& s) {
+    size_t len = std::min(s.size(), ShmLayout::NAME_SIZE - 1);
+    return std::memcmp(cell, s.data(), len) == 0 && cell[len] == '\0';
+}
+
+} // namespace
+
+void ShmLayout::describe(uint32_t capacity, Header& h) {
+    h.version = VERSION;
+    h.capacity = capacity;
+    h.reserved = 0;
+    uint64_t off = align(sizeof(Header));
+    h.valuesOffset = off;      off = align(off + capacity * sizeof(double));
+    h.sourceTimeOffset = off;  off = align(off + capacity * sizeof(int64_t));
+    h.statusOffset = off;      off = align(off + capacity * sizeof(uint32_t));
+    h.seqOffset = off;         off = align(off + capacity * sizeof(std::atomic<uint32_t>));
+    h.namesOffset = off;       off = align(off + capacity * NAME_SIZE);
+    h.nodeIdsOffset = off;     off = align(off + capacity * NAME_SIZE);
+    h.totalSize = off;
+}
+
+// ---------------- ShmPublisher ----------------
+
+ShmPublisher::ShmPublisher() : base(nullptr), mapped(0) {}
+
+ShmPublisher::~ShmPublisher() {
+#ifndef _WIN32
+    if (base) {
+        munmap(base, mapped);
+        shm_unlink(shm_name.c_str());
+    }
+#endif
+}
+
+bool ShmPublisher::create(const std::string& name, uint32_t capacity) {
+#ifndef _WIN32
+    ShmLayout::Header h;
+    ShmLayout::describe(capacity, h);
+    int fd = shm_open(name.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0644);
+    if (fd < 0) return false;
+    if (ftruncate(fd, (off_t)h.totalSize) != 0) {
+        close(fd);
+        shm_unlink(name.c_str());
+        return false;
+    }
+    void* p = mmap(nullptr, h.totalSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        shm_unlink(name.c_str());
+        return false;
+    }
+    base = static_cast<char*>(p);
+    mapped = h.totalSize;
+    shm_name = name;
+
+    // Сегмент после ftruncate обнулён: count и версии слотов начинаются с нуля
+    auto* hdr = reinterpret_cast<ShmLayout::Header*>(base);
+    ShmLayout::describe(capacity, *hdr);
+    // magic пишется последним: читатель не увидит недостроенный заголовок
+    std::atomic_thread_fence(std::memory_order_release);
+    hdr->magic = ShmLayout::MAGIC;
+    return true;
+#else
+    (void)name; (void)capacity;
+    return false;
+#endif
+}
+
+void ShmPublisher::onValueChanged(size_t slot, const OPCUAClient::TagData& tag, const UA_DataValue&) {
+    if (!base) return;
+    auto* hdr = reinterpret_cast<ShmLayout::Header*>(base);
+    if (slot >= hdr->capacity) return;
+
+    auto& seq = column<std::atomic<uint32_t>>(base, hdr->seqOffset)[slot];
+    uint32_t s = seq.load(std::memory_order_relaxed);
+    seq.store(s + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    column<double>(base, hdr->valuesOffset)[slot] = tag.value;
+    column<int64_t>(base, hdr->sourceTimeOffset)[slot] = tag.sourceTime;
+    column<uint32_t>(base, hdr->statusOffset)[slot] = tag.status;
+    // Имена переписываются, когда слот занял другой тег (замена набора тегов)
+    char* name_cell = base + hdr->namesOffset + slot * ShmLayout::NAME_SIZE;
+    char* node_cell = base + hdr->nodeIdsOffset + slot * ShmLayout::NAME_SIZE;
+    if (!sameName(name_cell, tag.name)) writeName(name_cell, tag.name);
+    if (!sameName(node_cell, tag.nodeId)) writeName(node_cell, tag.nodeId);
+
+    seq.store(s + 2, std::memory_order_release);
+
+    uint32_t count = hdr->count.load(std::memory_order_relaxed);
+    if (slot + 1 > count) hdr->count.store((uint32_t)slot + 1, std::memory_order_release);
+}
+
+void ShmPublisher::truncate(uint32_t count) {
+    if (!base) return;
+    auto* hdr = reinterpret_cast<ShmLayout::Header*>(base);
+    uint32_t old = hdr->count.load(std::memory_order_relaxed);
+    if (count >= old) return;
+    hdr->count.store(count, std::memory_order_release);
+    // Освобождённые слоты остаются без имени и значения, пока их не займёт новый тег
+    auto* seqs = column<std::atomic<uint32_t>>(base, hdr->seqOffset);
+    for (uint32_t slot = count; slot < old; ++slot) {
+        uint32_t s = seqs[slot].load(std::memory_order_relaxed);
+        if (s == 0) continue;
+        seqs[slot].store(s + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        column<double>(base, hdr->valuesOffset)[slot] = 0.0;
+        column<int64_t>(base, hdr->sourceTimeOffset)[slot] = 0;
+        column<uint32_t>(base, hdr->statusOffset)[slot] = UA_STATUSCODE_BADWAITINGFORINITIALDATA;
+        writeName(base + hdr->namesOffset + slot * ShmLayout::NAME_SIZE, "");
+        writeName(base + hdr->nodeIdsOffset + slot * ShmLayout::NAME_SIZE, "");
+        seqs[slot].store(s + 2, std::memory_order_release);
+    }
+}
+
+// ---------------- ShmTagReader ----------------
+
+ShmTagReader::ShmTagReader() : base(nullptr), mapped(0) {}
+
+ShmTagReader::~ShmTagReader() {
+#ifndef _WIN32
+    if (base) munmap(const_cast<char*>(base), mapped);
+#endif
+}
+
+bool ShmTagReader::open(const std::string& name) {
+#ifndef _WIN32
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(ShmLayout::Header)) {
+        close(fd);
+        return false;
+    }
+    void* p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) return false;
+
+    const char* b = static_cast<const char*>(p);
+    const ShmLayout::Header* hdr = header(b);
+    bool valid = hdr->magic == ShmLayout::MAGIC && hdr->version == ShmLayout::VERSION &&
+                 hdr->totalSize <= (uint64_t)st.st_size;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (!valid) {
+        munmap(p, (size_t)st.st_size);
+        return false;
+    }
+    base = b;
+    mapped = (size_t)st.st_size;
+    return true;
+#else
+    (void)name;
+    return false;
+#endif
+}
+
+uint32_t ShmTagReader::size() const {
+    if (!base) return 0;
+    return header(base)->count.load(std::memory_order_acquire);
+}
+
+std::string ShmTagReader::name(uint32_t slot) const {
+    if (slot >= size()) return "";
+    return readCell(slot, header(base)->namesOffset);
+}
+
+std::string ShmTagReader::nodeId(uint32_t slot) const {
+    if (slot >= size()) return "";
+    return readCell(slot, header(base)->nodeIdsOffset);
+}
+
+std::string ShmTagReader::readCell(uint32_t slot, uint64_t offset) const {
+    const ShmLayout::Header* hdr = header(base);
+    const auto& seq = column<std::atomic<uint32_t>>(base, hdr->seqOffset)[slot];
+    char cell[ShmLayout::NAME_SIZE];
+    // Имя меняется под тем же seqlock, что и значение: копия без разрыва или повтор
+    for (;;) {
+        uint32_t s1 = seq.load(std::memory_order_acquire);
+        if (s1 == 0) return "";
+        if (s1 & 1) continue;
+        std::memcpy(cell, base + offset + slot * ShmLayout::NAME_SIZE, sizeof(cell));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (seq.load(std::memory_order_relaxed) == s1) return readName(cell);
+    }
+}
+
+bool ShmTagReader::read(uint32_t slot, Sample& out) const {
+    if (!base) return false;
+    const ShmLayout::Header* hdr = header(base);
+    if (slot >= hdr->capacity || slot >= size()) return false;
+    const auto& seq = column<std::atomic<uint32_t>>(base, hdr->seqOffset)[slot];
+
+    for (;;) {
+        uint32_t s1 = seq.load(std::memory_order_acquire);
+        if (s1 == 0) return false;
+        if (s1 & 1) continue;  // писатель внутри записи — запись короткая, просто крутимся
+
+        out.value = column<double>(base, hdr->valuesOffset)[slot];
+        out.sourceTime = column<int64_t>(base, hdr->sourceTimeOffset)[slot];
+        out.status = column<uint32_t>(base, hdr->statusOffset)[slot];
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint32_t s2 = seq.load(std::memory_order_relaxed);
+        if (s1 == s2) {
+            out.version = s1 / 2;
+            return true;
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,149 @@
+#include "../include/spectrum.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const double PI = 3.14159265358979323846;
+
+size_t floorPowerOfTwo(size_t n) {
+    size_t p = 1;
+    while (p * 2 <= n) p *= 2;
+    return p;
+}
+
+} // namespace
+
+FftPlan::FftPlan(size_t n)
+    : n(std::max<size_t>(floorPowerOfTwo(n), 4)), half(this->n / 2), bitrev(half), work_re(half), work_im(half) {
+    size_t bits = 0;
+    while (((size_t)1 << bits) < half) ++bits;
+    for (size_t i = 0; i < half; ++i) {
+        size_t r = 0;
+        for (size_t b = 0; b < bits; ++b) r |= ((i >> b) & 1) << (bits - 1 - b);
+        bitrev[i] = (uint32_t)r;
+    }
+    for (size_t len = 2; len <= half; len *= 2) {
+        for (size_t j = 0; j < len / 2; ++j) {
+            stage_re.push_back(std::cos(-2 * PI * (double)j / (double)len));
+            stage_im.push_back(std::sin(-2 * PI * (double)j / (double)len));
+        }
+    }
+    for (size_t k = 0; k <= half; ++k) {
+        split_re.push_back(std::cos(-2 * PI * (double)k / (double)this->n));
+        split_im.push_back(std::sin(-2 * PI * (double)k / (double)this->n));
+    }
+}
+
+void FftPlan::forward(const double* in, double* re_out, double* im_out) {
+    double* re = work_re.data();
+    double* im = work_im.data();
+    // z[k] = x[2k] + i·x[2k+1], сразу в бит-реверсном порядке
+    for (size_t k = 0; k < half; ++k) {
+        re[bitrev[k]] = in[2 * k];
+        im[bitrev[k]] = in[2 * k + 1];
+    }
+    const double* wr = stage_re.data();
+    const double* wi = stage_im.data();
+    for (size_t len = 2; len <= half; len *= 2) {
+        size_t h = len / 2;
+        for (size_t start = 0; start < half; start += len) {
+            double* ar = re + start;
+            double* ai = im + start;
+            double* br = ar + h;
+            double* bi = ai + h;
+            for (size_t j = 0; j < h; ++j) {
+                double tr = br[j] * wr[j] - bi[j] * wi[j];
+                double ti = br[j] * wi[j] + bi[j] * wr[j];
+                br[j] = ar[j] - tr;
+                bi[j] = ai[j] - ti;
+                ar[j] += tr;
+                ai[j] += ti;
+            }
+        }
+        wr += h;
+        wi += h;
+    }
+    // X[k] = E[k] + W^k·O[k]: E = (Z[k] + conj Z[half-k]) / 2, O = (Z[k] - conj Z[half-k]) / 2i
+    for (size_t k = 0; k <= half; ++k) {
+        size_t a = k % half;
+        size_t b = (half - k) % half;
+        double er = (re[a] + re[b]) * 0.5;
+        double ei = (im[a] - im[b]) * 0.5;
+        double or_ = (im[a] + im[b]) * 0.5;
+        double oi = -(re[a] - re[b]) * 0.5;
+        re_out[k] = er + or_ * split_re[k] - oi * split_im[k];
+        im_out[k] = ei + or_ * split_im[k] + oi * split_re[k];
+    }
+}
+
+SpectrumAnalyzer::SpectrumAnalyzer(size_t fftSize, double overlap)
+    : max_size(std::max<size_t>(floorPowerOfTwo(fftSize), 8)), overlap(std::min(std::max(overlap, 0.0), 0.9)),
+      window_sum(0), last_segments(0) {}
+
+void SpectrumAnalyzer::prepare(size_t n) {
+    if (plan && plan->size() == n) return;
+    plan.reset(new FftPlan(n));
+    window.resize(n);
+    window_sum = 0;
+    for (size_t i = 0; i < n; ++i) {
+        window[i] = 0.5 - 0.5 * std::cos(2 * PI * (double)i / (double)n);
+        window_sum += window[i];
+    }
+    segment.resize(n);
+    re.resize(n / 2 + 1);
+    im.resize(n / 2 + 1);
+    power.resize(n / 2 + 1);
+}
+
+bool SpectrumAnalyzer::compute(const std::vector<double>& samples, std::vector<double>& out) {
+    if (samples.size() < 8) return false;
+    size_t n = std::min(max_size, floorPowerOfTwo(samples.size()));
+    prepare(n);
+    size_t hop = std::max<size_t>(1, (size_t)((double)n * (1.0 - overlap)));
+    size_t count = 1 + (samples.size() - n) / hop;
+    std::fill(power.begin(), power.end(), 0.0);
+    for (size_t s = 0; s < count; ++s) {
+        const double* x = samples.data() + (samples.size() - n - s * hop);
+        double mean = 0;
+        for (size_t i = 0; i < n; ++i) mean += x[i];
+        mean /= (double)n;
+        for (size_t i = 0; i < n; ++i) segment[i] = (x[i] - mean) * window[i];
+        plan->forward(segment.data(), re.data(), im.data());
+        for (size_t k = 0; k < power.size(); ++k) power[k] += re[k] * re[k] + im[k] * im[k];
+    }
+    // Односторонний спектр: кроме 0 и n/2 каждый бин собирает и отрицательную частоту
+    out.resize(power.size());
+    double scale = 1.0 / window_sum;
+    for (size_t k = 0; k < power.size(); ++k) {
+        double a = std::sqrt(power[k] / (double)count) * scale;
+        out[k] = (k == 0 || k == n / 2) ? a : 2 * a;
+    }
+    last_segments = count;
+    return true;
+}
+
+int64_t resampleHold(const std::vector<int64_t>& times, const std::vector<double>& values, int64_t stepMs,
+                     size_t maxPoints, std::vector<double>& out) {
+    out.clear();
+    size_t n = std::min(times.size(), values.size());
+    if (n < 2 || maxPoints == 0) return 0;
+    if (stepMs <= 0) {
+        std::vector<int64_t> gaps;
+        gaps.reserve(n - 1);
+        for (size_t i = 1; i < n; ++i) gaps.push_back(times[i] - times[i - 1]);
+        std::nth_element(gaps.begin(), gaps.begin() + gaps.size() / 2, gaps.end());
+        stepMs = std::max<int64_t>(gaps[gaps.size() / 2], 1);
+    }
+    int64_t end = times[n - 1];
+    if (end < times[0]) return 0;
+    size_t count = (size_t)std::min<int64_t>((end - times[0]) / stepMs + 1, (int64_t)maxPoints);
+    out.resize(count);
+    size_t j = 0;
+    for (size_t k = 0; k < count; ++k) {
+        int64_t at = end - (int64_t)(count - 1 - k) * stepMs;
+        while (j + 1 < n && times[j + 1] <= at) ++j;
+        out[k] = values[j];
+    }
+    return stepMs;
+}
@@ -0,0 +1,127 @@
+#include "../include/tag_search.hpp"
+#include <algorithm>
+#include <cctype>
+
+namespace {
+
+std::string lower(const std::string& s) {
+    std::string r(s);
+    for (auto& c : r) c = (char)std::tolower((unsigned char)c);
+    return r;
+}
+
+} // namespace
+
+void TagIndex::clear() {
+    ids.clear();
+    names.clear();
+    node_ids.clear();
+    postings.clear();
+    prefixes.clear();
+    prefix_sorted = true;
+    hits.clear();
+    touched.clear();
+}
+
+void TagIndex::addTrigrams(const std::string& key, std::vector<uint32_t>& out) const {
+    for (size_t i = 0; i + 3 <= key.size(); ++i) {
+        out.push_back(((uint32_t)(unsigned char)key[i] << 16) |
+                      ((uint32_t)(unsigned char)key[i + 1] << 8) |
+                      (uint32_t)(unsigned char)key[i + 2]);
+    }
+}
+
+void TagIndex::add(uint32_t id, const std::string& name, const std::string& nodeId) {
+    uint32_t pos = (uint32_t)ids.size();
+    ids.push_back(id);
+    names.push_back(lower(name));
+    node_ids.push_back(lower(nodeId));
+
+    // Позиция попадает в список триграммы один раз, даже если она повторяется в полях
+    std::vector<uint32_t> grams;
+    addTrigrams(names.back(), grams);
+    addTrigrams(node_ids.back(), grams);
+    std::sort(grams.begin(), grams.end());
+    grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+    for (uint32_t g : grams) postings[g].push_back(pos);
+
+    prefixes.emplace_back(names.back(), pos);
+    if (!node_ids.back().empty()) prefixes.emplace_back(node_ids.back(), pos);
+    prefix_sorted = false;
+}
+
+std::vector<uint32_t> TagIndex::searchPrefix(const std::string& query, size_t limit) {
+    if (!prefix_sorted) {
+        std::sort(prefixes.begin(), prefixes.end());
+        prefix_sorted = true;
+    }
+    if (hits.size() < ids.size()) hits.resize(ids.size(), 0);
+    std::vector<uint32_t> positions;
+    auto it = std::lower_bound(prefixes.begin(), prefixes.end(), std::make_pair(query, (uint32_t)0));
+    for (; it != prefixes.end() && positions.size() < limit; ++it) {
+        if (it->first.compare(0, query.size(), query) != 0) break;
+        // Тег мог совпасть и именем, и NodeId — в счёт limit он идёт один раз
+        if (hits[it->second]++ == 0) positions.push_back(it->second);
+    }
+    for (uint32_t p : positions) hits[p] = 0;
+    std::sort(positions.begin(), positions.end());
+
+    std::vector<uint32_t> result;
+    for (uint32_t p : positions) result.push_back(ids[p]);
+    return result;
+}
+
+std::vector<uint32_t> TagIndex::search(const std::string& text, size_t limit) {
+    std::string query = lower(text);
+    if (query.empty()) {
+        std::vector<uint32_t> result(ids.begin(), ids.begin() + std::min(limit, ids.size()));
+        return result;
+    }
+    if (query.size() < 3) return searchPrefix(query, limit);
+
+    std::vector<uint32_t> grams;
+    addTrigrams(query, grams);
+    std::sort(grams.begin(), grams.end());
+    grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+
+    // Подсчёт совпавших триграмм идёт только по спискам триграмм запроса
+    if (hits.size() < ids.size()) hits.resize(ids.size(), 0);
+    for (uint32_t g : grams) {
+        auto it = postings.find(g);
+        if (it == postings.end()) continue;
+        for (uint32_t pos : it->second) {
+            if (hits[pos]++ == 0) touched.push_back(pos);
+        }
+    }
+
+    size_t need = (grams.size() + 1) / 2;
+    std::vector<std::pair<int, uint32_t>> ranked;
+    for (uint32_t pos : touched) {
+        size_t matched = hits[pos];
+        hits[pos] = 0;
+        if (matched < need) continue;
+        int score = (int)(matched * 1000 / grams.size());
+        // Вхождение целиком проверяется только у тех, где совпали все триграммы
+        if (matched == grams.size()) {
+            const std::string& name = names[pos];
+            size_t at = name.find(query);
+            if (at == 0) score += 600;
+            else if (at != std::string::npos) score += 400;
+            else if (node_ids[pos].find(query) != std::string::npos) score += 300;
+        }
+        // При равном счёте короче — ближе к запросу
+        score = score * 256 - (int)std::min<size_t>(names[pos].size(), 255);
+        ranked.emplace_back(score, pos);
+    }
+    touched.clear();
+
+    size_t n = std::min(limit, ranked.size());
+    std::partial_sort(ranked.begin(), ranked.begin() + n, ranked.end(),
+                      [](const std::pair<int, uint32_t>& a, const std::pair<int, uint32_t>& b) {
+                          return a.first != b.first ? a.first > b.first : a.second < b.second;
+                      });
+    std::vector<uint32_t> result;
+    result.reserve(n);
+    for (size_t i = 0; i < n; ++i) result.push_back(ids[ranked[i].second]);
+    return result;
+}
@@ -0,0 +1,213 @@
+#include "../include/tag_stats.hpp"
+#include <algorithm>
+#include <cmath>
+
+void RunningStats::add(double x) {
+    ++n;
+    if (n == 1) {
+        min_value = max_value = x;
+    } else {
+        min_value = std::min(min_value, x);
+        max_value = std::max(max_value, x);
+    }
+    double delta = x - mean_value;
+    mean_value += delta / (double)n;
+    m2 += delta * (x - mean_value);
+}
+
+double RunningStats::stddev() const {
+    return std::sqrt(variance());
+}
+
+SlidingWindow::SlidingWindow(size_t capacity)
+    : values(std::max<size_t>(capacity, 2)), next_seq(0), filled(0), mean_value(0.0), m2(0.0) {
+    max_wedge = {std::vector<uint64_t>(values.size()), 0, 0};
+    min_wedge = {std::vector<uint64_t>(values.size()), 0, 0};
+}
+
+void SlidingWindow::pushWedge(Wedge& w, double x, bool keep_max) {
+    size_t cap = w.seq.size();
+    // Вышедший из окна отсчёт может лежать только в голове очереди
+    if (w.count > 0 && w.seq[w.head] + values.size() <= next_seq) {
+        w.head = (w.head + 1) % cap;
+        --w.count;
+    }
+    // Отсчёты, которые новый уже никогда не уступит, больше не нужны
+    while (w.count > 0) {
+        double back = at(w.seq[(w.head + w.count - 1) % cap]);
+        if (keep_max ? back > x : back < x) break;
+        --w.count;
+    }
+    w.seq[(w.head + w.count) % cap] = next_seq;
+    ++w.count;
+}
+
+void SlidingWindow::add(double x) {
+    size_t cap = values.size();
+    if (filled < cap) {
+        ++filled;
+        double delta = x - mean_value;
+        mean_value += delta / (double)filled;
+        m2 += delta * (x - mean_value);
+    } else {
+        // Замена самого старого отсчёта новым при неизменном размере окна
+        double old = values[next_seq % cap];
+        double new_mean = mean_value + (x - old) / (double)cap;
+        m2 += (x - old) * (x - new_mean + old - mean_value);
+        mean_value = new_mean;
+    }
+    values[next_seq % cap] = x;
+    pushWedge(max_wedge, x, true);
+    pushWedge(min_wedge, x, false);
+    ++next_seq;
+}
+
+double SlidingWindow::variance() const {
+    // Погрешность вычитаний может увести m2 чуть ниже нуля
+    return filled > 1 ? std::max(0.0, m2) / (double)(filled - 1) : 0.0;
+}
+
+double SlidingWindow::stddev() const {
+    return std::sqrt(variance());
+}
+
+double SlidingWindow::max() const {
+    return max_wedge.count ? at(max_wedge.seq[max_wedge.head]) : 0.0;
+}
+
+double SlidingWindow::min() const {
+    return min_wedge.count ? at(min_wedge.seq[min_wedge.head]) : 0.0;
+}
+
+P2Quantile::P2Quantile(double q) : p(q) {
+    reset();
+}
+
+void P2Quantile::reset() {
+    n = 0;
+    for (int i = 0; i < 5; ++i) heights[i] = positions[i] = desired[i] = 0.0;
+    increments[0] = 0.0;
+    increments[1] = p / 2.0;
+    increments[2] = p;
+    increments[3] = (1.0 + p) / 2.0;
+    increments[4] = 1.0;
+}
+
+void P2Quantile::add(double x) {
+    if (n < 5) {
+        heights[n++] = x;
+        if (n == 5) {
+            std::sort(heights, heights + 5);
+            for (int i = 0; i < 5; ++i) positions[i] = i + 1;
+            desired[0] = 1.0;
+            desired[1] = 1.0 + 2.0 * p;
+            desired[2] = 1.0 + 4.0 * p;
+            desired[3] = 3.0 + 2.0 * p;
+            desired[4] = 5.0;
+        }
+        return;
+    }
+
+    int k;
+    if (x < heights[0]) {
+        heights[0] = x;
+        k = 0;
+    } else if (x >= heights[4]) {
+        heights[4] = std::max(heights[4], x);
+        k = 3;
+    } else {
+        k = 0;
+        while (k < 3 && x >= heights[k + 1]) ++k;
+    }
+    for (int i = k + 1; i < 5; ++i) positions[i] += 1.0;
+    for (int i = 0; i < 5; ++i) desired[i] += increments[i];
+
+    // Средние маркеры сдвигаются к желаемым позициям по параболе (или линейно,
+    // если парабола нарушает порядок высот)
+    for (int i = 1; i <= 3; ++i) {
+        double d = desired[i] - positions[i];
+        if ((d >= 1.0 && positions[i + 1] - positions[i] > 1.0) ||
+            (d <= -1.0 && positions[i - 1] - positions[i] < -1.0)) {
+            double s = d > 0 ? 1.0 : -1.0;
+            double qp = heights[i] + s / (positions[i + 1] - positions[i - 1]) *
+                ((positions[i] - positions[i - 1] + s) * (heights[i + 1] - heights[i]) /
+                     (positions[i + 1] - positions[i]) +
+                 (positions[i + 1] - positions[i] - s) * (heights[i] - heights[i - 1]) /
+                     (positions[i] - positions[i - 1]));
+            if (heights[i - 1] < qp && qp < heights[i + 1]) {
+                heights[i] = qp;
+            } else {
+                int j = i + (int)s;
+                heights[i] += s * (heights[j] - heights[i]) / (positions[j] - positions[i]);
+            }
+            positions[i] += s;
+        }
+    }
+    ++n;
+}
+
+double P2Quantile::value() const {
+    if (n == 0) return 0.0;
+    if (n < 5) {
+        // Пока маркеры не сформированы — точный квантиль по имеющимся отсчётам
+        double sorted[5];
+        std::copy(heights, heights + n, sorted);
+        std::sort(sorted, sorted + n);
+        return sorted[(size_t)std::lround(p * (double)(n - 1))];
+    }
+    return heights[2];
+}
+
+TagStats::TagStats(size_t window)
+    : window_size(std::max<size_t>(window, 2)), window(window_size),
+      p50{P2Quantile(0.5), P2Quantile(0.5)}, p95{P2Quantile(0.95), P2Quantile(0.95)},
+      older(0), since_swap(0) {}
+
+void TagStats::add(double x) {
+    total.add(x);
+    window.add(x);
+    for (int i = 0; i < 2; ++i) {
+        p50[i].add(x);
+        p95[i].add(x);
+    }
+    // Каждые window отсчётов старшая пара обнуляется и становится младшей
+    if (++since_swap == window_size) {
+        since_swap = 0;
+        p50[older].reset();
+        p95[older].reset();
+        older = 1 - older;
+    }
+}
+
+TagStats::Summary TagStats::summary() const {
+    return {total.count(), window.size(), window.mean(), window.stddev(), window.min(), window.max(),
+            p50[older].value(), p95[older].value(), total.mean(), total.stddev()};
+}
+
+bool StatsSink::summary(size_t slot, const std::string& name, TagStats::Summary& out) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (slot >= stats.size() || !stats[slot] || names[slot] != name) return false;
+    out = stats[slot]->summary();
+    return true;
+}
+
+void StatsSink::onValueChanged(size_t slot, const OPCUAClient::TagData& tag, const UA_DataValue&) {
+    // Переход в плохое качество — не новое значение, в статистику не идёт
+    if (tag.quality == "BAD") return;
+    std::lock_guard<std::mutex> lock(mutex);
+    if (slot >= stats.size()) {
+        stats.resize(slot + 1);
+        names.resize(slot + 1);
+    }
+    if (!stats[slot] || names[slot] != tag.name) {
+        stats[slot].reset(new TagStats(window_size));
+        names[slot] = tag.name;
+    }
+    stats[slot]->add(tag.value);
+}
+
+void StatsSink::onReset() {
+    // Повторно пришедшие значения иначе вошли бы в статистику дважды
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto& s : stats) s.reset();
+}
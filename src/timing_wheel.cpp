@@ -0,0 +1,58 @@
+#include "../include/timing_wheel.hpp"
+
+TimingWheel::TimingWheel(uint64_t startTick) : current(startTick), pending(0) {}
+
+void TimingWheel::schedule(uint32_t id, uint64_t dueTick) {
+    if (dueTick <= current) dueTick = current + 1;
+    insert(Entry{id, dueTick});
+    ++pending;
+}
+
+void TimingWheel::insert(const Entry& e) {
+    // Уровень выбирается по старшим битам, совпадающим с текущим тиком:
+    // элемент попадает туда, где окажется при каскаде ровно к своему сроку
+    for (int level = 0; level < LEVELS; ++level) {
+        int shift = SLOT_BITS * (level + 1);
+        if ((e.due >> shift) == (current >> shift)) {
+            slots[level][(e.due >> (SLOT_BITS * level)) & (SLOTS - 1)].push_back(e);
+            return;
+        }
+    }
+    overflow.push_back(e);
+}
+
+void TimingWheel::cascade(int level) {
+    if (level == LEVELS) {
+        std::vector<Entry> moved;
+        moved.swap(overflow);
+        for (const auto& e : moved) insert(e);
+        return;
+    }
+    auto& slot = slots[level][(current >> (SLOT_BITS * level)) & (SLOTS - 1)];
+    std::vector<Entry> moved;
+    moved.swap(slot);
+    for (const auto& e : moved) insert(e);
+}
+
+void TimingWheel::advance(uint64_t nowTick, std::vector<uint32_t>& due) {
+    while (current < nowTick) {
+        ++current;
+        // На границе блока сначала спускаем элементы с верхних уровней
+        int top = 0;
+        while (top < LEVELS && (current & ((uint64_t(1) << (SLOT_BITS * (top + 1))) - 1)) == 0) ++top;
+        for (int level = top; level >= 1; --level) cascade(level);
+
+        auto& slot = slots[0][current & (SLOTS - 1)];
+        for (const auto& e : slot) due.push_back(e.id);
+        pending -= slot.size();
+        slot.clear();
+    }
+}
+
+void TimingWheel::clear() {
+    for (auto& level : slots) {
+        for (auto& slot : level) slot.clear();
+    }
+    overflow.clear();
+    pending = 0;
+}
\ No newline at end of file
@@ -0,0 +1,162 @@
+#include "../include/trace.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+std::atomic<bool> Trace::enabled_flag(false);
+
+namespace {
+
+struct Event {
+    const char* name;
+    int64_t ts_ns;
+    char phase;
+};
+
+// Кольцо одного потока: пишет только владелец, читает только фоновый поток
+struct ThreadRing {
+    static const size_t CAPACITY = 1 << 16;
+
+    explicit ThreadRing(int id) : tid(id), head(0), tail(0), dropped(0), events(CAPACITY) {}
+
+    int tid;
+    std::atomic<uint64_t> head;
+    std::atomic<uint64_t> tail;
+    std::atomic<uint64_t> dropped;
+    std::vector<Event> events;
+};
+
+struct Record {
+    const char* name;
+    int64_t ts_ns;
+    int tid;
+    char phase;
+};
+
+struct Collector {
+    std::mutex mutex;  // только регистрация колец и обмен с фоновым потоком
+    std::vector<std::shared_ptr<ThreadRing>> rings;
+    std::vector<Record> collected;
+    std::thread drainer;
+    std::condition_variable wake;
+    bool stop = false;
+    int next_tid = 1;
+
+    ~Collector() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stop = true;
+        }
+        wake.notify_all();
+        if (drainer.joinable()) drainer.join();
+    }
+};
+
+Collector& collector() {
+    static Collector c;
+    return c;
+}
+
+int64_t nowNanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Переносит события из колец в общий массив; вызывается под collector().mutex
+void drainLocked(Collector& c) {
+    for (auto& ring : c.rings) {
+        uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+        uint64_t head = ring->head.load(std::memory_order_acquire);
+        for (; tail < head; ++tail) {
+            const Event& e = ring->events[tail % ThreadRing::CAPACITY];
+            c.collected.push_back({e.name, e.ts_ns, ring->tid, e.phase});
+        }
+        ring->tail.store(tail, std::memory_order_release);
+    }
+}
+
+void drainLoop() {
+    Collector& c = collector();
+    std::unique_lock<std::mutex> lock(c.mutex);
+    while (!c.stop) {
+        c.wake.wait_for(lock, std::chrono::milliseconds(50));
+        drainLocked(c);
+    }
+}
+
+ThreadRing& localRing() {
+    thread_local std::shared_ptr<ThreadRing> ring;
+    if (!ring) {
+        Collector& c = collector();
+        std::lock_guard<std::mutex> lock(c.mutex);
+        ring = std::make_shared<ThreadRing>(c.next_tid++);
+        c.rings.push_back(ring);
+    }
+    return *ring;
+}
+
+void push(const char* name, char phase) {
+    ThreadRing& ring = localRing();
+    uint64_t head = ring.head.load(std::memory_order_relaxed);
+    if (head - ring.tail.load(std::memory_order_acquire) >= ThreadRing::CAPACITY) {
+        // Фоновый поток не успевает: событие теряется, но поток не ждёт
+        ring.dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    ring.events[head % ThreadRing::CAPACITY] = {name, nowNanos(), phase};
+    ring.head.store(head + 1, std::memory_order_release);
+}
+
+} // namespace
+
+void Trace::setEnabled(bool on) {
+    if (on) {
+        Collector& c = collector();
+        std::lock_guard<std::mutex> lock(c.mutex);
+        if (!c.drainer.joinable()) c.drainer = std::thread(drainLoop);
+    }
+    enabled_flag.store(on, std::memory_order_relaxed);
+}
+
+void Trace::begin(const char* name) {
+    push(name, 'B');
+}
+
+void Trace::end(const char* name) {
+    push(name, 'E');
+}
+
+size_t Trace::droppedEvents() {
+    Collector& c = collector();
+    std::lock_guard<std::mutex> lock(c.mutex);
+    size_t n = 0;
+    for (const auto& ring : c.rings) n += ring->dropped.load(std::memory_order_relaxed);
+    return n;
+}
+
+bool Trace::writeChromeJson(const std::string& path) {
+    std::vector<Record> records;
+    {
+        Collector& c = collector();
+        std::lock_guard<std::mutex> lock(c.mutex);
+        drainLocked(c);
+        records.swap(c.collected);
+    }
+
+    std::FILE* f = std::fopen(path.c_str(), "w");
+    if (!f) return false;
+    std::fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", f);
+    int64_t origin = records.empty() ? 0 : records.front().ts_ns;
+    for (const auto& r : records) origin = r.ts_ns < origin ? r.ts_ns : origin;
+    for (size_t i = 0; i < records.size(); ++i) {
+        const Record& r = records[i];
+        std::fprintf(f, "%s\n{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%d}",
+                     i ? "," : "", r.name, r.phase, (r.ts_ns - origin) / 1000.0, r.tid);
+    }
+    std::fputs("\n]}\n", f);
+    return std::fclose(f) == 0;
+}
\ No newline at end of file
@@ -0,0 +1,208 @@
+#include "../include/ua_allocator.hpp"
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <open62541/types.h>
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#elif defined(__APPLE__)
+#include <malloc/malloc.h>
+#elif defined(_WIN32)
+#include <malloc.h>
+#endif
+
+namespace {
+
+// Классы размеров: 16 байт .. 64 КБ, степени двойки
+const int MIN_SHIFT = 4;
+const int CLASS_COUNT = 13;
+const size_t MAX_CACHED_SIZE = size_t(1) << (MIN_SHIFT + CLASS_COUNT - 1);
+const size_t MAX_BLOCKS_PER_CLASS = 4096;
+// Кэш больше этого объёма отдаёт блоки системе сразу при освобождении
+const size_t MAX_CACHED_BYTES = 32 * 1024 * 1024;
+
+struct ThreadCache {
+    bool caching;
+    void** blocks[CLASS_COUNT];
+    size_t counts[CLASS_COUNT];
+    UaAllocator::Stats stats;
+};
+
+thread_local ThreadCache* cache = nullptr;
+
+// Кэш уходит вместе с потоком, даже если тот не снял его сам
+struct CacheOwner {
+    ~CacheOwner() { UaAllocator::uninstallForThisThread(); }
+};
+
+thread_local CacheOwner cache_owner;
+
+size_t usableSize(void* p) {
+#if defined(__GLIBC__)
+    return malloc_usable_size(p);
+#elif defined(__APPLE__)
+    return malloc_size(p);
+#elif defined(_WIN32)
+    return _msize(p);
+#else
+    (void)p;
+    return 0;  // размер неизвестен — блок просто возвращается системе
+#endif
+}
+
+// Наименьший класс, вмещающий size
+int classFor(size_t size) {
+    int c = 0;
+    while (c < CLASS_COUNT && (size_t(1) << (MIN_SHIFT + c)) < size) ++c;
+    return c;
+}
+
+// Наибольший класс, который целиком помещается в блок ёмкостью usable
+int classFitting(size_t usable) {
+    if (usable < (size_t(1) << MIN_SHIFT)) return -1;
+    int c = 0;
+    while (c + 1 < CLASS_COUNT && (size_t(1) << (MIN_SHIFT + c + 1)) <= usable) ++c;
+    return c;
+}
+
+void* systemAlloc(size_t size) {
+    if (cache) cache->stats.systemAllocs++;
+    return std::malloc(size);
+}
+
+void systemFree(void* p) {
+    if (cache) cache->stats.systemFrees++;
+    std::free(p);
+}
+
+void* hookMalloc(size_t size) { return UaAllocator::allocate(size); }
+void hookFree(void* p) { UaAllocator::release(p); }
+void* hookCalloc(size_t n, size_t size) { return UaAllocator::allocateZeroed(n, size); }
+void* hookRealloc(void* p, size_t size) { return UaAllocator::reallocate(p, size); }
+
+} // namespace
+
+bool UaAllocator::available() {
+#ifdef UA_ENABLE_MALLOC_SINGLETON
+    return true;
+#else
+    return false;
+#endif
+}
+
+void UaAllocator::installHooks() {
+    static std::once_flag once;
+    std::call_once(once, [] {
+#ifdef UA_ENABLE_MALLOC_SINGLETON
+        UA_mallocSingleton = hookMalloc;
+        UA_freeSingleton = hookFree;
+        UA_callocSingleton = hookCalloc;
+        UA_reallocSingleton = hookRealloc;
+#else
+        (void)hookMalloc; (void)hookFree; (void)hookCalloc; (void)hookRealloc;
+#endif
+    });
+}
+
+void UaAllocator::installForThisThread(bool caching) {
+    installHooks();
+    if (!cache) {
+        (void)&cache_owner;
+        cache = static_cast<ThreadCache*>(std::calloc(1, sizeof(ThreadCache)));
+        for (int c = 0; c < CLASS_COUNT; ++c) {
+            cache->blocks[c] = static_cast<void**>(std::malloc(MAX_BLOCKS_PER_CLASS * sizeof(void*)));
+        }
+    }
+    cache->caching = caching;
+}
+
+// Перехватчики остаются: другие потоки могут быть внутри них
+void UaAllocator::uninstallForThisThread() {
+    if (!cache) return;
+    trim(0);
+    ThreadCache* owned = cache;
+    cache = nullptr;
+    for (int c = 0; c < CLASS_COUNT; ++c) std::free(owned->blocks[c]);
+    std::free(owned);
+}
+
+bool UaAllocator::installedForThisThread() {
+    return cache != nullptr;
+}
+
+UaAllocator::Stats UaAllocator::threadStats() {
+    if (!cache) return Stats{0, 0, 0, 0};
+    return cache->stats;
+}
+
+void UaAllocator::trim(size_t keepBytes) {
+    if (!cache) return;
+    for (int c = CLASS_COUNT - 1; c >= 0 && cache->stats.cachedBytes > keepBytes; --c) {
+        size_t block = size_t(1) << (MIN_SHIFT + c);
+        while (cache->counts[c] > 0 && cache->stats.cachedBytes > keepBytes) {
+            systemFree(cache->blocks[c][--cache->counts[c]]);
+            cache->stats.cachedBytes -= block;
+        }
+    }
+}
+
+void* UaAllocator::allocate(size_t size) {
+    if (!cache) return std::malloc(size);
+    cache->stats.requests++;
+    if (!cache->caching || size > MAX_CACHED_SIZE) return systemAlloc(size);
+
+    int c = classFor(size == 0 ? 1 : size);
+    if (cache->counts[c] > 0) {
+        cache->stats.cachedBytes -= size_t(1) << (MIN_SHIFT + c);
+        return cache->blocks[c][--cache->counts[c]];
+    }
+    // Блок берётся с размером класса, чтобы потом его можно было отдать любому запросу класса
+    return systemAlloc(size_t(1) << (MIN_SHIFT + c));
+}
+
+void* UaAllocator::allocateZeroed(size_t count, size_t size) {
+    if (size != 0 && count > SIZE_MAX / size) return nullptr;
+    size_t total = count * size;
+    void* p = allocate(total);
+    if (p) std::memset(p, 0, total);
+    return p;
+}
+
+void* UaAllocator::reallocate(void* ptr, size_t size) {
+    if (!cache) return std::realloc(ptr, size);
+    cache->stats.requests++;
+    if (ptr && size != 0 && usableSize(ptr) >= size) return ptr;  // блок класса уже достаточно велик
+    if (!ptr) return allocate(size);
+    cache->stats.systemAllocs++;
+    return std::realloc(ptr, size);
+}
+
+void UaAllocator::release(void* ptr) {
+    if (!ptr) return;
+    if (!cache || !cache->caching) {
+        if (cache) cache->stats.systemFrees++;
+        std::free(ptr);
+        return;
+    }
+    int c = classFitting(usableSize(ptr));
+    if (c < 0 || cache->counts[c] >= MAX_BLOCKS_PER_CLASS ||
+        cache->stats.cachedBytes >= MAX_CACHED_BYTES) {
+        systemFree(ptr);
+        return;
+    }
+    cache->blocks[c][cache->counts[c]++] = ptr;
+    cache->stats.cachedBytes += size_t(1) << (MIN_SHIFT + c);
+}
+
+UaAllocator::CycleScope::CycleScope() : start_allocs(threadStats().systemAllocs) {}
+
+UaAllocator::CycleScope::~CycleScope() {
+    // После UA_ReadResponse_clear все блоки ответа уже в кэше; держим его
+    // в пределах лимита, чтобы редкие всплески не закрепляли память навсегда
+    if (cache && cache->stats.cachedBytes > MAX_CACHED_BYTES / 2) trim(MAX_CACHED_BYTES / 2);
+}
+
+uint64_t UaAllocator::CycleScope::systemAllocs() const {
+    return threadStats().systemAllocs - start_allocs;
+}
\ No newline at end of file
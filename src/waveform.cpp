@@ -0,0 +1,211 @@
+#include "../include/waveform.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+enum SampleType { NOT_WAVEFORM, INT16, UINT16, INT32, UINT32, FLOAT, DOUBLE };
+
+SampleType sampleType(const UA_Variant& v) {
+    if (UA_Variant_isScalar(&v) || v.arrayLength == 0 || v.data <= UA_EMPTY_ARRAY_SENTINEL) return NOT_WAVEFORM;
+    if (v.type == &UA_TYPES[UA_TYPES_INT16]) return INT16;
+    if (v.type == &UA_TYPES[UA_TYPES_UINT16]) return UINT16;
+    if (v.type == &UA_TYPES[UA_TYPES_INT32]) return INT32;
+    if (v.type == &UA_TYPES[UA_TYPES_UINT32]) return UINT32;
+    if (v.type == &UA_TYPES[UA_TYPES_FLOAT]) return FLOAT;
+    if (v.type == &UA_TYPES[UA_TYPES_DOUBLE]) return DOUBLE;
+    return NOT_WAVEFORM;
+}
+
+// Редкие типы: простой цикл, его векторизует компилятор
+template <typename T>
+void widen(const T* in, size_t n, double* out) {
+    for (size_t i = 0; i < n; ++i) out[i] = (double)in[i];
+}
+
+void convert(SampleType type, const void* data, size_t n, double* out) {
+    switch (type) {
+    case INT16: convertSamples((const int16_t*)data, n, out); break;
+    case UINT16: widen((const uint16_t*)data, n, out); break;
+    case INT32: widen((const int32_t*)data, n, out); break;
+    case UINT32: widen((const uint32_t*)data, n, out); break;
+    case FLOAT: convertSamples((const float*)data, n, out); break;
+    case DOUBLE: std::memcpy(out, data, n * sizeof(double)); break;
+    case NOT_WAVEFORM: break;
+    }
+}
+
+// Четыре независимые суммы: порядок сложения фиксирован, но цепочка зависимостей короче
+double sumSquares(const double* x, size_t n) {
+    double s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        s0 += x[i] * x[i];
+        s1 += x[i + 1] * x[i + 1];
+        s2 += x[i + 2] * x[i + 2];
+        s3 += x[i + 3] * x[i + 3];
+    }
+    for (; i < n; ++i) s0 += x[i] * x[i];
+    return (s0 + s1) + (s2 + s3);
+}
+
+} // namespace
+
+void convertSamples(const int16_t* in, size_t n, double* out) {
+    size_t i = 0;
+#if defined(__AVX2__)
+    for (; i + 8 <= n; i += 8) {
+        __m256i x = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(in + i)));
+        _mm256_storeu_pd(out + i, _mm256_cvtepi32_pd(_mm256_castsi256_si128(x)));
+        _mm256_storeu_pd(out + i + 4, _mm256_cvtepi32_pd(_mm256_extracti128_si256(x, 1)));
+    }
+#elif defined(__SSE2__)
+    for (; i + 8 <= n; i += 8) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(in + i));
+        // Знаковое расширение до 32 бит: каждое слово в старшей половине, затем сдвиг вправо
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+        _mm_storeu_pd(out + i, _mm_cvtepi32_pd(lo));
+        _mm_storeu_pd(out + i + 2, _mm_cvtepi32_pd(_mm_shuffle_epi32(lo, _MM_SHUFFLE(1, 0, 3, 2))));
+        _mm_storeu_pd(out + i + 4, _mm_cvtepi32_pd(hi));
+        _mm_storeu_pd(out + i + 6, _mm_cvtepi32_pd(_mm_shuffle_epi32(hi, _MM_SHUFFLE(1, 0, 3, 2))));
+    }
+#endif
+    widen(in + i, n - i, out + i);
+}
+
+void convertSamples(const float* in, size_t n, double* out) {
+    size_t i = 0;
+#if defined(__AVX2__)
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_pd(out + i, _mm256_cvtps_pd(_mm_loadu_ps(in + i)));
+        _mm256_storeu_pd(out + i + 4, _mm256_cvtps_pd(_mm_loadu_ps(in + i + 4)));
+    }
+#elif defined(__SSE2__)
+    for (; i + 4 <= n; i += 4) {
+        __m128 x = _mm_loadu_ps(in + i);
+        _mm_storeu_pd(out + i, _mm_cvtps_pd(x));
+        _mm_storeu_pd(out + i + 2, _mm_cvtps_pd(_mm_movehl_ps(x, x)));
+    }
+#endif
+    widen(in + i, n - i, out + i);
+}
+
+size_t waveformLength(const UA_Variant& v) {
+    return sampleType(v) == NOT_WAVEFORM ? 0 : v.arrayLength;
+}
+
+bool convertWaveform(const UA_Variant& v, double* out) {
+    SampleType type = sampleType(v);
+    if (type == NOT_WAVEFORM) return false;
+    convert(type, v.data, v.arrayLength, out);
+    return true;
+}
+
+bool waveformRms(const UA_Variant& v, double& out) {
+    SampleType type = sampleType(v);
+    if (type == NOT_WAVEFORM) return false;
+    double sum = 0;
+    if (type == DOUBLE) {
+        sum = sumSquares((const double*)v.data, v.arrayLength);
+    } else {
+        // Порциями через буфер на стеке, который не покидает L1
+        const size_t CHUNK = 256;
+        double buf[CHUNK];
+        const uint8_t* data = (const uint8_t*)v.data;
+        for (size_t i = 0; i < v.arrayLength; i += CHUNK) {
+            size_t n = std::min(CHUNK, v.arrayLength - i);
+            convert(type, data + i * v.type->memSize, n, buf);
+            sum += sumSquares(buf, n);
+        }
+    }
+    out = std::sqrt(sum / (double)v.arrayLength);
+    return true;
+}
+
+bool WaveformSink::latest(size_t slot, const std::string& name, std::vector<double>& out, uint64_t& sequence) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (slot >= rings.size() || rings[slot].count == 0 || rings[slot].name != name) return false;
+    const Ring& r = rings[slot];
+    if (r.sequence == sequence) return true;
+    const Block& b = r.blocks[(r.head + r.blocks.size() - 1) % r.blocks.size()];
+    out.assign(b.samples.begin(), b.samples.end());
+    sequence = r.sequence;
+    return true;
+}
+
+bool WaveformSink::recent(size_t slot, const std::string& name, size_t samples, std::vector<double>& out,
+                          uint64_t& sequence) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (slot >= rings.size() || rings[slot].count == 0 || rings[slot].name != name) return false;
+    const Ring& r = rings[slot];
+    if (r.sequence == sequence) return true;
+    size_t total = 0;
+    size_t used = 0;
+    while (used < r.count && total < samples) {
+        total += r.blocks[(r.head + r.blocks.size() - 1 - used) % r.blocks.size()].samples.size();
+        ++used;
+    }
+    total = std::min(total, samples);
+    // Заполняется с конца: от нового блока к старым
+    out.resize(total);
+    size_t end = total;
+    for (size_t k = 0; k < used && end > 0; ++k) {
+        const auto& s = r.blocks[(r.head + r.blocks.size() - 1 - k) % r.blocks.size()].samples;
+        size_t n = std::min(s.size(), end);
+        std::copy(s.end() - n, s.end(), out.begin() + (end - n));
+        end -= n;
+    }
+    sequence = r.sequence;
+    return true;
+}
+
+size_t WaveformSink::memoryBytes() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return rings.capacity() * sizeof(Ring) + stored * sizeof(double);
+}
+
+void WaveformSink::onReset() {
+    // Окно recent склеивает блоки подряд по времени; номера блоков, как и при смене тега, растут дальше
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto& r : rings) {
+        for (const auto& b : r.blocks) stored -= b.samples.size();
+        r.blocks.clear();
+        r.head = 0;
+        r.count = 0;
+    }
+}
+
+void WaveformSink::onValueChanged(size_t slot, const OPCUAClient::TagData& tag, const UA_DataValue& dv) {
+    size_t n = waveformLength(dv.value);
+    if (n == 0) return;
+    std::lock_guard<std::mutex> lock(mutex);
+    if (slot >= rings.size()) rings.resize(slot + 1, Ring{"", {}, 0, 0, 0});
+    Ring& r = rings[slot];
+    if (r.name != tag.name) {
+        // Номер блока не сбрасывается: у читателя не должен совпасть номер чужого блока
+        r.name = tag.name;
+        for (const auto& b : r.blocks) stored -= b.samples.size();
+        r.blocks.clear();
+        r.head = 0;
+        r.count = 0;
+    }
+    if (r.blocks.size() < depth) {
+        if (r.blocks.capacity() < depth) r.blocks.reserve(depth);
+        r.blocks.push_back(Block{0, {}});
+    }
+    Block& b = r.blocks[r.head];
+    stored += n;
+    stored -= b.samples.size();
+    // После заполнения кольца буфер блока уже нужного размера и не перераспределяется
+    b.samples.resize(n);
+    convertWaveform(dv.value, b.samples.data());
+    b.time = dv.hasSourceTimestamp ? dv.sourceTimestamp : UA_DateTime_now();
+    r.head = (r.head + 1) % depth;
+    r.count = std::min(r.count + 1, depth);
+    ++r.sequence;
+}
@@ -0,0 +1,122 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <thread>
+#include "../include/alarms.hpp"
+
+namespace {
+
+void feed(AlarmEngine& engine, OPCUAClient::TagData& tag, size_t slot, double value,
+          UA_DateTime sourceTime = 0) {
+    tag.value = value;
+    UA_DataValue dv;
+    UA_DataValue_init(&dv);
+    UA_Variant_setScalar(&dv.value, &value, &UA_TYPES[UA_TYPES_DOUBLE]);
+    dv.hasValue = true;
+    if (sourceTime) {
+        dv.sourceTimestamp = sourceTime;
+        dv.hasSourceTimestamp = true;
+    }
+    engine.onValueChanged(slot, tag, dv);
+}
+
+// Плохой статус: значение — последнее хорошее, как его передаёт OPCUAClient
+void feedBad(AlarmEngine& engine, OPCUAClient::TagData& tag, size_t slot, UA_DateTime sourceTime) {
+    tag.quality = "BAD";
+    tag.status = UA_STATUSCODE_BADCOMMUNICATIONERROR;
+    UA_DataValue dv;
+    UA_DataValue_init(&dv);
+    dv.status = tag.status;
+    dv.hasStatus = true;
+    dv.sourceTimestamp = sourceTime;
+    dv.hasSourceTimestamp = true;
+    engine.onValueChanged(slot, tag, dv);
+}
+
+} // namespace
+
+// Верхняя граница с гистерезисом: снятие только ниже limit - deadband
+TEST(AlarmEngineTest, LimitWithHysteresis) {
+    AlarmEngine engine;
+    engine.addRule({"Temperature", AlarmRule::HI, 80.0, 2.0});
+    engine.addRule({"Temperature", AlarmRule::LO, 10.0, 0.0});
+    OPCUAClient::TagData tag("Temperature", "ns=2;i=1");
+
+    feed(engine, tag, 0, 50.0);
+    EXPECT_TRUE(engine.activeAlarms().empty());
+    feed(engine, tag, 0, 81.0);
+    auto active = engine.activeAlarms();
+    ASSERT_EQ(active.size(), 1u);
+    EXPECT_EQ(active[0].kind, AlarmRule::HI);
+    EXPECT_EQ(engine.unacknowledgedCount(), 1u);
+
+    feed(engine, tag, 0, 79.0);  // внутри гистерезиса
+    EXPECT_EQ(engine.activeAlarms().size(), 1u);
+    engine.acknowledgeAll();
+    EXPECT_EQ(engine.unacknowledgedCount(), 0u);
+    feed(engine, tag, 0, 77.0);
+    EXPECT_TRUE(engine.activeAlarms().empty());
+
+    feed(engine, tag, 0, 5.0);
+    ASSERT_EQ(engine.activeAlarms().size(), 1u);
+    EXPECT_EQ(engine.activeAlarms()[0].kind, AlarmRule::LO);
+}
+
+// Скорость изменения по меткам времени источника
+TEST(AlarmEngineTest, RateOfChange) {
+    AlarmEngine engine;
+    engine.addRule({"Voltage", AlarmRule::ROC, 5.0, 0.0});
+    OPCUAClient::TagData tag("Voltage", "ns=2;i=2");
+    UA_DateTime t0 = UA_DateTime_now();
+
+    feed(engine, tag, 3, 100.0, t0);
+    feed(engine, tag, 3, 102.0, t0 + UA_DATETIME_SEC);  // 2 ед/с
+    EXPECT_TRUE(engine.activeAlarms().empty());
+    feed(engine, tag, 3, 112.0, t0 + 2 * UA_DATETIME_SEC);  // 10 ед/с
+    EXPECT_EQ(engine.activeAlarms().size(), 1u);
+    feed(engine, tag, 3, 113.0, t0 + 3 * UA_DATETIME_SEC);
+    EXPECT_TRUE(engine.activeAlarms().empty());
+}
+
+// Тревога устаревания срабатывает без изменений и снимается следующим значением
+TEST(AlarmEngineTest, StaleFiresWithoutChanges) {
+    AlarmEngine engine;
+    engine.addRule({"Temperature", AlarmRule::STALE, 150.0, 0.0});
+    OPCUAClient::TagData tag("Temperature", "ns=2;i=1");
+
+    engine.tick();
+    EXPECT_TRUE(engine.activeAlarms().empty());
+    std::this_thread::sleep_for(std::chrono::milliseconds(350));
+    engine.tick();
+    ASSERT_EQ(engine.activeAlarms().size(), 1u);
+    EXPECT_EQ(engine.activeAlarms()[0].kind, AlarmRule::STALE);
+
+    feed(engine, tag, 0, 1.0);
+    EXPECT_TRUE(engine.activeAlarms().empty());
+}
+
+// Плохой статус не снимает тревоги устаревания и скорости и не считается изменением
+TEST(AlarmEngineTest, BadStatusIsNotASample) {
+    AlarmEngine engine;
+    engine.addRule({"Temperature", AlarmRule::STALE, 150.0, 0.0});
+    engine.addRule({"Voltage", AlarmRule::ROC, 5.0, 0.0});
+    OPCUAClient::TagData temp("Temperature", "ns=2;i=1");
+    OPCUAClient::TagData volt("Voltage", "ns=2;i=2");
+    UA_DateTime t0 = UA_DateTime_now();
+
+    feed(engine, volt, 1, 100.0, t0);
+    feed(engine, volt, 1, 120.0, t0 + UA_DATETIME_SEC);  // 20 ед/с
+    std::this_thread::sleep_for(std::chrono::milliseconds(350));
+    engine.tick();
+    ASSERT_EQ(engine.activeAlarms().size(), 2u);
+
+    feedBad(engine, temp, 0, t0 + 2 * UA_DATETIME_SEC);
+    feedBad(engine, volt, 1, t0 + 2 * UA_DATETIME_SEC);
+    engine.tick();
+    EXPECT_EQ(engine.activeAlarms().size(), 2u);
+
+    // Хорошее значение снова снимает обе
+    temp.quality = volt.quality = "GOOD";
+    feed(engine, temp, 0, 1.0);
+    feed(engine, volt, 1, 121.0, t0 + 3 * UA_DATETIME_SEC);
+    EXPECT_TRUE(engine.activeAlarms().empty());
+}
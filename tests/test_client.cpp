@@ -1,4 +1,5 @@
 #include <gtest/gtest.h>
+#include <cstdio>
 #include "../include/opcua_client.hpp"
 
 // Проверка начального состояния без подключения
@@ -22,4 +23,184 @@ TEST(OPCUAClientTest, WriteValueOffline) {
     OPCUAClient client;
     bool result = client.writeValue("ns=2;i=2", 10.5);
     EXPECT_FALSE(result);
-}
\ No newline at end of file
+}
+// Конфигурация групп и тегов из файла
+TEST(OPCUAClientTest, LoadTagConfig) {
+    const char* path = "test_tags.cfg";
+    std::FILE* f = std::fopen(path, "w");
+    ASSERT_NE(f, nullptr);
+    std::fputs("# быстрые и медленные теги\n"
+               "group fast 5\n"
+               "group slow 60000\n"
+               "group auto 1000 100 30000\n"
+               "tag Pressure ns=2;i=3 fast\n"
+               "tag Level ns=2;i=4 slow\n"
+               "tag Flow ns=2;i=5\n"
+               "tag Valve ns=2;i=6 auto\n"
+               "calc Power Pressure * Flow / 1000\n", f);
+    std::fclose(f);
+
+    OPCUAClient client;
+    ASSERT_TRUE(client.loadTagConfig(path));
+    auto tags = client.getTags();
+    auto groups = client.getGroups();
+    ASSERT_EQ(tags.size(), 5);
+    EXPECT_EQ(tags[0].name, "Pressure");
+    EXPECT_EQ(groups[tags[0].group].name, "fast");
+    EXPECT_EQ(groups[tags[0].group].periodMs, 10u);  // ограничение снизу
+    EXPECT_EQ(groups[tags[1].group].name, "slow");
+    EXPECT_EQ(groups[tags[2].group].name, "default");
+    // Адаптивная группа: опрос начинается с periodMs, пределы сохраняются
+    const auto& adaptive = groups[tags[3].group];
+    EXPECT_EQ(adaptive.minPeriodMs, 100u);
+    EXPECT_EQ(adaptive.maxPeriodMs, 30000u);
+    EXPECT_EQ(tags[3].pollMs, 1000u);
+    EXPECT_EQ(tags[1].pollMs, 60000u);
+    EXPECT_EQ(tags[4].expression, "Pressure * Flow / 1000");
+
+    // Неизвестная группа — ошибка, текущий набор не меняется
+    f = std::fopen(path, "w");
+    std::fputs("tag X ns=2;i=9 missing\n", f);
+    std::fclose(f);
+    EXPECT_FALSE(client.loadTagConfig(path));
+    EXPECT_EQ(client.getTags().size(), 5);
+    std::remove(path);
+}
+
+// Вычисляемый тег пересчитывается при изменении входов, пришедших через ingest
+TEST(OPCUAClientTest, ComputedTagFollowsInputs) {
+    OPCUAClient client;
+    std::string error;
+    EXPECT_FALSE(client.addComputedTag("Bad", "Temperature * Missing", &error));
+    EXPECT_FALSE(error.empty());
+    ASSERT_TRUE(client.addComputedTag("Sum", "Temperature + Voltage"));
+    ASSERT_TRUE(client.addComputedTag("Double", "Sum * 2"));
+
+    UA_DataValue dv;
+    UA_DataValue_init(&dv);
+    double v = 20.0;
+    UA_Variant_setScalar(&dv.value, &v, &UA_TYPES[UA_TYPES_DOUBLE]);
+    dv.hasValue = true;
+    client.ingest(0, dv);
+    v = 3.0;
+    client.ingest(1, dv);
+
+    auto tags = client.getTags();
+    ASSERT_EQ(tags.size(), 4u);
+    EXPECT_DOUBLE_EQ(tags[2].value, 23.0);
+    EXPECT_DOUBLE_EQ(tags[3].value, 46.0);
+    EXPECT_EQ(tags[3].quality, "GOOD");
+    EXPECT_FALSE(client.writeValue(tags[2].nodeId, 1.0));
+}
+
+namespace {
+
+struct CountingSink : OPCUAClient::ValueSink {
+    std::vector<UA_StatusCode> statuses;
+    void onValueChanged(size_t, const OPCUAClient::TagData& tag, const UA_DataValue&) override {
+        statuses.push_back(tag.status);
+    }
+};
+
+} // namespace
+
+// Ответ со статусом Bad — изменение: приёмники его видят, значение остаётся последним хорошим
+TEST(OPCUAClientTest, BadStatusReachesSinks) {
+    OPCUAClient client;
+    auto sink = std::make_shared<CountingSink>();
+    client.addSink(sink);
+
+    UA_DataValue dv;
+    UA_DataValue_init(&dv);
+    double v = 20.0;
+    UA_Variant_setScalar(&dv.value, &v, &UA_TYPES[UA_TYPES_DOUBLE]);
+    dv.hasValue = true;
+    client.ingest(0, dv);
+
+    UA_DataValue bad;
+    UA_DataValue_init(&bad);
+    bad.status = UA_STATUSCODE_BADCOMMUNICATIONERROR;
+    bad.hasStatus = true;
+    client.ingest(0, bad);
+    client.ingest(0, bad);  // повтор того же статуса — не изменение
+
+    auto tags = client.getTags();
+    EXPECT_EQ(tags[0].quality, "BAD");
+    EXPECT_EQ(tags[0].status, UA_STATUSCODE_BADCOMMUNICATIONERROR);
+    EXPECT_DOUBLE_EQ(tags[0].value, 20.0);
+    ASSERT_EQ(sink->statuses.size(), 2u);
+    EXPECT_EQ(sink->statuses[1], UA_STATUSCODE_BADCOMMUNICATIONERROR);
+
+    client.ingest(0, dv);
+    tags = client.getTags();
+    EXPECT_EQ(tags[0].quality, "GOOD");
+    EXPECT_EQ(sink->statuses.size(), 3u);
+}
+
+// Деление на нулевой вход: вычисляемый тег и зависимые от него становятся BAD,
+// значение остаётся последним конечным; после восстановления входа — снова GOOD
+TEST(OPCUAClientTest, ComputedTagGoesBadOnDivideByZero) {
+    OPCUAClient client;
+    ASSERT_TRUE(client.addComputedTag("Ratio", "Temperature / Voltage"));
+    ASSERT_TRUE(client.addComputedTag("Scaled", "Ratio * 10"));
+    auto sink = std::make_shared<CountingSink>();
+    client.addSink(sink);
+
+    UA_DataValue dv;
+    UA_DataValue_init(&dv);
+    double v = 6.0;
+    UA_Variant_setScalar(&dv.value, &v, &UA_TYPES[UA_TYPES_DOUBLE]);
+    dv.hasValue = true;
+    client.ingest(0, dv);
+    v = 2.0;
+    client.ingest(1, dv);
+    auto tags = client.getTags();
+    EXPECT_DOUBLE_EQ(tags[2].value, 3.0);
+    EXPECT_DOUBLE_EQ(tags[3].value, 30.0);
+
+    v = 0.0;
+    client.ingest(1, dv);
+    tags = client.getTags();
+    EXPECT_EQ(tags[2].quality, "BAD");
+    EXPECT_EQ(tags[2].status, UA_STATUSCODE_BADOUTOFRANGE);
+    EXPECT_DOUBLE_EQ(tags[2].value, 3.0);
+    EXPECT_EQ(tags[3].quality, "BAD");
+    size_t notified = sink->statuses.size();
+
+    // Новое значение другого входа результат не исправляет и не повторяет уведомление
+    v = 7.0;
+    client.ingest(0, dv);
+    EXPECT_EQ(sink->statuses.size(), notified + 1);
+
+    v = 7.0;
+    client.ingest(1, dv);
+    tags = client.getTags();
+    EXPECT_EQ(tags[2].quality, "GOOD");
+    EXPECT_DOUBLE_EQ(tags[2].value, 1.0);
+    EXPECT_EQ(tags[3].quality, "GOOD");
+    EXPECT_DOUBLE_EQ(tags[3].value, 10.0);
+}
+
+// Подписка на события запоминается и без соединения; неверный источник отклоняется сразу
+TEST(OPCUAClientTest, EventSubscriptionIsKeptOffline) {
+    OPCUAClient client;
+    auto log = std::make_shared<EventLog>();
+    EXPECT_TRUE(client.subscribeEvents("ns=0;i=2253", {"Time", "Message"}, log));
+    EXPECT_FALSE(client.subscribeEvents("Server", {"Time"}, log));
+    EXPECT_FALSE(client.subscribeEvents("ns=0;i=2253", {}, log));
+}
+
+// Замена набора тегов на набор того же размера меняет поколение набора
+TEST(OPCUAClientTest, TagSetGenerationChangesOnReplace) {
+    OPCUAClient client;
+    uint64_t before = client.tagSetGeneration();
+    client.clearTags();
+    client.addTag("Pressure", "ns=2;i=7");
+    client.addTag("Flow", "ns=2;i=8");
+    EXPECT_EQ(client.tagCount(), 2u);
+    EXPECT_NE(client.tagSetGeneration(), before);
+
+    uint64_t after = client.tagSetGeneration();
+    client.addGroup("fast", 100);
+    EXPECT_EQ(client.tagSetGeneration(), after);
+}
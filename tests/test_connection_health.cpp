@@ -0,0 +1,85 @@
+#include <gtest/gtest.h>
+#include "../include/connection_health.hpp"
+
+namespace {
+const int64_t MS = 1000000;
+}
+
+// Перегрузка, обрыв и прочие ошибки различаются
+TEST(ConnectionHealthTest, Classifies) {
+    EXPECT_EQ(ConnectionHealth::classify(UA_STATUSCODE_GOOD), ConnectionHealth::OK);
+    EXPECT_EQ(ConnectionHealth::classify(UA_STATUSCODE_BADTOOMANYOPERATIONS), ConnectionHealth::OVERLOAD);
+    EXPECT_EQ(ConnectionHealth::classify(UA_STATUSCODE_BADRESOURCEUNAVAILABLE), ConnectionHealth::OVERLOAD);
+    EXPECT_EQ(ConnectionHealth::classify(UA_STATUSCODE_BADCONNECTIONCLOSED), ConnectionHealth::DISCONNECT);
+    EXPECT_EQ(ConnectionHealth::classify(UA_STATUSCODE_BADSESSIONIDINVALID), ConnectionHealth::DISCONNECT);
+    EXPECT_EQ(ConnectionHealth::classify(UA_STATUSCODE_BADNODEIDUNKNOWN), ConnectionHealth::FAILURE);
+}
+
+// RTT сглаживается, серия ошибок сбрасывается первым успехом
+TEST(ConnectionHealthTest, RttAndFailures) {
+    ConnectionHealth h;
+    EXPECT_EQ(h.snapshot().state, ConnectionHealth::DOWN);
+    h.onConnected();
+    h.onRequest(UA_STATUSCODE_GOOD, 8 * MS, 10, 0);
+    EXPECT_DOUBLE_EQ(h.snapshot().rttMs, 8.0);
+    h.onRequest(UA_STATUSCODE_GOOD, 16 * MS, 10, 0);
+    EXPECT_DOUBLE_EQ(h.snapshot().rttMs, 9.0);
+    EXPECT_DOUBLE_EQ(h.snapshot().lastRttMs, 16.0);
+
+    h.onRequest(UA_STATUSCODE_BADNODEIDUNKNOWN, 0, 10, 0);
+    h.onRequest(UA_STATUSCODE_BADTIMEOUT, 0, 10, 0);
+    auto s = h.snapshot();
+    EXPECT_EQ(s.state, ConnectionHealth::DEGRADED);
+    EXPECT_EQ(s.consecutiveFailures, 2u);
+    EXPECT_EQ(s.lastError, UA_STATUSCODE_BADTIMEOUT);
+    EXPECT_DOUBLE_EQ(s.rttMs, 9.0);
+    h.onRequest(UA_STATUSCODE_GOOD, 9 * MS, 10, 0);
+    EXPECT_EQ(h.snapshot().state, ConnectionHealth::HEALTHY);
+    EXPECT_EQ(h.snapshot().failures, 2u);
+
+    h.onPublishStalled();
+    EXPECT_EQ(h.snapshot().state, ConnectionHealth::DEGRADED);
+    h.onPublish(123);
+    EXPECT_EQ(h.snapshot().lastPublish, 123);
+    h.onDisconnected();
+    EXPECT_EQ(h.snapshot().state, ConnectionHealth::DOWN);
+    EXPECT_EQ(h.snapshot().disconnects, 1u);
+}
+
+// Перегрузка удваивает паузу, успехи её снимают
+TEST(ConnectionHealthTest, ThrottlesOnOverload) {
+    ConnectionHealth h;
+    h.onConnected();
+    EXPECT_TRUE(h.mayRequest(0));
+    h.onRequest(UA_STATUSCODE_BADRESOURCEUNAVAILABLE, 0, 10, 1000 * MS);
+    EXPECT_EQ(h.snapshot().state, ConnectionHealth::OVERLOADED);
+    EXPECT_EQ(h.snapshot().throttleMs, 100u);
+    EXPECT_FALSE(h.mayRequest(1050 * MS));
+    EXPECT_TRUE(h.mayRequest(1100 * MS));
+    for (int i = 0; i < 10; ++i) h.onRequest(UA_STATUSCODE_BADRESOURCEUNAVAILABLE, 0, 10, 0);
+    EXPECT_EQ(h.snapshot().throttleMs, ConnectionHealth::MAX_THROTTLE_MS);
+    EXPECT_EQ(h.snapshot().overloads, 11u);
+    // Число узлов в запросе от этого кода не меняется
+    EXPECT_EQ(h.maxOperations(), 0u);
+
+    int ok = 0;
+    while (h.snapshot().throttleMs > 0 && ok < 100) {
+        h.onRequest(UA_STATUSCODE_GOOD, MS, 10, 0);
+        ++ok;
+    }
+    EXPECT_LT(ok, 40);
+    EXPECT_EQ(h.snapshot().state, ConnectionHealth::HEALTHY);
+}
+
+// BadTooManyOperations делит запрос; рост не переходит размер, на котором был отказ
+TEST(ConnectionHealthTest, ShrinksRequests) {
+    ConnectionHealth h;
+    h.onConnected();
+    h.onRequest(UA_STATUSCODE_BADTOOMANYOPERATIONS, 0, 1000, 0);
+    EXPECT_EQ(h.maxOperations(), 500u);
+    for (int i = 0; i < 32 * 20; ++i) h.onRequest(UA_STATUSCODE_GOOD, MS, 500, 0);
+    EXPECT_EQ(h.maxOperations(), 999u);
+    // Новая сессия выясняет пределы заново
+    h.onConnected();
+    EXPECT_EQ(h.maxOperations(), 0u);
+}
@@ -0,0 +1,56 @@
+#include <gtest/gtest.h>
+#include <cstring>
+#include "../include/event_log.hpp"
+
+namespace {
+
+EventRecord record(uint16_t severity) {
+    EventRecord r;
+    std::memset(&r, 0, sizeof(r));
+    r.severity = severity;
+    return r;
+}
+
+} // namespace
+
+// Кольцо вытесняет старые записи и отдаёт окно от самой новой
+TEST(EventLogTest, RingKeepsNewest) {
+    EventLog log(4);
+    for (uint16_t i = 1; i <= 6; ++i) log.push(record(i));
+    EXPECT_EQ(log.size(), 4u);
+    EXPECT_EQ(log.total(), 6u);
+    EXPECT_EQ(log.overwritten(), 2u);
+
+    std::vector<EventRecord> window;
+    log.copyRecent(1, 2, window);
+    ASSERT_EQ(window.size(), 2u);
+    EXPECT_EQ(window[0].severity, 5);
+    EXPECT_EQ(window[1].severity, 4);
+
+    log.copyRecent(3, 10, window);
+    ASSERT_EQ(window.size(), 1u);
+    EXPECT_EQ(window[0].severity, 3);
+}
+
+// Известные поля раскладываются по колонкам, остальные попадают в текст
+TEST(EventLogTest, DecodesSelectedFields) {
+    std::vector<std::string> fields = {"Time", "Severity", "SourceName", "Message", "Retain"};
+    UA_DateTime time = 1234567;
+    UA_UInt16 severity = 700;
+    UA_String source = UA_STRING((char*)"Pump1");
+    UA_LocalizedText message = UA_LOCALIZEDTEXT((char*)"en", (char*)"Overpressure");
+    UA_Boolean retain = true;
+
+    UA_Variant values[5];
+    UA_Variant_setScalar(&values[0], &time, &UA_TYPES[UA_TYPES_DATETIME]);
+    UA_Variant_setScalar(&values[1], &severity, &UA_TYPES[UA_TYPES_UINT16]);
+    UA_Variant_setScalar(&values[2], &source, &UA_TYPES[UA_TYPES_STRING]);
+    UA_Variant_setScalar(&values[3], &message, &UA_TYPES[UA_TYPES_LOCALIZEDTEXT]);
+    UA_Variant_setScalar(&values[4], &retain, &UA_TYPES[UA_TYPES_BOOLEAN]);
+
+    EventRecord r = EventLog::decode(fields, 5, values);
+    EXPECT_EQ(r.time, time);
+    EXPECT_EQ(r.severity, 700);
+    EXPECT_STREQ(r.source, "Pump1");
+    EXPECT_STREQ(r.message, "Overpressure Retain=true");
+}
@@ -0,0 +1,87 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <map>
+#include "../include/expression.hpp"
+
+namespace {
+
+Expression::Resolver resolver(const std::map<std::string, uint32_t>& names) {
+    return [names](const std::string& name, uint32_t& slot) {
+        auto it = names.find(name);
+        if (it == names.end()) return false;
+        slot = it->second;
+        return true;
+    };
+}
+
+} // namespace
+
+// Приоритеты операций, функции и свёртка констант
+TEST(ExpressionTest, CompilesAndEvaluates) {
+    auto resolve = resolver({{"U", 0}, {"I", 1}});
+    double current[2] = {230.0, 2.0};
+    double previous[2] = {220.0, 2.0};
+
+    Expression e;
+    ASSERT_TRUE(e.compile("U * I", resolve));
+    EXPECT_DOUBLE_EQ(e.evaluate(current, previous), 460.0);
+    ASSERT_EQ(e.inputs().size(), 2u);
+
+    ASSERT_TRUE(e.compile("-2^2 + 3 * (1 + 1)", resolve));
+    EXPECT_EQ(e.code().size(), 1u);  // всё свернулось в одну константу
+    EXPECT_DOUBLE_EQ(e.evaluate(current, previous), 2.0);
+
+    ASSERT_TRUE(e.compile("U - prev(U)", resolve));
+    EXPECT_DOUBLE_EQ(e.evaluate(current, previous), 10.0);
+    ASSERT_EQ(e.inputs().size(), 1u);
+
+    ASSERT_TRUE(e.compile("max(abs(-U), 1e3, sqrt(I * 8))", resolve));
+    EXPECT_DOUBLE_EQ(e.evaluate(current, previous), 1000.0);
+}
+
+TEST(ExpressionTest, ReportsErrors) {
+    auto resolve = resolver({{"U", 0}});
+    Expression e;
+    EXPECT_FALSE(e.compile("U *", resolve));
+    EXPECT_FALSE(e.compile("(U", resolve));
+    EXPECT_FALSE(e.compile("Missing + 1", resolve));
+    EXPECT_NE(e.error().find("Missing"), std::string::npos);
+    EXPECT_FALSE(e.compile("foo(U)", resolve));
+    EXPECT_FALSE(e.compile("U U", resolve));
+}
+
+// Пересчёт только зависимых выражений, цепочки за один проход
+TEST(ComputedTagsTest, EvaluatesIncrementally) {
+    auto resolve = resolver({{"U", 0}, {"I", 1}, {"P", 2}});
+    ComputedTags computed;
+    Expression power, kw;
+    ASSERT_TRUE(power.compile("U * I", resolve));
+    ASSERT_TRUE(kw.compile("P / 1000", resolve));
+    ASSERT_TRUE(computed.add(2, power));
+    ASSERT_TRUE(computed.add(3, kw));
+    EXPECT_FALSE(computed.add(1, kw));  // вход позже результата
+
+    std::map<uint32_t, double> published;
+    int evaluations = 0;
+    auto publish = [&](uint32_t slot, double v) {
+        ++evaluations;
+        published[slot] = v;
+        computed.inputChanged(slot, v);
+    };
+
+    computed.inputChanged(0, 230.0);
+    computed.inputChanged(1, 10.0);
+    computed.evaluate(publish);
+    EXPECT_DOUBLE_EQ(published[2], 2300.0);
+    EXPECT_DOUBLE_EQ(published[3], 2.3);
+    EXPECT_EQ(evaluations, 2);
+
+    evaluations = 0;
+    computed.evaluate(publish);
+    EXPECT_EQ(evaluations, 0);  // входы не менялись
+
+    computed.inputChanged(1, 20.0);
+    computed.evaluate(publish);
+    EXPECT_EQ(evaluations, 2);
+    EXPECT_DOUBLE_EQ(published[3], 4.6);
+}
@@ -0,0 +1,149 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include "../include/fanout.hpp"
+
+namespace {
+UA_DataValue makeValue(UA_Double* v) {
+    UA_DataValue dv;
+    UA_DataValue_init(&dv);
+    UA_Variant_setScalar(&dv.value, v, &UA_TYPES[UA_TYPES_DOUBLE]);
+    dv.hasValue = true;
+    return dv;
+}
+}
+
+// Зритель получает список тегов и изменения от коллектора через Unix-сокет
+TEST(FanoutTest, ViewerReceivesTagsAndDeltas) {
+    const std::string path = "/tmp/opcua_fanout_test.sock";
+    OPCUAClient source;
+    auto server = std::make_shared<FanoutServer>(source);
+    ASSERT_TRUE(server->listen(path));
+    source.addSink(server);
+
+    OPCUAClient store;
+    store.clearTags();
+    FanoutClient viewer(store);
+    ASSERT_TRUE(viewer.connect(path));
+
+    server->poll();
+    EXPECT_EQ(server->clientCount(), 1u);
+
+    UA_Double v = 42.0;
+    UA_DataValue dv = makeValue(&v);
+    source.ingest(1, dv);
+    source.flushSinks();
+
+    for (int i = 0; i < 50; ++i) {
+        viewer.poll();
+        auto tags = store.getTags();
+        if (tags.size() == 2 && tags[1].value == 42.0) break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    auto tags = store.getTags();
+    ASSERT_EQ(tags.size(), 2u);
+    EXPECT_EQ(tags[0].name, "Temperature");
+    EXPECT_EQ(tags[1].name, "Voltage");
+    EXPECT_DOUBLE_EQ(tags[1].value, 42.0);
+}
+
+// Новый зритель сразу получает снимок последних значений
+TEST(FanoutTest, LateViewerGetsSnapshot) {
+    const std::string path = "/tmp/opcua_fanout_snapshot.sock";
+    OPCUAClient source;
+    auto server = std::make_shared<FanoutServer>(source);
+    ASSERT_TRUE(server->listen(path));
+    source.addSink(server);
+
+    UA_Double v = 7.5;
+    UA_DataValue dv = makeValue(&v);
+    source.ingest(0, dv);
+    source.flushSinks();
+
+    OPCUAClient store;
+    FanoutClient viewer(store);
+    ASSERT_TRUE(viewer.connect(path));
+    server->poll();
+
+    for (int i = 0; i < 50 && store.getTags()[0].value != 7.5; ++i) {
+        viewer.poll();
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_DOUBLE_EQ(store.getTags()[0].value, 7.5);
+}
+
+// Тег, появившийся после запуска (PubSub), объявляется из poll, а не из конца цикла:
+// flushSinks под sinks_mutex не обращается к хранилищу
+TEST(FanoutTest, NewSlotIsAnnouncedByPoll) {
+    const std::string path = "/tmp/opcua_fanout_grow.sock";
+    OPCUAClient source;
+    auto server = std::make_shared<FanoutServer>(source);
+    ASSERT_TRUE(server->listen(path));
+    source.addSink(server);
+
+    OPCUAClient store;
+    FanoutClient viewer(store);
+    ASSERT_TRUE(viewer.connect(path));
+    server->poll();
+
+    size_t slot = source.addExternalTag("Flow", "udp:4840/1/1/0");
+    UA_Double v = 3.25;
+    UA_DataValue dv = makeValue(&v);
+    source.ingest(slot, dv);
+    source.flushSinks();
+    server->poll();
+
+    for (int i = 0; i < 50; ++i) {
+        viewer.poll();
+        auto tags = store.getTags();
+        if (tags.size() == 3 && tags[2].value == 3.25) break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    auto tags = store.getTags();
+    ASSERT_EQ(tags.size(), 3u);
+    EXPECT_EQ(tags[2].name, "Flow");
+    EXPECT_DOUBLE_EQ(tags[2].value, 3.25);
+}
+
+// Набор того же размера, заменённый на коллекторе, объявляется заново;
+// значения старых тегов под новыми именами не показываются
+TEST(FanoutTest, ReplacedTagSetIsAnnounced) {
+    const std::string path = "/tmp/opcua_fanout_replace.sock";
+    OPCUAClient source;
+    auto server = std::make_shared<FanoutServer>(source);
+    ASSERT_TRUE(server->listen(path));
+    source.addSink(server);
+
+    UA_Double old_value = 1.5;
+    UA_DataValue dv = makeValue(&old_value);
+    source.ingest(0, dv);
+    source.flushSinks();
+
+    OPCUAClient store;
+    FanoutClient viewer(store);
+    ASSERT_TRUE(viewer.connect(path));
+    server->poll();
+
+    source.clearTags();
+    source.addExternalTag("Level", "udp:4840/1/1/0");
+    source.addExternalTag("Flow", "udp:4840/1/1/1");
+    UA_Double v = 9.0;
+    dv = makeValue(&v);
+    source.ingest(1, dv);
+    source.flushSinks();
+    server->poll();
+
+    for (int i = 0; i < 50; ++i) {
+        viewer.poll();
+        auto tags = store.getTags();
+        if (tags.size() == 2 && tags[0].name == "Level" && tags[1].value == 9.0) break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    auto tags = store.getTags();
+    ASSERT_EQ(tags.size(), 2u);
+    EXPECT_EQ(tags[0].name, "Level");
+    EXPECT_EQ(tags[0].quality, "INIT");
+    EXPECT_EQ(tags[1].name, "Flow");
+    EXPECT_DOUBLE_EQ(tags[1].value, 9.0);
+}
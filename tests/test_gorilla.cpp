@@ -0,0 +1,72 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <random>
+#include "../include/gorilla.hpp"
+
+namespace {
+
+void roundTrip(const std::vector<int64_t>& times, const std::vector<double>& values) {
+    GorillaEncoder enc;
+    for (size_t i = 0; i < times.size(); ++i) enc.append(times[i], values[i]);
+    ASSERT_EQ(enc.count(), times.size());
+    GorillaBlock block = GorillaBlock::seal(enc);
+    std::vector<int64_t> t(times.size());
+    std::vector<double> v(values.size());
+    ASSERT_TRUE(gorillaDecode(block.words.data(), block.words.size(), block.count, t.data(), v.data()));
+    EXPECT_EQ(t, times);
+    for (size_t i = 0; i < values.size(); ++i) {
+        // Сравнение по битам: NaN и -0 должны вернуться как были
+        ASSERT_EQ(std::memcmp(&v[i], &values[i], sizeof(double)), 0) << "i=" << i;
+    }
+}
+
+} // namespace
+
+TEST(GorillaTest, RoundTripsEdgeCases) {
+    roundTrip({5}, {1.5});
+    // Скачки времени всех размеров, назад и вперёд; особые значения
+    std::vector<int64_t> t = {1700000000000, 1700000000100, 1700000000200, 1700000000263, 1700000000500,
+                              1700000001000, 1700000000000, 1800000000000, 1800000000001, -5};
+    std::vector<double> v = {0.0, -0.0, 1.0, std::numeric_limits<double>::quiet_NaN(),
+                             std::numeric_limits<double>::infinity(), 1e-300, -1e300, 42.0, 42.0,
+                             std::numeric_limits<double>::denorm_min()};
+    roundTrip(t, v);
+
+    std::mt19937_64 rng(3);
+    std::vector<int64_t> rt(5000);
+    std::vector<double> rv(5000);
+    int64_t now = 1700000000000;
+    for (size_t i = 0; i < rt.size(); ++i) {
+        now += (int64_t)(rng() % 5000) - 100;
+        rt[i] = now;
+        uint64_t bits = rng();
+        std::memcpy(&rv[i], &bits, sizeof(double));
+    }
+    roundTrip(rt, rv);
+}
+
+// Ряд с постоянным шагом и медленно меняющимся значением датчика сжимается в разы
+TEST(GorillaTest, CompressesTypicalSignal) {
+    GorillaEncoder enc;
+    const size_t N = 10000;
+    for (size_t i = 0; i < N; ++i) {
+        // Температура с дискретом АЦП 0.5 и шагом опроса 1 с без дрожания
+        double value = std::round(2 * (60.0 + 5 * std::sin((double)i / 600.0))) / 2;
+        enc.append(1700000000000 + (int64_t)i * 1000, value);
+    }
+    double ratio = (double)(N * 16) / (double)enc.bytes();
+    EXPECT_GT(ratio, 8.0) << enc.bytes() << " bytes";
+}
+
+TEST(GorillaTest, RejectsTruncatedBlock) {
+    GorillaEncoder enc;
+    for (int i = 0; i < 100; ++i) enc.append(i * 10, i * 0.1);
+    std::vector<int64_t> t(100);
+    std::vector<double> v(100);
+    EXPECT_FALSE(gorillaDecode(enc.words().data(), enc.words().size() / 2, 100, t.data(), v.data()));
+    enc.clear();
+    EXPECT_EQ(enc.count(), 0u);
+    EXPECT_EQ(enc.bytes(), 0u);
+}
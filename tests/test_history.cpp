@@ -0,0 +1,162 @@
+#include <gtest/gtest.h>
+#include "../include/history.hpp"
+#include <cmath>
+
+namespace {
+
+void feed(HistorySink& sink, OPCUAClient::TagData& tag, size_t slot, double value) {
+    tag.value = value;
+    UA_DataValue dv;
+    UA_DataValue_init(&dv);
+    sink.onValueChanged(slot, tag, dv);
+}
+
+void feedAt(HistorySink& sink, OPCUAClient::TagData& tag, size_t slot, int64_t ms, double value) {
+    tag.value = value;
+    UA_DataValue dv;
+    UA_DataValue_init(&dv);
+    dv.hasSourceTimestamp = true;
+    dv.sourceTimestamp = UA_DATETIME_UNIX_EPOCH + ms * UA_DATETIME_MSEC;
+    sink.onValueChanged(slot, tag, dv);
+}
+
+} // namespace
+
+// Кольцо хранит последние depth значений в порядке поступления
+TEST(HistorySinkTest, KeepsLastValuesInOrder) {
+    HistorySink sink(3);
+    OPCUAClient::TagData tag("Voltage", "ns=2;i=2");
+    std::vector<double> out;
+    EXPECT_FALSE(sink.copy(5, "Voltage", out));
+
+    for (double v : {1.0, 2.0}) feed(sink, tag, 5, v);
+    ASSERT_TRUE(sink.copy(5, "Voltage", out));
+    EXPECT_EQ(out, (std::vector<double>{1.0, 2.0}));
+
+    for (double v : {3.0, 4.0, 5.0}) feed(sink, tag, 5, v);
+    ASSERT_TRUE(sink.copy(5, "Voltage", out));
+    EXPECT_EQ(out, (std::vector<double>{3.0, 4.0, 5.0}));
+}
+
+// Нулевая глубина считается единицей: кольцо держит последнее значение
+TEST(HistorySinkTest, ZeroDepthKeepsLastValue) {
+    HistorySink sink(0);
+    OPCUAClient::TagData tag("Voltage", "ns=2;i=2");
+    std::vector<double> out;
+    for (double v : {1.0, 2.0}) feed(sink, tag, 0, v);
+    ASSERT_TRUE(sink.copy(0, "Voltage", out));
+    EXPECT_EQ(out, (std::vector<double>{2.0}));
+}
+
+// Другой тег в том же слоте начинает историю заново
+TEST(HistorySinkTest, ResetsWhenSlotChangesOwner) {
+    HistorySink sink(3);
+    OPCUAClient::TagData a("A", "ns=2;i=1"), b("B", "ns=2;i=2");
+    feed(sink, a, 0, 1.0);
+    feed(sink, b, 0, 7.0);
+    std::vector<double> out;
+    EXPECT_FALSE(sink.copy(0, "A", out));
+    ASSERT_TRUE(sink.copy(0, "B", out));
+    EXPECT_EQ(out, (std::vector<double>{7.0}));
+}
+
+// Вытесненные из кольца значения уходят в сжатые сегменты и остаются в полной истории
+TEST(HistorySinkTest, KeepsEvictedValuesInPackedSegments) {
+    HistorySink sink(4, 8, 2);
+    OPCUAClient::TagData tag("Flow", "ns=2;i=3");
+    for (int i = 0; i < 30; ++i) feedAt(sink, tag, 1, 1000 + i * 100, i * 0.5);
+
+    std::vector<double> out;
+    ASSERT_TRUE(sink.copy(1, "Flow", out));
+    EXPECT_EQ(out, (std::vector<double>{13.0, 13.5, 14.0, 14.5}));
+    // 26 вытесненных: 3 закрытых сегмента по 8, старейший удалён, 2 — в открытом
+    EXPECT_EQ(sink.packedSamples(), 18u);
+    EXPECT_GT(sink.packedBytes(), 0u);
+
+    std::vector<int64_t> times;
+    std::vector<double> values;
+    ASSERT_TRUE(sink.copySeries(1, "Flow", 0, times, values));
+    ASSERT_EQ(times.size(), 22u);
+    for (size_t i = 0; i < times.size(); ++i) {
+        EXPECT_EQ(times[i], 1000 + (int64_t)(i + 8) * 100);
+        EXPECT_EQ(values[i], (double)(i + 8) * 0.5);
+    }
+
+    ASSERT_TRUE(sink.copySeries(1, "Flow", 2450, times, values));
+    ASSERT_FALSE(times.empty());
+    EXPECT_EQ(times.front(), 2500);
+    EXPECT_EQ(times.back(), 3900);
+}
+
+// Смена владельца слота сбрасывает и сжатые сегменты
+TEST(HistorySinkTest, ResetClearsPackedSegments) {
+    HistorySink sink(2, 4, 8);
+    OPCUAClient::TagData a("A", "ns=2;i=1"), b("B", "ns=2;i=2");
+    for (int i = 0; i < 20; ++i) feedAt(sink, a, 0, i * 1000, 1.0);
+    EXPECT_EQ(sink.packedSamples(), 18u);
+    feedAt(sink, b, 0, 50000, 2.0);
+    EXPECT_EQ(sink.packedSamples(), 0u);
+    EXPECT_EQ(sink.packedBytes(), 0u);
+
+    std::vector<int64_t> times;
+    std::vector<double> values;
+    ASSERT_TRUE(sink.copySeries(0, "B", 0, times, values));
+    EXPECT_EQ(values, (std::vector<double>{2.0}));
+}
+
+// Масштаб графика: мелкий диапазон — по точкам, крупный — по самой грубой подходящей ступени
+TEST(HistorySinkTest, ColumnsPickCoarsestTier) {
+    HistorySink sink(100, 1024, 4);
+    OPCUAClient::TagData tag("Level", "ns=2;i=4");
+    // Двое суток, значение раз в 10 с: номер часа
+    const int64_t day = 24 * 3600 * 1000;
+    for (int64_t t = 0; t < 2 * day; t += 10000) feedAt(sink, tag, 0, t, (double)(t / 3600000));
+
+    std::vector<RollupBucket> cols;
+    int tier = 0;
+    ASSERT_TRUE(sink.copyColumns(0, "Level", 2 * day - 60000, 2 * day, 120, cols, &tier));
+    EXPECT_EQ(tier, -1);
+    EXPECT_EQ(cols[0].count, 1u);
+    EXPECT_EQ(cols[0].last, 47.0);
+
+    ASSERT_TRUE(sink.copyColumns(0, "Level", 2 * day - 3600000, 2 * day, 60, cols, &tier));
+    EXPECT_EQ(tier, 1);
+    EXPECT_EQ(cols[0].count, 6u);
+
+    // 30 суток: час на столбец, за пределами записанного — пусто
+    ASSERT_TRUE(sink.copyColumns(0, "Level", 2 * day - 30 * day, 2 * day, 720, cols, &tier));
+    EXPECT_EQ(tier, 2);
+    EXPECT_EQ(cols[0].count, 0u);
+    size_t total = 0;
+    for (const auto& c : cols) total += c.count;
+    EXPECT_EQ(total, (size_t)(2 * day / 10000));
+    EXPECT_EQ(cols[719].mean(), 47.0);
+    EXPECT_EQ(cols[719 - 47].mean(), 0.0);
+    EXPECT_EQ(cols[719 - 47].count, 360u);
+
+    EXPECT_FALSE(sink.copyColumns(0, "Other", 0, day, 10, cols));
+}
+
+// Тег, менявшийся до окна: столбцы без изменений держат значение из-за окна
+TEST(HistorySinkTest, ColumnsReportValueBeforeWindow) {
+    HistorySink sink(4, 4, 2);
+    OPCUAClient::TagData tag("Level", "ns=2;i=4");
+    feedAt(sink, tag, 0, 1000, 3.0);
+    feedAt(sink, tag, 0, 2000, 5.0);
+    feedAt(sink, tag, 0, 90000, 7.0);
+
+    std::vector<RollupBucket> cols;
+    double before = 0;
+    ASSERT_TRUE(sink.copyColumns(0, "Level", 60000, 120000, 60, cols, nullptr, &before));
+    EXPECT_EQ(before, 5.0);
+    EXPECT_EQ(cols[0].count, 0u);
+    EXPECT_EQ(cols[30].last, 7.0);
+
+    // Кольцо вытеснило ранние точки — значение берётся из ступеней свёртки
+    for (int i = 0; i < 8; ++i) feedAt(sink, tag, 0, 100000 + i * 1000, 9.0);
+    ASSERT_TRUE(sink.copyColumns(0, "Level", 60000, 120000, 60, cols, nullptr, &before));
+    EXPECT_EQ(before, 5.0);
+
+    ASSERT_TRUE(sink.copyColumns(0, "Level", 0, 120000, 60, cols, nullptr, &before));
+    EXPECT_TRUE(std::isnan(before));
+}
@@ -0,0 +1,43 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
+#include "../include/json_stream.hpp"
+
+// Каждое изменение превращается в отдельную строку NDJSON
+TEST(JsonStreamTest, WritesOneLinePerChange) {
+    const char* path = "json_stream_test.ndjson";
+    std::remove(path);
+    {
+        JsonStreamSink sink(path);
+        ASSERT_TRUE(sink.isOpen());
+
+        OPCUAClient::TagData tag("Temperature", "ns=2;i=1");
+        UA_DataValue dv;
+        UA_DataValue_init(&dv);
+        UA_Double v = 21.5;
+        UA_Variant_setScalar(&dv.value, &v, &UA_TYPES[UA_TYPES_DOUBLE]);
+        dv.hasValue = true;
+
+        sink.onValueChanged(0, tag, dv);
+        sink.onValueChanged(0, tag, dv);
+        sink.onCycleEnd();
+        EXPECT_EQ(sink.linesWritten(), 2u);
+    }
+
+    std::ifstream in(path);
+    std::string line;
+    int count = 0;
+    while (std::getline(in, line)) {
+        EXPECT_NE(line.find("\"tag\":\"Temperature\""), std::string::npos);
+        EXPECT_NE(line.find("21.5"), std::string::npos);
+        ++count;
+    }
+    EXPECT_EQ(count, 2);
+    std::remove(path);
+}
+
+// Недоступный сокет не должен приводить к падению
+TEST(JsonStreamTest, MissingSocketIsClosed) {
+    JsonStreamSink sink("unix:/nonexistent/opcua.sock");
+    EXPECT_FALSE(sink.isOpen());
+}
@@ -0,0 +1,35 @@
+#include <gtest/gtest.h>
+#include "../include/latency_histogram.hpp"
+
+// Каждое значение попадает в диапазон, чья верхняя граница не меньше его самого
+TEST(LatencyHistogramTest, BucketsCoverValues) {
+    for (uint64_t v : {0ULL, 1ULL, 63ULL, 64ULL, 65ULL, 1000ULL, 123456789ULL, 1ULL << 62}) {
+        int idx = LatencyHistogram::bucketIndex(v);
+        ASSERT_LT(idx, LatencyHistogram::BUCKET_COUNT);
+        EXPECT_GE(LatencyHistogram::bucketUpperBound(idx), v);
+        if (idx > 0) {
+            EXPECT_LT(LatencyHistogram::bucketUpperBound(idx - 1), v);
+        }
+    }
+}
+
+// Квантили равномерного распределения совпадают с точными с точностью ~3%
+TEST(LatencyHistogramTest, PercentilesWithinPrecision) {
+    LatencyHistogram h;
+    for (uint64_t v = 1; v <= 100000; ++v) h.record(v * 1000);
+
+    EXPECT_EQ(h.count(), 100000u);
+    EXPECT_EQ(h.min(), 1000u);
+    EXPECT_EQ(h.max(), 100000000u);
+    EXPECT_NEAR((double)h.percentile(0.5), 50e6, 50e6 * 0.035);
+    EXPECT_NEAR((double)h.percentile(0.99), 99e6, 99e6 * 0.035);
+    EXPECT_LE(h.percentile(0.999), h.max());
+}
+
+TEST(LatencyHistogramTest, ResetClears) {
+    LatencyHistogram h;
+    h.record(500);
+    h.reset();
+    EXPECT_EQ(h.count(), 0u);
+    EXPECT_EQ(h.percentile(0.99), 0u);
+}
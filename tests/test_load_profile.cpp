@@ -0,0 +1,90 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include "../include/load_profile.hpp"
+
+// Группы нумеруются подряд, параметры и ошибки разбираются построчно
+TEST(LoadProfileTest, ParsesGroups) {
+    std::vector<LoadGroup> groups;
+    std::string error;
+    ASSERT_TRUE(parseLoadProfile("# стенд\n"
+                                 "group Fast 100 double rate=10\n"
+                                 "\n"
+                                 "group Wave 5 float array=256 burst=1000/100/20\n",
+                                 groups, &error)) << error;
+    ASSERT_EQ(groups.size(), 2u);
+    EXPECT_EQ(groups[0].firstId, 1u);
+    EXPECT_EQ(groups[1].firstId, 101u);
+    EXPECT_EQ(groups[1].type, LoadGroup::FLOAT);
+    EXPECT_EQ(groups[1].arraySize, 256u);
+    EXPECT_DOUBLE_EQ(groups[1].rate, 1.0);
+    EXPECT_EQ(groups[1].burstPeriodMs, 1000u);
+    EXPECT_DOUBLE_EQ(groups[1].burstFactor, 20.0);
+    EXPECT_EQ(loadVariableCount(groups), 105u);
+    EXPECT_EQ(loadTagName(groups[1], 3), "Wave.3");
+
+    EXPECT_FALSE(parseLoadProfile("group A 10 complex\n", groups, &error));
+    EXPECT_EQ(error, "line 1: unknown type complex");
+    EXPECT_FALSE(parseLoadProfile("group A 10 int32\ngroup A 5 bool\n", groups, &error));
+    EXPECT_FALSE(parseLoadProfile("group A 10 int32 burst=100/200/2\n", groups, &error));
+    EXPECT_FALSE(parseLoadProfile("group A 10 int32 rate=fast\n", groups, &error));
+    EXPECT_FALSE(parseLoadProfile("group A 600000 bool\ngroup B 400001 bool\n", groups, &error));
+    EXPECT_EQ(error, "line 2: more than 1000000 variables");
+    // Неудачный разбор не трогает прежний профиль
+    EXPECT_EQ(groups.size(), 2u);
+}
+
+// Всплеск умножает частоту только в своём окне
+TEST(LoadProfileTest, BurstRates) {
+    LoadGroup g{"G", 10, LoadGroup::DOUBLE, 0, 2.0, 1000, 250, 5.0, 1};
+    EXPECT_DOUBLE_EQ(g.changesBy(250), 2.0 * 5.0 * 0.25);
+    EXPECT_DOUBLE_EQ(g.changesBy(1000), 2.0 * (0.75 + 5.0 * 0.25));
+    EXPECT_DOUBLE_EQ(g.changesBy(2100), 2.0 * (2 * 2.0 + 0.1 * 5.0));
+    EXPECT_DOUBLE_EQ(g.averageRate(), 4.0);
+    // Опрос раз в 500 мс видит не больше двух изменений в секунду
+    EXPECT_DOUBLE_EQ(g.observableRate(500), 2.0);
+    EXPECT_DOUBLE_EQ(g.observableRate(100), 0.25 * 10.0 + 0.75 * 2.0);
+}
+
+// Переменные меняются по кругу; отставание больше круга не копится
+TEST(LoadProfileTest, ScheduleRoundRobin) {
+    std::vector<LoadGroup> groups = {{"A", 4, LoadGroup::INT32, 0, 1.0, 0, 0, 1.0, 1},
+                                     {"B", 2, LoadGroup::BOOL, 0, 10.0, 0, 0, 1.0, 5}};
+    LoadSchedule schedule(groups);
+    std::vector<LoadSchedule::Change> changes;
+    schedule.advance(500, changes);
+    // A: 4 * 0.5 = 2 изменения, B: 2 * 5 = 10, но не больше одного круга
+    size_t a = 0, b = 0;
+    for (const auto& c : changes) (c.group == 0 ? a : b)++;
+    EXPECT_EQ(a, 2u);
+    EXPECT_EQ(b, 2u);
+    EXPECT_EQ(schedule.skipped(), 8u);
+    EXPECT_EQ(changes[0].index, 0u);
+    EXPECT_EQ(changes[1].index, 1u);
+    EXPECT_EQ(changes.back().round, 4u);
+
+    changes.clear();
+    schedule.advance(1000, changes);
+    ASSERT_EQ(changes.size(), 4u);
+    EXPECT_EQ(changes[0].index, 2u);
+    EXPECT_EQ(changes[1].index, 3u);
+    EXPECT_EQ(changes[1].round, 0u);
+    EXPECT_EQ(schedule.emitted(), 8u);
+}
+
+// Конфигурация тегов для клиента ограничивается первыми limit переменными
+TEST(LoadProfileTest, WritesTagConfig) {
+    std::vector<LoadGroup> groups;
+    ASSERT_TRUE(parseLoadProfile("group A 3 double\ngroup B 3 int32\n", groups));
+    std::string path = (std::filesystem::temp_directory_path() / "opcua_load_tags.cfg").string();
+    ASSERT_TRUE(writeLoadTagConfig(groups, path, 250, 4));
+    std::ifstream in(path);
+    std::vector<std::string> lines;
+    for (std::string line; std::getline(in, line);) lines.push_back(line);
+    ASSERT_EQ(lines.size(), 6u);
+    EXPECT_EQ(lines[0], "group A 250");
+    EXPECT_EQ(lines[2], "tag A.0 ns=1;i=1 A");
+    EXPECT_EQ(lines[5], "tag B.0 ns=1;i=4 B");
+    std::remove(path.c_str());
+}
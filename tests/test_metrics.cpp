@@ -0,0 +1,43 @@
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+#include "../include/metrics.hpp"
+
+// Инкременты из разных потоков суммируются без потерь
+TEST(MetricsTest, ShardedCounterAggregates) {
+    ShardedCounter c;
+    std::vector<std::thread> workers;
+    for (int t = 0; t < 8; ++t) {
+        workers.emplace_back([&c] { for (int i = 0; i < 10000; ++i) c.inc(); });
+    }
+    for (auto& w : workers) w.join();
+    EXPECT_EQ(c.value(), 80000u);
+}
+
+// Экспозиция содержит HELP/TYPE и значения в текстовом формате Prometheus
+TEST(MetricsTest, ExpositionFormat) {
+    auto& reg = MetricsRegistry::instance();
+    reg.counter("test_events_total", "Test events").inc(3);
+    reg.gauge("test_queue_depth", "Test queue").set(7);
+    reg.histogram("test_duration_seconds", "Test durations").record(2000000);  // 2 мс
+
+    std::string text = reg.exposition();
+    EXPECT_NE(text.find("# TYPE test_events_total counter\ntest_events_total 3\n"), std::string::npos);
+    EXPECT_NE(text.find("test_queue_depth 7\n"), std::string::npos);
+    EXPECT_NE(text.find("test_duration_seconds_bucket{le=\"0.001\"} 0\n"), std::string::npos);
+    EXPECT_NE(text.find("test_duration_seconds_bucket{le=\"0.0025\"} 1\n"), std::string::npos);
+    EXPECT_NE(text.find("test_duration_seconds_count 1\n"), std::string::npos);
+}
+
+// Источник выполняется без блокировки реестра: регистрация метрики изнутри не зависает
+TEST(MetricsTest, CollectorMayRegisterMetrics) {
+    auto& r = MetricsRegistry::instance();
+    int id = r.addCollector([&r](std::string& out) {
+        r.counter("test_lazy_total", "Registered from inside a collector").inc();
+        out += "test_collector_line 1\n";
+    });
+    std::string text = r.exposition();
+    r.removeCollector(id);
+    EXPECT_NE(text.find("test_collector_line 1"), std::string::npos);
+    EXPECT_NE(r.exposition().find("test_lazy_total 1"), std::string::npos);
+}
@@ -0,0 +1,108 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include "../include/pubsub_source.hpp"
+
+namespace {
+const char* CONFIG =
+    "group fast 10\n"
+    "tag Speed ns=2;i=1 fast\n"
+    "pubsub line1 opc.udp://224.0.0.22:4840 eth0\n"
+    "reader drive line1 2234 100 62541\n"
+    "field Torque drive float\n"
+    "field Current drive int16\n"
+    "# комментарий\n"
+    "field Running drive bool\n";
+}
+
+// Строки PubSub разбираются из общего файла тегов, прочие строки пропускаются
+TEST(PubSubSourceTest, ParsesConfig) {
+    PubSubConfig c;
+    std::string error;
+    ASSERT_TRUE(parsePubSubConfig(CONFIG, c, &error)) << error;
+    ASSERT_EQ(c.connections.size(), 1u);
+    EXPECT_EQ(c.connections[0].url, "opc.udp://224.0.0.22:4840");
+    EXPECT_EQ(c.connections[0].networkInterface, "eth0");
+    ASSERT_EQ(c.readers.size(), 1u);
+    EXPECT_EQ(c.readers[0].publisherId, 2234);
+    EXPECT_EQ(c.readers[0].writerGroupId, 100);
+    EXPECT_EQ(c.readers[0].dataSetWriterId, 62541);
+    ASSERT_EQ(c.fields.size(), 3u);
+    EXPECT_EQ(c.fields[0].tag, "Torque");
+    EXPECT_EQ(c.fields[0].type, UA_TYPES_FLOAT);
+    EXPECT_EQ(c.fields[1].type, UA_TYPES_INT16);
+
+    PubSubConfig empty;
+    EXPECT_TRUE(parsePubSubConfig("tag A ns=2;i=1\n", empty));
+    EXPECT_TRUE(empty.readers.empty());
+}
+
+TEST(PubSubSourceTest, RejectsBadConfig) {
+    PubSubConfig c;
+    std::string error;
+    EXPECT_FALSE(parsePubSubConfig("pubsub a opc.tcp://host:4840\n", c, &error));
+    EXPECT_FALSE(parsePubSubConfig("pubsub a opc.udp://h:1\nreader r b 1 2 3\n", c, &error));
+    EXPECT_NE(error.find("unknown connection"), std::string::npos);
+    EXPECT_FALSE(parsePubSubConfig("pubsub a opc.udp://h:1\nreader r a 1 2 70000\n", c, &error));
+    EXPECT_FALSE(parsePubSubConfig("pubsub a opc.udp://h:1\nreader r a 1 2 3\nfield X r string\n", c, &error));
+    EXPECT_NE(error.find("line 3"), std::string::npos);
+    // Читатель без полей ничего не даёт — скорее всего, опечатка в имени
+    EXPECT_FALSE(parsePubSubConfig("pubsub a opc.udp://h:1\nreader r a 1 2 3\nfield X q double\n", c, &error));
+    EXPECT_FALSE(parsePubSubConfig("pubsub a opc.udp://h:1\nreader r a 1 2 3\n", c, &error));
+    EXPECT_NE(error.find("no fields"), std::string::npos);
+}
+
+TEST(PubSubSourceTest, ConvertsFields) {
+    double out = 0;
+    int16_t i16 = -1234;
+    EXPECT_TRUE(pubsubFieldToDouble(UA_TYPES_INT16, &i16, out));
+    EXPECT_DOUBLE_EQ(out, -1234.0);
+    float f = 1.5f;
+    EXPECT_TRUE(pubsubFieldToDouble(UA_TYPES_FLOAT, &f, out));
+    EXPECT_DOUBLE_EQ(out, 1.5);
+    uint8_t b = 1;
+    EXPECT_TRUE(pubsubFieldToDouble(UA_TYPES_BOOLEAN, &b, out));
+    EXPECT_DOUBLE_EQ(out, 1.0);
+    EXPECT_FALSE(pubsubFieldToDouble(UA_TYPES_STRING, &b, out));
+    EXPECT_EQ(parsePubSubType("uint32"), UA_TYPES_UINT32);
+    EXPECT_EQ(parsePubSubType("decimal"), -1);
+}
+
+// Поля становятся тегами без опроса; значения приходят пачкой через ingest
+TEST(PubSubSourceTest, FieldsBecomeExternalTags) {
+    const char* path = "test_pubsub.cfg";
+    std::FILE* f = std::fopen(path, "w");
+    ASSERT_NE(f, nullptr);
+    std::fputs(CONFIG, f);
+    std::fclose(f);
+
+    OPCUAClient client;
+    ASSERT_TRUE(client.loadTagConfig(path));
+    PubSubSource source(client);
+    std::string error;
+    ASSERT_TRUE(source.loadConfig(path, &error)) << error;
+    std::remove(path);
+    auto tags = client.getTags();
+    ASSERT_EQ(tags.size(), 4u);
+    EXPECT_EQ(tags[1].name, "Torque");
+    EXPECT_EQ(tags[1].nodeId, "pubsub:drive");
+    EXPECT_EQ(tags[1].pollMs, 0u);
+
+    UA_DataValue values[2];
+    double v[2] = {12.5, 3.0};
+    uint32_t slots[2] = {1, 2};
+    for (int i = 0; i < 2; ++i) {
+        UA_DataValue_init(&values[i]);
+        UA_Variant_setScalar(&values[i].value, &v[i], &UA_TYPES[UA_TYPES_DOUBLE]);
+        values[i].hasValue = true;
+    }
+    client.ingest(slots, values, 2);
+    tags = client.getTags();
+    EXPECT_DOUBLE_EQ(tags[1].value, 12.5);
+    EXPECT_DOUBLE_EQ(tags[2].value, 3.0);
+    EXPECT_EQ(tags[2].quality, "GOOD");
+
+    // Повторная настройка тех же тегов — ошибка
+    PubSubConfig c;
+    ASSERT_TRUE(parsePubSubConfig(CONFIG, c));
+    EXPECT_FALSE(source.configure(c, &error));
+}
@@ -0,0 +1,242 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include "../include/recorder.hpp"
+
+namespace {
+
+std::string tempPath(const char* name) {
+    return (std::filesystem::temp_directory_path() / name).string();
+}
+
+UA_DataValue doubleValue(double& d, UA_DateTime source) {
+    UA_DataValue dv;
+    UA_DataValue_init(&dv);
+    dv.value.type = &UA_TYPES[UA_TYPES_DOUBLE];
+    dv.value.data = &d;
+    dv.hasValue = true;
+    dv.sourceTimestamp = source;
+    dv.hasSourceTimestamp = true;
+    return dv;
+}
+
+std::vector<RecordedChange> readAll(RecordingReader& reader) {
+    std::vector<RecordedChange> all, block;
+    for (size_t i = 0; i < reader.blocks().size(); ++i) {
+        EXPECT_TRUE(reader.readBlock(i, block));
+        all.insert(all.end(), block.begin(), block.end());
+    }
+    return all;
+}
+
+} // namespace
+
+// Сжатие обратимо и на повторяющихся, и на случайных данных
+TEST(RecorderTest, LzRoundTrip) {
+    std::vector<uint8_t> text;
+    for (int i = 0; i < 5000; ++i) {
+        std::string s = "tag" + std::to_string(i % 37) + "=" + std::to_string(i % 5) + ";";
+        text.insert(text.end(), s.begin(), s.end());
+    }
+    std::vector<uint8_t> packed(text.size()), back(text.size());
+    size_t n = lzCompress(text.data(), text.size(), packed.data(), packed.size());
+    ASSERT_GT(n, 0u);
+    EXPECT_LT(n, text.size() / 4);
+    ASSERT_TRUE(lzDecompress(packed.data(), n, back.data(), back.size()));
+    EXPECT_EQ(back, text);
+
+    std::mt19937 rng(7);
+    std::vector<uint8_t> noise(20000);
+    for (auto& b : noise) b = (uint8_t)rng();
+    std::vector<uint8_t> big(noise.size() * 2), out(noise.size());
+    n = lzCompress(noise.data(), noise.size(), big.data(), big.size());
+    ASSERT_GT(n, 0u);
+    ASSERT_TRUE(lzDecompress(big.data(), n, out.data(), out.size()));
+    EXPECT_EQ(out, noise);
+    // Несжимаемые данные не помещаются в буфер размером с исходные
+    EXPECT_EQ(lzCompress(noise.data(), noise.size(), big.data(), noise.size() - 1), 0u);
+}
+
+// Всё записанное читается обратно в том же порядке, с тегами из заголовка
+TEST(RecorderTest, RecordsAndReadsBack) {
+    std::string path = tempPath("opcua_recorder_test.rec");
+    std::vector<OPCUAClient::TagData> tags = {{"Temp", "ns=1;s=Temp"}, {"Press", "ns=1;s=Press"}};
+    const int N = 20000;
+    {
+        SessionRecorder rec;
+        ASSERT_TRUE(rec.open(path, tags));
+        for (int i = 0; i < N; ++i) {
+            double d = i * 0.5;
+            UA_DataValue dv = doubleValue(d, 1000 + i);
+            rec.onValueChanged(i % 2, tags[i % 2], dv);
+        }
+        rec.close();
+        EXPECT_EQ(rec.recorded(), (uint64_t)N);
+        EXPECT_EQ(rec.dropped(), 0u);
+    }
+
+    RecordingReader reader;
+    ASSERT_TRUE(reader.open(path));
+    EXPECT_FALSE(reader.indexRecovered());
+    ASSERT_EQ(reader.tags().size(), 2u);
+    EXPECT_EQ(reader.tags()[1].nodeId, "ns=1;s=Press");
+    EXPECT_GT(reader.blocks().size(), 1u);
+
+    auto all = readAll(reader);
+    ASSERT_EQ(all.size(), (size_t)N);
+    for (int i = 0; i < N; i += 997) {
+        EXPECT_EQ(all[i].kind, RecordedChange::VALUE);
+        EXPECT_EQ(all[i].slot, (uint32_t)(i % 2));
+        EXPECT_EQ(all[i].sourceTime, 1000 + i);
+        UA_DataValue dv;
+        ASSERT_TRUE(RecordingReader::toDataValue(all[i], dv));
+        ASSERT_TRUE(UA_Variant_hasScalarType(&dv.value, &UA_TYPES[UA_TYPES_DOUBLE]));
+        EXPECT_DOUBLE_EQ(*(double*)dv.value.data, i * 0.5);
+        UA_DataValue_clear(&dv);
+    }
+    std::remove(path.c_str());
+}
+
+// Тег, появившийся после начала записи, записывается перед своим значением;
+// файл без индекса читается сканированием блоков
+TEST(RecorderTest, NewTagAndMissingIndex) {
+    std::string path = tempPath("opcua_recorder_tail.rec");
+    std::vector<OPCUAClient::TagData> tags = {{"Temp", "ns=1;s=Temp"}};
+    {
+        SessionRecorder rec;
+        ASSERT_TRUE(rec.open(path, tags));
+        double d = 1.0;
+        UA_DataValue dv = doubleValue(d, 5);
+        rec.onValueChanged(0, tags[0], dv);
+        OPCUAClient::TagData level("Level", "ns=1;s=Level");
+        rec.onValueChanged(1, level, dv);
+        rec.close();
+    }
+    // Отрезаем индекс, как если бы запись оборвалась
+    auto size = std::filesystem::file_size(path);
+    std::filesystem::resize_file(path, size - 16 - 8 - 32);
+
+    RecordingReader reader;
+    ASSERT_TRUE(reader.open(path));
+    EXPECT_TRUE(reader.indexRecovered());
+    auto all = readAll(reader);
+    ASSERT_EQ(all.size(), 3u);
+    EXPECT_EQ(all[1].kind, RecordedChange::TAG);
+    EXPECT_EQ(all[1].slot, 1u);
+    EXPECT_EQ(all[1].bytes, std::string("Level\0ns=1;s=Level", 18));
+    EXPECT_EQ(all[2].slot, 1u);
+    std::remove(path.c_str());
+}
+
+// Потерянная запись тега не меняет известное имя слота, а значение без неё не пишется
+TEST(RecorderTest, DroppedTagRecordKeepsSlotName) {
+    std::string path = tempPath("opcua_recorder_drop.rec");
+    std::vector<OPCUAClient::TagData> tags = {{"Temp", "ns=1;s=Temp"}};
+    {
+        SessionRecorder rec(4096);
+        ASSERT_TRUE(rec.open(path, tags));
+        double d = 1.0;
+        UA_DataValue dv = doubleValue(d, 5);
+        // Запись тега больше половины очереди в неё не помещается
+        OPCUAClient::TagData huge(std::string(3000, 'x'), "ns=1;s=Huge");
+        rec.onValueChanged(0, huge, dv);
+        EXPECT_EQ(rec.dropped(), 2u);
+        rec.onValueChanged(0, tags[0], dv);
+        OPCUAClient::TagData level("Level", "ns=1;s=Level");
+        rec.onValueChanged(0, level, dv);
+        rec.close();
+        EXPECT_EQ(rec.dropped(), 2u);
+    }
+
+    RecordingReader reader;
+    ASSERT_TRUE(reader.open(path));
+    auto all = readAll(reader);
+    ASSERT_EQ(all.size(), 3u);
+    EXPECT_EQ(all[0].kind, RecordedChange::VALUE);
+    EXPECT_EQ(all[1].kind, RecordedChange::TAG);
+    EXPECT_EQ(all[1].bytes, std::string("Level\0ns=1;s=Level", 18));
+    EXPECT_EQ(all[2].kind, RecordedChange::VALUE);
+    std::remove(path.c_str());
+}
+
+// Double восстанавливаются бит в бит после XOR-кодирования, включая повторы и NaN;
+// записи одного цикла получают общее время приёма
+TEST(RecorderTest, XorDoublesAndCycleTimesRoundTrip) {
+    std::string path = tempPath("opcua_recorder_xor.rec");
+    std::vector<OPCUAClient::TagData> tags = {{"A", "ns=1;s=A"}, {"B", "ns=1;s=B"}, {"C", "ns=1;s=C"}};
+    std::mt19937 rng(3);
+    std::normal_distribution<double> noise(0.0, 0.2);
+    std::vector<double> written;
+    double level = 50.0;
+    {
+        SessionRecorder rec;
+        ASSERT_TRUE(rec.open(path, tags));
+        for (int cycle = 0; cycle < 3000; ++cycle) {
+            for (size_t slot = 0; slot < tags.size(); ++slot) {
+                level += noise(rng);
+                double d = slot == 0 ? std::round(level * 10) / 10 : slot == 1 ? level : (cycle % 7 ? 1.0 : NAN);
+                written.push_back(d);
+                UA_DataValue dv = doubleValue(d, 1000 + cycle);
+                rec.onValueChanged(slot, tags[slot], dv);
+            }
+            rec.onCycleEnd();
+        }
+        rec.close();
+    }
+
+    RecordingReader reader;
+    ASSERT_TRUE(reader.open(path));
+    auto all = readAll(reader);
+    ASSERT_EQ(all.size(), written.size());
+    for (size_t i = 0; i < all.size(); ++i) {
+        ASSERT_EQ(all[i].bytes.size(), 9u);
+        uint64_t got, want;
+        std::memcpy(&got, all[i].bytes.data() + 1, 8);
+        std::memcpy(&want, &written[i], 8);
+        ASSERT_EQ(got, want) << i;
+        EXPECT_EQ(all[i].sourceTime, 1000 + (UA_DateTime)(i / tags.size()));
+        if (i % tags.size()) {
+            EXPECT_EQ(all[i].received, all[i - 1].received);
+        } else if (i) {
+            EXPECT_GE(all[i].received, all[i - 1].received);
+        }
+    }
+    std::remove(path.c_str());
+}
+
+// Файл прежнего формата с блоками "BLK1" читается
+TEST(RecorderTest, ReadsVersionOneBlocks) {
+    std::string path = tempPath("opcua_recorder_v1.rec");
+    double d = 2.5;
+    std::vector<uint8_t> data = {8, 0, 0xc8, 0x01};  // Double, слот 0, время приёма 100
+    data.insert(data.end(), (const uint8_t*)&d, (const uint8_t*)&d + 8);
+    std::vector<uint8_t> file = {'O', 'P', 'C', 'U', 'R', 'E', 'C', '1', 0, 0, 0, 0};
+    auto put32 = [&](uint32_t v) { file.insert(file.end(), (const uint8_t*)&v, (const uint8_t*)&v + 4); };
+    auto put64 = [&](int64_t v) { file.insert(file.end(), (const uint8_t*)&v, (const uint8_t*)&v + 8); };
+    put32(0x314b4c42);
+    put32((uint32_t)data.size());
+    put32((uint32_t)data.size());
+    put32(1);
+    put64(100);
+    put64(100);
+    file.insert(file.end(), data.begin(), data.end());
+    FILE* f = std::fopen(path.c_str(), "wb");
+    ASSERT_NE(f, nullptr);
+    std::fwrite(file.data(), 1, file.size(), f);
+    std::fclose(f);
+
+    RecordingReader reader;
+    ASSERT_TRUE(reader.open(path));
+    EXPECT_TRUE(reader.indexRecovered());
+    auto all = readAll(reader);
+    ASSERT_EQ(all.size(), 1u);
+    EXPECT_EQ(all[0].received, 100);
+    UA_DataValue dv;
+    ASSERT_TRUE(RecordingReader::toDataValue(all[0], dv));
+    EXPECT_EQ(*(double*)dv.value.data, 2.5);
+    UA_DataValue_clear(&dv);
+    std::remove(path.c_str());
+}
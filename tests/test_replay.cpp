@@ -0,0 +1,155 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <filesystem>
+#include <thread>
+#include "../include/history.hpp"
+#include "../include/replay.hpp"
+
+namespace {
+
+std::string tempPath(const char* name) {
+    return (std::filesystem::temp_directory_path() / name).string();
+}
+
+// Запись: cycles циклов, в каждом оба тега меняются на номер цикла
+void writeSession(const std::string& path, int cycles) {
+    std::vector<OPCUAClient::TagData> tags = {{"Temp", "ns=1;s=Temp"}, {"Press", "ns=1;s=Press"}};
+    SessionRecorder rec;
+    ASSERT_TRUE(rec.open(path, tags));
+    for (int c = 0; c < cycles; ++c) {
+        for (size_t slot = 0; slot < tags.size(); ++slot) {
+            UA_Double v = c + slot * 1000.0;
+            UA_DataValue dv;
+            UA_DataValue_init(&dv);
+            UA_Variant_setScalar(&dv.value, &v, &UA_TYPES[UA_TYPES_DOUBLE]);
+            dv.hasValue = true;
+            rec.onValueChanged(slot, tags[slot], dv);
+        }
+        rec.onCycleEnd();
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    rec.close();
+}
+
+} // namespace
+
+// Без пауз запись целиком проходит через хранилище: теги из заголовка, последние значения
+TEST(ReplayTest, ReplaysIntoStore) {
+    std::string path = tempPath("opcua_replay_test.rec");
+    writeSession(path, 20);
+
+    OPCUAClient store;
+    SessionPlayer player(store);
+    ASSERT_TRUE(player.open(path));
+    ASSERT_EQ(store.tagCount(), 2u);
+    player.setSpeed(0);
+    while (player.step() > 0) {}
+    EXPECT_TRUE(player.finished());
+    EXPECT_EQ(player.applied(), 40u);
+
+    OPCUAClient::TagData tag("", "");
+    ASSERT_TRUE(store.getTag(1, tag));
+    EXPECT_EQ(tag.name, "Press");
+    EXPECT_DOUBLE_EQ(tag.value, 1019.0);
+    std::remove(path.c_str());
+}
+
+// Перемотка к концу пропускает всё, что раньше; на паузе записи не применяются
+TEST(ReplayTest, SeekAndPause) {
+    std::string path = tempPath("opcua_replay_seek.rec");
+    writeSession(path, 20);
+
+    OPCUAClient store;
+    SessionPlayer player(store);
+    ASSERT_TRUE(player.open(path));
+    player.setSpeed(0);
+    player.setPaused(true);
+    EXPECT_EQ(player.step(), 0u);
+    player.setPaused(false);
+
+    player.seek(player.end());
+    while (player.step() > 0) {}
+    EXPECT_EQ(player.applied(), 2u);
+    OPCUAClient::TagData tag("", "");
+    ASSERT_TRUE(store.getTag(0, tag));
+    EXPECT_DOUBLE_EQ(tag.value, 19.0);
+
+    // Назад — к началу: снова вся запись
+    player.seek(player.begin());
+    EXPECT_FALSE(player.finished());
+    while (player.step() > 0) {}
+    EXPECT_EQ(player.applied(), 42u);
+    std::remove(path.c_str());
+}
+
+// Тег, объявленный в пропущенном блоке, появляется в хранилище и при перемотке вперёд
+TEST(ReplayTest, SeekAppliesTagsOfSkippedBlocks) {
+    std::string path = tempPath("opcua_replay_tags.rec");
+    std::vector<OPCUAClient::TagData> tags = {{"Temp", "ns=1;s=Temp"}};
+    OPCUAClient::TagData level("Level", "ns=1;s=Level");
+    {
+        SessionRecorder rec;
+        ASSERT_TRUE(rec.open(path, tags));
+        for (int c = 0; c < 400; ++c) {
+            for (int k = 0; k < 100; ++k) {
+                UA_Double v = c * 100 + k;
+                UA_DataValue dv;
+                UA_DataValue_init(&dv);
+                UA_Variant_setScalar(&dv.value, &v, &UA_TYPES[UA_TYPES_DOUBLE]);
+                dv.hasValue = true;
+                // Level появляется в первом цикле и дальше пишется вместе с Temp
+                if (k % 2) rec.onValueChanged(1, level, dv);
+                else rec.onValueChanged(0, tags[0], dv);
+            }
+            rec.onCycleEnd();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        rec.close();
+    }
+
+    OPCUAClient store;
+    SessionPlayer player(store);
+    ASSERT_TRUE(player.open(path));
+    RecordingReader reader;
+    ASSERT_TRUE(reader.open(path));
+    ASSERT_GT(reader.blocks().size(), 1u);
+    // Индекс знает, в каких блоках есть записи TAG: остальные перемотка не читает
+    EXPECT_EQ(reader.blocks().front().tagRecords, 1u);
+    EXPECT_EQ(reader.blocks().back().tagRecords, 0u);
+    EXPECT_EQ(store.tagCount(), 1u);
+
+    player.setSpeed(0);
+    player.seek(player.end());
+    while (player.step() > 0) {}
+    OPCUAClient::TagData tag("", "");
+    ASSERT_EQ(store.tagCount(), 2u);
+    ASSERT_TRUE(store.getTag(1, tag));
+    EXPECT_EQ(tag.name, "Level");
+    EXPECT_DOUBLE_EQ(tag.value, 39999.0);
+    std::remove(path.c_str());
+}
+
+// Перемотка назад сбрасывает историю: значения не воспроизводятся в неё второй раз
+TEST(ReplayTest, RewindResetsSinks) {
+    std::string path = tempPath("opcua_replay_rewind.rec");
+    writeSession(path, 20);
+
+    OPCUAClient store;
+    auto history = std::make_shared<HistorySink>(100);
+    store.addSink(history);
+    SessionPlayer player(store);
+    ASSERT_TRUE(player.open(path));
+    player.setSpeed(0);
+    while (player.step() > 0) {}
+    std::vector<double> values;
+    ASSERT_TRUE(history->copy(0, "Temp", values));
+    EXPECT_EQ(values.size(), 20u);
+
+    player.seek(player.begin());
+    while (player.step() > 0) {}
+    ASSERT_TRUE(history->copy(0, "Temp", values));
+    ASSERT_EQ(values.size(), 20u);
+    EXPECT_DOUBLE_EQ(values.front(), 0.0);
+    EXPECT_DOUBLE_EQ(values.back(), 19.0);
+    std::remove(path.c_str());
+}
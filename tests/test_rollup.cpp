@@ -0,0 +1,65 @@
+#include <gtest/gtest.h>
+#include "../include/rollup.hpp"
+
+// Каждое значение попадает во все ступени; сводка интервала — min/max/среднее/последнее
+TEST(RollupTest, AggregatesIntoAllTiers) {
+    RollupSeries r;
+    // 0..119 с по одному значению в 100 мс
+    for (int i = 0; i < 1200; ++i) r.add((int64_t)i * 100, (double)(i % 10));
+
+    std::vector<RollupBucket> out;
+    r.copy(0, 0, 120000, out);
+    ASSERT_EQ(out.size(), 120u);
+    EXPECT_EQ(out[5].start, 5000);
+    EXPECT_EQ(out[5].count, 10u);
+    EXPECT_EQ(out[5].min, 0.0);
+    EXPECT_EQ(out[5].max, 9.0);
+    EXPECT_DOUBLE_EQ(out[5].mean(), 4.5);
+    EXPECT_EQ(out[5].last, 9.0);
+
+    r.copy(1, 0, 120000, out);
+    ASSERT_EQ(out.size(), 2u);
+    EXPECT_EQ(out[1].start, 60000);
+    EXPECT_EQ(out[1].count, 600u);
+
+    r.copy(2, 0, 120000, out);
+    ASSERT_EQ(out.size(), 1u);
+    EXPECT_EQ(out[0].count, 1200u);
+    EXPECT_EQ(r.bucketCount(), 123u);
+}
+
+// Кольцо ступени хранит последние интервалы; запрос возвращает только пересекающие диапазон
+TEST(RollupTest, KeepsNewestBucketsAndSelectsRange) {
+    RollupSeries r(10, 10, 10);
+    for (int i = 0; i < 25; ++i) r.add((int64_t)i * 1000 + 500, (double)i);
+    int64_t start;
+    ASSERT_TRUE(r.oldest(0, start));
+    EXPECT_EQ(start, 15000);
+    EXPECT_FALSE(RollupSeries(1, 1, 1).oldest(0, start));
+
+    std::vector<RollupBucket> out;
+    r.copy(0, 17500, 20000, out);
+    ASSERT_EQ(out.size(), 3u);
+    EXPECT_EQ(out.front().start, 17000);
+    EXPECT_EQ(out.back().last, 19.0);
+
+    // Метка раньше последнего интервала учитывается в нём, а не создаёт новый
+    r.add(1000, 100.0);
+    r.copy(0, 24000, 25000, out);
+    ASSERT_EQ(out.size(), 1u);
+    EXPECT_EQ(out[0].count, 2u);
+    EXPECT_EQ(out[0].max, 100.0);
+}
+
+// Значение к началу окна — из самой мелкой ступени, которая ещё помнит это время
+TEST(RollupTest, LastBeforeFallsBackToCoarserTier) {
+    RollupSeries r(3, 10, 10);
+    for (int i = 0; i < 10; ++i) r.add((int64_t)i * 1000 + 500, (double)i);
+    double v = 0;
+    ASSERT_TRUE(r.lastBefore(9000, v));
+    EXPECT_EQ(v, 8.0);
+    // Секундная ступень начинается с 7 с — значение на конец минутного интервала
+    ASSERT_TRUE(r.lastBefore(5000, v));
+    EXPECT_EQ(v, 9.0);
+    EXPECT_FALSE(r.lastBefore(0, v));
+}
@@ -0,0 +1,70 @@
+#include <gtest/gtest.h>
+#include <cstring>
+#include "../include/security.hpp"
+
+// Короткие имена и полные URI политик
+TEST(SecurityTest, PolicyNames) {
+    EXPECT_EQ(securityPolicyUri("None"), "http://opcfoundation.org/UA/SecurityPolicy#None");
+    EXPECT_EQ(securityPolicyUri("Basic256Sha256"), "http://opcfoundation.org/UA/SecurityPolicy#Basic256Sha256");
+    EXPECT_EQ(securityPolicyUri("http://opcfoundation.org/UA/SecurityPolicy#Aes128_Sha256_RsaOaep"),
+              "http://opcfoundation.org/UA/SecurityPolicy#Aes128_Sha256_RsaOaep");
+    EXPECT_EQ(securityPolicyUri("Basic512"), "");
+
+    UA_MessageSecurityMode mode = UA_MESSAGESECURITYMODE_INVALID;
+    EXPECT_TRUE(parseSecurityMode("signencrypt", mode));
+    EXPECT_EQ(mode, UA_MESSAGESECURITYMODE_SIGNANDENCRYPT);
+    EXPECT_TRUE(parseSecurityMode("sign", mode));
+    EXPECT_EQ(mode, UA_MESSAGESECURITYMODE_SIGN);
+    EXPECT_FALSE(parseSecurityMode("encrypt", mode));
+}
+
+TEST(SecurityTest, TrustArgument) {
+    SecurityConfig s;
+    parseTrustArgument("a.der,,b.pem", s);
+    ASSERT_EQ(s.trust.size(), 2u);
+    EXPECT_EQ(s.trust[1], "b.pem");
+    EXPECT_FALSE(s.acceptAnyServer);
+    parseTrustArgument("any", s);
+    EXPECT_TRUE(s.trust.empty());
+    EXPECT_TRUE(s.acceptAnyServer);
+}
+
+// Несовместимые настройки отклоняются до подключения, конфигурация не меняется
+TEST(SecurityTest, RejectsBadSettings) {
+    UA_ClientConfig config;
+    std::memset(&config, 0, sizeof(config));
+    std::string error;
+    SecurityConfig s;
+    s.policy = "Basic512";
+    EXPECT_FALSE(applySecurity(&config, s, &error));
+    EXPECT_NE(error.find("policy"), std::string::npos);
+
+    s.policy = "None";
+    s.mode = "signencrypt";
+    EXPECT_FALSE(applySecurity(&config, s, &error));
+    s.policy = "Basic256Sha256";
+    s.mode = "none";
+    EXPECT_FALSE(applySecurity(&config, s, &error));
+
+    // Шифрование без доверенных сертификатов сервера — только по явному "any"
+    s.mode = "";
+    EXPECT_FALSE(applySecurity(&config, s, &error));
+    EXPECT_NE(error.find("trust"), std::string::npos);
+    s.certificate = "client.der";
+    s.acceptAnyServer = true;
+    EXPECT_FALSE(applySecurity(&config, s, &error));
+    EXPECT_EQ(config.securityMode, 0);
+}
+
+TEST(SecurityTest, NonePolicyTunesLifetimes) {
+    UA_ClientConfig config;
+    std::memset(&config, 0, sizeof(config));
+    SecurityConfig s;
+    ASSERT_TRUE(applySecurity(&config, s));
+    EXPECT_EQ(config.securityMode, UA_MESSAGESECURITYMODE_NONE);
+    EXPECT_EQ(std::string((const char*)config.securityPolicyUri.data, config.securityPolicyUri.length),
+              "http://opcfoundation.org/UA/SecurityPolicy#None");
+    EXPECT_EQ(config.secureChannelLifeTime, 3600u * 1000);
+    EXPECT_EQ(config.requestedSessionTimeout, 3600.0 * 1000);
+    UA_String_clear(&config.securityPolicyUri);
+}
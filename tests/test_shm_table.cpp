@@ -0,0 +1,78 @@
+#include <gtest/gtest.h>
+#include "../include/shm_table.hpp"
+
+// Читатель видит имя, значение и версию, записанные публикатором
+TEST(ShmTableTest, ReaderSeesPublishedValue) {
+    ShmPublisher publisher;
+    ASSERT_TRUE(publisher.create("/opcua_shm_test", 16));
+
+    OPCUAClient::TagData tag("Voltage", "ns=2;i=2");
+    tag.value = 230.5;
+    tag.sourceTime = 123456;
+    UA_DataValue dv;
+    UA_DataValue_init(&dv);
+    publisher.onValueChanged(1, tag, dv);
+
+    ShmTagReader reader;
+    ASSERT_TRUE(reader.open("/opcua_shm_test"));
+    EXPECT_EQ(reader.size(), 2u);
+    EXPECT_EQ(reader.name(1), "Voltage");
+    EXPECT_EQ(reader.nodeId(1), "ns=2;i=2");
+
+    ShmTagReader::Sample sample;
+    EXPECT_FALSE(reader.read(0, sample));  // слот 0 ещё не записывался
+    ASSERT_TRUE(reader.read(1, sample));
+    EXPECT_DOUBLE_EQ(sample.value, 230.5);
+    EXPECT_EQ(sample.sourceTime, 123456);
+    EXPECT_EQ(sample.version, 1u);
+
+    tag.value = 231.0;
+    publisher.onValueChanged(1, tag, dv);
+    ASSERT_TRUE(reader.read(1, sample));
+    EXPECT_DOUBLE_EQ(sample.value, 231.0);
+    EXPECT_EQ(sample.version, 2u);
+}
+
+// Слоты за пределами ёмкости сегмента игнорируются
+TEST(ShmTableTest, OutOfCapacityIgnored) {
+    ShmPublisher publisher;
+    ASSERT_TRUE(publisher.create("/opcua_shm_small", 1));
+    OPCUAClient::TagData tag("T", "ns=2;i=1");
+    UA_DataValue dv;
+    UA_DataValue_init(&dv);
+    publisher.onValueChanged(5, tag, dv);
+
+    ShmTagReader reader;
+    ASSERT_TRUE(reader.open("/opcua_shm_small"));
+    EXPECT_EQ(reader.size(), 0u);
+}
+
+// Другой тег в слоте переписывает имена; освобождённые слоты не читаются
+TEST(ShmTableTest, ReplacedTagsRewriteNames) {
+    ShmPublisher publisher;
+    ASSERT_TRUE(publisher.create("/opcua_shm_replace", 16));
+    UA_DataValue dv;
+    UA_DataValue_init(&dv);
+    OPCUAClient::TagData voltage("Voltage", "ns=2;i=2");
+    OPCUAClient::TagData current("Current", "ns=2;i=3");
+    publisher.onValueChanged(0, voltage, dv);
+    publisher.onValueChanged(1, current, dv);
+
+    ShmTagReader reader;
+    ASSERT_TRUE(reader.open("/opcua_shm_replace"));
+    ASSERT_EQ(reader.size(), 2u);
+
+    publisher.truncate(0);
+    EXPECT_EQ(reader.size(), 0u);
+    ShmTagReader::Sample sample;
+    EXPECT_FALSE(reader.read(1, sample));
+
+    OPCUAClient::TagData flow("Flow", "ns=3;s=Flow");
+    flow.value = 4.5;
+    publisher.onValueChanged(0, flow, dv);
+    ASSERT_EQ(reader.size(), 1u);
+    EXPECT_EQ(reader.name(0), "Flow");
+    EXPECT_EQ(reader.nodeId(0), "ns=3;s=Flow");
+    ASSERT_TRUE(reader.read(0, sample));
+    EXPECT_DOUBLE_EQ(sample.value, 4.5);
+}
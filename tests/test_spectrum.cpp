@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include "../include/spectrum.hpp"
+
+namespace {
+
+const double PI = 3.14159265358979323846;
+
+std::vector<double> sine(size_t n, double amplitude, double cycles, double offset = 0) {
+    std::vector<double> x(n);
+    for (size_t i = 0; i < n; ++i) x[i] = offset + amplitude * std::sin(2 * PI * cycles * (double)i / (double)n);
+    return x;
+}
+
+} // namespace
+
+// Совпадает с прямым ДПФ на всех размерах, включая наименьший
+TEST(SpectrumTest, FftMatchesDirectDft) {
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<double> dist(-1, 1);
+    for (size_t n : {4u, 8u, 64u, 1024u}) {
+        FftPlan plan(n);
+        std::vector<double> x(n);
+        for (auto& v : x) v = dist(rng);
+        std::vector<double> re(n / 2 + 1), im(n / 2 + 1);
+        plan.forward(x.data(), re.data(), im.data());
+        for (size_t k = 0; k <= n / 2; ++k) {
+            double dr = 0, di = 0;
+            for (size_t t = 0; t < n; ++t) {
+                dr += x[t] * std::cos(-2 * PI * (double)(k * t) / (double)n);
+                di += x[t] * std::sin(-2 * PI * (double)(k * t) / (double)n);
+            }
+            ASSERT_NEAR(re[k], dr, 1e-9 * (double)n) << "n=" << n << " k=" << k;
+            ASSERT_NEAR(im[k], di, 1e-9 * (double)n) << "n=" << n << " k=" << k;
+        }
+    }
+}
+
+// Синус точно на бине: амплитуда восстанавливается, постоянная составляющая убрана
+TEST(SpectrumTest, RecoversSineAmplitude) {
+    SpectrumAnalyzer analyzer(1024, 0.5);
+    std::vector<double> out;
+    ASSERT_TRUE(analyzer.compute(sine(1024, 3.0, 64, 100.0), out));
+    ASSERT_EQ(out.size(), 513u);
+    EXPECT_EQ(analyzer.size(), 1024u);
+    EXPECT_EQ(analyzer.segments(), 1u);
+    EXPECT_NEAR(out[64], 3.0, 1e-9);
+    EXPECT_LT(out[0], 1e-9);
+    EXPECT_LT(out[200], 1e-9);
+    size_t peak = std::max_element(out.begin(), out.end()) - out.begin();
+    EXPECT_EQ(peak, 64u);
+}
+
+// Длинная запись делится на сегменты с перекрытием, короткая — на меньший размер
+TEST(SpectrumTest, SegmentsAndShortInput) {
+    SpectrumAnalyzer analyzer(256, 0.5);
+    std::vector<double> out;
+    // 1024 отсчёта, сегмент 256, шаг 128: (1024 - 256) / 128 + 1
+    ASSERT_TRUE(analyzer.compute(sine(1024, 1.0, 32), out));
+    EXPECT_EQ(analyzer.segments(), 7u);
+    EXPECT_NEAR(out[8], 1.0, 1e-9);
+
+    ASSERT_TRUE(analyzer.compute(sine(100, 1.0, 10), out));
+    EXPECT_EQ(analyzer.size(), 64u);
+    EXPECT_EQ(out.size(), 33u);
+    EXPECT_FALSE(analyzer.compute(std::vector<double>(7, 1.0), out));
+}
+
+// Изменения с неравными промежутками держатся до следующего; сетка кончается на последней точке
+TEST(SpectrumTest, ResampleHoldsChanges) {
+    std::vector<int64_t> times = {1000, 1030, 1100, 1110};
+    std::vector<double> values = {1, 2, 3, 4};
+    std::vector<double> out;
+    ASSERT_EQ(resampleHold(times, values, 20, 100, out), 20);
+    // Узлы 1010, 1030, ..., 1110
+    EXPECT_EQ(out, (std::vector<double>{1, 2, 2, 2, 2, 4}));
+
+    ASSERT_EQ(resampleHold(times, values, 20, 3, out), 20);
+    EXPECT_EQ(out, (std::vector<double>{2, 2, 4}));
+
+    // Без шага — медиана интервалов 30, 70, 10; узлы 1020, 1050, 1080, 1110
+    ASSERT_EQ(resampleHold(times, values, 0, 100, out), 30);
+    EXPECT_EQ(out, (std::vector<double>{1, 2, 2, 4}));
+
+    EXPECT_EQ(resampleHold({5}, {1}, 10, 100, out), 0);
+    EXPECT_TRUE(out.empty());
+}
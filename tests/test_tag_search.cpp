@@ -0,0 +1,69 @@
+#include <gtest/gtest.h>
+#include <string>
+#include "../include/tag_search.hpp"
+
+namespace {
+
+TagIndex sampleIndex() {
+    TagIndex index;
+    index.add(0, "Temperature", "ns=2;i=1");
+    index.add(1, "Voltage", "ns=2;i=2");
+    index.add(2, "Boiler.Temperature.Outlet", "ns=2;i=3");
+    index.add(3, "Pressure", "ns=2;i=40");
+    return index;
+}
+
+} // namespace
+
+// Совпадение с начала имени выше вхождения в середине
+TEST(TagIndexTest, RanksPrefixAboveSubstring) {
+    TagIndex index = sampleIndex();
+    auto found = index.search("temper", 10);
+    ASSERT_EQ(found.size(), 2u);
+    EXPECT_EQ(found[0], 0u);
+    EXPECT_EQ(found[1], 2u);
+}
+
+TEST(TagIndexTest, ToleratesTypos) {
+    TagIndex index = sampleIndex();
+    auto found = index.search("temprature", 10);
+    ASSERT_FALSE(found.empty());
+    EXPECT_EQ(found[0], 0u);
+}
+
+TEST(TagIndexTest, SearchesNodeIdsAndShortPrefixes) {
+    TagIndex index = sampleIndex();
+    auto found = index.search("i=40", 10);
+    ASSERT_FALSE(found.empty());
+    EXPECT_EQ(found[0], 3u);
+
+    found = index.search("vo", 10);
+    ASSERT_EQ(found.size(), 1u);
+    EXPECT_EQ(found[0], 1u);
+    EXPECT_EQ(index.search("", 3).size(), 3u);
+}
+
+// Короткий запрос: тег, совпавший и именем, и NodeId, занимает одно место из limit
+TEST(TagIndexTest, PrefixLimitCountsTagsOnce) {
+    TagIndex index;
+    index.add(0, "ns=2;s=Pump", "ns=2;s=Pump");
+    index.add(1, "ns=2;s=Valve", "ns=2;s=Valve");
+    index.add(2, "ns=2;s=Fan", "ns=2;s=Fan");
+    auto found = index.search("ns", 2);
+    ASSERT_EQ(found.size(), 2u);
+    EXPECT_EQ(found[0], 0u);
+    EXPECT_EQ(found[1], 2u);
+    EXPECT_EQ(index.search("ns", 10).size(), 3u);
+}
+
+// 100 тыс. тегов: нужный находится первым (время запроса — в opcua_search_bench)
+TEST(TagIndexTest, LargeIndex) {
+    TagIndex index;
+    for (uint32_t i = 0; i < 100000; ++i) {
+        index.add(i, "Plant" + std::to_string(i % 97) + ".Unit" + std::to_string(i) + ".Flow",
+                  "ns=2;i=" + std::to_string(1000 + i));
+    }
+    auto found = index.search("unit4242.flow", 20);
+    ASSERT_FALSE(found.empty());
+    EXPECT_EQ(found[0], 4242u);
+}
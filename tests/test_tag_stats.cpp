@@ -0,0 +1,70 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+#include "../include/tag_stats.hpp"
+
+// Скользящее окно совпадает с прямым пересчётом по последним значениям
+TEST(TagStatsTest, SlidingWindowMatchesDirect) {
+    SlidingWindow window(50);
+    std::vector<double> all;
+    std::mt19937 rng(7);
+    std::normal_distribution<double> noise(100.0, 5.0);
+    for (int i = 0; i < 1000; ++i) {
+        double x = noise(rng) + (i > 500 ? 30.0 : 0.0);
+        window.add(x);
+        all.push_back(x);
+    }
+    std::vector<double> last(all.end() - 50, all.end());
+    double mean = 0.0;
+    for (double x : last) mean += x;
+    mean /= last.size();
+    double var = 0.0;
+    for (double x : last) var += (x - mean) * (x - mean);
+    var /= last.size() - 1;
+
+    EXPECT_EQ(window.size(), 50u);
+    EXPECT_NEAR(window.mean(), mean, 1e-9);
+    EXPECT_NEAR(window.variance(), var, 1e-6);
+    EXPECT_DOUBLE_EQ(window.min(), *std::min_element(last.begin(), last.end()));
+    EXPECT_DOUBLE_EQ(window.max(), *std::max_element(last.begin(), last.end()));
+}
+
+TEST(TagStatsTest, RunningStatsMoments) {
+    RunningStats s;
+    for (double x : {2.0, 4.0, 4.0, 4.0, 5.0, 5.0, 7.0, 9.0}) s.add(x);
+    EXPECT_EQ(s.count(), 8u);
+    EXPECT_DOUBLE_EQ(s.mean(), 5.0);
+    EXPECT_NEAR(s.variance(), 32.0 / 7.0, 1e-12);
+    EXPECT_DOUBLE_EQ(s.min(), 2.0);
+    EXPECT_DOUBLE_EQ(s.max(), 9.0);
+}
+
+// P² на равномерном распределении близок к точным квантилям
+TEST(TagStatsTest, P2QuantileConverges) {
+    P2Quantile median(0.5), tail(0.95);
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<double> u(0.0, 1000.0);
+    for (int i = 0; i < 20000; ++i) {
+        double x = u(rng);
+        median.add(x);
+        tail.add(x);
+    }
+    EXPECT_NEAR(median.value(), 500.0, 20.0);
+    EXPECT_NEAR(tail.value(), 950.0, 20.0);
+}
+
+// Квантили окна следуют за сменой уровня сигнала
+TEST(TagStatsTest, WindowQuantilesFollowShift) {
+    TagStats stats(100);
+    for (int i = 0; i < 1000; ++i) stats.add(10.0 + (i % 10));
+    for (int i = 0; i < 300; ++i) stats.add(100.0 + (i % 10));
+    auto s = stats.summary();
+    EXPECT_EQ(s.count, 1300u);
+    EXPECT_EQ(s.window, 100u);
+    EXPECT_NEAR(s.mean, 104.5, 1e-9);
+    EXPECT_GE(s.p50, 100.0);
+    EXPECT_LE(s.p95, 110.0);
+    EXPECT_LT(s.total_mean, s.mean);
+}
@@ -0,0 +1,42 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <vector>
+#include "../include/timing_wheel.hpp"
+
+// Элемент срабатывает ровно на своём тике, не раньше
+TEST(TimingWheelTest, FiresOnDueTick) {
+    TimingWheel wheel;
+    wheel.schedule(1, 5);
+    std::vector<uint32_t> due;
+    wheel.advance(4, due);
+    EXPECT_TRUE(due.empty());
+    wheel.advance(5, due);
+    ASSERT_EQ(due.size(), 1u);
+    EXPECT_EQ(due[0], 1u);
+    EXPECT_EQ(wheel.size(), 0u);
+}
+
+// Дальние сроки проходят каскадом через все уровни и не теряются
+TEST(TimingWheelTest, CascadesAcrossLevels) {
+    TimingWheel wheel(100);
+    const std::vector<uint64_t> deadlines = {101, 163, 164, 4196, 300000, 360000 + 100};
+    for (size_t i = 0; i < deadlines.size(); ++i) wheel.schedule((uint32_t)i, deadlines[i]);
+
+    std::vector<uint32_t> due;
+    for (size_t i = 0; i < deadlines.size(); ++i) {
+        wheel.advance(deadlines[i] - 1, due);
+        EXPECT_EQ(due.size(), i) << "early fire before " << deadlines[i];
+        wheel.advance(deadlines[i], due);
+        ASSERT_EQ(due.size(), i + 1);
+        EXPECT_EQ(due.back(), (uint32_t)i);
+    }
+}
+
+// Все элементы одного тика возвращаются вместе — клиент читает их одним запросом
+TEST(TimingWheelTest, BatchesSameTick) {
+    TimingWheel wheel;
+    for (uint32_t id = 0; id < 1000; ++id) wheel.schedule(id, 70);
+    std::vector<uint32_t> due;
+    wheel.advance(70, due);
+    EXPECT_EQ(due.size(), 1000u);
+}
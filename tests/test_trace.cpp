@@ -0,0 +1,38 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include "../include/trace.hpp"
+
+// Пока трассировка выключена, события не записываются
+TEST(TraceTest, DisabledRecordsNothing) {
+    Trace::setEnabled(false);
+    { TRACE_SCOPE("ignored"); }
+    ASSERT_TRUE(Trace::writeChromeJson("trace_disabled.json"));
+    std::ifstream in("trace_disabled.json");
+    std::stringstream ss;
+    ss << in.rdbuf();
+    EXPECT_EQ(ss.str().find("ignored"), std::string::npos);
+    std::remove("trace_disabled.json");
+}
+
+// События из нескольких потоков попадают в один JSON с парами B/E
+TEST(TraceTest, WritesBeginEndPairs) {
+    Trace::setEnabled(true);
+    { TRACE_SCOPE("main_work"); }
+    std::thread worker([] { TRACE_SCOPE("worker_work"); });
+    worker.join();
+    Trace::setEnabled(false);
+
+    ASSERT_TRUE(Trace::writeChromeJson("trace_test.json"));
+    std::ifstream in("trace_test.json");
+    std::stringstream ss;
+    ss << in.rdbuf();
+    std::string json = ss.str();
+    EXPECT_NE(json.find("\"traceEvents\""), std::string::npos);
+    EXPECT_NE(json.find("\"name\":\"main_work\",\"ph\":\"B\""), std::string::npos);
+    EXPECT_NE(json.find("\"name\":\"main_work\",\"ph\":\"E\""), std::string::npos);
+    EXPECT_NE(json.find("\"name\":\"worker_work\",\"ph\":\"E\""), std::string::npos);
+    std::remove("trace_test.json");
+}
@@ -0,0 +1,65 @@
+#include <gtest/gtest.h>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include "../include/ua_allocator.hpp"
+
+// Во втором цикле те же размеры обслуживаются из кэша без системной кучи
+TEST(UaAllocatorTest, SteadyStateHitsCache) {
+    UaAllocator::installForThisThread(true);
+    auto cycle = [] {
+        std::vector<void*> blocks;
+        for (size_t size : {8u, 24u, 100u, 1000u, 5000u}) blocks.push_back(UaAllocator::allocate(size));
+        for (void* p : blocks) UaAllocator::release(p);
+    };
+
+    cycle();
+    uint64_t warm = UaAllocator::threadStats().systemAllocs;
+    EXPECT_GT(warm, 0u);
+
+    UaAllocator::CycleScope scope;
+    cycle();
+    EXPECT_EQ(scope.systemAllocs(), 0u);
+    EXPECT_EQ(UaAllocator::threadStats().systemAllocs, warm);
+    UaAllocator::uninstallForThisThread();
+}
+
+// Без кэша каждое выделение идёт в систему, но учитывается в статистике
+TEST(UaAllocatorTest, PassthroughCounts) {
+    UaAllocator::installForThisThread(false);
+    void* p = UaAllocator::allocateZeroed(4, 16);
+    ASSERT_NE(p, nullptr);
+    EXPECT_EQ(static_cast<unsigned char*>(p)[63], 0);
+    UaAllocator::release(p);
+    auto stats = UaAllocator::threadStats();
+    EXPECT_EQ(stats.systemAllocs, 1u);
+    EXPECT_EQ(stats.systemFrees, 1u);
+    UaAllocator::uninstallForThisThread();
+}
+
+// Блок, выделенный кэшем, можно расширить через reallocate без потери данных
+TEST(UaAllocatorTest, ReallocatePreservesData) {
+    UaAllocator::installForThisThread(true);
+    char* p = static_cast<char*>(UaAllocator::allocate(10));
+    std::memcpy(p, "open62541", 10);
+    p = static_cast<char*>(UaAllocator::reallocate(p, 4000));
+    EXPECT_STREQ(p, "open62541");
+    UaAllocator::release(p);
+    UaAllocator::uninstallForThisThread();
+}
+
+// Кэш у каждого потока свой; поток, не снявший кэш, освобождает его при завершении
+TEST(UaAllocatorTest, CacheIsPerThread) {
+    UaAllocator::installForThisThread(true);
+    std::thread worker([] {
+        EXPECT_FALSE(UaAllocator::installedForThisThread());
+        UaAllocator::installForThisThread(true);
+        UaAllocator::release(UaAllocator::allocate(100));
+        EXPECT_GT(UaAllocator::threadStats().cachedBytes, 0u);
+    });
+    worker.join();
+    EXPECT_TRUE(UaAllocator::installedForThisThread());
+    EXPECT_EQ(UaAllocator::threadStats().requests, 0u);
+    UaAllocator::uninstallForThisThread();
+    EXPECT_FALSE(UaAllocator::installedForThisThread());
+}
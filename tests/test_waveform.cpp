@@ -0,0 +1,132 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include "../include/waveform.hpp"
+
+namespace {
+
+// Массив в DataValue без копирования: данные живут у вызывающего
+template <typename T>
+UA_DataValue arrayValue(std::vector<T>& data, int typeIndex, UA_DateTime source = 0) {
+    UA_DataValue dv;
+    UA_DataValue_init(&dv);
+    UA_Variant_setArray(&dv.value, data.data(), data.size(), &UA_TYPES[typeIndex]);
+    dv.hasValue = true;
+    if (source) {
+        dv.sourceTimestamp = source;
+        dv.hasSourceTimestamp = true;
+    }
+    return dv;
+}
+
+} // namespace
+
+// Векторный путь и хвост короче регистра дают то же, что поэлементное преобразование
+TEST(WaveformTest, ConvertsInt16AndFloat) {
+    for (size_t n : {1u, 7u, 8u, 17u, 4096u}) {
+        std::vector<int16_t> i16(n);
+        std::vector<float> f(n);
+        for (size_t i = 0; i < n; ++i) {
+            i16[i] = (int16_t)(i % 2 ? -32768 + (int)i : 32767 - (int)i);
+            f[i] = (float)i * -0.25f;
+        }
+        std::vector<double> out(n, -1);
+        convertSamples(i16.data(), n, out.data());
+        for (size_t i = 0; i < n; ++i) ASSERT_EQ(out[i], (double)i16[i]) << "n=" << n << " i=" << i;
+        convertSamples(f.data(), n, out.data());
+        for (size_t i = 0; i < n; ++i) ASSERT_EQ(out[i], (double)f[i]) << "n=" << n << " i=" << i;
+    }
+}
+
+TEST(WaveformTest, DetectsArraysAndComputesRms) {
+    UA_Variant scalar;
+    double x = 3.0;
+    UA_Variant_setScalar(&scalar, &x, &UA_TYPES[UA_TYPES_DOUBLE]);
+    EXPECT_EQ(waveformLength(scalar), 0u);
+
+    std::vector<uint16_t> u = {3, 4, 3, 4};
+    UA_DataValue dv = arrayValue(u, UA_TYPES_UINT16);
+    EXPECT_EQ(waveformLength(dv.value), 4u);
+    double rms = 0;
+    ASSERT_TRUE(waveformRms(dv.value, rms));
+    EXPECT_DOUBLE_EQ(rms, std::sqrt(12.5));
+
+    // Больше одной порции буфера
+    std::vector<int16_t> s(1000, -2);
+    dv = arrayValue(s, UA_TYPES_INT16);
+    ASSERT_TRUE(waveformRms(dv.value, rms));
+    EXPECT_DOUBLE_EQ(rms, 2.0);
+
+    std::vector<uint8_t> b(4, 1);
+    dv = arrayValue(b, UA_TYPES_BOOLEAN);
+    EXPECT_EQ(waveformLength(dv.value), 0u);
+    EXPECT_FALSE(waveformRms(dv.value, rms));
+}
+
+// Номер блока: без нового блока копия не повторяется
+TEST(WaveformTest, SinkKeepsLatestBlocks) {
+    WaveformSink sink(2);
+    OPCUAClient::TagData tag("Vib", "ns=2;i=7");
+    std::vector<double> out;
+    uint64_t seq = 0;
+    EXPECT_FALSE(sink.latest(0, "Vib", out, seq));
+
+    std::vector<float> a = {1, 2, 3};
+    std::vector<float> b = {4, 5};
+    std::vector<float> c = {6, 7, 8, 9};
+    sink.onValueChanged(0, tag, arrayValue(a, UA_TYPES_FLOAT));
+    ASSERT_TRUE(sink.latest(0, "Vib", out, seq));
+    EXPECT_EQ(out, (std::vector<double>{1, 2, 3}));
+    EXPECT_EQ(seq, 1u);
+    out.clear();
+    ASSERT_TRUE(sink.latest(0, "Vib", out, seq));
+    EXPECT_TRUE(out.empty());
+
+    sink.onValueChanged(0, tag, arrayValue(b, UA_TYPES_FLOAT));
+    sink.onValueChanged(0, tag, arrayValue(c, UA_TYPES_FLOAT));
+    ASSERT_TRUE(sink.latest(0, "Vib", out, seq));
+    EXPECT_EQ(out, (std::vector<double>{6, 7, 8, 9}));
+    EXPECT_EQ(seq, 3u);
+
+    // Окно по нескольким блокам; блок a уже вытеснен
+    uint64_t window_seq = 0;
+    ASSERT_TRUE(sink.recent(0, "Vib", 5, out, window_seq));
+    EXPECT_EQ(out, (std::vector<double>{5, 6, 7, 8, 9}));
+    window_seq = 0;
+    ASSERT_TRUE(sink.recent(0, "Vib", 100, out, window_seq));
+    EXPECT_EQ(out, (std::vector<double>{4, 5, 6, 7, 8, 9}));
+    EXPECT_GE(sink.memoryBytes(), 6 * sizeof(double));
+
+    // Скаляры не пишутся; другой тег в слоте начинает кольцо заново
+    OPCUAClient::TagData other("Other", "ns=2;i=8");
+    UA_DataValue scalar;
+    UA_DataValue_init(&scalar);
+    sink.onValueChanged(0, other, scalar);
+    EXPECT_TRUE(sink.latest(0, "Vib", out, seq));
+    sink.onValueChanged(0, other, arrayValue(a, UA_TYPES_FLOAT));
+    EXPECT_FALSE(sink.latest(0, "Vib", out, seq));
+    uint64_t other_seq = 0;
+    ASSERT_TRUE(sink.latest(0, "Other", out, other_seq));
+    EXPECT_EQ(out, (std::vector<double>{1, 2, 3}));
+}
+
+// В хранилище тег-массив получает СКЗ как значение и длину массива
+TEST(WaveformTest, ClientStoresRmsOfArray) {
+    OPCUAClient client;
+    std::vector<int16_t> samples = {-3, 3, -3, 3};
+    client.ingest(0, arrayValue(samples, UA_TYPES_INT16));
+    OPCUAClient::TagData tag("", "");
+    ASSERT_TRUE(client.getTag(0, tag));
+    EXPECT_DOUBLE_EQ(tag.value, 3.0);
+    EXPECT_EQ(tag.samples, 4u);
+    EXPECT_EQ(tag.quality, "GOOD");
+    uint64_t changes = tag.changes;
+
+    // Без метки источника тот же массив — новое чтение, с меткой — повтор
+    client.ingest(0, arrayValue(samples, UA_TYPES_INT16));
+    ASSERT_TRUE(client.getTag(0, tag));
+    EXPECT_EQ(tag.changes, changes + 1);
+    client.ingest(0, arrayValue(samples, UA_TYPES_INT16, 1000));
+    client.ingest(0, arrayValue(samples, UA_TYPES_INT16, 1000));
+    ASSERT_TRUE(client.getTag(0, tag));
+    EXPECT_EQ(tag.changes, changes + 2);
+}